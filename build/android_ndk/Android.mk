@@ -163,6 +163,7 @@ LOCAL_SRC_FILES += \
 	soundlib/MixFuncTable.cpp \
 	soundlib/ModChannel.cpp \
 	soundlib/modcommand.cpp \
+	soundlib/ModFingerprint.cpp \
 	soundlib/ModInstrument.cpp \
 	soundlib/ModSample.cpp \
 	soundlib/ModSequence.cpp \
@@ -171,11 +172,14 @@ LOCAL_SRC_FILES += \
 	soundlib/MPEGFrame.cpp \
 	soundlib/OggStream.cpp \
 	soundlib/OPL.cpp \
+	soundlib/ParallelSampleReader.cpp \
 	soundlib/Paula.cpp \
 	soundlib/patternContainer.cpp \
 	soundlib/pattern.cpp \
 	soundlib/RowVisitor.cpp \
 	soundlib/S3MTools.cpp \
+	soundlib/SampleCache.cpp \
+	soundlib/SampleCopyLoops.cpp \
 	soundlib/SampleFormats.cpp \
 	soundlib/SampleFormatBRR.cpp \
 	soundlib/SampleFormatFLAC.cpp \
@@ -185,6 +189,8 @@ LOCAL_SRC_FILES += \
 	soundlib/SampleFormatSFZ.cpp \
 	soundlib/SampleFormatVorbis.cpp \
 	soundlib/SampleIO.cpp \
+	soundlib/SampleStore.cpp \
+	soundlib/SampleStream.cpp \
 	soundlib/Sndfile.cpp \
 	soundlib/Snd_flt.cpp \
 	soundlib/Snd_fx.cpp \
@@ -219,8 +225,10 @@ LOCAL_SRC_FILES += \
 	sounddsp/AGC.cpp \
 	sounddsp/DSP.cpp \
 	sounddsp/EQ.cpp \
+	sounddsp/Loudness.cpp \
 	sounddsp/Reverb.cpp \
 	test/TestToolsLib.cpp \
+	test/benchmark.cpp \
 	test/test.cpp
 
 include $(BUILD_SHARED_LIBRARY)
@@ -399,7 +399,7 @@ constexpr int countl_zero(T x) noexcept
 	int count = 0;
 	for(int bit = std::numeric_limits<T>::digits - 1; bit >= 0; --bit)
 	{
-		if((x & (1u<<bit)) == 0u)
+		if((x & (static_cast<T>(1) << bit)) == 0u)
 		{
 			count++;
 		} else
@@ -418,7 +418,7 @@ constexpr int countl_one(T x) noexcept
 	int count = 0;
 	for(int bit = std::numeric_limits<T>::digits - 1; bit >= 0; --bit)
 	{
-		if((x & (1u<<bit)) != 0u)
+		if((x & (static_cast<T>(1) << bit)) != 0u)
 		{
 			count++;
 		} else
@@ -437,7 +437,7 @@ constexpr int countr_zero(T x) noexcept
 	int count = 0;
 	for(int bit = 0; bit < std::numeric_limits<T>::digits; ++bit)
 	{
-		if((x & (1u<<bit)) == 0u)
+		if((x & (static_cast<T>(1) << bit)) == 0u)
 		{
 			count++;
 		} else
@@ -456,7 +456,7 @@ constexpr int countr_one(T x) noexcept
 	int count = 0;
 	for(int bit = 0; bit < std::numeric_limits<T>::digits; ++bit)
 	{
-		if((x & (1u<<bit)) != 0u)
+		if((x & (static_cast<T>(1) << bit)) != 0u)
 		{
 			count++;
 		} else
@@ -232,6 +232,16 @@ extern void stb_vorbis_flush_pushdata(stb_vorbis *f);
 // call stb_vorbis_flush_pushdata(), then start calling decoding, then once
 // decoding is returning you data, call stb_vorbis_get_sample_offset, and
 // if you don't like the result, seek your file again and repeat.
+
+extern stb_vorbis *stb_vorbis_copy_pushdata_state(const stb_vorbis *f, float ***output); // OpenMPT
+extern void stb_vorbis_close_pushdata_state(stb_vorbis *f); // OpenMPT
+// OpenMPT: create an independent copy of the decoding state of f, so that decoding
+// can later continue from the current position without resynchronizing. The copy
+// shares all setup data (codebooks, floors, windows, ...) with f, so f must not be
+// closed before the copy. If output is not NULL, it receives the copy's equivalent of
+// the output buffers last returned by stb_vorbis_decode_frame_pushdata for f.
+// Returns NULL if out of memory or if f uses an alloc buffer.
+// Copies must be freed with stb_vorbis_close_pushdata_state, not stb_vorbis_close.
 #endif
 
 
@@ -4333,6 +4343,67 @@ static stb_vorbis * vorbis_alloc(stb_vorbis *f)
 
 #ifndef STB_VORBIS_NO_PUSHDATA_API
 
+void stb_vorbis_close_pushdata_state(stb_vorbis *f) // OpenMPT
+{ // OpenMPT
+   int i; // OpenMPT
+   if (f == NULL) return; // OpenMPT
+   for (i=0; i < f->channels; ++i) { // OpenMPT
+      free(f->channel_buffers[i]); // OpenMPT
+      free(f->previous_window[i]); // OpenMPT
+      #ifndef STB_VORBIS_NO_DEFER_FLOOR // OpenMPT
+      free(f->finalY[i]); // OpenMPT
+      #else // OpenMPT
+      free(f->floor_buffers[i]); // OpenMPT
+      #endif // OpenMPT
+   } // OpenMPT
+   free(f); // OpenMPT
+} // OpenMPT
+
+stb_vorbis *stb_vorbis_copy_pushdata_state(const stb_vorbis *f, float ***output) // OpenMPT
+{ // OpenMPT
+   // only the buffers allocated at the end of start_decoder are modified while decoding // OpenMPT
+   int i, longest_floorlist = 0; // OpenMPT
+   stb_vorbis *p; // OpenMPT
+   if (f->alloc.alloc_buffer) return NULL; // OpenMPT
+   for (i=0; i < f->floor_count; ++i) // OpenMPT
+      if (f->floor_types[i] == 1 && f->floor_config[i].floor1.values > longest_floorlist) // OpenMPT
+         longest_floorlist = f->floor_config[i].floor1.values; // OpenMPT
+   p = (stb_vorbis *) malloc(sizeof(*p)); // OpenMPT
+   if (p == NULL) return NULL; // OpenMPT
+   memcpy(p, f, sizeof(*p)); // OpenMPT
+   for (i=0; i < f->channels; ++i) { // OpenMPT
+      p->channel_buffers[i] = NULL; // OpenMPT
+      p->previous_window[i] = NULL; // OpenMPT
+      #ifndef STB_VORBIS_NO_DEFER_FLOOR // OpenMPT
+      p->finalY[i] = NULL; // OpenMPT
+      #else // OpenMPT
+      p->floor_buffers[i] = NULL; // OpenMPT
+      #endif // OpenMPT
+   } // OpenMPT
+   for (i=0; i < f->channels; ++i) { // OpenMPT
+      p->channel_buffers[i] = (float *) malloc(sizeof(float) * f->blocksize_1); // OpenMPT
+      p->previous_window[i] = (float *) malloc(sizeof(float) * f->blocksize_1/2); // OpenMPT
+      #ifndef STB_VORBIS_NO_DEFER_FLOOR // OpenMPT
+      p->finalY[i] = (int16 *) malloc(sizeof(int16) * (longest_floorlist ? longest_floorlist : 1)); // OpenMPT
+      if (p->finalY[i] == NULL) break; // OpenMPT
+      #else // OpenMPT
+      p->floor_buffers[i] = (float *) malloc(sizeof(float) * f->blocksize_1/2); // OpenMPT
+      if (p->floor_buffers[i] == NULL) break; // OpenMPT
+      #endif // OpenMPT
+      if (p->channel_buffers[i] == NULL || p->previous_window[i] == NULL) break; // OpenMPT
+      memcpy(p->channel_buffers[i], f->channel_buffers[i], sizeof(float) * f->blocksize_1); // OpenMPT
+      memcpy(p->previous_window[i], f->previous_window[i], sizeof(float) * f->blocksize_1/2); // OpenMPT
+      if (f->outputs[i]) // OpenMPT
+         p->outputs[i] = p->channel_buffers[i] + (f->outputs[i] - f->channel_buffers[i]); // OpenMPT
+   } // OpenMPT
+   if (i < f->channels) { // OpenMPT
+      stb_vorbis_close_pushdata_state(p); // OpenMPT
+      return NULL; // OpenMPT
+   } // OpenMPT
+   if (output) *output = p->outputs; // OpenMPT
+   return p; // OpenMPT
+} // OpenMPT
+
 void stb_vorbis_flush_pushdata(stb_vorbis *f)
 {
    f->previous_length = 0;
@@ -1136,6 +1136,8 @@ LIBOPENMPT_API const char * openmpt_module_get_metadata_keys( openmpt_module * m
  *          - message: Song message. If the song message is empty or the module format does not support song messages, a list of instrument and sample names is returned instead.
  *          - message_raw: Song message. If the song message is empty or the module format does not support song messages, an empty string is returned.
  *          - warnings: A list of warnings that were generated while loading the module.
+ *          - fingerprint: Hash of the pattern data, order lists and sample data as 16 hexadecimal digits. Names, messages and format-specific padding do not affect it, so it can be used to find duplicate modules without rendering them.
+ *          - fingerprint_fuzzy: Like fingerprint, but only covers the notes in playback order of the first sequence, the number of rows between them and a coarse representation of the sample data, so that it stays the same after converting the module to another format (e.g. MOD to XM).
  * \return The associated value for key.
  * \sa openmpt_module_get_metadata_keys
  */
@@ -1409,6 +1411,10 @@ LIBOPENMPT_API const char * openmpt_module_highlight_pattern_row_channel( openmp
  *          - load.skip_patterns (boolean): Set to "1" to avoid loading patterns into memory
  *          - load.skip_plugins (boolean): Set to "1" to avoid loading plugins
  *          - load.skip_subsongs_init (boolean): Set to "1" to avoid pre-initializing sub-songs. Skipping results in faster module loading but slower seeking.
+ *          - load.sample_cache_size (integer): Maximum amount of memory in bytes used for caching decoded compressed samples (IT, MO3) between modules loaded from identical files. Unlike all other ctls, this is not a per-module setting: The cache is shared by the whole process, so setting this ctl on any module changes the limit for all modules, the limit stays in effect after the module has been destroyed, and reading it returns the current process-wide value, which may have been set through another module. Applications that use several modules at once should set it only once. "0" disables the cache. The default is "0".
+ *          - load.threads (integer): Number of threads used for decoding compressed samples (IT, MO3) while loading. "0" uses one thread per CPU core. Only has an effect if passed to openmpt_module_create2 or openmpt_module_create_from_memory2. The default is "1".
+ *          - load.sample_stream_threshold (integer): Compressed samples (OggVorbis samples in XM files, IT-compressed samples in IT and MPTM files) whose decoded size in bytes exceeds this value are decoded during playback instead of while loading, which reduces memory usage for very long samples. "0" always decodes samples while loading. Only has an effect if passed to openmpt_module_create2 or openmpt_module_create_from_memory2. The default is "0".
+ *          - load.share_samples (boolean): Set to "1" to share the memory of identical sample data with other sample slots of this module and with other modules that are loaded with this ctl enabled. Looped samples of MOD files that use the invert loop effect (EFx), which modifies sample data during playback, are not shared. Only has an effect if passed to openmpt_module_create2 or openmpt_module_create_from_memory2. The default is "0".
  *          - seek.sync_samples (boolean): Set to "1" to sync sample playback when using openmpt_module_set_position_seconds or openmpt_module_set_position_order_row.
  *          - subsong (integer): The current subsong. Setting it has identical semantics as openmpt_module_select_subsong(), getting it returns the currently selected subsong.
  *          - play.at_end (text): Chooses the behaviour when the end of song is reached:
@@ -1417,6 +1423,7 @@ LIBOPENMPT_API const char * openmpt_module_highlight_pattern_row_channel( openmp
  *                         - "stop": Returns 0 rendered frames when the song end is reached. Subsequent reads will return 0 rendered frames.
  *          - play.tempo_factor (floatingpoint): Set a floating point tempo factor. "1.0" is the default tempo.
  *          - play.pitch_factor (floatingpoint): Set a floating point pitch factor. "1.0" is the default pitch.
+ *          - play.state_hash (integer): Read-only. Non-negative hash of the complete playback and mixer state, or -1 if the state cannot be hashed (e.g. because DSP effects, plugins, OPL or streamed samples are used, or render.cpu_budget is set). If two instances of the same module with the same settings report the same hash, they render identical audio from here on, except for random effects and dither. The value is only comparable within the same process.
  *          - render.resampler.emulate_amiga (boolean): Set to "1" to enable the Amiga resampler for Amiga modules. This emulates the sound characteristics of the Paula chip and overrides the selected interpolation filter. Non-Amiga module formats are not affected by this setting.
  *          - render.resampler.emulate_amiga_type (string): Configures the filter type to use for the Amiga resampler. Supported values are:
  *                    - "auto": Filter type is chosen by the library and might change. This is the default.
@@ -1424,6 +1431,18 @@ LIBOPENMPT_API const char * openmpt_module_highlight_pattern_row_channel( openmp
  *                    - "a1200": Amiga A1200 filter.
  *                    - "unfiltered": BLEP synthesis without model-specific filters. The LED filter is ignored by this setting. This filter mode is considered to be experimental and might change in the future.
  *          - render.opl.volume_factor (floatingpoint): Set volume factor applied to synthesized OPL sounds, relative to the default OPL volume.
+ *          - render.preview (boolean): Set to 1 to render at low cost, e.g. for previews or waveform overviews: All voices are mixed with at most linear interpolation, and reverb, plugins and DSP effects are bypassed. Combine with a low sample rate and mono output for best speed. Default is 0.
+ *          - render.cpu_budget (floatingpoint): Set the maximum fraction of real time that may be spent rendering, e.g. 0.5 means that rendering one second of audio may take at most half a second. If rendering takes longer, the least important voices are first mixed with linear interpolation and then not mixed at all, until rendering is within budget again. Pattern channels take precedence over NNA voices, which are ordered by volume and age. 0.0 (the default) disables the budget.
+ *          - render.cpu_budget.downgrade_resampling (boolean): Set to 0 to stop mixing voices that exceed render.cpu_budget right away instead of reducing their resampling quality first. Default is 1.
+ *          - render.cpu_budget.min_voices (integer): Set the number of voices that are always mixed even if render.cpu_budget is exceeded. Default is 16.
+ *          - analysis.loudness (boolean): Set to 1 to measure the loudness of the rendered audio according to EBU R128 while rendering. Setting it to 1 discards all previous measurements. Default is 0.
+ *          - analysis.loudness.integrated (floatingpoint): Read-only. Integrated loudness in LUFS of everything rendered since analysis.loudness was enabled, or -infinity if nothing has been measured yet.
+ *          - analysis.loudness.range (floatingpoint): Read-only. Loudness range in LU of everything rendered since analysis.loudness was enabled.
+ *          - analysis.loudness.true_peak (floatingpoint): Read-only. Maximum true peak in dBTP of everything rendered since analysis.loudness was enabled, or -infinity if nothing has been measured yet.
+ *          - memory.sample_data (integer): Read-only. Amount of memory in bytes used by the sample data of this module. Sample data shared with other modules is counted in full.
+ *          - memory.sample_data.shared (integer): Read-only. Amount of memory in bytes used by the sample data of this module that is shared with other sample slots or modules (see load.share_samples).
+ *          - memory.sample_store.size (integer): Read-only. Process-wide amount of memory in bytes used by sample data of all modules loaded with load.share_samples enabled.
+ *          - memory.sample_store.saved (integer): Read-only. Process-wide amount of memory in bytes saved by sharing identical sample data between all modules loaded with load.share_samples enabled.
  *          - dither (integer): Set the dither algorithm that is used for the 16 bit versions of openmpt_module_read. Supported values are:
  *                    - 0: No dithering.
  *                    - 1: Default mode. Chosen by OpenMPT code, might change.
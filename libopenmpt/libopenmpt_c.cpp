@@ -1721,6 +1721,137 @@ static int stop_note( openmpt_module_ext * mod_ext, int32_t channel ) {
 	return 0;
 }
 
+static int64_t queue_get_render_position( openmpt_module_ext * mod_ext ) {
+	try {
+		openmpt::interface::check_soundfile( mod_ext );
+		return mod_ext->impl->get_render_position();
+	} catch ( ... ) {
+		openmpt::report_exception( __func__, mod_ext ? &mod_ext->mod : NULL );
+	}
+	return 0;
+}
+static int queue_set_current_speed( openmpt_module_ext * mod_ext, int32_t speed, int64_t frame ) {
+	try {
+		openmpt::interface::check_soundfile( mod_ext );
+		return mod_ext->impl->set_current_speed( speed, frame ) ? 1 : 0;
+	} catch ( ... ) {
+		openmpt::report_exception( __func__, mod_ext ? &mod_ext->mod : NULL );
+	}
+	return 0;
+}
+static int queue_set_current_tempo( openmpt_module_ext * mod_ext, int32_t tempo, int64_t frame ) {
+	try {
+		openmpt::interface::check_soundfile( mod_ext );
+		return mod_ext->impl->set_current_tempo( tempo, frame ) ? 1 : 0;
+	} catch ( ... ) {
+		openmpt::report_exception( __func__, mod_ext ? &mod_ext->mod : NULL );
+	}
+	return 0;
+}
+static int queue_set_tempo_factor( openmpt_module_ext * mod_ext, double factor, int64_t frame ) {
+	try {
+		openmpt::interface::check_soundfile( mod_ext );
+		return mod_ext->impl->set_tempo_factor( factor, frame ) ? 1 : 0;
+	} catch ( ... ) {
+		openmpt::report_exception( __func__, mod_ext ? &mod_ext->mod : NULL );
+	}
+	return 0;
+}
+static int queue_set_pitch_factor( openmpt_module_ext * mod_ext, double factor, int64_t frame ) {
+	try {
+		openmpt::interface::check_soundfile( mod_ext );
+		return mod_ext->impl->set_pitch_factor( factor, frame ) ? 1 : 0;
+	} catch ( ... ) {
+		openmpt::report_exception( __func__, mod_ext ? &mod_ext->mod : NULL );
+	}
+	return 0;
+}
+static int queue_set_global_volume( openmpt_module_ext * mod_ext, double volume, int64_t frame ) {
+	try {
+		openmpt::interface::check_soundfile( mod_ext );
+		return mod_ext->impl->set_global_volume( volume, frame ) ? 1 : 0;
+	} catch ( ... ) {
+		openmpt::report_exception( __func__, mod_ext ? &mod_ext->mod : NULL );
+	}
+	return 0;
+}
+static int queue_set_channel_volume( openmpt_module_ext * mod_ext, int32_t channel, double volume, int64_t frame ) {
+	try {
+		openmpt::interface::check_soundfile( mod_ext );
+		return mod_ext->impl->set_channel_volume( channel, volume, frame ) ? 1 : 0;
+	} catch ( ... ) {
+		openmpt::report_exception( __func__, mod_ext ? &mod_ext->mod : NULL );
+	}
+	return 0;
+}
+static int queue_set_channel_mute_status( openmpt_module_ext * mod_ext, int32_t channel, int mute, int64_t frame ) {
+	try {
+		openmpt::interface::check_soundfile( mod_ext );
+		return mod_ext->impl->set_channel_mute_status( channel, mute ? true : false, frame ) ? 1 : 0;
+	} catch ( ... ) {
+		openmpt::report_exception( __func__, mod_ext ? &mod_ext->mod : NULL );
+	}
+	return 0;
+}
+static int queue_set_instrument_mute_status( openmpt_module_ext * mod_ext, int32_t instrument, int mute, int64_t frame ) {
+	try {
+		openmpt::interface::check_soundfile( mod_ext );
+		return mod_ext->impl->set_instrument_mute_status( instrument, mute ? true : false, frame ) ? 1 : 0;
+	} catch ( ... ) {
+		openmpt::report_exception( __func__, mod_ext ? &mod_ext->mod : NULL );
+	}
+	return 0;
+}
+static int64_t queue_play_note( openmpt_module_ext * mod_ext, int32_t instrument, int32_t note, double volume, double panning, int64_t frame ) {
+	try {
+		openmpt::interface::check_soundfile( mod_ext );
+		return mod_ext->impl->play_note( instrument, note, volume, panning, frame );
+	} catch ( ... ) {
+		openmpt::report_exception( __func__, mod_ext ? &mod_ext->mod : NULL );
+	}
+	return -1;
+}
+static int queue_stop_note( openmpt_module_ext * mod_ext, int64_t voice, int64_t frame ) {
+	try {
+		openmpt::interface::check_soundfile( mod_ext );
+		return mod_ext->impl->stop_note( voice, frame ) ? 1 : 0;
+	} catch ( ... ) {
+		openmpt::report_exception( __func__, mod_ext ? &mod_ext->mod : NULL );
+	}
+	return 0;
+}
+
+static int32_t stems_get_num_stems( openmpt_module_ext * mod_ext, int32_t layout ) {
+	try {
+		openmpt::interface::check_soundfile( mod_ext );
+		return mod_ext->impl->get_num_stems( static_cast<openmpt::ext::stems::stem_layout>( layout ) );
+	} catch ( ... ) {
+		openmpt::report_exception( __func__, mod_ext ? &mod_ext->mod : NULL );
+	}
+	return -1;
+}
+static size_t stems_read_stems( openmpt_module_ext * mod_ext, int32_t samplerate, size_t count, int32_t layout, float * const * buffers ) {
+	try {
+		openmpt::interface::check_soundfile( mod_ext );
+		openmpt::interface::check_pointer( buffers );
+		return mod_ext->impl->read_stems( samplerate, count, static_cast<openmpt::ext::stems::stem_layout>( layout ), buffers );
+	} catch ( ... ) {
+		openmpt::report_exception( __func__, mod_ext ? &mod_ext->mod : NULL );
+	}
+	return 0;
+}
+static size_t preview_read_peaks( openmpt_module_ext * mod_ext, int32_t samplerate, size_t frames_per_peak, size_t count, float * min_peaks, float * max_peaks ) {
+	try {
+		openmpt::interface::check_soundfile( mod_ext );
+		openmpt::interface::check_pointer( min_peaks );
+		openmpt::interface::check_pointer( max_peaks );
+		return mod_ext->impl->read_peaks( samplerate, frames_per_peak, count, min_peaks, max_peaks );
+	} catch ( ... ) {
+		openmpt::report_exception( __func__, mod_ext ? &mod_ext->mod : NULL );
+	}
+	return 0;
+}
+
 
 
 /* add stuff here */
@@ -1769,6 +1900,38 @@ int openmpt_module_ext_get_interface( openmpt_module_ext * mod_ext, const char *
 
 
 
+		} else if ( !std::strcmp( interface_id, LIBOPENMPT_EXT_C_INTERFACE_INTERACTIVE_QUEUE ) && ( interface_size == sizeof( openmpt_module_ext_interface_interactive_queue ) ) ) {
+			openmpt_module_ext_interface_interactive_queue * i = static_cast< openmpt_module_ext_interface_interactive_queue * >( interface );
+			i->get_render_position = &queue_get_render_position;
+			i->set_current_speed = &queue_set_current_speed;
+			i->set_current_tempo = &queue_set_current_tempo;
+			i->set_tempo_factor = &queue_set_tempo_factor;
+			i->set_pitch_factor = &queue_set_pitch_factor;
+			i->set_global_volume = &queue_set_global_volume;
+			i->set_channel_volume = &queue_set_channel_volume;
+			i->set_channel_mute_status = &queue_set_channel_mute_status;
+			i->set_instrument_mute_status = &queue_set_instrument_mute_status;
+			i->play_note = &queue_play_note;
+			i->stop_note = &queue_stop_note;
+			result = 1;
+
+
+
+		} else if ( !std::strcmp( interface_id, LIBOPENMPT_EXT_C_INTERFACE_STEMS ) && ( interface_size == sizeof( openmpt_module_ext_interface_stems ) ) ) {
+			openmpt_module_ext_interface_stems * i = static_cast< openmpt_module_ext_interface_stems * >( interface );
+			i->get_num_stems = &stems_get_num_stems;
+			i->read_stems = &stems_read_stems;
+			result = 1;
+
+
+
+		} else if ( !std::strcmp( interface_id, LIBOPENMPT_EXT_C_INTERFACE_PREVIEW ) && ( interface_size == sizeof( openmpt_module_ext_interface_preview ) ) ) {
+			openmpt_module_ext_interface_preview * i = static_cast< openmpt_module_ext_interface_preview * >( interface );
+			i->read_peaks = &preview_read_peaks;
+			result = 1;
+
+
+
 /* add stuff here */
 
 
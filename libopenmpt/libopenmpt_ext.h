@@ -302,6 +302,204 @@ typedef struct openmpt_module_ext_interface_interactive {
 
 
 
+#ifndef LIBOPENMPT_EXT_C_INTERFACE_INTERACTIVE_QUEUE
+#define LIBOPENMPT_EXT_C_INTERFACE_INTERACTIVE_QUEUE "interactive_queue"
+#endif
+
+/*! \brief Thread-safe variant of openmpt_module_ext_interface_interactive
+ *
+ * The functions of this interface can be called from any number of threads concurrently, also while another thread is rendering audio.
+ * They do not modify the playback state themselves, but put a command into a fixed-size lock-free queue and return immediately.
+ * The queued commands are applied by the thread calling openmpt_module_read_* between two rendered frames, without ever waiting for the queueing threads.
+ *
+ * Every command carries a timestamp in frames, relative to the render position as returned by openmpt_module_ext_interface_interactive_queue::get_render_position.
+ * Commands with a timestamp that is not in the future (e.g. 0) are applied before the next frame is rendered.
+ * Commands with a timestamp in the future are applied exactly before the frame with that render position is rendered.
+ * Commands with equal timestamps that have been queued by the same thread are applied in the order in which they have been queued.
+ */
+typedef struct openmpt_module_ext_interface_interactive_queue {
+	/*! Get the render position
+	 *
+	 * \param mod_ext The module handle to work on.
+	 * \return The number of frames that have been rendered since the module has been loaded. Seeking or changing the subsong does not reset the render position.
+	 */
+	int64_t ( * get_render_position ) ( openmpt_module_ext * mod_ext );
+
+	/*! Queue setting the current ticks per row (speed)
+	 *
+	 * \param mod_ext The module handle to work on.
+	 * \param speed The new tick count in range [1, 65535].
+	 * \param frame The render position at which the command is applied.
+	 * \return 1 if the command has been queued, 0 on failure (invalid argument or queue full).
+	 * \sa openmpt_module_ext_interface_interactive::set_current_speed
+	 */
+	int ( * set_current_speed ) ( openmpt_module_ext * mod_ext, int32_t speed, int64_t frame );
+
+	/*! Queue setting the current module tempo
+	 *
+	 * \param mod_ext The module handle to work on.
+	 * \param tempo The new tempo in range [32, 512]. The exact meaning of the value depends on the tempo mode used by the module.
+	 * \param frame The render position at which the command is applied.
+	 * \return 1 if the command has been queued, 0 on failure (invalid argument or queue full).
+	 * \sa openmpt_module_ext_interface_interactive::set_current_tempo
+	 */
+	int ( * set_current_tempo ) ( openmpt_module_ext * mod_ext, int32_t tempo, int64_t frame );
+
+	/*! Queue setting the current module tempo factor without affecting playback pitch
+	 *
+	 * \param mod_ext The module handle to work on.
+	 * \param factor The new tempo factor in range ]0.0, 4.0] - 1.0 means unmodified tempo.
+	 * \param frame The render position at which the command is applied.
+	 * \return 1 if the command has been queued, 0 on failure (invalid argument or queue full).
+	 * \sa openmpt_module_ext_interface_interactive::set_tempo_factor
+	 */
+	int ( * set_tempo_factor ) ( openmpt_module_ext * mod_ext, double factor, int64_t frame );
+
+	/*! Queue setting the current module pitch factor without affecting playback speed
+	 *
+	 * \param mod_ext The module handle to work on.
+	 * \param factor The new pitch factor in range ]0.0, 4.0] - 1.0 means unmodified pitch.
+	 * \param frame The render position at which the command is applied.
+	 * \return 1 if the command has been queued, 0 on failure (invalid argument or queue full).
+	 * \sa openmpt_module_ext_interface_interactive::set_pitch_factor
+	 */
+	int ( * set_pitch_factor ) ( openmpt_module_ext * mod_ext, double factor, int64_t frame );
+
+	/*! Queue setting the current global volume
+	 *
+	 * \param mod_ext The module handle to work on.
+	 * \param volume The new global volume in range [0.0, 1.0]
+	 * \param frame The render position at which the command is applied.
+	 * \return 1 if the command has been queued, 0 on failure (invalid argument or queue full).
+	 * \sa openmpt_module_ext_interface_interactive::set_global_volume
+	 */
+	int ( * set_global_volume ) ( openmpt_module_ext * mod_ext, double volume, int64_t frame );
+
+	/*! Queue setting the current channel volume for a channel
+	 *
+	 * \param mod_ext The module handle to work on.
+	 * \param channel The channel whose volume should be set, in range [0, openmpt_module_get_num_channels()[
+	 * \param volume The new channel volume in range [0.0, 1.0]
+	 * \param frame The render position at which the command is applied.
+	 * \return 1 if the command has been queued, 0 on failure (invalid argument or queue full).
+	 * \sa openmpt_module_ext_interface_interactive::set_channel_volume
+	 */
+	int ( * set_channel_volume ) ( openmpt_module_ext * mod_ext, int32_t channel, double volume, int64_t frame );
+
+	/*! Queue setting the current mute status for a channel
+	 *
+	 * \param mod_ext The module handle to work on.
+	 * \param channel The channel whose mute status should be set, in range [0, openmpt_module_get_num_channels()[
+	 * \param mute The new mute status. true is muted, false is unmuted.
+	 * \param frame The render position at which the command is applied.
+	 * \return 1 if the command has been queued, 0 on failure (invalid argument or queue full).
+	 * \sa openmpt_module_ext_interface_interactive::set_channel_mute_status
+	 */
+	int ( * set_channel_mute_status ) ( openmpt_module_ext * mod_ext, int32_t channel, int mute, int64_t frame );
+
+	/*! Queue setting the current mute status for an instrument
+	 *
+	 * \param mod_ext The module handle to work on.
+	 * \param instrument The instrument whose mute status should be set, in range [0, openmpt_module_get_num_instruments()[ if openmpt_module_get_num_instruments is not 0, otherwise in [0, openmpt_module_get_num_samples()[
+	 * \param mute The new mute status. true is muted, false is unmuted.
+	 * \param frame The render position at which the command is applied.
+	 * \return 1 if the command has been queued, 0 on failure (invalid argument or queue full).
+	 * \sa openmpt_module_ext_interface_interactive::set_instrument_mute_status
+	 */
+	int ( * set_instrument_mute_status ) ( openmpt_module_ext * mod_ext, int32_t instrument, int mute, int64_t frame );
+
+	/*! Queue playing a note using the specified instrument
+	 *
+	 * \param mod_ext The module handle to work on.
+	 * \param instrument The instrument that should be played, in range [0, openmpt_module_get_num_instruments()[ if openmpt_module_get_num_instruments is not 0, otherwise in [0, openmpt_module_get_num_samples()[
+	 * \param note The note to play, in rage [0, 119]. 60 is the middle C.
+	 * \param volume The volume at which the note should be triggered, in range [0.0, 1.0]
+	 * \param panning The panning position at which the note should be triggered, in range [-1.0, 1.0], 0.0 is center.
+	 * \param frame The render position at which the command is applied.
+	 * \return A voice handle that can be passed to openmpt_module_ext_interface_interactive_queue::stop_note to stop the note. -1 means that the command could not be queued (invalid argument or queue full).
+	 * \sa openmpt_module_ext_interface_interactive::play_note
+	 */
+	int64_t ( * play_note ) ( openmpt_module_ext * mod_ext, int32_t instrument, int32_t note, double volume, double panning, int64_t frame );
+
+	/*! Queue stopping a note
+	 *
+	 * \param mod_ext The module handle to work on.
+	 * \param voice The voice handle returned by a previous openmpt_module_ext_interface_interactive_queue::play_note call.
+	 * \param frame The render position at which the command is applied.
+	 * \return 1 if the command has been queued, 0 on failure (invalid voice handle or queue full).
+	 * \remarks If the note has already stopped playing and its channel has been reused for another note, the command is ignored.
+	 * \sa openmpt_module_ext_interface_interactive_queue::play_note
+	 */
+	int ( * stop_note ) ( openmpt_module_ext * mod_ext, int64_t voice, int64_t frame );
+} openmpt_module_ext_interface_interactive_queue;
+
+
+
+#ifndef LIBOPENMPT_EXT_C_INTERFACE_STEMS
+#define LIBOPENMPT_EXT_C_INTERFACE_STEMS "stems"
+#endif
+
+/*! Stem layout */
+#define OPENMPT_MODULE_EXT_INTERFACE_STEMS_LAYOUT_CHANNELS    0
+#define OPENMPT_MODULE_EXT_INTERFACE_STEMS_LAYOUT_INSTRUMENTS 1
+
+/*! \brief Render separate outputs (stems) per pattern channel or per instrument
+ *
+ * Rendering stems with this interface takes a single rendering pass, no matter how many stems there are.
+ * Every voice is mixed into the stem of its pattern channel or instrument instead of the regular mix. New Note Action voices belong to the stem of the pattern channel they have been started from.
+ * Global volume, stereo separation and the master gain are applied to each stem.
+ * Voices that are routed to a plugin, OPL (AdLib) voices and all master effects (e.g. plugins, reverb, equalizer) are not part of any stem.
+ */
+typedef struct openmpt_module_ext_interface_stems {
+	/*! Get the number of stems
+	 *
+	 * \param mod_ext The module handle to work on.
+	 * \param layout The stem layout (see OPENMPT_MODULE_EXT_INTERFACE_STEMS_LAYOUT_*)
+	 * \return The number of stems rendered by openmpt_module_ext_interface_stems::read_stems with the given layout, or -1 if the layout is invalid.
+	 */
+	int32_t ( * get_num_stems ) ( openmpt_module_ext * mod_ext, int32_t layout );
+
+	/*! Render audio data into one buffer per stem
+	 *
+	 * \param mod_ext The module handle to work on.
+	 * \param samplerate Sample rate to render output. Should be in [8000,192000], but this is not enforced.
+	 * \param count Number of audio frames to render per stem. The buffers must be at least this large.
+	 * \param layout The stem layout (see OPENMPT_MODULE_EXT_INTERFACE_STEMS_LAYOUT_*)
+	 * \param buffers Array of openmpt_module_ext_interface_stems::get_num_stems pointers to interleaved stereo output buffers for 2 * count samples each. Null pointers are allowed for stems that should not be output, they are still rendered.
+	 * \return The number of frames actually rendered per stem, or 0 if the end of song has been reached or an error occurred.
+	 * \remarks The output is floating point in the range [-1.0,1.0], like openmpt_module_read_interleaved_float_stereo. Samples are not clipped.
+	 */
+	size_t ( * read_stems ) ( openmpt_module_ext * mod_ext, int32_t samplerate, size_t count, int32_t layout, float * const * buffers );
+} openmpt_module_ext_interface_stems;
+
+
+
+#ifndef LIBOPENMPT_EXT_C_INTERFACE_PREVIEW
+#define LIBOPENMPT_EXT_C_INTERFACE_PREVIEW "preview"
+#endif
+
+/*! \brief Low-cost rendering of previews and waveform overviews
+ *
+ * Set the ctl render.preview to 1 to render at reduced quality, see openmpt_module_ctl_set_boolean.
+ */
+typedef struct openmpt_module_ext_interface_preview {
+	/*! Render audio data and only output its peak values
+	 *
+	 * The module is rendered in mono. For every block of frames_per_peak frames, only the minimum and maximum sample value are output.
+	 * \param mod_ext The module handle to work on.
+	 * \param samplerate Sample rate to render output. Should be in [8000,192000], but this is not enforced.
+	 * \param frames_per_peak Number of audio frames that are reduced to one pair of peak values.
+	 * \param count Number of peak values to render. Up to count * frames_per_peak audio frames are rendered. min_peaks and max_peaks must be at least this large.
+	 * \param min_peaks Buffer for the minimum sample value of each block.
+	 * \param max_peaks Buffer for the maximum sample value of each block.
+	 * \return The number of peak values actually rendered, or 0 if the end of song has been reached or an error occurred. If the end of song is reached, the last block may be shorter than frames_per_peak.
+	 * \remarks The peak values are floating point in the range [-1.0,1.0], like openmpt_module_read_float_mono. Samples are not clipped.
+	 */
+	size_t ( * read_peaks ) ( openmpt_module_ext * mod_ext, int32_t samplerate, size_t frames_per_peak, size_t count, float * min_peaks, float * max_peaks );
+} openmpt_module_ext_interface_preview;
+
+
+
 /* add stuff here */
 
 
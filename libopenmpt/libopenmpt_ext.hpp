@@ -293,6 +293,234 @@ class interactive {
 }; // class interactive
 
 
+#ifndef LIBOPENMPT_EXT_INTERFACE_INTERACTIVE_QUEUE
+#define LIBOPENMPT_EXT_INTERFACE_INTERACTIVE_QUEUE
+#endif
+
+LIBOPENMPT_DECLARE_EXT_CXX_INTERFACE(interactive_queue)
+
+//! Thread-safe variant of openmpt::ext::interactive
+/*!
+  openmpt::ext::interactive modifies the playback state directly and thus must not be used while another thread is rendering audio.
+  The functions of this interface can be called from any number of threads concurrently, also while another thread calls openmpt::module::read.
+  They do not modify the playback state themselves, but put a command into a fixed-size lock-free queue and return immediately.
+  The queued commands are applied by the thread calling openmpt::module::read, between two rendered frames, without ever waiting for the queueing threads.
+
+  Every command carries a timestamp in frames, relative to the render position as returned by openmpt::ext::interactive_queue::get_render_position.
+  Commands with a timestamp that is not in the future (e.g. 0) are applied before the next frame is rendered.
+  Commands with a timestamp in the future are applied exactly before the frame with that render position is rendered, even if that frame is in the middle of a buffer passed to openmpt::module::read.
+  Commands with equal timestamps that have been queued by the same thread are applied in the order in which they have been queued.
+
+  Arguments are validated when queueing a command. If a command cannot be applied anymore at the time it is due (e.g. stopping a note that has already been replaced by another note), it is ignored.
+*/
+class interactive_queue {
+
+	LIBOPENMPT_EXT_CXX_INTERFACE(interactive_queue)
+
+	//! Get the render position
+	/*!
+	  \return The number of frames that have been rendered by openmpt::module::read since the module has been loaded. Seeking or changing the subsong does not reset the render position.
+	  \remarks The render position is updated while rendering. Calling this function from a different thread than the one calling openmpt::module::read returns the position at some point during the current or last openmpt::module::read call.
+	*/
+	virtual std::int64_t get_render_position( ) const = 0;
+
+	//! Queue setting the current ticks per row (speed)
+	/*!
+	  \param speed The new tick count in range [1, 65535].
+	  \param frame The render position at which the command is applied.
+	  \return true if the command has been queued, false if the queue is full.
+	  \throws openmpt::exception Throws an exception derived from openmpt::exception if the speed is outside the specified range.
+	  \sa openmpt::ext::interactive::set_current_speed
+	*/
+	virtual bool set_current_speed( std::int32_t speed, std::int64_t frame ) = 0;
+
+	//! Queue setting the current module tempo
+	/*!
+	  \param tempo The new tempo in range [32, 512]. The exact meaning of the value depends on the tempo mode used by the module.
+	  \param frame The render position at which the command is applied.
+	  \return true if the command has been queued, false if the queue is full.
+	  \throws openmpt::exception Throws an exception derived from openmpt::exception if the tempo is outside the specified range.
+	  \sa openmpt::ext::interactive::set_current_tempo
+	*/
+	virtual bool set_current_tempo( std::int32_t tempo, std::int64_t frame ) = 0;
+
+	//! Queue setting the current module tempo factor without affecting playback pitch
+	/*!
+	  \param factor The new tempo factor in range ]0.0, 4.0] - 1.0 means unmodified tempo.
+	  \param frame The render position at which the command is applied.
+	  \return true if the command has been queued, false if the queue is full.
+	  \throws openmpt::exception Throws an exception derived from openmpt::exception if the factor is outside the specified range.
+	  \sa openmpt::ext::interactive::set_tempo_factor
+	*/
+	virtual bool set_tempo_factor( double factor, std::int64_t frame ) = 0;
+
+	//! Queue setting the current module pitch factor without affecting playback speed
+	/*!
+	  \param factor The new pitch factor in range ]0.0, 4.0] - 1.0 means unmodified pitch.
+	  \param frame The render position at which the command is applied.
+	  \return true if the command has been queued, false if the queue is full.
+	  \throws openmpt::exception Throws an exception derived from openmpt::exception if the factor is outside the specified range.
+	  \sa openmpt::ext::interactive::set_pitch_factor
+	*/
+	virtual bool set_pitch_factor( double factor, std::int64_t frame ) = 0;
+
+	//! Queue setting the current global volume
+	/*!
+	  \param volume The new global volume in range [0.0, 1.0]
+	  \param frame The render position at which the command is applied.
+	  \return true if the command has been queued, false if the queue is full.
+	  \throws openmpt::exception Throws an exception derived from openmpt::exception if the volume is outside the specified range.
+	  \sa openmpt::ext::interactive::set_global_volume
+	*/
+	virtual bool set_global_volume( double volume, std::int64_t frame ) = 0;
+
+	//! Queue setting the current channel volume for a channel
+	/*!
+	  \param channel The channel whose volume should be set, in range [0, openmpt::module::get_num_channels()[
+	  \param volume The new channel volume in range [0.0, 1.0]
+	  \param frame The render position at which the command is applied.
+	  \return true if the command has been queued, false if the queue is full.
+	  \throws openmpt::exception Throws an exception derived from openmpt::exception if the channel or volume is outside the specified range.
+	  \sa openmpt::ext::interactive::set_channel_volume
+	*/
+	virtual bool set_channel_volume( std::int32_t channel, double volume, std::int64_t frame ) = 0;
+
+	//! Queue setting the current mute status for a channel
+	/*!
+	  \param channel The channel whose mute status should be set, in range [0, openmpt::module::get_num_channels()[
+	  \param mute The new mute status. true is muted, false is unmuted.
+	  \param frame The render position at which the command is applied.
+	  \return true if the command has been queued, false if the queue is full.
+	  \throws openmpt::exception Throws an exception derived from openmpt::exception if the channel is outside the specified range.
+	  \sa openmpt::ext::interactive::set_channel_mute_status
+	*/
+	virtual bool set_channel_mute_status( std::int32_t channel, bool mute, std::int64_t frame ) = 0;
+
+	//! Queue setting the current mute status for an instrument
+	/*!
+	  \param instrument The instrument whose mute status should be set, in range [0, openmpt::module::get_num_instruments()[ if openmpt::module::get_num_instruments is not 0, otherwise in [0, openmpt::module::get_num_samples()[
+	  \param mute The new mute status. true is muted, false is unmuted.
+	  \param frame The render position at which the command is applied.
+	  \return true if the command has been queued, false if the queue is full.
+	  \throws openmpt::exception Throws an exception derived from openmpt::exception if the instrument is outside the specified range.
+	  \sa openmpt::ext::interactive::set_instrument_mute_status
+	*/
+	virtual bool set_instrument_mute_status( std::int32_t instrument, bool mute, std::int64_t frame ) = 0;
+
+	//! Queue playing a note using the specified instrument
+	/*!
+	  \param instrument The instrument that should be played, in range [0, openmpt::module::get_num_instruments()[ if openmpt::module::get_num_instruments is not 0, otherwise in [0, openmpt::module::get_num_samples()[
+	  \param note The note to play, in rage [0, 119]. 60 is the middle C.
+	  \param volume The volume at which the note should be triggered, in range [0.0, 1.0]
+	  \param panning The panning position at which the note should be triggered, in range [-1.0, 1.0], 0.0 is center.
+	  \param frame The render position at which the command is applied.
+	  \return A voice handle that can be passed to openmpt::ext::interactive_queue::stop_note to stop the note, or -1 if the queue is full.
+	  \throws openmpt::exception Throws an exception derived from openmpt::exception if the instrument or note is outside the specified range.
+	  \sa openmpt::ext::interactive::play_note
+	*/
+	virtual std::int64_t play_note( std::int32_t instrument, std::int32_t note, double volume, double panning, std::int64_t frame ) = 0;
+
+	//! Queue stopping a note
+	/*!
+	  \param voice The voice handle returned by a previous openmpt::ext::interactive_queue::play_note call.
+	  \param frame The render position at which the command is applied.
+	  \return true if the command has been queued, false if the queue is full.
+	  \throws openmpt::exception Throws an exception derived from openmpt::exception if the voice handle is invalid.
+	  \remarks If the note has already stopped playing and its channel has been reused for another note, the command is ignored.
+	  \sa openmpt::ext::interactive_queue::play_note
+	*/
+	virtual bool stop_note( std::int64_t voice, std::int64_t frame ) = 0;
+
+}; // class interactive_queue
+
+
+#ifndef LIBOPENMPT_EXT_INTERFACE_STEMS
+#define LIBOPENMPT_EXT_INTERFACE_STEMS
+#endif
+
+LIBOPENMPT_DECLARE_EXT_CXX_INTERFACE(stems)
+
+//! Render separate outputs (stems) per pattern channel or per instrument
+/*!
+  Rendering stems with this interface takes a single rendering pass, no matter how many stems there are.
+  Every voice is mixed into the stem of its pattern channel or instrument instead of the regular mix. New Note Action voices belong to the stem of the pattern channel they have been started from.
+  Global volume, stereo separation and the master gain are applied to each stem.
+  Voices that are routed to a plugin, OPL (AdLib) voices and all master effects (e.g. plugins, reverb, equalizer) are not part of any stem.
+  Voices started with openmpt::ext::interactive::play_note are not part of any channel stem.
+
+  openmpt::ext::stems::read_stems advances playback just like openmpt::module::read does, and both can be called alternately.
+*/
+class stems {
+
+	LIBOPENMPT_EXT_CXX_INTERFACE(stems)
+
+	//! Stem layout
+	enum stem_layout {
+
+		stems_channels = 0,
+		stems_instruments = 1
+
+	}; // enum stem_layout
+
+	//! Get the number of stems
+	/*!
+	  \param layout The stem layout (see openmpt::ext::stems::stem_layout)
+	  \return The number of stems rendered by openmpt::ext::stems::read_stems with the given layout. This is openmpt::module::get_num_channels for stems_channels, and openmpt::module::get_num_instruments (or openmpt::module::get_num_samples if the module has no instruments) for stems_instruments.
+	  \throws openmpt::exception Throws an exception derived from openmpt::exception if the layout is invalid.
+	*/
+	virtual std::int32_t get_num_stems( stem_layout layout ) const = 0;
+
+	//! Render audio data into one buffer per stem
+	/*!
+	  \param samplerate Sample rate to render output. Should be in [8000,192000], but this is not enforced.
+	  \param count Number of audio frames to render per stem. The buffers must be at least this large.
+	  \param layout The stem layout (see openmpt::ext::stems::stem_layout)
+	  \param buffers Array of openmpt::ext::stems::get_num_stems pointers to interleaved stereo output buffers for 2 * count samples each. Null pointers are allowed for stems that should not be output, they are still rendered.
+	  \return The number of frames actually rendered per stem.
+	  \retval 0 The end of song has been reached.
+	  \throws openmpt::exception Throws an exception derived from openmpt::exception if the layout is invalid or buffers is a null pointer.
+	  \remarks The output is floating point in the range [-1.0,1.0], like openmpt::module::read_interleaved_stereo. Samples are not clipped.
+	  \sa openmpt::module::read_interleaved_stereo
+	*/
+	virtual std::size_t read_stems( std::int32_t samplerate, std::size_t count, stem_layout layout, float * const * buffers ) = 0;
+
+}; // class stems
+
+
+#ifndef LIBOPENMPT_EXT_INTERFACE_PREVIEW
+#define LIBOPENMPT_EXT_INTERFACE_PREVIEW
+#endif
+
+LIBOPENMPT_DECLARE_EXT_CXX_INTERFACE(preview)
+
+//! Low-cost rendering of previews and waveform overviews
+/*!
+  Set the ctl render.preview to 1 to render at reduced quality, see openmpt::module::ctl_set_boolean.
+
+  openmpt::ext::preview::read_peaks advances playback just like openmpt::module::read does, and both can be called alternately.
+*/
+class preview {
+
+	LIBOPENMPT_EXT_CXX_INTERFACE(preview)
+
+	//! Render audio data and only output its peak values
+	/*!
+	  The module is rendered in mono. For every block of frames_per_peak frames, only the minimum and maximum sample value are output.
+	  \param samplerate Sample rate to render output. Should be in [8000,192000], but this is not enforced.
+	  \param frames_per_peak Number of audio frames that are reduced to one pair of peak values.
+	  \param count Number of peak values to render. Up to count * frames_per_peak audio frames are rendered. min_peaks and max_peaks must be at least this large.
+	  \param min_peaks Buffer for the minimum sample value of each block.
+	  \param max_peaks Buffer for the maximum sample value of each block.
+	  \return The number of peak values actually rendered. If the end of song is reached, the last block may be shorter than frames_per_peak.
+	  \retval 0 The end of song has been reached.
+	  \throws openmpt::exception Throws an exception derived from openmpt::exception if frames_per_peak is 0 or a buffer is a null pointer.
+	  \remarks The peak values are floating point in the range [-1.0,1.0], like openmpt::module::read. Samples are not clipped.
+	*/
+	virtual std::size_t read_peaks( std::int32_t samplerate, std::size_t frames_per_peak, std::size_t count, float * min_peaks, float * max_peaks ) = 0;
+
+}; // class preview
+
+
 /* add stuff here */
 
 
@@ -14,6 +14,7 @@
 
 #include "libopenmpt_ext_impl.hpp"
 
+#include <algorithm>
 #include <stdexcept>
 
 #include "soundlib/Sndfile.h"
@@ -56,6 +57,11 @@ namespace openmpt {
 
 	void module_ext_impl::ctor() {
 
+		m_pending_commands.reserve( command_queue::capacity );
+		m_channel_voice.assign( MAX_CHANNELS, -1 );
+		m_next_voice.store( 0 );
+		m_render_position.store( 0 );
+
 
 
 		/* add stuff here */
@@ -85,6 +91,12 @@ namespace openmpt {
 			return dynamic_cast< ext::pattern_vis * >( this );
 		} else if ( interface_id == ext::interactive_id ) {
 			return dynamic_cast< ext::interactive * >( this );
+		} else if ( interface_id == ext::interactive_queue_id ) {
+			return dynamic_cast< ext::interactive_queue * >( this );
+		} else if ( interface_id == ext::stems_id ) {
+			return dynamic_cast< ext::stems * >( this );
+		} else if ( interface_id == ext::preview_id ) {
+			return dynamic_cast< ext::preview * >( this );
 
 
 
@@ -295,6 +307,304 @@ namespace openmpt {
 		chn.pCurrentSample = nullptr;
 	}
 
+	// interactive_queue
+
+	module_ext_impl::command_queue::command_queue()
+		: m_slots( std::make_unique<slot[]>( capacity ) )
+		, m_write_pos( 0 )
+		, m_read_pos( 0 )
+	{
+		for ( std::size_t i = 0; i < capacity; ++i ) {
+			m_slots[i].sequence.store( i, std::memory_order_relaxed );
+		}
+	}
+
+	// A slot with sequence == pos is free for the producer writing position pos,
+	// a slot with sequence == pos + 1 contains the command for position pos.
+	bool module_ext_impl::command_queue::push( const queued_command & command ) noexcept {
+		std::uint64_t pos = m_write_pos.load( std::memory_order_relaxed );
+		while ( true ) {
+			slot & s = m_slots[pos % capacity];
+			const std::uint64_t sequence = s.sequence.load( std::memory_order_acquire );
+			if ( sequence == pos ) {
+				if ( m_write_pos.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) ) {
+					s.command = command;
+					s.sequence.store( pos + 1, std::memory_order_release );
+					return true;
+				}
+			} else if ( sequence < pos ) {
+				// The consumer has not yet taken the command written one lap earlier
+				return false;
+			} else {
+				pos = m_write_pos.load( std::memory_order_relaxed );
+			}
+		}
+	}
+
+	bool module_ext_impl::command_queue::pop( queued_command & command ) noexcept {
+		slot & s = m_slots[m_read_pos % capacity];
+		if ( s.sequence.load( std::memory_order_acquire ) != m_read_pos + 1 ) {
+			// Empty, or the producer of the next command has not finished writing it yet
+			return false;
+		}
+		command = s.command;
+		s.sequence.store( m_read_pos + capacity, std::memory_order_release );
+		m_read_pos++;
+		return true;
+	}
+
+	bool module_ext_impl::queue_command( const queued_command & command ) {
+		return m_command_queue.push( command );
+	}
+
+	void module_ext_impl::apply_queued_command( const queued_command & command ) {
+		switch ( command.type ) {
+			case queued_command::command_type::set_current_speed:
+				set_current_speed( command.index );
+				break;
+			case queued_command::command_type::set_current_tempo:
+				set_current_tempo( command.index );
+				break;
+			case queued_command::command_type::set_tempo_factor:
+				set_tempo_factor( command.value );
+				break;
+			case queued_command::command_type::set_pitch_factor:
+				set_pitch_factor( command.value );
+				break;
+			case queued_command::command_type::set_global_volume:
+				set_global_volume( command.value );
+				break;
+			case queued_command::command_type::set_channel_volume:
+				set_channel_volume( command.index, command.value );
+				break;
+			case queued_command::command_type::set_channel_mute_status:
+				set_channel_mute_status( command.index, command.mute );
+				break;
+			case queued_command::command_type::set_instrument_mute_status:
+				set_instrument_mute_status( command.index, command.mute );
+				break;
+			case queued_command::command_type::play_note:
+				{
+					const std::int32_t channel = play_note( command.index, command.note, command.value, command.panning );
+					m_channel_voice[channel] = command.voice;
+				}
+				break;
+			case queued_command::command_type::stop_note:
+				for ( std::size_t channel = 0; channel < m_channel_voice.size(); ++channel ) {
+					if ( m_channel_voice[channel] == command.voice ) {
+						m_channel_voice[channel] = -1;
+						// Do not stop a note that has been moved to this channel by a pattern's NNA in the meantime
+						if ( m_sndFile->m_PlayState.Chn[channel].nMasterChn == 0 ) {
+							stop_note( static_cast<std::int32_t>( channel ) );
+						}
+						break;
+					}
+				}
+				break;
+		}
+	}
+
+	std::size_t module_ext_impl::begin_read_chunk( std::size_t count ) {
+		const std::int64_t position = m_render_position.load( std::memory_order_relaxed );
+		// Sort newly queued commands into the pending commands. Commands with equal timestamps keep their queue order.
+		// If there are too many pending commands, the rest stays in the queue until some of them have been applied.
+		queued_command command;
+		while ( m_pending_commands.size() < command_queue::capacity && m_command_queue.pop( command ) ) {
+			auto pos = std::upper_bound( m_pending_commands.begin(), m_pending_commands.end(), command, []( const queued_command & l, const queued_command & r ) { return l.frame < r.frame; } );
+			m_pending_commands.insert( pos, command );
+		}
+		auto due_end = std::find_if( m_pending_commands.begin(), m_pending_commands.end(), [position]( const queued_command & c ) { return c.frame > position; } );
+		for ( auto it = m_pending_commands.begin(); it != due_end; ++it ) {
+			apply_queued_command( *it );
+		}
+		m_pending_commands.erase( m_pending_commands.begin(), due_end );
+		// Stop rendering right before the next command is due
+		if ( !m_pending_commands.empty() ) {
+			count = static_cast<std::size_t>( std::min( static_cast<std::uint64_t>( count ), static_cast<std::uint64_t>( m_pending_commands.front().frame - position ) ) );
+		}
+		return count;
+	}
+
+	void module_ext_impl::end_read_chunk( std::size_t count ) {
+		m_render_position.fetch_add( static_cast<std::int64_t>( count ), std::memory_order_relaxed );
+	}
+
+	std::int64_t module_ext_impl::get_render_position( ) const {
+		return m_render_position.load( std::memory_order_relaxed );
+	}
+
+	bool module_ext_impl::set_current_speed( std::int32_t speed, std::int64_t frame ) {
+		if ( speed < 1 || speed > 65535 ) {
+			throw openmpt::exception("invalid tick count");
+		}
+		queued_command command{};
+		command.type = queued_command::command_type::set_current_speed;
+		command.frame = frame;
+		command.index = speed;
+		return queue_command( command );
+	}
+
+	bool module_ext_impl::set_current_tempo( std::int32_t tempo, std::int64_t frame ) {
+		if ( tempo < 32 || tempo > 512 ) {
+			throw openmpt::exception("invalid tempo");
+		}
+		queued_command command{};
+		command.type = queued_command::command_type::set_current_tempo;
+		command.frame = frame;
+		command.index = tempo;
+		return queue_command( command );
+	}
+
+	bool module_ext_impl::set_tempo_factor( double factor, std::int64_t frame ) {
+		if ( factor <= 0.0 || factor > 4.0 ) {
+			throw openmpt::exception("invalid tempo factor");
+		}
+		queued_command command{};
+		command.type = queued_command::command_type::set_tempo_factor;
+		command.frame = frame;
+		command.value = factor;
+		return queue_command( command );
+	}
+
+	bool module_ext_impl::set_pitch_factor( double factor, std::int64_t frame ) {
+		if ( factor <= 0.0 || factor > 4.0 ) {
+			throw openmpt::exception("invalid pitch factor");
+		}
+		queued_command command{};
+		command.type = queued_command::command_type::set_pitch_factor;
+		command.frame = frame;
+		command.value = factor;
+		return queue_command( command );
+	}
+
+	bool module_ext_impl::set_global_volume( double volume, std::int64_t frame ) {
+		if ( volume < 0.0 || volume > 1.0 ) {
+			throw openmpt::exception("invalid global volume");
+		}
+		queued_command command{};
+		command.type = queued_command::command_type::set_global_volume;
+		command.frame = frame;
+		command.value = volume;
+		return queue_command( command );
+	}
+
+	bool module_ext_impl::set_channel_volume( std::int32_t channel, double volume, std::int64_t frame ) {
+		if ( channel < 0 || channel >= get_num_channels() ) {
+			throw openmpt::exception("invalid channel");
+		}
+		if ( volume < 0.0 || volume > 1.0 ) {
+			throw openmpt::exception("invalid global volume");
+		}
+		queued_command command{};
+		command.type = queued_command::command_type::set_channel_volume;
+		command.frame = frame;
+		command.index = channel;
+		command.value = volume;
+		return queue_command( command );
+	}
+
+	bool module_ext_impl::set_channel_mute_status( std::int32_t channel, bool mute, std::int64_t frame ) {
+		if ( channel < 0 || channel >= get_num_channels() ) {
+			throw openmpt::exception("invalid channel");
+		}
+		queued_command command{};
+		command.type = queued_command::command_type::set_channel_mute_status;
+		command.frame = frame;
+		command.index = channel;
+		command.mute = mute;
+		return queue_command( command );
+	}
+
+	bool module_ext_impl::set_instrument_mute_status( std::int32_t instrument, bool mute, std::int64_t frame ) {
+		const bool instrument_mode = get_num_instruments() != 0;
+		const int32_t max_instrument = instrument_mode ? get_num_instruments() : get_num_samples();
+		if ( instrument < 0 || instrument >= max_instrument ) {
+			throw openmpt::exception("invalid instrument");
+		}
+		queued_command command{};
+		command.type = queued_command::command_type::set_instrument_mute_status;
+		command.frame = frame;
+		command.index = instrument;
+		command.mute = mute;
+		return queue_command( command );
+	}
+
+	std::int64_t module_ext_impl::play_note( std::int32_t instrument, std::int32_t note, double volume, double panning, std::int64_t frame ) {
+		const bool instrument_mode = get_num_instruments() != 0;
+		const int32_t max_instrument = instrument_mode ? get_num_instruments() : get_num_samples();
+		if ( instrument < 0 || instrument >= max_instrument ) {
+			throw openmpt::exception("invalid instrument");
+		}
+		if ( note < 0 || note > NOTE_MAX - NOTE_MIN ) {
+			throw openmpt::exception("invalid note");
+		}
+		queued_command command{};
+		command.type = queued_command::command_type::play_note;
+		command.frame = frame;
+		command.voice = m_next_voice.fetch_add( 1, std::memory_order_relaxed );
+		command.index = instrument;
+		command.note = note;
+		command.value = volume;
+		command.panning = panning;
+		if ( !queue_command( command ) ) {
+			return -1;
+		}
+		return command.voice;
+	}
+
+	bool module_ext_impl::stop_note( std::int64_t voice, std::int64_t frame ) {
+		if ( voice < 0 || voice >= m_next_voice.load( std::memory_order_relaxed ) ) {
+			throw openmpt::exception("invalid voice");
+		}
+		queued_command command{};
+		command.type = queued_command::command_type::stop_note;
+		command.frame = frame;
+		command.voice = voice;
+		return queue_command( command );
+	}
+
+	// stems
+
+	static StemLayout to_stem_layout( ext::stems::stem_layout layout ) {
+		switch ( layout ) {
+			case ext::stems::stems_channels:
+				return StemLayout::Channels;
+			case ext::stems::stems_instruments:
+				return StemLayout::Instruments;
+		}
+		throw openmpt::exception("invalid stem layout");
+	}
+
+	std::int32_t module_ext_impl::get_num_stems( stem_layout layout ) const {
+		return static_cast<std::int32_t>( m_sndFile->GetNumStems( to_stem_layout( layout ) ) );
+	}
+
+	std::size_t module_ext_impl::read_stems( std::int32_t samplerate, std::size_t count, stem_layout layout, float * const * buffers ) {
+		if ( !buffers ) {
+			throw openmpt::exception("null pointer");
+		}
+		const StemLayout soundlib_layout = to_stem_layout( layout );
+		apply_mixer_settings( samplerate, 2 );
+		count = read_stems_wrapper( count, soundlib_layout, buffers );
+		m_currentPositionSeconds += static_cast<double>( count ) / static_cast<double>( samplerate );
+		return count;
+	}
+
+	// preview
+
+	std::size_t module_ext_impl::read_peaks( std::int32_t samplerate, std::size_t frames_per_peak, std::size_t count, float * min_peaks, float * max_peaks ) {
+		if ( !min_peaks || !max_peaks ) {
+			throw openmpt::exception("null pointer");
+		}
+		if ( frames_per_peak == 0 ) {
+			throw openmpt::exception("invalid number of frames per peak");
+		}
+		apply_mixer_settings( samplerate, 1 );
+		const std::size_t frames = read_peaks_wrapper( std::min( count, std::numeric_limits<std::size_t>::max() / frames_per_peak ) * frames_per_peak, frames_per_peak, min_peaks, max_peaks );
+		m_currentPositionSeconds += static_cast<double>( frames ) / static_cast<double>( samplerate );
+		return ( frames + frames_per_peak - 1 ) / frames_per_peak;
+	}
+
 
 	/* add stuff here */
 
@@ -14,12 +14,19 @@
 #include "libopenmpt_impl.hpp"
 #include "libopenmpt_ext.hpp"
 
+#include <atomic>
+#include <memory>
+#include <vector>
+
 namespace openmpt {
 
 class module_ext_impl
 	: public module_impl
 	, public ext::pattern_vis
 	, public ext::interactive
+	, public ext::interactive_queue
+	, public ext::stems
+	, public ext::preview
 
 
 
@@ -41,6 +48,65 @@ public:
 
 private:
 
+	struct queued_command {
+		enum class command_type : std::uint8_t {
+			set_current_speed,
+			set_current_tempo,
+			set_tempo_factor,
+			set_pitch_factor,
+			set_global_volume,
+			set_channel_volume,
+			set_channel_mute_status,
+			set_instrument_mute_status,
+			play_note,
+			stop_note,
+		};
+		std::int64_t frame;
+		std::int64_t voice;
+		double value;
+		double panning;
+		std::int32_t index;
+		std::int32_t note;
+		command_type type;
+		bool mute;
+	}; // struct queued_command
+
+	// Bounded multi-producer single-consumer queue.
+	// Producers never wait for the consumer, and the consumer never waits for producers.
+	class command_queue {
+	public:
+		static constexpr std::size_t capacity = 1024;
+		command_queue();
+		// Called by any thread, returns false if the queue is full.
+		bool push( const queued_command & command ) noexcept;
+		// Called by the rendering thread only, returns false if the queue is empty.
+		bool pop( queued_command & command ) noexcept;
+	private:
+		struct slot {
+			std::atomic<std::uint64_t> sequence;
+			queued_command command;
+		};
+		std::unique_ptr<slot[]> m_slots;
+		std::atomic<std::uint64_t> m_write_pos;
+		std::uint64_t m_read_pos;
+	}; // class command_queue
+
+	command_queue m_command_queue;
+	// Commands taken from the queue that are not due yet, sorted by timestamp. Only accessed by the rendering thread.
+	std::vector<queued_command> m_pending_commands;
+	// The voice that has been started on each channel by the queue, or -1. Only accessed by the rendering thread.
+	std::vector<std::int64_t> m_channel_voice;
+	std::atomic<std::int64_t> m_next_voice;
+	std::atomic<std::int64_t> m_render_position;
+
+	bool queue_command( const queued_command & command );
+	void apply_queued_command( const queued_command & command );
+
+protected:
+
+	std::size_t begin_read_chunk( std::size_t count ) override;
+	void end_read_chunk( std::size_t count ) override;
+
 
 
 	/* add stuff here */
@@ -99,6 +165,41 @@ public:
 
 	void stop_note( std::int32_t channel ) override;
 
+	// interactive_queue
+
+	std::int64_t get_render_position( ) const override;
+
+	bool set_current_speed( std::int32_t speed, std::int64_t frame ) override;
+
+	bool set_current_tempo( std::int32_t tempo, std::int64_t frame ) override;
+
+	bool set_tempo_factor( double factor, std::int64_t frame ) override;
+
+	bool set_pitch_factor( double factor, std::int64_t frame ) override;
+
+	bool set_global_volume( double volume, std::int64_t frame ) override;
+
+	bool set_channel_volume( std::int32_t channel, double volume, std::int64_t frame ) override;
+
+	bool set_channel_mute_status( std::int32_t channel, bool mute, std::int64_t frame ) override;
+
+	bool set_instrument_mute_status( std::int32_t instrument, bool mute, std::int64_t frame ) override;
+
+	std::int64_t play_note( std::int32_t instrument, std::int32_t note, double volume, double panning, std::int64_t frame ) override;
+
+	bool stop_note( std::int64_t voice, std::int64_t frame ) override;
+
+	// stems
+
+	std::int32_t get_num_stems( stem_layout layout ) const override;
+
+	std::size_t read_stems( std::int32_t samplerate, std::size_t count, stem_layout layout, float * const * buffers ) override;
+
+	// preview
+
+	std::size_t read_peaks( std::int32_t samplerate, std::size_t frames_per_peak, std::size_t count, float * min_peaks, float * max_peaks ) override;
+
+
 
 	/* add stuff here */
 
@@ -32,7 +32,10 @@
 #include "common/mptMutex.h"
 #include "soundlib/Sndfile.h"
 #include "soundlib/mod_specifications.h"
+#include "soundlib/ModFingerprint.h"
 #include "soundlib/AudioReadTarget.h"
+#include "soundlib/SampleCache.h"
+#include "soundlib/SampleStore.h"
 
 OPENMPT_NAMESPACE_BEGIN
 
@@ -494,20 +497,23 @@ bool module_impl::is_loaded() const {
 std::size_t module_impl::read_wrapper( std::size_t count, std::int16_t * left, std::int16_t * right, std::int16_t * rear_left, std::int16_t * rear_right ) {
 	m_sndFile->ResetMixStat();
 	m_sndFile->m_bIsRendering = ( m_ctl_play_at_end != song_end_action::fadeout_song );
+	const std::chrono::steady_clock::time_point render_start = begin_cpu_budget_measurement();
 	std::size_t count_read = 0;
 	std::int16_t * const buffers[4] = { left, right, rear_left, rear_right };
 	AudioReadTargetGainBuffer<audio_buffer_planar<std::int16_t>> target( audio_buffer_planar<std::int16_t>( buffers, planar_audio_buffer_valid_channels( buffers, std::size( buffers ) ), count ), *m_Dither, m_Gain );
 	while ( count > 0 ) {
 		std::size_t count_chunk = m_sndFile->Read(
-			static_cast<CSoundFile::samplecount_t>( std::min( static_cast<std::uint64_t>( count ), static_cast<std::uint64_t>( std::numeric_limits<CSoundFile::samplecount_t>::max() / 2 / 4 / 4 ) ) ), // safety margin / samplesize / channels
+			static_cast<CSoundFile::samplecount_t>( std::min( static_cast<std::uint64_t>( begin_read_chunk( count ) ), static_cast<std::uint64_t>( std::numeric_limits<CSoundFile::samplecount_t>::max() / 2 / 4 / 4 ) ) ), // safety margin / samplesize / channels
 			target
 			);
 		if ( count_chunk == 0 ) {
 			break;
 		}
+		end_read_chunk( count_chunk );
 		count -= count_chunk;
 		count_read += count_chunk;
 	}
+	end_cpu_budget_measurement( render_start, count_read );
 	if ( count_read == 0 && m_ctl_play_at_end == song_end_action::continue_song ) {
 		// This is the song end, but allow the song or loop to restart on the next call
 		m_sndFile->m_SongFlags.reset(SONG_ENDREACHED);
@@ -517,20 +523,23 @@ std::size_t module_impl::read_wrapper( std::size_t count, std::int16_t * left, s
 std::size_t module_impl::read_wrapper( std::size_t count, float * left, float * right, float * rear_left, float * rear_right ) {
 	m_sndFile->ResetMixStat();
 	m_sndFile->m_bIsRendering = ( m_ctl_play_at_end != song_end_action::fadeout_song );
+	const std::chrono::steady_clock::time_point render_start = begin_cpu_budget_measurement();
 	std::size_t count_read = 0;
 	float * const buffers[4] = { left, right, rear_left, rear_right };
 	AudioReadTargetGainBuffer<audio_buffer_planar<float>> target( audio_buffer_planar<float>( buffers, planar_audio_buffer_valid_channels( buffers, std::size( buffers ) ), count ), *m_Dither, m_Gain );
 	while ( count > 0 ) {
 		std::size_t count_chunk = m_sndFile->Read(
-			static_cast<CSoundFile::samplecount_t>( std::min( static_cast<std::uint64_t>( count ), static_cast<std::uint64_t>( std::numeric_limits<CSoundFile::samplecount_t>::max() / 2 / 4 / 4 ) ) ), // safety margin / samplesize / channels
+			static_cast<CSoundFile::samplecount_t>( std::min( static_cast<std::uint64_t>( begin_read_chunk( count ) ), static_cast<std::uint64_t>( std::numeric_limits<CSoundFile::samplecount_t>::max() / 2 / 4 / 4 ) ) ), // safety margin / samplesize / channels
 			target
 			);
 		if ( count_chunk == 0 ) {
 			break;
 		}
+		end_read_chunk( count_chunk );
 		count -= count_chunk;
 		count_read += count_chunk;
 	}
+	end_cpu_budget_measurement( render_start, count_read );
 	if ( count_read == 0 && m_ctl_play_at_end == song_end_action::continue_song ) {
 		// This is the song end, but allow the song or loop to restart on the next call
 		m_sndFile->m_SongFlags.reset(SONG_ENDREACHED);
@@ -540,19 +549,22 @@ std::size_t module_impl::read_wrapper( std::size_t count, float * left, float *
 std::size_t module_impl::read_interleaved_wrapper( std::size_t count, std::size_t channels, std::int16_t * interleaved ) {
 	m_sndFile->ResetMixStat();
 	m_sndFile->m_bIsRendering = ( m_ctl_play_at_end != song_end_action::fadeout_song );
+	const std::chrono::steady_clock::time_point render_start = begin_cpu_budget_measurement();
 	std::size_t count_read = 0;
 	AudioReadTargetGainBuffer<audio_buffer_interleaved<std::int16_t>> target( audio_buffer_interleaved<std::int16_t>( interleaved, channels, count ), *m_Dither, m_Gain );
 	while ( count > 0 ) {
 		std::size_t count_chunk = m_sndFile->Read(
-			static_cast<CSoundFile::samplecount_t>( std::min( static_cast<std::uint64_t>( count ), static_cast<std::uint64_t>( std::numeric_limits<CSoundFile::samplecount_t>::max() / 2 / 4 / 4 ) ) ), // safety margin / samplesize / channels
+			static_cast<CSoundFile::samplecount_t>( std::min( static_cast<std::uint64_t>( begin_read_chunk( count ) ), static_cast<std::uint64_t>( std::numeric_limits<CSoundFile::samplecount_t>::max() / 2 / 4 / 4 ) ) ), // safety margin / samplesize / channels
 			target
 			);
 		if ( count_chunk == 0 ) {
 			break;
 		}
+		end_read_chunk( count_chunk );
 		count -= count_chunk;
 		count_read += count_chunk;
 	}
+	end_cpu_budget_measurement( render_start, count_read );
 	if ( count_read == 0 && m_ctl_play_at_end == song_end_action::continue_song ) {
 		// This is the song end, but allow the song or loop to restart on the next call
 		m_sndFile->m_SongFlags.reset(SONG_ENDREACHED);
@@ -562,25 +574,133 @@ std::size_t module_impl::read_interleaved_wrapper( std::size_t count, std::size_
 std::size_t module_impl::read_interleaved_wrapper( std::size_t count, std::size_t channels, float * interleaved ) {
 	m_sndFile->ResetMixStat();
 	m_sndFile->m_bIsRendering = ( m_ctl_play_at_end != song_end_action::fadeout_song );
+	const std::chrono::steady_clock::time_point render_start = begin_cpu_budget_measurement();
 	std::size_t count_read = 0;
 	AudioReadTargetGainBuffer<audio_buffer_interleaved<float>> target( audio_buffer_interleaved<float>( interleaved, channels, count ), *m_Dither, m_Gain );
 	while ( count > 0 ) {
 		std::size_t count_chunk = m_sndFile->Read(
-			static_cast<CSoundFile::samplecount_t>( std::min( static_cast<std::uint64_t>( count ), static_cast<std::uint64_t>( std::numeric_limits<CSoundFile::samplecount_t>::max() / 2 / 4 / 4 ) ) ), // safety margin / samplesize / channels
+			static_cast<CSoundFile::samplecount_t>( std::min( static_cast<std::uint64_t>( begin_read_chunk( count ) ), static_cast<std::uint64_t>( std::numeric_limits<CSoundFile::samplecount_t>::max() / 2 / 4 / 4 ) ) ), // safety margin / samplesize / channels
 			target
 			);
 		if ( count_chunk == 0 ) {
 			break;
 		}
+		end_read_chunk( count_chunk );
 		count -= count_chunk;
 		count_read += count_chunk;
 	}
+	end_cpu_budget_measurement( render_start, count_read );
 	if ( count_read == 0 && m_ctl_play_at_end == song_end_action::continue_song ) {
 		// This is the song end, but allow the song or loop to restart on the next call
 		m_sndFile->m_SongFlags.reset(SONG_ENDREACHED);
 	}
 	return count_read;
 }
+std::size_t module_impl::read_stems_wrapper( std::size_t count, OpenMPT::StemLayout layout, float * const * stems ) {
+	m_sndFile->ResetMixStat();
+	m_sndFile->m_bIsRendering = ( m_ctl_play_at_end != song_end_action::fadeout_song );
+	const std::chrono::steady_clock::time_point render_start = begin_cpu_budget_measurement();
+	std::size_t count_read = 0;
+	AudioReadTargetStems target( layout, stems, m_Gain );
+	while ( count > 0 ) {
+		std::size_t count_chunk = m_sndFile->Read(
+			static_cast<CSoundFile::samplecount_t>( std::min( static_cast<std::uint64_t>( begin_read_chunk( count ) ), static_cast<std::uint64_t>( std::numeric_limits<CSoundFile::samplecount_t>::max() / 2 / 4 / 4 ) ) ), // safety margin / samplesize / channels
+			target
+			);
+		if ( count_chunk == 0 ) {
+			break;
+		}
+		end_read_chunk( count_chunk );
+		count -= count_chunk;
+		count_read += count_chunk;
+	}
+	end_cpu_budget_measurement( render_start, count_read );
+	if ( count_read == 0 && m_ctl_play_at_end == song_end_action::continue_song ) {
+		// This is the song end, but allow the song or loop to restart on the next call
+		m_sndFile->m_SongFlags.reset(SONG_ENDREACHED);
+	}
+	return count_read;
+}
+std::size_t module_impl::read_peaks_wrapper( std::size_t count, std::size_t frames_per_peak, float * min_peaks, float * max_peaks ) {
+	m_sndFile->ResetMixStat();
+	m_sndFile->m_bIsRendering = ( m_ctl_play_at_end != song_end_action::fadeout_song );
+	const std::chrono::steady_clock::time_point render_start = begin_cpu_budget_measurement();
+	std::size_t count_read = 0;
+	AudioReadTargetPeaks target( frames_per_peak, min_peaks, max_peaks, m_Gain );
+	while ( count > 0 ) {
+		std::size_t count_chunk = m_sndFile->Read(
+			static_cast<CSoundFile::samplecount_t>( std::min( static_cast<std::uint64_t>( begin_read_chunk( count ) ), static_cast<std::uint64_t>( std::numeric_limits<CSoundFile::samplecount_t>::max() / 2 / 4 / 4 ) ) ), // safety margin / samplesize / channels
+			target
+			);
+		if ( count_chunk == 0 ) {
+			break;
+		}
+		end_read_chunk( count_chunk );
+		count -= count_chunk;
+		count_read += count_chunk;
+	}
+	target.Finish();
+	end_cpu_budget_measurement( render_start, count_read );
+	if ( count_read == 0 && m_ctl_play_at_end == song_end_action::continue_song ) {
+		// This is the song end, but allow the song or loop to restart on the next call
+		m_sndFile->m_SongFlags.reset(SONG_ENDREACHED);
+	}
+	return count_read;
+}
+
+std::chrono::steady_clock::time_point module_impl::begin_cpu_budget_measurement() const {
+	if ( m_ctl_render_cpu_budget <= 0.0 ) {
+		return std::chrono::steady_clock::time_point();
+	}
+	return std::chrono::steady_clock::now();
+}
+void module_impl::end_cpu_budget_measurement( std::chrono::steady_clock::time_point start, std::size_t frames ) {
+	if ( m_ctl_render_cpu_budget <= 0.0 ) {
+		return;
+	}
+	m_cpu_budget_render_seconds += std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+	m_cpu_budget_frames += frames;
+	m_cpu_budget_max_voices_mixed = std::max( m_cpu_budget_max_voices_mixed, static_cast<std::int32_t>( m_sndFile->GetMixStat() ) );
+	const std::uint32_t samplerate = m_sndFile->GetSampleRate();
+	// Judge the load over at least 50ms of audio, single read calls are too short to be measured reliably.
+	if ( m_cpu_budget_frames == 0 || m_cpu_budget_frames < samplerate / 20 ) {
+		return;
+	}
+	const double load = m_cpu_budget_render_seconds * samplerate / static_cast<double>( m_cpu_budget_frames );
+	const CHANNELINDEX voices_mixed = static_cast<CHANNELINDEX>( m_cpu_budget_max_voices_mixed );
+	const CHANNELINDEX min_voices = static_cast<CHANNELINDEX>( std::clamp( m_ctl_render_cpu_budget_min_voices, std::int32_t( 0 ), std::int32_t( MAX_CHANNELS ) ) );
+	VoiceBudget & budget = m_sndFile->m_voiceBudget;
+	if ( load > m_ctl_render_cpu_budget ) {
+		// Over budget: First reduce the resampling quality of the least important voices, then stop mixing them.
+		if ( m_ctl_render_cpu_budget_downgrade_resampling && budget.fullQualityVoices > 0 ) {
+			budget.fullQualityVoices = static_cast<CHANNELINDEX>( std::min( budget.fullQualityVoices, voices_mixed ) * 3 / 4 );
+		} else if ( budget.maxVoices > min_voices ) {
+			budget.maxVoices = std::max( min_voices, static_cast<CHANNELINDEX>( std::min( budget.maxVoices, voices_mixed ) * 3 / 4 ) );
+		}
+	} else if ( load < m_ctl_render_cpu_budget * 0.75 ) {
+		// Comfortably within budget: Gradually bring back culled voices first, then resampling quality.
+		if ( budget.maxVoices < MAX_CHANNELS ) {
+			budget.maxVoices = ( budget.maxVoices >= voices_mixed + 4 ) ? MAX_CHANNELS : static_cast<CHANNELINDEX>( budget.maxVoices + 2 );
+		} else if ( budget.fullQualityVoices < MAX_CHANNELS ) {
+			budget.fullQualityVoices = ( budget.fullQualityVoices >= voices_mixed + 4 ) ? MAX_CHANNELS : static_cast<CHANNELINDEX>( budget.fullQualityVoices + 2 );
+		}
+	}
+	m_cpu_budget_render_seconds = 0.0;
+	m_cpu_budget_frames = 0;
+	m_cpu_budget_max_voices_mixed = 0;
+}
+void module_impl::reset_cpu_budget() {
+	m_sndFile->m_voiceBudget = VoiceBudget();
+	m_cpu_budget_render_seconds = 0.0;
+	m_cpu_budget_frames = 0;
+	m_cpu_budget_max_voices_mixed = 0;
+}
+std::size_t module_impl::begin_read_chunk( std::size_t count ) {
+	return count;
+}
+void module_impl::end_read_chunk( std::size_t /* count */ ) {
+	return;
+}
 
 std::vector<std::string> module_impl::get_supported_extensions() {
 	std::vector<std::string> retval;
@@ -1150,6 +1270,8 @@ std::vector<std::string> module_impl::get_metadata_keys() const {
 		"message",
 		"message_raw",
 		"warnings",
+		"fingerprint",
+		"fingerprint_fuzzy",
 	};
 }
 std::string module_impl::get_message_instruments() const {
@@ -1278,6 +1400,16 @@ std::string module_impl::get_metadata( const std::string & key ) const {
 			retval += msg;
 		}
 		return retval;
+	} else if ( key == std::string("fingerprint") ) {
+		if ( !m_fingerprint ) {
+			m_fingerprint = ModFingerprint::CalculateExact( *m_sndFile );
+		}
+		return mpt::fmt::hex0<16>( *m_fingerprint );
+	} else if ( key == std::string("fingerprint_fuzzy") ) {
+		if ( !m_fingerprint_fuzzy ) {
+			m_fingerprint_fuzzy = ModFingerprint::CalculateFuzzy( *m_sndFile );
+		}
+		return mpt::fmt::hex0<16>( *m_fingerprint_fuzzy );
 	}
 	return "";
 }
@@ -1619,14 +1751,31 @@ std::pair<const module_impl::ctl_info *, const module_impl::ctl_info *> module_i
 		{ "load.skip_patterns", ctl_type::boolean },
 		{ "load.skip_plugins", ctl_type::boolean },
 		{ "load.skip_subsongs_init", ctl_type::boolean },
+		{ "load.sample_cache_size", ctl_type::integer },
+		{ "load.threads", ctl_type::integer },
+		{ "load.sample_stream_threshold", ctl_type::integer },
+		{ "load.share_samples", ctl_type::boolean },
 		{ "seek.sync_samples", ctl_type::boolean },
 		{ "subsong", ctl_type::integer },
 		{ "play.tempo_factor", ctl_type::floatingpoint },
 		{ "play.pitch_factor", ctl_type::floatingpoint },
 		{ "play.at_end", ctl_type::text },
+		{ "play.state_hash", ctl_type::integer },
 		{ "render.resampler.emulate_amiga", ctl_type::boolean },
 		{ "render.resampler.emulate_amiga_type", ctl_type::text },
 		{ "render.opl.volume_factor", ctl_type::floatingpoint },
+		{ "render.preview", ctl_type::boolean },
+		{ "render.cpu_budget", ctl_type::floatingpoint },
+		{ "render.cpu_budget.downgrade_resampling", ctl_type::boolean },
+		{ "render.cpu_budget.min_voices", ctl_type::integer },
+		{ "analysis.loudness", ctl_type::boolean },
+		{ "analysis.loudness.integrated", ctl_type::floatingpoint },
+		{ "analysis.loudness.range", ctl_type::floatingpoint },
+		{ "analysis.loudness.true_peak", ctl_type::floatingpoint },
+		{ "memory.sample_data", ctl_type::integer },
+		{ "memory.sample_data.shared", ctl_type::integer },
+		{ "memory.sample_store.size", ctl_type::integer },
+		{ "memory.sample_store.saved", ctl_type::integer },
 		{ "dither", ctl_type::integer }
 	};
 	return std::make_pair(std::begin(ctl_infos), std::end(ctl_infos));
@@ -1720,10 +1869,18 @@ bool module_impl::ctl_get_boolean( std::string_view ctl, bool throw_if_unknown )
 		return m_ctl_load_skip_plugins;
 	} else if ( ctl == "load.skip_subsongs_init" ) {
 		return m_ctl_load_skip_subsongs_init;
+	} else if ( ctl == "load.share_samples" ) {
+		return m_sndFile->m_shareSamples;
 	} else if ( ctl == "seek.sync_samples" ) {
 		return m_ctl_seek_sync_samples;
 	} else if ( ctl == "render.resampler.emulate_amiga" ) {
 		return ( m_sndFile->m_Resampler.m_Settings.emulateAmiga != Resampling::AmigaFilter::Off );
+	} else if ( ctl == "render.preview" ) {
+		return m_sndFile->m_previewRender;
+	} else if ( ctl == "render.cpu_budget.downgrade_resampling" ) {
+		return m_ctl_render_cpu_budget_downgrade_resampling;
+	} else if ( ctl == "analysis.loudness" ) {
+		return m_sndFile->m_analyzeLoudness;
 	} else {
 		MPT_ASSERT_NOTREACHED();
 		return false;
@@ -1758,10 +1915,32 @@ std::int64_t module_impl::ctl_get_integer( std::string_view ctl, bool throw_if_u
 	}
 	if ( ctl == "" ) {
 		throw openmpt::exception("empty ctl");
+	} else if ( ctl == "load.sample_cache_size" ) {
+		return mpt::saturate_cast<std::int64_t>( DecodedSampleCache::GetMaxSize() );
+	} else if ( ctl == "load.threads" ) {
+		return m_sndFile->m_loadThreads;
+	} else if ( ctl == "load.sample_stream_threshold" ) {
+		return mpt::saturate_cast<std::int64_t>( m_sndFile->m_sampleStreamThreshold );
+	} else if ( ctl == "render.cpu_budget.min_voices" ) {
+		return m_ctl_render_cpu_budget_min_voices;
 	} else if ( ctl == "subsong" ) {
 		return get_selected_subsong();
 	} else if ( ctl == "dither" ) {
 		return static_cast<int>( m_Dither->GetMode() );
+	} else if ( ctl == "memory.sample_data" ) {
+		return mpt::saturate_cast<std::int64_t>( m_sndFile->GetSampleMemoryUsage() );
+	} else if ( ctl == "memory.sample_data.shared" ) {
+		std::size_t shared = 0;
+		m_sndFile->GetSampleMemoryUsage( &shared );
+		return mpt::saturate_cast<std::int64_t>( shared );
+	} else if ( ctl == "memory.sample_store.size" ) {
+		return mpt::saturate_cast<std::int64_t>( SampleStore::GetSize() );
+	} else if ( ctl == "memory.sample_store.saved" ) {
+		return mpt::saturate_cast<std::int64_t>( SampleStore::GetSavedSize() );
+	} else if ( ctl == "play.state_hash" ) {
+		// the cpu budget adjusts the voice limits depending on the measured render time
+		const std::optional<std::uint64_t> hash = ( m_ctl_render_cpu_budget > 0.0 ) ? std::nullopt : m_sndFile->GetPlaybackStateHash();
+		return hash ? static_cast<std::int64_t>( *hash >> 1 ) : -1;
 	} else {
 		MPT_ASSERT_NOTREACHED();
 		return 0;
@@ -1808,6 +1987,15 @@ double module_impl::ctl_get_floatingpoint( std::string_view ctl, bool throw_if_u
 		return m_sndFile->m_nFreqFactor / 65536.0;
 	} else if ( ctl == "render.opl.volume_factor" ) {
 		return static_cast<double>( m_sndFile->m_OPLVolumeFactor ) / static_cast<double>( m_sndFile->m_OPLVolumeFactorScale );
+	} else if ( ctl == "render.cpu_budget" ) {
+		return m_ctl_render_cpu_budget;
+	} else if ( ctl == "analysis.loudness.integrated" ) {
+		return m_sndFile->m_LoudnessMeter.GetIntegratedLoudness() + 20.0 * std::log10( m_Gain );
+	} else if ( ctl == "analysis.loudness.range" ) {
+		return m_sndFile->m_LoudnessMeter.GetLoudnessRange();
+	} else if ( ctl == "analysis.loudness.true_peak" ) {
+		const double peak = m_sndFile->m_LoudnessMeter.GetTruePeak() * m_Gain;
+		return ( peak > 0.0 ) ? 20.0 * std::log10( peak ) : -std::numeric_limits<double>::infinity();
 	} else {
 		MPT_ASSERT_NOTREACHED();
 		return 0.0;
@@ -1943,6 +2131,8 @@ void module_impl::ctl_set_boolean( std::string_view ctl, bool value, bool throw_
 		m_ctl_load_skip_plugins = value;
 	} else if ( ctl == "load.skip_subsongs_init" ) {
 		m_ctl_load_skip_subsongs_init = value;
+	} else if ( ctl == "load.share_samples" ) {
+		m_sndFile->m_shareSamples = value;
 	} else if ( ctl == "seek.sync_samples" ) {
 		m_ctl_seek_sync_samples = value;
 	} else if ( ctl == "render.resampler.emulate_amiga" ) {
@@ -1955,6 +2145,16 @@ void module_impl::ctl_set_boolean( std::string_view ctl, bool value, bool throw_
 		if ( newsettings != m_sndFile->m_Resampler.m_Settings ) {
 			m_sndFile->SetResamplerSettings( newsettings );
 		}
+	} else if ( ctl == "render.preview" ) {
+		m_sndFile->m_previewRender = value;
+	} else if ( ctl == "render.cpu_budget.downgrade_resampling" ) {
+		m_ctl_render_cpu_budget_downgrade_resampling = value;
+		reset_cpu_budget();
+	} else if ( ctl == "analysis.loudness" ) {
+		if ( value ) {
+			m_sndFile->m_LoudnessMeter.Reset();
+		}
+		m_sndFile->m_analyzeLoudness = value;
 	} else {
 		MPT_ASSERT_NOTREACHED();
 	}
@@ -1986,6 +2186,14 @@ void module_impl::ctl_set_integer( std::string_view ctl, std::int64_t value, boo
 
 	if ( ctl == "" ) {
 		throw openmpt::exception("empty ctl: := " + mpt::fmt::val( value ) );
+	} else if ( ctl == "load.sample_cache_size" ) {
+		DecodedSampleCache::SetMaxSize( mpt::saturate_cast<std::size_t>( std::max( value, std::int64_t( 0 ) ) ) );
+	} else if ( ctl == "load.threads" ) {
+		m_sndFile->m_loadThreads = mpt::saturate_cast<uint32>( std::max( value, std::int64_t( 0 ) ) );
+	} else if ( ctl == "load.sample_stream_threshold" ) {
+		m_sndFile->m_sampleStreamThreshold = static_cast<uint64>( std::max( value, std::int64_t( 0 ) ) );
+	} else if ( ctl == "render.cpu_budget.min_voices" ) {
+		m_ctl_render_cpu_budget_min_voices = mpt::saturate_cast<std::int32_t>( std::clamp( value, std::int64_t( 0 ), std::int64_t( MAX_CHANNELS ) ) );
 	} else if ( ctl == "subsong" ) {
 		select_subsong( mpt::saturate_cast<int32>( value ) );
 	} else if ( ctl == "dither" ) {
@@ -1994,6 +2202,8 @@ void module_impl::ctl_set_integer( std::string_view ctl, std::int64_t value, boo
 			dither = DitherDefault;
 		}
 		m_Dither->SetMode( static_cast<DitherMode>( dither ) );
+	} else if ( ctl == "memory.sample_data" || ctl == "memory.sample_data.shared" || ctl == "memory.sample_store.size" || ctl == "memory.sample_store.saved" || ctl == "play.state_hash" ) {
+		throw openmpt::exception("read-only ctl: " + std::string(ctl));
 	} else {
 		MPT_ASSERT_NOTREACHED();
 	}
@@ -2047,6 +2257,11 @@ void module_impl::ctl_set_floatingpoint( std::string_view ctl, double value, boo
 		m_sndFile->RecalculateSamplesPerTick();
 	} else if ( ctl == "render.opl.volume_factor" ) {
 		m_sndFile->m_OPLVolumeFactor = mpt::saturate_round<int32>( value * static_cast<double>( m_sndFile->m_OPLVolumeFactorScale ) );
+	} else if ( ctl == "render.cpu_budget" ) {
+		m_ctl_render_cpu_budget = std::max( value, 0.0 );
+		reset_cpu_budget();
+	} else if ( ctl == "analysis.loudness.integrated" || ctl == "analysis.loudness.range" || ctl == "analysis.loudness.true_peak" ) {
+		throw openmpt::exception("read-only ctl: " + std::string(ctl));
 	} else {
 		MPT_ASSERT_NOTREACHED();
 	}
@@ -13,8 +13,10 @@
 #include "libopenmpt_internal.h"
 #include "libopenmpt.hpp"
 
+#include <chrono>
 #include <iosfwd>
 #include <memory>
+#include <optional>
 #include <utility>
 
 #if defined(_MSC_VER)
@@ -33,6 +35,7 @@ class FileReader;
 typedef detail::FileReader<FileReaderTraitsDefault> FileReader;
 class CSoundFile;
 class Dither;
+enum class StemLayout;
 } // namespace OpenMPT
 
 namespace openmpt {
@@ -127,7 +130,16 @@ protected:
 	bool m_ctl_load_skip_plugins;
 	bool m_ctl_load_skip_subsongs_init;
 	bool m_ctl_seek_sync_samples;
+	double m_ctl_render_cpu_budget = 0.0;
+	bool m_ctl_render_cpu_budget_downgrade_resampling = true;
+	std::int32_t m_ctl_render_cpu_budget_min_voices = 16;
+	double m_cpu_budget_render_seconds = 0.0;
+	std::uint64_t m_cpu_budget_frames = 0;
+	std::int32_t m_cpu_budget_max_voices_mixed = 0;
 	std::vector<std::string> m_loaderMessages;
+	// calculated on the first query, as hashing all sample data is too expensive to do for every load
+	mutable std::optional<std::uint64_t> m_fingerprint;
+	mutable std::optional<std::uint64_t> m_fingerprint_fuzzy;
 public:
 	void PushToCSoundFileLog( const std::string & text ) const;
 	void PushToCSoundFileLog( int loglevel, const std::string & text ) const;
@@ -145,6 +157,15 @@ protected:
 	std::size_t read_wrapper( std::size_t count, float * left, float * right, float * rear_left, float * rear_right );
 	std::size_t read_interleaved_wrapper( std::size_t count, std::size_t channels, std::int16_t * interleaved );
 	std::size_t read_interleaved_wrapper( std::size_t count, std::size_t channels, float * interleaved );
+	std::size_t read_stems_wrapper( std::size_t count, OpenMPT::StemLayout layout, float * const * stems );
+	std::size_t read_peaks_wrapper( std::size_t count, std::size_t frames_per_peak, float * min_peaks, float * max_peaks );
+	std::chrono::steady_clock::time_point begin_cpu_budget_measurement() const;
+	void end_cpu_budget_measurement( std::chrono::steady_clock::time_point start, std::size_t frames );
+	void reset_cpu_budget();
+	// Called by the read wrappers before rendering each chunk, returns the maximum number of frames to render in the chunk (at least 1 if count is not 0).
+	virtual std::size_t begin_read_chunk( std::size_t count );
+	// Called by the read wrappers after rendering a chunk of count frames.
+	virtual void end_read_chunk( std::size_t count );
 	std::string get_message_instruments() const;
 	std::string get_message_samples() const;
 	std::pair< std::string, std::string > format_and_highlight_pattern_row_channel_command( std::int32_t p, std::int32_t r, std::int32_t c, int command ) const;
@@ -173,7 +194,7 @@ public:
 	module_impl( const std::uint8_t * data, std::size_t size, std::unique_ptr<log_interface> log, const std::map< std::string, std::string > & ctls );
 	module_impl( const char * data, std::size_t size, std::unique_ptr<log_interface> log, const std::map< std::string, std::string > & ctls );
 	module_impl( const void * data, std::size_t size, std::unique_ptr<log_interface> log, const std::map< std::string, std::string > & ctls );
-	~module_impl();
+	virtual ~module_impl();
 public:
 	void select_subsong( std::int32_t subsong );
 	std::int32_t get_selected_subsong() const;
@@ -15,6 +15,8 @@
 
 #include <iostream>
 #include <locale>
+#include <string>
+#include <vector>
 
 #include <clocale>
 #include <cstdlib>
@@ -26,15 +28,29 @@ using namespace OpenMPT;
 #if (defined(_WIN32) || defined(WIN32)) && (defined(_UNICODE) || defined(UNICODE))
 #if defined(__GNUC__)
 // mingw-w64 g++ does only default to special C linkage for "main", but not for "wmain" (see <https://sourceforge.net/p/mingw-w64/wiki2/Unicode%20apps/>).
-extern "C" int wmain( int /*argc*/ , wchar_t * /*argv*/ [] );
+extern "C" int wmain( int argc, wchar_t * argv [] );
 extern "C"
 #endif
-int wmain( int /*argc*/ , wchar_t * /*argv*/ [] ) {
+int wmain( int argc, wchar_t * argv [] ) {
 #else
-int main( int /*argc*/ , char * /*argv*/ [] ) {
+int main( int argc, char * argv [] ) {
 #endif
 	try {
-	
+
+		// "--benchmark [name...]" runs the benchmarks instead of the tests. Benchmark names are plain ASCII.
+		std::vector<std::string> args;
+		for ( int i = 1; i < argc; ++i ) {
+			std::string arg;
+			for ( std::size_t j = 0; argv[i][j] != 0; ++j ) {
+				arg.push_back( static_cast<char>( argv[i][j] ) );
+			}
+			args.push_back( arg );
+		}
+		if ( !args.empty() && args[0] == "--benchmark" ) {
+			Test::DoBenchmarks( std::vector<std::string>( args.begin() + 1, args.end() ) );
+			return 0;
+		}
+
 		// run test with "C" / classic() locale
 		Test::DoTests();
 
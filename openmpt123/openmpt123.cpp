@@ -38,6 +38,7 @@ static const char * const license =
 #include "openmpt123_config.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <deque>
 #include <fstream>
 #include <iomanip>
@@ -46,11 +47,13 @@ static const char * const license =
 #include <limits>
 #include <locale>
 #include <map>
+#include <memory>
 #include <random>
 #include <set>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include <cassert>
@@ -93,9 +96,11 @@ static const char * const license =
 #endif
 
 #include <libopenmpt/libopenmpt.hpp>
+#include <libopenmpt/libopenmpt_ext.hpp>
 
 #include "openmpt123.hpp"
 
+#include "openmpt123_async.hpp"
 #include "openmpt123_flac.hpp"
 #include "openmpt123_mmio.hpp"
 #include "openmpt123_sndfile.hpp"
@@ -192,6 +197,18 @@ static void set_input_mode() {
 class file_audio_stream_raii : public file_audio_stream_base {
 private:
 	std::unique_ptr<file_audio_stream_base> impl;
+#if defined( MPT_WITH_THREADS )
+	// destroyed before impl, so all queued audio gets written to the file before it is closed
+	std::unique_ptr<async_audio_stream_raii> async_impl;
+#endif
+	file_audio_stream_base & stream() {
+#if defined( MPT_WITH_THREADS )
+		if ( async_impl ) {
+			return *async_impl;
+		}
+#endif
+		return *impl;
+	}
 public:
 	file_audio_stream_raii( const commandlineflags & flags, const std::string & filename, std::ostream & log )
 		: impl(nullptr)
@@ -222,21 +239,34 @@ public:
 		if ( !impl ) {
 			throw exception( "file format handler '" + flags.output_extension + "' not found" );
 		}
+#if defined( MPT_WITH_THREADS )
+		if ( flags.write_queue > 0 ) {
+			async_impl = std::make_unique<async_audio_stream_raii>( *impl, static_cast<std::size_t>( flags.write_queue ) );
+		}
+#endif
 	}
 	virtual ~file_audio_stream_raii() {
 		return;
 	}
+	// Wait for all audio to be written and report any errors that occurred on the writer thread.
+	void flush() {
+#if defined( MPT_WITH_THREADS )
+		if ( async_impl ) {
+			async_impl->flush();
+		}
+#endif
+	}
 	void write_metadata( std::map<std::string,std::string> metadata ) override {
-		impl->write_metadata( metadata );
+		stream().write_metadata( metadata );
 	}
 	void write_updated_metadata( std::map<std::string,std::string> metadata ) override {
-		impl->write_updated_metadata( metadata );
+		stream().write_updated_metadata( metadata );
 	}
 	void write( const std::vector<float*> buffers, std::size_t frames ) override {
-		impl->write( buffers, frames );
+		stream().write( buffers, frames );
 	}
 	void write( const std::vector<std::int16_t*> buffers, std::size_t frames ) override {
-		impl->write( buffers, frames );
+		stream().write( buffers, frames );
 	}
 };                                                                                                                
 
@@ -298,6 +328,12 @@ static std::ostream & operator << ( std::ostream & s, const commandlineflags & f
 	s << "Tempo: " << tempo_flag_to_double( flags.tempo ) << std::endl;
 	s << "Pitch: " << pitch_flag_to_double( flags.pitch ) << std::endl;
 	s << "Output dithering: " << flags.dither << std::endl;
+	s << "Write queue: " << flags.write_queue << std::endl;
+	s << "Prefetch: " << flags.prefetch << "ms" << std::endl;
+	s << "Render threads: " << flags.render_threads << std::endl;
+	s << "Stems: " << stems_to_string( flags.stems ) << std::endl;
+	s << "Peaks: " << flags.peaks << std::endl;
+	s << "ReplayGain: " << flags.replaygain << std::endl;
 	s << "Repeat count: " << flags.repeatcount << std::endl;
 	s << "Seek target: " << flags.seek_target << std::endl;
 	s << "End time: " << flags.end_time << std::endl;
@@ -655,6 +691,7 @@ static void show_help( textout & log, bool with_info = true, bool longhelp = fal
 		log << "     --repeat n             Repeat song n times (-1 means forever) [default: " << commandlineflags().repeatcount << "]" << std::endl;
 		log << "     --seek n               Seek to n seconds on start [default: " << commandlineflags().seek_target << "]" << std::endl;
 		log << "     --end-time n           Play until position is n seconds (0 means until the end) [default: " << commandlineflags().end_time << "]" << std::endl;
+		log << "     --prefetch n           Load the next playlist entry in the background and pre-render its first n ms (0 disables prefetching) [default: " << commandlineflags().prefetch << "]" << std::endl;
 		log << std::endl;
 		log << "     --ctl c=v              Set libopenmpt ctl c to value v" << std::endl;
 		log << std::endl;
@@ -667,6 +704,14 @@ static void show_help( textout & log, bool with_info = true, bool longhelp = fal
 		log << "     --output-type t        Use output format t when writing to a individual PCM files (only applies to --render mode) [default: " << commandlineflags().output_extension << "]" << std::endl;
 		log << " -o, --output f             Write PCM output to file f instead of streaming to audio device (only applies to --ui and --batch modes) [default: " << commandlineflags().output_filename << "]" << std::endl;
 		log << "     --force                Force overwriting of output file [default: " << commandlineflags().force_overwrite << "]" << std::endl;
+		log << "     --write-queue n        Queue up to n rendered blocks for a separate file writer thread (0 writes synchronously) [default: " << commandlineflags().write_queue << "]" << std::endl;
+		log << "     --render-threads n     Render long modules in segments on n threads (0 uses all cores, only applies to --render mode). The output stays identical to 1 thread [default: " << commandlineflags().render_threads << "]" << std::endl;
+		log << "     --stems                Write one stereo file per pattern channel instead of the mix, in a single pass (only applies to --render mode)" << std::endl;
+		log << "     --instrument-stems     Write one stereo file per instrument (or sample) instead of the mix, in a single pass (only applies to --render mode)" << std::endl;
+		log << "     --preview              Render at low cost for previews: 11025 Hz, mono, linear interpolation, no reverb, plugins or DSP effects" << std::endl;
+		log << "                            (use --samplerate or --channels after --preview to override)" << std::endl;
+		log << "     --peaks n              Write the minimum and maximum value of every n frames to a text file instead of PCM data (only applies to --render mode) [default: " << commandlineflags().peaks << "]" << std::endl;
+		log << "     --replaygain           Measure the loudness (EBU R128) while rendering and write ReplayGain tags to the output file (only applies to --render mode) [default: " << commandlineflags().replaygain << "]" << std::endl;
 		log << std::endl;
 		log << "     --                     Interpret further arguments as filenames" << std::endl;
 		log << std::endl;
@@ -749,6 +794,32 @@ static void apply_mod_settings( commandlineflags & flags, Tmod & mod ) {
 	mod.ctl_set_integer( "dither", flags.dither );
 }
 
+// The settings that can be changed with keys while a module is playing.
+struct live_settings {
+	std::int32_t gain;
+	std::int32_t separation;
+	std::int32_t filtertaps;
+	std::int32_t ramping;
+	std::int32_t tempo;
+	std::int32_t pitch;
+	explicit live_settings( const commandlineflags & flags )
+		: gain(flags.gain)
+		, separation(flags.separation)
+		, filtertaps(flags.filtertaps)
+		, ramping(flags.ramping)
+		, tempo(flags.tempo)
+		, pitch(flags.pitch)
+	{
+		return;
+	}
+	bool operator == ( const live_settings & other ) const {
+		return gain == other.gain && separation == other.separation && filtertaps == other.filtertaps && ramping == other.ramping && tempo == other.tempo && pitch == other.pitch;
+	}
+	bool operator != ( const live_settings & other ) const {
+		return !( *this == other );
+	}
+};
+
 struct prev_file { int count; prev_file( int c ) : count(c) { } };
 struct next_file { int count; next_file( int c ) : count(c) { } };
 
@@ -1018,19 +1089,404 @@ static void draw_channel_meters( std::ostream & log, float peak_left, float peak
 	log << peak_to_string_left( peak_left, width / 2 ) << ( width % 2 == 1 ? ":" : "" ) << peak_to_string_right( peak_right, width / 2 );
 }
 
-template < typename Tsample, typename Tmod >
-void render_loop( commandlineflags & flags, Tmod & mod, double & duration, textout & log, write_buffers_interface & audio_stream ) {
-
-	log.writeout();
-
-	std::size_t bufsize;
+static std::size_t get_render_bufsize( const commandlineflags & flags ) {
 	if ( flags.mode == Mode::UI ) {
-		bufsize = std::min( flags.ui_redraw_interval, flags.period ) * flags.samplerate / 1000;
+		return std::min( flags.ui_redraw_interval, flags.period ) * flags.samplerate / 1000;
 	} else if ( flags.mode == Mode::Batch ) {
-		bufsize = flags.period * flags.samplerate / 1000;
+		return flags.period * flags.samplerate / 1000;
 	} else {
-		bufsize = 1024;
+		return 1024;
+	}
+}
+
+// Audio that has been rendered from a module in advance and is played before rendering continues.
+class parallel_renderer;
+
+struct prerendered_audio {
+	std::vector<std::vector<float>> float_channels;
+	std::vector<std::vector<std::int16_t>> int_channels;
+	std::size_t frames = 0;
+	template < typename Tsample >
+	std::vector<std::vector<Tsample>> & channels() {
+		if constexpr ( std::is_same<Tsample, float>::value ) {
+			return float_channels;
+		} else {
+			return int_channels;
+		}
+	}
+};
+
+#if defined( MPT_WITH_THREADS )
+
+// Renders a single module on multiple threads in --render mode, with output identical to serial rendering.
+// The song is cut into segments at render block boundaries, and each segment is rendered by its own module instance.
+// Such an instance seeks (with sample sync) to a few seconds before its segment and renders up to the segment start
+// without output, which gives voices, ramping and filters time to settle into the same state as in serial rendering.
+// A segment is only used if it renders exactly like its predecessor for a short overlap and both instances then report
+// the same complete playback and mixer state (ctl play.state_hash), which covers voices, ramping, filter and resampler
+// history as well as effect memory. The state cannot be compared if reverb, plugins or other effects with a tail are used.
+// As soon as one segment cannot be joined, the rest of the song is rendered serially.
+// Workers only render a limited number of segments ahead of the output, which bounds the amount of buffered audio.
+class parallel_renderer {
+private:
+	static constexpr double preroll_seconds = 5.0;
+	static constexpr double overlap_seconds = 0.5;
+	static constexpr double min_segment_seconds = 30.0;
+	static constexpr double max_segment_seconds = 60.0;
+	struct render_position {
+		std::int32_t order = -1;
+		std::int32_t pattern = -1;
+		std::int32_t row = -1;
+		std::int32_t speed = -1;
+		std::int32_t tempo = -1;
+		std::int32_t playing_channels = -1;
+		std::vector<float> channel_vu;
+		std::int64_t state_hash = -1; // -1 if the state cannot be compared
+		bool operator == ( const render_position & other ) const {
+			return order == other.order && pattern == other.pattern && row == other.row && speed == other.speed && tempo == other.tempo && playing_channels == other.playing_channels && channel_vu == other.channel_vu && state_hash == other.state_hash;
+		}
+	};
+	struct segment {
+		std::int64_t begin = 0;
+		std::int64_t end = -1; // -1 for the last segment
+		std::unique_ptr<std::ostringstream> silentlog; // mod keeps a reference to it, so it has to outlive mod
+		std::unique_ptr<openmpt::module> mod;
+		prerendered_audio audio; // starts at begin, continues for overlap frames past end
+		std::int64_t mod_frame = 0; // position of mod, in frames
+		render_position overlap_position; // position of mod after rendering the first overlap frames
+		bool valid = false;
+		bool done = false;
+		void clear() {
+			mod.reset();
+			*this = segment();
+		}
+	};
+	const commandlineflags flags;
+	const std::vector<char> & data;
+	const std::size_t bufsize;
+	const std::int64_t overlap;
+	const std::size_t max_segments_ahead;
+	std::vector<segment> segments;
+	std::atomic<std::size_t> next_job;
+	std::atomic<bool> stop;
+	std::mutex mutex;
+	std::condition_variable cond;
+	std::vector<std::thread> threads;
+	// Instance that renders exactly like serial rendering, and the audio it has rendered but not output yet
+	std::unique_ptr<std::ostringstream> chain_silentlog;
+	std::unique_ptr<openmpt::module> chain;
+	prerendered_audio chain_audio;
+	std::int64_t chain_audio_begin = 0;
+	std::int64_t chain_frame = 0;
+	bool chain_ended = false;
+	std::int64_t output_frame = 0;
+	std::size_t next_segment = 0; // modified with the mutex held, as the workers wait for it
+	std::size_t joined_segments = 0;
+	template < typename Tsample >
+	std::size_t read_mod( openmpt::module & mod, std::size_t count, prerendered_audio & audio ) {
+		std::vector<std::vector<Tsample>> & channels = audio.channels<Tsample>();
+		if ( channels.size() != static_cast<std::size_t>( flags.channels ) ) {
+			channels.resize( flags.channels );
+		}
+		for ( auto & channel : channels ) {
+			channel.resize( audio.frames + count );
+		}
+		std::size_t frames = 0;
+		switch ( flags.channels ) {
+			case 1: frames = mod.read( flags.samplerate, count, channels[0].data() + audio.frames ); break;
+			case 2: frames = mod.read( flags.samplerate, count, channels[0].data() + audio.frames, channels[1].data() + audio.frames ); break;
+			case 4: frames = mod.read( flags.samplerate, count, channels[0].data() + audio.frames, channels[1].data() + audio.frames, channels[2].data() + audio.frames, channels[3].data() + audio.frames ); break;
+		}
+		audio.frames += frames;
+		for ( auto & channel : channels ) {
+			channel.resize( audio.frames );
+		}
+		return frames;
+	}
+	static render_position get_render_position( const openmpt::module & mod ) {
+		render_position result;
+		result.order = mod.get_current_order();
+		result.pattern = mod.get_current_pattern();
+		result.row = mod.get_current_row();
+		result.speed = mod.get_current_speed();
+		result.tempo = mod.get_current_tempo();
+		result.playing_channels = mod.get_current_playing_channels();
+		for ( std::int32_t channel = 0; channel < mod.get_num_channels(); ++channel ) {
+			result.channel_vu.push_back( mod.get_current_channel_vu_mono( channel ) );
+		}
+		result.state_hash = mod.ctl_get_integer( "play.state_hash" );
+		return result;
+	}
+	template < typename Tsample >
+	void render_segment( segment & seg ) {
+		commandlineflags mod_flags = flags;
+		seg.silentlog = std::make_unique<std::ostringstream>();
+		seg.mod = std::make_unique<openmpt::module>( data, *seg.silentlog, flags.ctls );
+		openmpt::module & mod = *seg.mod;
+		mod.select_subsong( flags.subsong );
+		mod.set_repeat_count( mod_flags.repeatcount );
+		apply_mod_settings( mod_flags, mod );
+		prerendered_audio scratch;
+		if ( seg.begin > 0 ) {
+			// Seeking depends on the tick lengths at the output sample rate
+			Tsample dummy[4] = { };
+			switch ( flags.channels ) {
+				case 1: mod.read( flags.samplerate, 0, &dummy[0] ); break;
+				case 2: mod.read( flags.samplerate, 0, &dummy[0], &dummy[1] ); break;
+				case 4: mod.read( flags.samplerate, 0, &dummy[0], &dummy[1], &dummy[2], &dummy[3] ); break;
+			}
+			mod.ctl_set_boolean( "seek.sync_samples", true );
+			const double target = static_cast<double>( seg.begin ) / flags.samplerate - preroll_seconds;
+			if ( target > 0.0 ) {
+				mod.set_position_seconds( target );
+				seg.mod_frame = std::llround( mod.get_position_seconds() * flags.samplerate );
+			}
+			if ( seg.mod_frame > seg.begin ) {
+				return;
+			}
+			while ( seg.mod_frame < seg.begin && !stop ) {
+				scratch.frames = 0;
+				const std::size_t frames = read_mod<Tsample>( mod, static_cast<std::size_t>( std::min( static_cast<std::int64_t>( bufsize ), seg.begin - seg.mod_frame ) ), scratch );
+				if ( frames == 0 ) {
+					return;
+				}
+				seg.mod_frame += frames;
+			}
+		}
+		while ( ( seg.end < 0 || seg.mod_frame < seg.end + overlap ) && !stop ) {
+			const std::size_t frames = read_mod<Tsample>( mod, bufsize, seg.audio );
+			seg.mod_frame += frames;
+			if ( seg.mod_frame == seg.begin + overlap ) {
+				seg.overlap_position = get_render_position( mod );
+			}
+			if ( frames == 0 ) {
+				break;
+			}
+		}
+		seg.valid = !stop;
+	}
+	template < typename Tsample >
+	void worker() {
+		while ( !stop ) {
+			const std::size_t job = next_job++;
+			if ( job >= segments.size() ) {
+				break;
+			}
+			{
+				// Do not get too far ahead of the output, finished segments are kept in memory until they are joined
+				std::unique_lock<std::mutex> lock( mutex );
+				cond.wait( lock, [this, job]() { return stop || job < next_segment + max_segments_ahead; } );
+			}
+			segment & seg = segments[job];
+			try {
+				render_segment<Tsample>( seg );
+			} catch ( ... ) {
+				seg.valid = false;
+			}
+			std::lock_guard<std::mutex> guard( mutex );
+			seg.done = true;
+			cond.notify_all();
+		}
+	}
+	void render_rest_serially() {
+		{
+			std::lock_guard<std::mutex> guard( mutex );
+			stop = true;
+			next_segment = segments.size();
+			cond.notify_all();
+		}
+		for ( auto & thread : threads ) {
+			thread.join();
+		}
+		threads.clear();
+		for ( auto & seg : segments ) {
+			seg.clear();
+		}
+	}
+	// Continue rendering with the current chain instance
+	template < typename Tsample >
+	bool extend_chain() {
+		if ( chain_ended ) {
+			return false;
+		}
+		if ( chain_audio_begin + static_cast<std::int64_t>( chain_audio.frames ) == output_frame ) {
+			// everything has been output, start over to keep memory usage bounded
+			chain_audio.frames = 0;
+			chain_audio_begin = output_frame;
+		}
+		const std::size_t frames = read_mod<Tsample>( *chain, bufsize, chain_audio );
+		chain_frame += frames;
+		chain_ended = ( frames == 0 );
+		return frames > 0;
+	}
+	template < typename Tsample >
+	static bool same_audio( prerendered_audio & a, std::size_t a_offset, prerendered_audio & b, std::size_t b_offset, std::size_t frames ) {
+		const std::vector<std::vector<Tsample>> & a_channels = a.channels<Tsample>();
+		const std::vector<std::vector<Tsample>> & b_channels = b.channels<Tsample>();
+		for ( std::size_t channel = 0; channel < a_channels.size(); ++channel ) {
+			if ( std::memcmp( a_channels[channel].data() + a_offset, b_channels[channel].data() + b_offset, frames * sizeof( Tsample ) ) != 0 ) {
+				return false;
+			}
+		}
+		return true;
+	}
+	// Switch the chain over to the next segment if it continues exactly like the chain would
+	template < typename Tsample >
+	void join_next_segment() {
+		segment & seg = segments[next_segment];
+		{
+			std::unique_lock<std::mutex> lock( mutex );
+			next_segment++;
+			cond.notify_all();
+			cond.wait( lock, [&seg]() { return seg.done; } );
+		}
+		if ( seg.begin == 0 ) {
+			if ( !seg.valid ) {
+				throw exception( "parallel rendering failed" );
+			}
+		} else {
+			while ( chain_frame < seg.begin + overlap && extend_chain<Tsample>() ) {
+			}
+			if ( chain_frame < seg.begin + overlap ) {
+				// the song ends before the overlap, so there is nothing left to join
+				seg.clear();
+				return;
+			}
+			const bool joinable = seg.valid
+				&& seg.audio.frames >= static_cast<std::size_t>( overlap )
+				&& chain_frame == seg.begin + overlap
+				&& seg.overlap_position.state_hash >= 0
+				&& get_render_position( *chain ) == seg.overlap_position
+				&& same_audio<Tsample>( chain_audio, static_cast<std::size_t>( seg.begin - chain_audio_begin ), seg.audio, 0, static_cast<std::size_t>( overlap ) );
+			if ( !joinable ) {
+				// Later segments would be compared against a chain that they were not checked against, so stop parallel rendering altogether
+				seg.clear();
+				render_rest_serially();
+				return;
+			}
+		}
+		chain = std::move( seg.mod );
+		chain_silentlog = std::move( seg.silentlog );
+		chain_audio = std::move( seg.audio );
+		chain_audio_begin = seg.begin;
+		chain_frame = seg.mod_frame;
+		chain_ended = ( seg.end < 0 );
+		joined_segments++;
+		seg.clear();
+	}
+public:
+	parallel_renderer( const commandlineflags & flags_, const std::vector<char> & data_, double duration, std::size_t bufsize_, std::size_t num_segments )
+		: flags(flags_)
+		, data(data_)
+		, bufsize(bufsize_)
+		, overlap(static_cast<std::int64_t>( ( std::llround( overlap_seconds * flags_.samplerate ) + bufsize_ - 1 ) / bufsize_ * bufsize_ ))
+		, max_segments_ahead(static_cast<std::size_t>( get_num_threads( flags_ ) ))
+		, next_job(0)
+		, stop(false)
+	{
+		const std::int64_t total_frames = std::llround( duration * flags.samplerate );
+		segments.resize( num_segments );
+		for ( std::size_t i = 0; i < num_segments; ++i ) {
+			segments[i].begin = total_frames * static_cast<std::int64_t>( i ) / static_cast<std::int64_t>( num_segments ) / static_cast<std::int64_t>( bufsize ) * static_cast<std::int64_t>( bufsize );
+			if ( i > 0 ) {
+				segments[i - 1].end = segments[i].begin;
+			}
+		}
+		const std::size_t num_threads = std::min( num_segments, static_cast<std::size_t>( get_num_threads( flags ) ) );
+		for ( std::size_t i = 0; i < num_threads; ++i ) {
+			if ( flags.use_float ) {
+				threads.emplace_back( [this]() { worker<float>(); } );
+			} else {
+				threads.emplace_back( [this]() { worker<std::int16_t>(); } );
+			}
+		}
+	}
+	~parallel_renderer() {
+		{
+			std::lock_guard<std::mutex> guard( mutex );
+			stop = true;
+			cond.notify_all();
+		}
+		for ( auto & thread : threads ) {
+			thread.join();
+		}
+	}
+	template < typename Tsample >
+	std::size_t read( std::size_t count, const std::vector<Tsample*> & buffers ) {
+		std::size_t written = 0;
+		while ( written < count ) {
+			if ( next_segment < segments.size() && output_frame == segments[next_segment].begin ) {
+				join_next_segment<Tsample>();
+				continue;
+			}
+			std::int64_t available = chain_audio_begin + static_cast<std::int64_t>( chain_audio.frames ) - output_frame;
+			if ( next_segment < segments.size() ) {
+				available = std::min( available, segments[next_segment].begin - output_frame );
+			}
+			if ( available <= 0 ) {
+				if ( !extend_chain<Tsample>() ) {
+					break;
+				}
+				continue;
+			}
+			const std::size_t frames = std::min( count - written, static_cast<std::size_t>( available ) );
+			const std::size_t offset = static_cast<std::size_t>( output_frame - chain_audio_begin );
+			for ( int channel = 0; channel < flags.channels; ++channel ) {
+				const std::vector<Tsample> & src = chain_audio.channels<Tsample>()[channel];
+				std::copy( src.begin() + offset, src.begin() + offset + frames, buffers[channel] + written );
+			}
+			written += frames;
+			output_frame += frames;
+		}
+		return written;
+	}
+	double get_position_seconds() const {
+		return static_cast<double>( output_frame ) / flags.samplerate;
+	}
+	std::size_t get_num_segments() const {
+		return segments.size();
+	}
+	std::size_t get_num_joined_segments() const {
+		return joined_segments;
+	}
+	static std::int32_t get_num_threads( const commandlineflags & flags ) {
+		return flags.render_threads > 0 ? flags.render_threads : std::max( static_cast<std::int32_t>( std::thread::hardware_concurrency() ), std::int32_t(1) );
+	}
+	// Returns the number of segments that mod should be split into, or 0 if it should be rendered serially.
+	static std::size_t get_num_segments( const commandlineflags & flags, const openmpt::module & mod, double duration ) {
+		if ( flags.mode != Mode::Render || get_num_threads( flags ) < 2 ) {
+			return 0;
+		}
+		// Repeating, seeking and dithering cannot be reproduced from a seek point
+		if ( flags.repeatcount != 0 || flags.seek_target > 0.0 || flags.end_time > 0.0 || ( !flags.use_float && flags.dither != 0 ) ) {
+			return 0;
+		}
+		// Loudness can only be measured by an instance that renders the whole song
+		if ( flags.replaygain ) {
+			return 0;
+		}
+		if ( flags.subsong == -1 && mod.get_num_subsongs() > 1 ) {
+			return 0;
+		}
+		std::size_t num_segments = std::min( static_cast<std::size_t>( get_num_threads( flags ) ) * 2, static_cast<std::size_t>( duration / min_segment_seconds ) );
+		if ( num_segments < 2 ) {
+			return 0;
+		}
+		// Shorter segments for very long songs, so that the audio buffered ahead of the output stays bounded
+		num_segments = std::max( num_segments, static_cast<std::size_t>( std::ceil( duration / max_segment_seconds ) ) );
+		return num_segments;
 	}
+};
+
+#endif // MPT_WITH_THREADS
+
+template < typename Tsample, typename Tmod >
+void render_loop( commandlineflags & flags, Tmod & mod, double & duration, textout & log, write_buffers_interface & audio_stream, prerendered_audio * prerendered = nullptr, parallel_renderer * parallel = nullptr ) {
+
+	log.writeout();
+
+	const std::size_t bufsize = get_render_bufsize( flags );
+	std::size_t prerendered_pos = 0;
 
 	std::int64_t last_redraw_frame = std::int64_t{0} - flags.ui_redraw_interval;
 	std::int64_t rendered_frames = 0;
@@ -1095,6 +1551,10 @@ void render_loop( commandlineflags & flags, Tmod & mod, double & duration, texto
 
 		if ( flags.mode == Mode::UI ) {
 
+			const bool has_prerendered = prerendered && prerendered_pos < prerendered->frames;
+			const live_settings settings_before( flags );
+			const double position_before = has_prerendered ? mod.get_position_seconds() : 0.0;
+
 #if defined( __DJGPP__ )
 
 			while ( kbhit() ) {
@@ -1143,6 +1603,11 @@ void render_loop( commandlineflags & flags, Tmod & mod, double & duration, texto
 
 #endif
 
+			if ( has_prerendered && ( live_settings( flags ) != settings_before || mod.get_position_seconds() != position_before ) ) {
+				// The rest of the pre-rendered audio does not match the new settings or position anymore.
+				prerendered = nullptr;
+			}
+
 			if ( flags.paused ) {
 				audio_stream.sleep( flags.ui_redraw_interval );
 				continue;
@@ -1158,12 +1623,32 @@ void render_loop( commandlineflags & flags, Tmod & mod, double & duration, texto
 
 		std::size_t count = 0;
 
-		switch ( flags.channels ) {
-			case 1: count = mod.read( flags.samplerate, bufsize, left.data() ); break;
-			case 2: count = mod.read( flags.samplerate, bufsize, left.data(), right.data() ); break;
-			case 4: count = mod.read( flags.samplerate, bufsize, left.data(), right.data(), rear_left.data(), rear_right.data() ); break;
+		if ( prerendered && prerendered_pos < prerendered->frames ) {
+			count = std::min( bufsize, prerendered->frames - prerendered_pos );
+			for ( int channel = 0; channel < flags.channels; ++channel ) {
+				const std::vector<Tsample> & src = prerendered->channels<Tsample>()[channel];
+				std::copy( src.begin() + prerendered_pos, src.begin() + prerendered_pos + count, buffers[channel] );
+			}
+			prerendered_pos += count;
+#if defined( MPT_WITH_THREADS )
+		} else if ( parallel ) {
+			count = parallel->read<Tsample>( bufsize, buffers );
+#endif
+		} else {
+			switch ( flags.channels ) {
+				case 1: count = mod.read( flags.samplerate, bufsize, left.data() ); break;
+				case 2: count = mod.read( flags.samplerate, bufsize, left.data(), right.data() ); break;
+				case 4: count = mod.read( flags.samplerate, bufsize, left.data(), right.data(), rear_left.data(), rear_right.data() ); break;
+			}
 		}
 		
+		double position_seconds = mod.get_position_seconds();
+#if defined( MPT_WITH_THREADS )
+		if ( parallel ) {
+			position_seconds = parallel->get_position_seconds();
+		}
+#endif
+
 		char cpu_str[64] = "";
 		if ( flags.show_details ) {
 			cpu_end = std::clock();
@@ -1291,7 +1776,7 @@ void render_loop( commandlineflags & flags, Tmod & mod, double & duration, texto
 				}
 			}
 			if ( flags.show_progress ) {
-				log << "Position...: " << seconds_to_string( mod.get_position_seconds() ) << " / " << seconds_to_string( duration ) << "   " << std::endl;
+				log << "Position...: " << seconds_to_string( position_seconds ) << " / " << seconds_to_string( duration ) << "   " << std::endl;
 			}
 		} else if ( flags.show_channel_meters ) {
 			if ( flags.show_ui || flags.show_details || flags.show_progress ) {
@@ -1351,7 +1836,7 @@ void render_loop( commandlineflags & flags, Tmod & mod, double & duration, texto
 			}
 			if ( flags.show_progress ) {
 				log << " ";
-				log << seconds_to_string( mod.get_position_seconds() );
+				log << seconds_to_string( position_seconds );
 				log << "/";
 				log << seconds_to_string( duration );
 			}
@@ -1366,6 +1851,11 @@ void render_loop( commandlineflags & flags, Tmod & mod, double & duration, texto
 			break;
 		}
 		
+		if ( prerendered && prerendered_pos < prerendered->frames ) {
+			// the module has already been rendered up to the end of the prerendered audio
+			continue;
+		}
+
 		if ( flags.end_time > 0 && mod.get_position_seconds() >= flags.end_time ) {
 			break;
 		}
@@ -1472,17 +1962,48 @@ static void probe_mod_file( commandlineflags & flags, const std::string & filena
 
 }
 
+// A module that has been loaded in the background, with all settings applied and its first few hundred milliseconds already rendered.
+struct prefetched_module {
+	std::ostringstream silentlog; // mod keeps a reference to it, so it is declared first and thus destroyed last
+	std::unique_ptr<openmpt::module> mod;
+	std::uint64_t filesize = 0;
+	double duration = 0.0;
+	prerendered_audio audio;
+};
+
+// Writes the loudness that has been measured while rendering mod as ReplayGain 2.0 tags (reference level -18 LUFS).
+template < typename Tmod >
+static void write_replaygain( Tmod & mod, textout & log, write_buffers_interface & audio_stream ) {
+	const double loudness = mod.ctl_get_floatingpoint( "analysis.loudness.integrated" );
+	const double range = mod.ctl_get_floatingpoint( "analysis.loudness.range" );
+	const double true_peak = mod.ctl_get_floatingpoint( "analysis.loudness.true_peak" );
+	std::ostringstream str;
+	str << std::fixed << std::setprecision( 1 ) << loudness << " LUFS, range " << range << " LU, true peak " << true_peak << " dBTP";
+	log << "Loudness: " << str.str() << std::endl;
+	if ( !std::isfinite( loudness ) ) {
+		return;
+	}
+	std::map<std::string,std::string> metadata = get_metadata( mod );
+	std::ostringstream gain;
+	gain << std::fixed << std::setprecision( 2 ) << ( -18.0 - loudness ) << " dB";
+	metadata[ "replaygain_track_gain" ] = gain.str();
+	std::ostringstream peak;
+	peak << std::fixed << std::setprecision( 6 ) << std::pow( 10.0, true_peak / 20.0 );
+	metadata[ "replaygain_track_peak" ] = peak.str();
+	audio_stream.write_updated_metadata( metadata );
+}
+
 template < typename Tmod >
-void render_mod_file( commandlineflags & flags, const std::string & filename, std::uint64_t filesize, Tmod & mod, textout & log, write_buffers_interface & audio_stream ) {
+void render_mod_file( commandlineflags & flags, const std::string & filename, std::uint64_t filesize, Tmod & mod, textout & log, write_buffers_interface & audio_stream, prefetched_module * prefetched = nullptr, const std::vector<char> * data = nullptr ) {
 
 	log.writeout();
 
-	if ( flags.mode != Mode::Probe && flags.mode != Mode::Info ) {
+	if ( !prefetched && flags.mode != Mode::Probe && flags.mode != Mode::Info ) {
 		mod.set_repeat_count( flags.repeatcount );
 		apply_mod_settings( flags, mod );
 	}
 	
-	double duration = mod.get_duration_seconds();
+	double duration = prefetched ? prefetched->duration : mod.get_duration_seconds();
 
 	std::vector<field> fields;
 
@@ -1539,6 +2060,9 @@ void render_mod_file( commandlineflags & flags, const std::string & filename, st
 		set_field( fields, "Instruments" ).ostream() << mod.get_num_instruments();
 		set_field( fields, "Samples" ).ostream() << mod.get_num_samples();
 	}
+	if ( flags.mode == Mode::Info ) {
+		set_field( fields, "Fingerprint" ).ostream() << mod.get_metadata( "fingerprint" ) << " (fuzzy: " << mod.get_metadata( "fingerprint_fuzzy" ) << ")";
+	}
 	if ( flags.show_message ) {
 		set_field( fields, "Message" ).ostream() << mod.get_metadata( "message" );
 	}
@@ -1557,19 +2081,41 @@ void render_mod_file( commandlineflags & flags, const std::string & filename, st
 		return;
 	}
 
-	if ( flags.seek_target > 0.0 ) {
+	if ( !prefetched && flags.seek_target > 0.0 ) {
 		mod.set_position_seconds( flags.seek_target );
 	}
 
+	parallel_renderer * parallel = nullptr;
+#if defined( MPT_WITH_THREADS )
+	std::unique_ptr<parallel_renderer> parallel_storage;
+	if ( data ) {
+		const std::size_t num_segments = parallel_renderer::get_num_segments( flags, mod, duration );
+		if ( num_segments > 0 ) {
+			parallel_storage = std::make_unique<parallel_renderer>( flags, *data, duration, get_render_bufsize( flags ), num_segments );
+			parallel = parallel_storage.get();
+		}
+	}
+#else
+	static_cast<void>( data );
+#endif
+
 	try {
 		if ( flags.use_float ) {
-			render_loop<float>( flags, mod, duration, log, audio_stream );
+			render_loop<float>( flags, mod, duration, log, audio_stream, prefetched ? &prefetched->audio : nullptr, parallel );
 		} else {
-			render_loop<std::int16_t>( flags, mod, duration, log, audio_stream );
+			render_loop<std::int16_t>( flags, mod, duration, log, audio_stream, prefetched ? &prefetched->audio : nullptr, parallel );
+		}
+#if defined( MPT_WITH_THREADS )
+		if ( parallel && flags.verbose ) {
+			log << "Parallel rendering: " << parallel->get_num_joined_segments() << " of " << parallel->get_num_segments() << " segments rendered in parallel" << std::endl;
 		}
+#endif
 		if ( flags.show_progress ) {
 			log << std::endl;
 		}
+		if ( flags.replaygain ) {
+			write_replaygain( mod, log, audio_stream );
+		}
 	} catch ( ... ) {
 		if ( flags.show_progress ) {
 			log << std::endl;
@@ -1581,6 +2127,45 @@ void render_mod_file( commandlineflags & flags, const std::string & filename, st
 
 }
 
+#if defined(WIN32) && defined(UNICODE) && !defined(_MSC_VER)
+typedef std::istringstream file_input_stream;
+#else
+typedef std::ifstream file_input_stream;
+#endif
+
+static std::uint64_t open_file_input_stream( file_input_stream & file_stream, const std::string & filename ) {
+	std::uint64_t filesize = 0;
+	#if defined(WIN32) && defined(UNICODE) && !defined(_MSC_VER)
+		// Only MSVC has std::ifstream::ifstream(std::wstring).
+		// Fake it for other compilers using _wfopen().
+		std::string data;
+		FILE * f = _wfopen( utf8_to_wstring( filename ).c_str(), L"rb" );
+		if ( f ) {
+			while ( !feof( f ) ) {
+				static const std::size_t BUFFER_SIZE = 4096;
+				char buffer[BUFFER_SIZE];
+				size_t data_read = fread( buffer, 1, BUFFER_SIZE, f );
+				std::copy( buffer, buffer + data_read, std::back_inserter( data ) );
+			}
+			fclose( f );
+			f = NULL;
+		}
+		file_stream.str( data );
+		filesize = data.length();
+	#elif defined(_MSC_VER) && defined(UNICODE)
+		file_stream.open( utf8_to_wstring( filename ), std::ios::binary );
+		file_stream.seekg( 0, std::ios::end );
+		filesize = file_stream.tellg();
+		file_stream.seekg( 0, std::ios::beg );
+	#else
+		file_stream.open( filename, std::ios::binary );
+		file_stream.seekg( 0, std::ios::end );
+		filesize = file_stream.tellg();
+		file_stream.seekg( 0, std::ios::beg );
+	#endif
+	return filesize;
+}
+
 static void probe_file( commandlineflags & flags, const std::string & filename, textout & log ) {
 
 	log.writeout();
@@ -1589,42 +2174,11 @@ static void probe_file( commandlineflags & flags, const std::string & filename,
 
 	try {
 
-#if defined(WIN32) && defined(UNICODE) && !defined(_MSC_VER)
-		std::istringstream file_stream;
-#else
-		std::ifstream file_stream;
-#endif
+		file_input_stream file_stream;
 		std::uint64_t filesize = 0;
 		bool use_stdin = ( filename == "-" );
 		if ( !use_stdin ) {
-			#if defined(WIN32) && defined(UNICODE) && !defined(_MSC_VER)
-				// Only MSVC has std::ifstream::ifstream(std::wstring).
-				// Fake it for other compilers using _wfopen().
-				std::string data;
-				FILE * f = _wfopen( utf8_to_wstring( filename ).c_str(), L"rb" );
-				if ( f ) {
-					while ( !feof( f ) ) {
-						static const std::size_t BUFFER_SIZE = 4096;
-						char buffer[BUFFER_SIZE];
-						size_t data_read = fread( buffer, 1, BUFFER_SIZE, f );
-						std::copy( buffer, buffer + data_read, std::back_inserter( data ) );
-					}
-					fclose( f );
-					f = NULL;
-				}
-				file_stream.str( data );
-				filesize = data.length();
-			#elif defined(_MSC_VER) && defined(UNICODE)
-				file_stream.open( utf8_to_wstring( filename ), std::ios::binary );
-				file_stream.seekg( 0, std::ios::end );
-				filesize = file_stream.tellg();
-				file_stream.seekg( 0, std::ios::beg );
-			#else
-				file_stream.open( filename, std::ios::binary );
-				file_stream.seekg( 0, std::ios::end );
-				filesize = file_stream.tellg();
-				file_stream.seekg( 0, std::ios::beg );
-			#endif
+			filesize = open_file_input_stream( file_stream, filename );
 		}
 		std::istream & data_stream = use_stdin ? std::cin : file_stream;
 		if ( data_stream.fail() ) {
@@ -1657,7 +2211,139 @@ static void probe_file( commandlineflags & flags, const std::string & filename,
 
 }
 
-static void render_file( commandlineflags & flags, const std::string & filename, textout & log, write_buffers_interface & audio_stream ) {
+// Returns true if a module prepared with flags a renders exactly like one prepared with flags b,
+// apart from the live_settings, which can simply be applied again.
+static bool same_render_settings( const commandlineflags & a, const commandlineflags & b ) {
+	return a.mode == b.mode
+		&& a.ui_redraw_interval == b.ui_redraw_interval && a.period == b.period
+		&& a.samplerate == b.samplerate && a.channels == b.channels && a.use_float == b.use_float
+		&& a.dither == b.dither
+		&& a.repeatcount == b.repeatcount && a.subsong == b.subsong && a.ctls == b.ctls
+		&& a.seek_target == b.seek_target && a.end_time == b.end_time;
+}
+
+// Loads and pre-renders the next playlist entry on a separate thread while the current one is playing,
+// so that switching to it does not leave a gap in the audio output.
+// If the prefetched module is not needed anymore (e.g. because the user skipped to another playlist entry),
+// the prefetching is cancelled after the current step, so that waiting for the thread never takes longer than loading the module.
+class module_prefetcher {
+private:
+	const commandlineflags flags;
+	const std::string filename;
+	std::unique_ptr<prefetched_module> result;
+	std::atomic<bool> cancelled;
+#if defined( MPT_WITH_THREADS )
+	std::thread thread;
+#endif
+	template < typename Tsample >
+	void prerender( commandlineflags & mod_flags, openmpt::module & mod, prerendered_audio & audio ) {
+		const std::size_t bufsize = get_render_bufsize( mod_flags );
+		const std::size_t frames = static_cast<std::size_t>( flags.prefetch ) * flags.samplerate / 1000;
+		const std::size_t blocks = ( frames + bufsize - 1 ) / bufsize;
+		std::vector<std::vector<Tsample>> & channels = audio.channels<Tsample>();
+		channels.assign( flags.channels, std::vector<Tsample>( blocks * bufsize ) );
+		for ( std::size_t block = 0; block < blocks; ++block ) {
+			if ( cancelled.load() ) {
+				break;
+			}
+			std::size_t count = 0;
+			switch ( flags.channels ) {
+				case 1: count = mod.read( flags.samplerate, bufsize, channels[0].data() + audio.frames ); break;
+				case 2: count = mod.read( flags.samplerate, bufsize, channels[0].data() + audio.frames, channels[1].data() + audio.frames ); break;
+				case 4: count = mod.read( flags.samplerate, bufsize, channels[0].data() + audio.frames, channels[1].data() + audio.frames, channels[2].data() + audio.frames, channels[3].data() + audio.frames ); break;
+			}
+			audio.frames += count;
+			if ( count == 0 ) {
+				break;
+			}
+			if ( flags.end_time > 0 && mod.get_position_seconds() >= flags.end_time ) {
+				break;
+			}
+		}
+	}
+	void load() {
+		try {
+			// Prepare the module exactly like render_mod_file would.
+			std::unique_ptr<prefetched_module> prefetched = std::make_unique<prefetched_module>();
+			file_input_stream file_stream;
+			prefetched->filesize = open_file_input_stream( file_stream, filename );
+			if ( file_stream.fail() ) {
+				return;
+			}
+			prefetched->mod = std::make_unique<openmpt::module>( file_stream, prefetched->silentlog, flags.ctls );
+			if ( cancelled.load() ) {
+				return;
+			}
+			prefetched->mod->select_subsong( flags.subsong );
+			commandlineflags mod_flags = flags;
+			prefetched->mod->set_repeat_count( mod_flags.repeatcount );
+			apply_mod_settings( mod_flags, *prefetched->mod );
+			prefetched->duration = prefetched->mod->get_duration_seconds();
+			if ( mod_flags.seek_target > 0.0 ) {
+				prefetched->mod->set_position_seconds( mod_flags.seek_target );
+			}
+			if ( flags.use_float ) {
+				prerender<float>( mod_flags, *prefetched->mod, prefetched->audio );
+			} else {
+				prerender<std::int16_t>( mod_flags, *prefetched->mod, prefetched->audio );
+			}
+			if ( cancelled.load() ) {
+				return;
+			}
+			result = std::move( prefetched );
+		} catch ( ... ) {
+			// Leave it to the regular loading path to report the error.
+		}
+	}
+public:
+	module_prefetcher( const commandlineflags & flags_, const std::string & filename_ )
+		: flags(flags_)
+		, filename(filename_)
+		, cancelled(false)
+	{
+#if defined( MPT_WITH_THREADS )
+		thread = std::thread( [this]() { load(); } );
+#endif
+	}
+	~module_prefetcher() {
+		cancelled.store( true );
+#if defined( MPT_WITH_THREADS )
+		if ( thread.joinable() ) {
+			thread.join();
+		}
+#endif
+	}
+	// Returns the prefetched module if it has been prepared for filename with the current settings.
+	std::unique_ptr<prefetched_module> take( const commandlineflags & current_flags, const std::string & current_filename ) {
+		const bool usable = current_filename == filename && same_render_settings( current_flags, flags );
+		if ( !usable ) {
+			cancelled.store( true );
+		}
+#if defined( MPT_WITH_THREADS )
+		if ( thread.joinable() ) {
+			thread.join();
+		}
+#endif
+		if ( !usable || !result ) {
+			return nullptr;
+		}
+		if ( live_settings( current_flags ) != live_settings( flags ) ) {
+			// Gain, tempo etc. have been changed while the previous module was playing.
+			// Apply the new settings and start over, because the pre-rendered audio does not match them.
+			commandlineflags mod_flags = current_flags;
+			apply_mod_settings( mod_flags, *result->mod );
+			result->mod->set_position_seconds( std::max( mod_flags.seek_target, 0.0 ) );
+			result->duration = result->mod->get_duration_seconds();
+			result->audio = prerendered_audio();
+		}
+		return std::move( result );
+	}
+	static bool can_prefetch( const commandlineflags & flags, const std::string & filename ) {
+		return flags.prefetch > 0 && filename != "-" && ( flags.mode == Mode::UI || flags.mode == Mode::Batch || ( flags.mode == Mode::Render && flags.render_threads == 1 ) );
+	}
+};
+
+static void render_file( commandlineflags & flags, const std::string & filename, textout & log, write_buffers_interface & audio_stream, module_prefetcher * prefetcher = nullptr ) {
 
 	log.writeout();
 
@@ -1665,53 +2351,36 @@ static void render_file( commandlineflags & flags, const std::string & filename,
 
 	try {
 
-#if defined(WIN32) && defined(UNICODE) && !defined(_MSC_VER)
-		std::istringstream file_stream;
-#else
-		std::ifstream file_stream;
-#endif
-		std::uint64_t filesize = 0;
-		bool use_stdin = ( filename == "-" );
-		if ( !use_stdin ) {
-			#if defined(WIN32) && defined(UNICODE) && !defined(_MSC_VER)
-				// Only MSVC has std::ifstream::ifstream(std::wstring).
-				// Fake it for other compilers using _wfopen().
-				std::string data;
-				FILE * f = _wfopen( utf8_to_wstring( filename ).c_str(), L"rb" );
-				if ( f ) {
-					while ( !feof( f ) ) {
-						static const std::size_t BUFFER_SIZE = 4096;
-						char buffer[BUFFER_SIZE];
-						size_t data_read = fread( buffer, 1, BUFFER_SIZE, f );
-						std::copy( buffer, buffer + data_read, std::back_inserter( data ) );
-					}
-					fclose( f );
-					f = NULL;
-				}
-				file_stream.str( data );
-				filesize = data.length();
-			#elif defined(_MSC_VER) && defined(UNICODE)
-				file_stream.open( utf8_to_wstring( filename ), std::ios::binary );
-				file_stream.seekg( 0, std::ios::end );
-				filesize = file_stream.tellg();
-				file_stream.seekg( 0, std::ios::beg );
-			#else
-				file_stream.open( filename, std::ios::binary );
-				file_stream.seekg( 0, std::ios::end );
-				filesize = file_stream.tellg();
-				file_stream.seekg( 0, std::ios::beg );
-			#endif
-		}
-		std::istream & data_stream = use_stdin ? std::cin : file_stream;
-		if ( data_stream.fail() ) {
-			throw exception( "file open error" );
-		}
+		std::unique_ptr<prefetched_module> prefetched = prefetcher ? prefetcher->take( flags, filename ) : nullptr;
+		if ( prefetched ) {
+			render_mod_file( flags, filename, prefetched->filesize, *prefetched->mod, log, audio_stream, prefetched.get() );
+		} else {
+
+			file_input_stream file_stream;
+			std::uint64_t filesize = 0;
+			bool use_stdin = ( filename == "-" );
+			if ( !use_stdin ) {
+				filesize = open_file_input_stream( file_stream, filename );
+			}
+			std::istream & data_stream = use_stdin ? std::cin : file_stream;
+			if ( data_stream.fail() ) {
+				throw exception( "file open error" );
+			}
+
+			if ( !use_stdin && flags.mode == Mode::Render && flags.render_threads != 1 ) {
+				// Keep the file contents around, parallel rendering loads additional instances of the module from it.
+				const std::vector<char> data( ( std::istreambuf_iterator<char>( data_stream ) ), std::istreambuf_iterator<char>() );
+				openmpt::module mod( data, silentlog, flags.ctls );
+				mod.select_subsong( flags.subsong );
+				silentlog.str( std::string() ); // clear, loader messages get stored to get_metadata( "warnings" ) by libopenmpt internally
+				render_mod_file( flags, filename, filesize, mod, log, audio_stream, nullptr, &data );
+			} else {
+				openmpt::module mod( data_stream, silentlog, flags.ctls );
+				mod.select_subsong( flags.subsong );
+				silentlog.str( std::string() ); // clear, loader messages get stored to get_metadata( "warnings" ) by libopenmpt internally
+				render_mod_file( flags, filename, filesize, mod, log, audio_stream );
+			}
 
-		{
-			openmpt::module mod( data_stream, silentlog, flags.ctls );
-			mod.select_subsong( flags.subsong );
-			silentlog.str( std::string() ); // clear, loader messages get stored to get_metadata( "warnings" ) by libopenmpt internally
-			render_mod_file( flags, filename, filesize, mod, log, audio_stream );
 		}
 
 	} catch ( prev_file & ) {
@@ -1751,6 +2420,216 @@ static std::string get_random_filename( std::set<std::string> & filenames, std::
 }
 
 
+template < typename Tsample >
+static void write_stems( const std::vector<std::vector<float>> & interleaved, std::size_t frames, std::vector<std::unique_ptr<file_audio_stream_raii>> & stem_streams ) {
+	std::vector<Tsample> left( frames );
+	std::vector<Tsample> right( frames );
+	const std::vector<Tsample*> buffers = { left.data(), right.data() };
+	for ( std::size_t stem = 0; stem < stem_streams.size(); ++stem ) {
+		for ( std::size_t frame = 0; frame < frames; ++frame ) {
+			left[frame] = convert_sample_to<Tsample>( interleaved[stem][frame * 2 + 0] );
+			right[frame] = convert_sample_to<Tsample>( interleaved[stem][frame * 2 + 1] );
+		}
+		stem_streams[stem]->write( buffers, frames );
+	}
+}
+
+// Renders one stereo file per pattern channel or instrument in a single rendering pass.
+static void render_stems_file( commandlineflags & flags, const std::string & filename, textout & log ) {
+
+	log.writeout();
+
+	std::ostringstream silentlog;
+
+	try {
+
+		file_input_stream file_stream;
+		bool use_stdin = ( filename == "-" );
+		if ( !use_stdin ) {
+			open_file_input_stream( file_stream, filename );
+		}
+		std::istream & data_stream = use_stdin ? std::cin : file_stream;
+		if ( data_stream.fail() ) {
+			throw exception( "file open error" );
+		}
+
+		openmpt::module_ext mod( data_stream, silentlog, flags.ctls );
+		mod.select_subsong( flags.subsong );
+		silentlog.str( std::string() );
+		mod.set_repeat_count( flags.repeatcount );
+		apply_mod_settings( flags, mod );
+		openmpt::ext::stems * stems = static_cast<openmpt::ext::stems *>( mod.get_interface( openmpt::ext::stems_id ) );
+		if ( !stems ) {
+			throw exception( "stems interface not available" );
+		}
+		const openmpt::ext::stems::stem_layout layout = ( flags.stems == Stems::Instruments ) ? openmpt::ext::stems::stems_instruments : openmpt::ext::stems::stems_channels;
+		const std::size_t num_stems = static_cast<std::size_t>( stems->get_num_stems( layout ) );
+		const double duration = mod.get_duration_seconds();
+
+		std::vector<field> fields;
+		set_field( fields, "Title" ).ostream() << mod.get_metadata( "title" );
+		set_field( fields, "Duration" ).ostream() << seconds_to_string( duration );
+		set_field( fields, "Stems" ).ostream() << num_stems << " (" << stems_to_string( flags.stems ) << ")";
+		show_fields( log, fields );
+		log.writeout();
+
+		// Stems are always stereo
+		commandlineflags stem_flags = flags;
+		stem_flags.channels = 2;
+		const std::map<std::string, std::string> metadata = get_metadata( mod );
+		std::vector<std::unique_ptr<file_audio_stream_raii>> stem_streams;
+		for ( std::size_t stem = 0; stem < num_stems; ++stem ) {
+			std::ostringstream stem_filename;
+			stem_filename << filename << ( flags.stems == Stems::Instruments ? ".ins" : ".ch" ) << std::setfill('0') << std::setw(2) << ( stem + 1 ) << "." << flags.output_extension;
+			stem_streams.push_back( std::make_unique<file_audio_stream_raii>( stem_flags, stem_filename.str(), log ) );
+			stem_streams.back()->write_metadata( metadata );
+		}
+
+		const std::size_t bufsize = get_render_bufsize( flags );
+		std::vector<std::vector<float>> interleaved( num_stems, std::vector<float>( bufsize * 2 ) );
+		std::vector<float*> buffers( num_stems );
+		for ( std::size_t stem = 0; stem < num_stems; ++stem ) {
+			buffers[stem] = interleaved[stem].data();
+		}
+		if ( flags.show_progress ) {
+			log << std::endl;
+		}
+		while ( true ) {
+			const std::size_t count = stems->read_stems( flags.samplerate, bufsize, layout, buffers.data() );
+			if ( count == 0 ) {
+				break;
+			}
+			if ( flags.use_float ) {
+				write_stems<float>( interleaved, count, stem_streams );
+			} else {
+				write_stems<std::int16_t>( interleaved, count, stem_streams );
+			}
+			if ( flags.show_progress ) {
+				log << seconds_to_string( mod.get_position_seconds() ) << "/" << seconds_to_string( duration ) << "   " << "\r";
+				log.writeout();
+			}
+		}
+		if ( flags.show_progress ) {
+			log << std::endl;
+		}
+		for ( auto & stem_stream : stem_streams ) {
+			stem_stream->flush();
+		}
+
+	} catch ( silent_exit_exception & ) {
+		throw;
+	} catch ( std::exception & e ) {
+		if ( !silentlog.str().empty() ) {
+			log << "errors loading '" << filename << "': " << silentlog.str() << std::endl;
+		} else {
+			log << "errors loading '" << filename << "'" << std::endl;
+		}
+		log << "error rendering stems of '" << filename << "': " << e.what() << std::endl;
+	}
+
+	log << std::endl;
+
+	log.writeout();
+
+}
+
+// Writes the minimum and maximum value of every flags.peaks frames as one line of text, without producing PCM data.
+static void render_peaks_file( commandlineflags & flags, const std::string & filename, textout & log ) {
+
+	log.writeout();
+
+	std::ostringstream silentlog;
+
+	try {
+
+		file_input_stream file_stream;
+		bool use_stdin = ( filename == "-" );
+		if ( !use_stdin ) {
+			open_file_input_stream( file_stream, filename );
+		}
+		std::istream & data_stream = use_stdin ? std::cin : file_stream;
+		if ( data_stream.fail() ) {
+			throw exception( "file open error" );
+		}
+
+		openmpt::module_ext mod( data_stream, silentlog, flags.ctls );
+		mod.select_subsong( flags.subsong );
+		silentlog.str( std::string() );
+		mod.set_repeat_count( flags.repeatcount );
+		apply_mod_settings( flags, mod );
+		openmpt::ext::preview * preview = static_cast<openmpt::ext::preview *>( mod.get_interface( openmpt::ext::preview_id ) );
+		if ( !preview ) {
+			throw exception( "preview interface not available" );
+		}
+		if ( flags.seek_target > 0.0 ) {
+			mod.set_position_seconds( flags.seek_target );
+		}
+		const double duration = mod.get_duration_seconds();
+
+		std::vector<field> fields;
+		set_field( fields, "Title" ).ostream() << mod.get_metadata( "title" );
+		set_field( fields, "Duration" ).ostream() << seconds_to_string( duration );
+		set_field( fields, "Peaks" ).ostream() << "every " << flags.peaks << " frames at " << flags.samplerate << " Hz";
+		show_fields( log, fields );
+		log.writeout();
+
+		const std::string peaks_filename = filename + ".peaks.txt";
+		if ( !flags.force_overwrite ) {
+			std::ifstream testfile( peaks_filename, std::ios::binary );
+			if ( testfile ) {
+				throw exception( "file already exists" );
+			}
+		}
+		std::ofstream peaks_stream( peaks_filename, std::ios::binary );
+		if ( !peaks_stream ) {
+			throw exception( "file open error" );
+		}
+
+		const std::size_t frames_per_peak = static_cast<std::size_t>( flags.peaks );
+		const std::size_t bufsize = std::max( get_render_bufsize( flags ) / frames_per_peak, std::size_t( 1 ) );
+		std::vector<float> min_peaks( bufsize );
+		std::vector<float> max_peaks( bufsize );
+		if ( flags.show_progress ) {
+			log << std::endl;
+		}
+		while ( true ) {
+			const std::size_t count = preview->read_peaks( flags.samplerate, frames_per_peak, bufsize, min_peaks.data(), max_peaks.data() );
+			if ( count == 0 ) {
+				break;
+			}
+			for ( std::size_t peak = 0; peak < count; ++peak ) {
+				peaks_stream << min_peaks[peak] << " " << max_peaks[peak] << "\n";
+			}
+			if ( flags.show_progress ) {
+				log << seconds_to_string( mod.get_position_seconds() ) << "/" << seconds_to_string( duration ) << "   " << "\r";
+				log.writeout();
+			}
+			if ( flags.end_time > 0 && mod.get_position_seconds() >= flags.end_time ) {
+				break;
+			}
+		}
+		if ( flags.show_progress ) {
+			log << std::endl;
+		}
+		peaks_stream.flush();
+
+	} catch ( silent_exit_exception & ) {
+		throw;
+	} catch ( std::exception & e ) {
+		if ( !silentlog.str().empty() ) {
+			log << "errors loading '" << filename << "': " << silentlog.str() << std::endl;
+		} else {
+			log << "errors loading '" << filename << "'" << std::endl;
+		}
+		log << "error rendering peaks of '" << filename << "': " << e.what() << std::endl;
+	}
+
+	log << std::endl;
+
+	log.writeout();
+
+}
+
 static void render_files( commandlineflags & flags, textout & log, write_buffers_interface & audio_stream, std::default_random_engine & prng ) {
 	if ( flags.randomize ) {
 		std::shuffle( flags.filenames.begin(), flags.filenames.end(), prng );
@@ -1783,13 +2662,22 @@ static void render_files( commandlineflags & flags, textout & log, write_buffers
 				}
 			} else {
 				std::vector<std::string>::iterator filename = flags.filenames.begin();
+				std::unique_ptr<module_prefetcher> prefetcher;
 				while ( true ) {
 					if ( filename == flags.filenames.end() ) {
 						break;
 					}
 					try {
 						flags.playlist_index = filename - flags.filenames.begin();
-						render_file( flags, *filename, log, audio_stream );
+						std::unique_ptr<module_prefetcher> current_prefetcher = std::move( prefetcher );
+						std::vector<std::string>::iterator next_filename = filename + 1;
+						if ( next_filename == flags.filenames.end() && flags.restart ) {
+							next_filename = flags.filenames.begin();
+						}
+						if ( next_filename != flags.filenames.end() && module_prefetcher::can_prefetch( flags, *next_filename ) ) {
+							prefetcher = std::make_unique<module_prefetcher>( flags, *next_filename );
+						}
+						render_file( flags, *filename, log, audio_stream, current_prefetcher.get() );
 						filename++;
 						continue;
 					} catch ( prev_file & e ) {
@@ -2107,6 +2995,33 @@ static commandlineflags parse_openmpt123( const std::vector<std::string> & args,
 				++i;
 			} else if ( arg == "--force" ) {
 				flags.force_overwrite = true;
+			} else if ( arg == "--prefetch" && nextarg != "" ) {
+				std::istringstream istr( nextarg );
+				istr >> flags.prefetch;
+				++i;
+			} else if ( arg == "--write-queue" && nextarg != "" ) {
+				std::istringstream istr( nextarg );
+				istr >> flags.write_queue;
+				++i;
+			} else if ( arg == "--render-threads" && nextarg != "" ) {
+				std::istringstream istr( nextarg );
+				istr >> flags.render_threads;
+				++i;
+			} else if ( arg == "--stems" ) {
+				flags.stems = Stems::Channels;
+			} else if ( arg == "--instrument-stems" ) {
+				flags.stems = Stems::Instruments;
+			} else if ( arg == "--preview" ) {
+				flags.samplerate = 11025;
+				flags.channels = 1;
+				flags.ctls[ "render.preview" ] = "1";
+			} else if ( arg == "--peaks" && nextarg != "" ) {
+				std::istringstream istr( nextarg );
+				istr >> flags.peaks;
+				++i;
+			} else if ( arg == "--replaygain" ) {
+				flags.replaygain = true;
+				flags.ctls[ "analysis.loudness" ] = "1";
 			} else if ( arg == "--output-type" && nextarg != "" ) {
 				flags.output_extension = nextarg;
 				++i;
@@ -2437,6 +3352,7 @@ static int main( int argc, char * argv [] ) {
 					flags.apply_default_buffer_sizes();
 					file_audio_stream_raii file_audio_stream( flags, flags.output_filename, log );
 					render_files( flags, log, file_audio_stream, prng );
+					file_audio_stream.flush();
 #if defined( MPT_WITH_PULSEAUDIO )
 				} else if ( flags.driver == "pulseaudio" || flags.driver.empty() ) {
 					pulseaudio_stream_raii pulseaudio_stream( flags, log );
@@ -2471,10 +3387,26 @@ static int main( int argc, char * argv [] ) {
 				}
 			} break;
 			case Mode::Render: {
-				for ( const auto & filename : flags.filenames ) {
+				std::unique_ptr<module_prefetcher> prefetcher;
+				for ( auto filename = flags.filenames.begin(); filename != flags.filenames.end(); ++filename ) {
 					flags.apply_default_buffer_sizes();
-					file_audio_stream_raii file_audio_stream( flags, filename + std::string(".") + flags.output_extension, log );
-					render_file( flags, filename, log, file_audio_stream );
+					if ( flags.stems != Stems::None ) {
+						render_stems_file( flags, *filename, log );
+						flags.playlist_index++;
+						continue;
+					}
+					if ( flags.peaks > 0 ) {
+						render_peaks_file( flags, *filename, log );
+						flags.playlist_index++;
+						continue;
+					}
+					std::unique_ptr<module_prefetcher> current_prefetcher = std::move( prefetcher );
+					if ( filename + 1 != flags.filenames.end() && module_prefetcher::can_prefetch( flags, *( filename + 1 ) ) ) {
+						prefetcher = std::make_unique<module_prefetcher>( flags, *( filename + 1 ) );
+					}
+					file_audio_stream_raii file_audio_stream( flags, *filename + std::string(".") + flags.output_extension, log );
+					render_file( flags, *filename, log, file_audio_stream, current_prefetcher.get() );
+					file_audio_stream.flush();
 					flags.playlist_index++;
 				}
 			} break;
@@ -932,6 +932,21 @@ static inline std::string mode_to_string( Mode mode ) {
 	return "";
 }
 
+enum class Stems {
+	None,
+	Channels,
+	Instruments
+};
+
+static inline std::string stems_to_string( Stems stems ) {
+	switch ( stems ) {
+		case Stems::None:        return "none"; break;
+		case Stems::Channels:    return "channels"; break;
+		case Stems::Instruments: return "instruments"; break;
+	}
+	return "";
+}
+
 static const std::int32_t default_low = -2;
 static const std::int32_t default_high = -1;
 
@@ -979,6 +994,12 @@ struct commandlineflags {
 	std::string output_filename;
 	std::string output_extension;
 	bool force_overwrite;
+	std::int32_t write_queue;
+	std::int32_t prefetch;
+	std::int32_t render_threads;
+	Stems stems;
+	std::int32_t peaks;
+	bool replaygain;
 	bool paused;
 	std::string warnings;
 	void apply_default_buffer_sizes() {
@@ -1100,6 +1121,17 @@ struct commandlineflags {
 		playlist_index = 0;
 		output_extension = "auto";
 		force_overwrite = false;
+#if defined(MPT_WITH_THREADS)
+		write_queue = 8;
+		prefetch = 500;
+#else
+		write_queue = 0;
+		prefetch = 0;
+#endif
+		render_threads = 1;
+		stems = Stems::None;
+		peaks = 0;
+		replaygain = false;
 		paused = false;
 	}
 	void check_and_sanitize() {
@@ -1179,6 +1211,20 @@ struct commandlineflags {
 		if ( samplerate < 0 ) {
 			samplerate = commandlineflags().samplerate;
 		}
+		if ( write_queue < 0 ) {
+			write_queue = commandlineflags().write_queue;
+		}
+		if ( prefetch < 0 ) {
+			prefetch = commandlineflags().prefetch;
+		}
+		if ( render_threads < 0 ) {
+			render_threads = commandlineflags().render_threads;
+		}
+#if !defined(MPT_WITH_THREADS)
+		write_queue = 0;
+		prefetch = 0;
+		render_threads = 1;
+#endif
 		if ( output_extension == "auto" ) {
 			output_extension = "";
 		}
@@ -1188,6 +1234,18 @@ struct commandlineflags {
 		if ( mode == Mode::Render && !output_filename.empty() ) {
 			throw args_error_exception();
 		}
+		if ( mode != Mode::Render && stems != Stems::None ) {
+			throw args_error_exception();
+		}
+		if ( peaks < 0 ) {
+			peaks = commandlineflags().peaks;
+		}
+		if ( peaks > 0 && ( mode != Mode::Render || stems != Stems::None ) ) {
+			throw args_error_exception();
+		}
+		if ( replaygain && ( mode != Mode::Render || stems != Stems::None || peaks > 0 ) ) {
+			throw args_error_exception();
+		}
 		if ( mode != Mode::Render && !output_filename.empty() ) {
 			output_extension = get_extension( output_filename );
 		}
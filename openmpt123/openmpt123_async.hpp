@@ -0,0 +1,187 @@
+/*
+ * openmpt123_async.hpp
+ * --------------------
+ * Purpose: libopenmpt command line player
+ * Notes  : Writes rendered audio on a separate thread, so that rendering and encoding can overlap.
+ * Authors: OpenMPT Devs
+ * The OpenMPT source code is released under the BSD license. Read LICENSE for more details.
+ */
+
+#ifndef OPENMPT123_ASYNC_HPP
+#define OPENMPT123_ASYNC_HPP
+
+#include "openmpt123_config.hpp"
+#include "openmpt123.hpp"
+
+#if defined(MPT_WITH_THREADS)
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <type_traits>
+#include <vector>
+#if (defined(__MINGW32__) || defined(__MINGW64__)) && !defined(_GLIBCXX_HAS_GTHREADS) && defined(MPT_WITH_MINGWSTDTHREADS)
+#include <mingw.condition_variable.h>
+#include <mingw.mutex.h>
+#include <mingw.thread.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+namespace openmpt123 {
+
+// Forwards all audio to another stream on a separate writer thread.
+// Rendered blocks are passed through a single-producer single-consumer ring which is only ever touched by
+// the rendering thread (producer) and the writer thread (consumer). The ring positions are atomics. The mutex
+// is only taken by a side that has to sleep because the ring is full or empty, and by the other side to wake it up
+// again; as long as neither side has to wait, pushing and popping blocks does not lock anything.
+class async_audio_stream_raii : public file_audio_stream_base {
+private:
+	struct block {
+		bool is_float = false;
+		std::size_t frames = 0;
+		std::vector<float> float_samples;
+		std::vector<std::int16_t> int_samples;
+		std::vector<float*> float_buffers;
+		std::vector<std::int16_t*> int_buffers;
+	};
+	write_buffers_interface & impl;
+	std::vector<block> ring;
+	// Monotonically increasing block counters. The producer only writes write_pos, the consumer only writes read_pos.
+	std::atomic<std::size_t> write_pos;
+	std::atomic<std::size_t> read_pos;
+	std::atomic<bool> stop;
+	std::atomic<bool> failed;
+	// Number of threads sleeping (or about to sleep) in wait_until.
+	// The positions, stop and waiters use sequentially consistent operations, so that either the notifying side sees
+	// a waiter or the waiting side sees the updated position before it goes to sleep.
+	std::atomic<int> waiters;
+	std::exception_ptr error;
+	std::mutex wait_mutex;
+	std::condition_variable wait_cond;
+	std::thread writer;
+private:
+	void notify() {
+		if ( waiters.load() == 0 ) {
+			return;
+		}
+		std::lock_guard<std::mutex> guard( wait_mutex );
+		wait_cond.notify_all();
+	}
+	template < typename Tpred >
+	void wait_until( Tpred pred ) {
+		if ( pred() ) {
+			return;
+		}
+		std::unique_lock<std::mutex> guard( wait_mutex );
+		waiters.fetch_add( 1 );
+		wait_cond.wait( guard, pred );
+		waiters.fetch_sub( 1 );
+	}
+	void writer_thread() {
+		while ( true ) {
+			const std::size_t pos = read_pos.load( std::memory_order_relaxed );
+			wait_until( [&]() { return write_pos.load() != pos || stop.load(); } );
+			if ( write_pos.load() == pos ) {
+				// stopped and everything has been written
+				break;
+			}
+			block & b = ring[ pos % ring.size() ];
+			if ( !failed.load( std::memory_order_relaxed ) ) {
+				try {
+					if ( b.is_float ) {
+						impl.write( b.float_buffers, b.frames );
+					} else {
+						impl.write( b.int_buffers, b.frames );
+					}
+				} catch ( ... ) {
+					// keep consuming blocks so that the producer never blocks forever
+					error = std::current_exception();
+					failed.store( true, std::memory_order_release );
+				}
+			}
+			read_pos.store( pos + 1 );
+			notify();
+		}
+	}
+	void check_error() {
+		if ( failed.load( std::memory_order_acquire ) && error ) {
+			std::exception_ptr e = error;
+			error = nullptr;
+			std::rethrow_exception( e );
+		}
+	}
+	template < typename Tsample >
+	void copy_to_block( block & b, const std::vector<Tsample*> & buffers, std::size_t frames, std::vector<Tsample> & samples, std::vector<Tsample*> & block_buffers ) {
+		const std::size_t channels = buffers.size();
+		if ( samples.size() < channels * frames ) {
+			samples.resize( channels * frames );
+		}
+		block_buffers.resize( channels );
+		for ( std::size_t channel = 0; channel < channels; ++channel ) {
+			block_buffers[channel] = samples.data() + channel * frames;
+			std::copy( buffers[channel], buffers[channel] + frames, block_buffers[channel] );
+		}
+		b.frames = frames;
+	}
+	template < typename Tsample >
+	void push( const std::vector<Tsample*> & buffers, std::size_t frames ) {
+		check_error();
+		const std::size_t pos = write_pos.load( std::memory_order_relaxed );
+		wait_until( [&]() { return pos - read_pos.load() < ring.size(); } );
+		block & b = ring[ pos % ring.size() ];
+		b.is_float = std::is_same<Tsample, float>::value;
+		if constexpr ( std::is_same<Tsample, float>::value ) {
+			copy_to_block( b, buffers, frames, b.float_samples, b.float_buffers );
+		} else {
+			copy_to_block( b, buffers, frames, b.int_samples, b.int_buffers );
+		}
+		write_pos.store( pos + 1 );
+		notify();
+	}
+public:
+	async_audio_stream_raii( write_buffers_interface & impl_, std::size_t depth )
+		: impl(impl_)
+		, ring(std::max( depth, std::size_t(1) ))
+		, write_pos(0)
+		, read_pos(0)
+		, stop(false)
+		, failed(false)
+		, waiters(0)
+	{
+		writer = std::thread( [this]() { writer_thread(); } );
+	}
+	~async_audio_stream_raii() {
+		stop.store( true );
+		notify();
+		writer.join();
+	}
+	// Wait until all queued blocks have been written, and rethrow any error that occurred while writing them.
+	void flush() {
+		const std::size_t pos = write_pos.load( std::memory_order_relaxed );
+		wait_until( [&]() { return read_pos.load() == pos; } );
+		check_error();
+	}
+	void write_metadata( std::map<std::string,std::string> metadata ) override {
+		flush();
+		impl.write_metadata( metadata );
+	}
+	void write_updated_metadata( std::map<std::string,std::string> metadata ) override {
+		flush();
+		impl.write_updated_metadata( metadata );
+	}
+	void write( const std::vector<float*> buffers, std::size_t frames ) override {
+		push( buffers, frames );
+	}
+	void write( const std::vector<std::int16_t*> buffers, std::size_t frames ) override {
+		push( buffers, frames );
+	}
+};
+
+} // namespace openmpt123
+
+#endif // MPT_WITH_THREADS
+
+#endif // OPENMPT123_ASYNC_HPP
@@ -85,6 +85,21 @@
 
 #endif // MPT_BUILD_MSVC
 
+// Same conditions as MPT_PLATFORM_MULTITHREADED and mpt::mutex in libopenmpt.
+// _GLIBCXX_HAS_GTHREADS is only known after including a standard library header, so check it here.
+#include <cstddef>
+#if defined(MPT_NO_THREADS)
+// disabled by the build system
+#elif defined(__DJGPP__)
+// no threads on DOS
+#elif defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+// Emscripten without pthreads
+#elif (defined(__MINGW32__) || defined(__MINGW64__)) && !defined(_GLIBCXX_HAS_GTHREADS) && !defined(MPT_WITH_MINGWSTDTHREADS)
+// MinGW win32 threading model without mingw-std-threads
+#else
+#define MPT_WITH_THREADS
+#endif
+
 #define OPENMPT123_VERSION_STRING OPENMPT_API_VERSION_STRING
 
 #endif // OPENMPT123_CONFIG_HPP
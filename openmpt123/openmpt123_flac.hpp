@@ -40,6 +40,7 @@ private:
 	std::string filename;
 	bool called_init;
 	std::vector< std::pair< std::string, std::string > > tags;
+	std::vector< std::pair< std::string, std::string > > updated_tags;
 	FLAC__StreamMetadata * flac_metadata[1];
 	FLAC__StreamEncoder * encoder;
 	std::vector<FLAC__int32> interleaved_buffer;
@@ -50,6 +51,42 @@ private:
 			FLAC__metadata_object_vorbiscomment_append_comment( vorbiscomment, entry, false );
 		}
 	}
+	// Adds tags that only became known after encoding to the finished file.
+	void write_updated_tags() {
+		FLAC__Metadata_Chain * chain = FLAC__metadata_chain_new();
+		if ( !chain ) {
+			return;
+		}
+		if ( FLAC__metadata_chain_read( chain, filename.c_str() ) ) {
+			FLAC__Metadata_Iterator * iterator = FLAC__metadata_iterator_new();
+			if ( iterator ) {
+				FLAC__metadata_iterator_init( iterator, chain );
+				FLAC__StreamMetadata * vorbiscomment = 0;
+				do {
+					if ( FLAC__metadata_iterator_get_block_type( iterator ) == FLAC__METADATA_TYPE_VORBIS_COMMENT ) {
+						vorbiscomment = FLAC__metadata_iterator_get_block( iterator );
+						break;
+					}
+				} while ( FLAC__metadata_iterator_next( iterator ) );
+				if ( !vorbiscomment ) {
+					vorbiscomment = FLAC__metadata_object_new( FLAC__METADATA_TYPE_VORBIS_COMMENT );
+					if ( vorbiscomment && !FLAC__metadata_iterator_insert_block_after( iterator, vorbiscomment ) ) {
+						FLAC__metadata_object_delete( vorbiscomment );
+						vorbiscomment = 0;
+					}
+				}
+				if ( vorbiscomment ) {
+					for ( std::vector< std::pair< std::string, std::string > >::iterator tag = updated_tags.begin(); tag != updated_tags.end(); ++tag ) {
+						add_vorbiscomment_field( vorbiscomment, tag->first, tag->second );
+					}
+					FLAC__metadata_chain_sort_padding( chain );
+					FLAC__metadata_chain_write( chain, true, false );
+				}
+				FLAC__metadata_iterator_delete( iterator );
+			}
+		}
+		FLAC__metadata_chain_delete( chain );
+	}
 public:
 	flac_stream_raii( const std::string & filename_, const commandlineflags & flags_, std::ostream & /*log*/ ) : flags(flags_), filename(filename_), called_init(false), encoder(0) {
 		flac_metadata[0] = 0;
@@ -68,6 +105,9 @@ public:
 			 FLAC__stream_encoder_delete( encoder );
 			 encoder = 0;
 		}
+		if ( called_init && !updated_tags.empty() ) {
+			write_updated_tags();
+		}
 		if ( flac_metadata[0] ) {
 			FLAC__metadata_object_delete( flac_metadata[0] );
 			flac_metadata[0] = 0;
@@ -98,6 +138,14 @@ public:
 		}
 		FLAC__stream_encoder_set_metadata( encoder, flac_metadata, 1 );
 	}
+	void write_updated_metadata( std::map<std::string,std::string> metadata ) override {
+		// Only the ReplayGain tags can still be added once encoding has started
+		updated_tags.clear();
+		if ( !metadata[ "replaygain_track_gain" ].empty() ) {
+			updated_tags.push_back( std::make_pair( "REPLAYGAIN_TRACK_GAIN", metadata[ "replaygain_track_gain" ] ) );
+			updated_tags.push_back( std::make_pair( "REPLAYGAIN_TRACK_PEAK", metadata[ "replaygain_track_peak" ] ) );
+		}
+	}
 	void write( const std::vector<float*> buffers, std::size_t frames ) override {
 		if ( !called_init ) {
 			FLAC__stream_encoder_init_file( encoder, filename.c_str(), NULL, 0 );
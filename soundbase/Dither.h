@@ -35,6 +35,7 @@ enum DitherMode
 struct Dither_None
 {
 public:
+	static constexpr bool has_channel_state = false;
 	using prng_type = struct
 	{
 	};
@@ -61,6 +62,7 @@ public:
 struct Dither_ModPlug
 {
 public:
+	static constexpr bool has_channel_state = false;
 	using prng_type = mpt::rng::modplug_dither;
 	template <typename Trd>
 	static prng_type prng_init(Trd &)
@@ -100,6 +102,7 @@ template <int ditherdepth = 1, bool triangular = false, bool shaped = true>
 struct Dither_SimpleImpl
 {
 public:
+	static constexpr bool has_channel_state = true;
 	using prng_type = mpt::fast_prng;
 	template <typename Trd>
 	static prng_type prng_init(Trd &rd)
@@ -201,6 +204,35 @@ public:
 	{
 		return DitherChannels[channel].template process<targetbits>(sample, prng);
 	}
+	// Dither a block of interleaved samples in place.
+	// Random numbers are consumed in the same order as when processing the samples one by one.
+	template <uint32 targetbits>
+	void process(MixSampleInt *samples, std::size_t channels, std::size_t count)
+	{
+		if constexpr(std::is_same<Tdither, Dither_None>::value)
+		{
+			MPT_UNREFERENCED_PARAMETER(samples);
+			MPT_UNREFERENCED_PARAMETER(channels);
+			MPT_UNREFERENCED_PARAMETER(count);
+		} else if constexpr(!Tdither::has_channel_state)
+		{
+			Tdither dither;
+			for(std::size_t i = 0; i < channels * count; ++i)
+			{
+				samples[i] = dither.template process<targetbits>(samples[i], prng);
+			}
+		} else
+		{
+			for(std::size_t frame = 0; frame < count; ++frame)
+			{
+				for(std::size_t channel = 0; channel < channels; ++channel)
+				{
+					*samples = DitherChannels[channel].template process<targetbits>(*samples, prng);
+					samples++;
+				}
+			}
+		}
+	}
 };
 
 
@@ -0,0 +1,282 @@
+/*
+ * Loudness.cpp
+ * ------------
+ * Purpose: Loudness analysis according to ITU-R BS.1770 / EBU R128.
+ * Notes  : Measures integrated loudness, loudness range and true peak of the final mix while it is being rendered.
+ * Authors: OpenMPT Devs
+ * The OpenMPT source code is released under the BSD license. Read LICENSE for more details.
+ */
+
+
+#include "stdafx.h"
+#include "../sounddsp/Loudness.h"
+
+#include <algorithm>
+#include <limits>
+
+
+OPENMPT_NAMESPACE_BEGIN
+
+
+// Blocks quieter than this (in LUFS) are never taken into account
+static constexpr double AbsoluteGate = -70.0;
+// Relative gates (in LU) for integrated loudness and loudness range
+static constexpr double IntegratedRelativeGate = -10.0;
+static constexpr double RangeRelativeGate = -20.0;
+
+
+static double EnergyToLoudness(double energy)
+{
+	return -0.691 + 10.0 * std::log10(energy);
+}
+
+
+static double LoudnessToEnergy(double loudness)
+{
+	return std::pow(10.0, (loudness + 0.691) / 10.0);
+}
+
+
+// Returns the blocks above the absolute gate and the relative gate, which is calculated from the mean energy of the blocks above the absolute gate.
+static std::vector<double> GateBlocks(const std::vector<double> &blocks, double relativeGate)
+{
+	const double absoluteThreshold = LoudnessToEnergy(AbsoluteGate);
+	std::vector<double> gated;
+	double sum = 0.0;
+	for(double energy : blocks)
+	{
+		if(energy > absoluteThreshold)
+		{
+			gated.push_back(energy);
+			sum += energy;
+		}
+	}
+	if(gated.empty())
+		return gated;
+	const double relativeThreshold = sum / gated.size() * std::pow(10.0, relativeGate / 10.0);
+	gated.erase(std::remove_if(gated.begin(), gated.end(), [relativeThreshold](double energy) { return energy <= relativeThreshold; }), gated.end());
+	return gated;
+}
+
+
+LoudnessMeter::LoudnessMeter()
+{
+	Initialize(48000);
+}
+
+
+void LoudnessMeter::Initialize(uint32 sampleRate)
+{
+	if(sampleRate == m_sampleRate || sampleRate == 0)
+		return;
+	m_sampleRate = sampleRate;
+
+	// K-weighting pre-filter (high shelf) and RLB weighting filter (high pass), with coefficients derived for arbitrary sample rates
+	Biquad shelf;
+	{
+		const double f0 = 1681.974450955533, gain = 3.999843853973347, q = 0.7071752369554196;
+		const double k = std::tan(M_PI * f0 / sampleRate);
+		const double vh = std::pow(10.0, gain / 20.0);
+		const double vb = std::pow(vh, 0.4996667741545416);
+		const double a0 = 1.0 + k / q + k * k;
+		shelf.b0 = (vh + vb * k / q + k * k) / a0;
+		shelf.b1 = 2.0 * (k * k - vh) / a0;
+		shelf.b2 = (vh - vb * k / q + k * k) / a0;
+		shelf.a1 = 2.0 * (k * k - 1.0) / a0;
+		shelf.a2 = (1.0 - k / q + k * k) / a0;
+	}
+	Biquad highpass;
+	{
+		const double f0 = 38.13547087602444, q = 0.5003270373238773;
+		const double k = std::tan(M_PI * f0 / sampleRate);
+		const double a0 = 1.0 + k / q + k * k;
+		highpass.b0 = 1.0;
+		highpass.b1 = -2.0;
+		highpass.b2 = 1.0;
+		highpass.a1 = 2.0 * (k * k - 1.0) / a0;
+		highpass.a2 = (1.0 - k / q + k * k) / a0;
+	}
+	for(auto &state : m_channelState)
+	{
+		state.shelf = shelf;
+		state.highpass = highpass;
+	}
+
+	m_subblockLength = std::max(sampleRate / 10u, 1u);
+
+	// True peak: Oversample to at least 192 kHz using a Hann-windowed sinc interpolator.
+	// Phase 0 reproduces the original sample, so the true peak is never lower than the sample peak.
+	m_oversampling = (sampleRate < 96000) ? 4 : ((sampleRate < 192000) ? 2 : 1);
+	m_truePeakFilter.assign(m_oversampling * TruePeakTaps, 0.0);
+	m_truePeakFilterGain = 1.0;
+	for(uint32 phase = 0; phase < m_oversampling; phase++)
+	{
+		double gain = 0.0;
+		for(uint32 tap = 0; tap < TruePeakTaps; tap++)
+		{
+			// Distance between the interpolated point and the input sample this tap is applied to
+			const double x = (TruePeakTaps / 2 - 1) - static_cast<double>(tap) + static_cast<double>(phase) / m_oversampling;
+			const double sinc = (x == 0.0) ? 1.0 : std::sin(M_PI * x) / (M_PI * x);
+			const double window = 0.5 * (1.0 + std::cos(M_PI * x / (TruePeakTaps / 2)));
+			m_truePeakFilter[phase * TruePeakTaps + tap] = sinc * window;
+			gain += std::abs(sinc * window);
+		}
+		m_truePeakFilterGain = std::max(m_truePeakFilterGain, gain);
+	}
+
+	Reset();
+}
+
+
+void LoudnessMeter::Reset()
+{
+	for(auto &state : m_channelState)
+	{
+		state.shelf.z1 = state.shelf.z2 = 0.0;
+		state.highpass.z1 = state.highpass.z2 = 0.0;
+		state.history.fill(0.0);
+		state.historyPos = 0;
+	}
+	m_subblockPos = 0;
+	m_subblockEnergy = 0.0;
+	m_subblocks.fill(0.0);
+	m_numSubblocks = 0;
+	m_momentaryBlocks.clear();
+	m_shortTermBlocks.clear();
+	m_truePeak = 0.0;
+}
+
+
+void LoudnessMeter::ProcessTruePeak(ChannelState &state, double x, bool interpolate)
+{
+	if(m_oversampling == 1)
+	{
+		m_truePeak = std::max(m_truePeak, std::abs(x));
+		return;
+	}
+	state.history[state.historyPos] = x;
+	state.history[state.historyPos + TruePeakTaps] = x;
+	state.historyPos = (state.historyPos + 1) % TruePeakTaps;
+	if(!interpolate)
+		return;
+	const double *history = state.history.data() + state.historyPos;
+	const double *coeffs = m_truePeakFilter.data();
+	for(uint32 phase = 0; phase < m_oversampling; phase++, coeffs += TruePeakTaps)
+	{
+		double y = 0.0;
+		for(uint32 tap = 0; tap < TruePeakTaps; tap++)
+		{
+			y += coeffs[tap] * history[tap];
+		}
+		m_truePeak = std::max(m_truePeak, std::abs(y));
+	}
+}
+
+
+void LoudnessMeter::FinishSubblock()
+{
+	m_subblocks[m_numSubblocks % m_subblocks.size()] = m_subblockEnergy / m_subblockLength;
+	m_numSubblocks++;
+	m_subblockPos = 0;
+	m_subblockEnergy = 0.0;
+
+	// Gating blocks overlap by 75% (momentary) and 97% (short-term), i.e. a new block starts every 100ms
+	auto blockEnergy = [this](uint32 numSubblocks)
+	{
+		double sum = 0.0;
+		for(uint32 i = 1; i <= numSubblocks; i++)
+		{
+			sum += m_subblocks[(m_numSubblocks - i) % m_subblocks.size()];
+		}
+		return sum / numSubblocks;
+	};
+	if(m_numSubblocks >= 4)
+		m_momentaryBlocks.push_back(blockEnergy(4));
+	if(m_numSubblocks >= m_subblocks.size())
+		m_shortTermBlocks.push_back(blockEnergy(static_cast<uint32>(m_subblocks.size())));
+}
+
+
+void LoudnessMeter::Process(const mixsample_t *buffer, uint32 channels, uint32 count)
+{
+	MPT_ASSERT(channels > 0 && channels <= MaxChannels);
+	if(channels != m_channels)
+	{
+		// Measurements with a different channel layout cannot be combined
+		Reset();
+		m_channels = channels;
+	}
+#ifdef MPT_INTMIXER
+	constexpr double scale = 1.0 / MIXING_SCALEF;
+#else
+	constexpr double scale = 1.0;
+#endif
+
+	// Interpolating is the most expensive part of the analysis, but it is pointless if even the loudest possible
+	// interpolated value in this chunk (and the filter history it depends on) cannot exceed the current true peak.
+	bool interpolate = true;
+	if(m_oversampling > 1)
+	{
+		double maxSample = 0.0;
+		for(uint32 i = 0; i < count * channels; i++)
+		{
+			maxSample = std::max(maxSample, std::abs(static_cast<double>(buffer[i])));
+		}
+		maxSample *= scale;
+		for(uint32 channel = 0; channel < channels; channel++)
+		{
+			for(double x : m_channelState[channel].history)
+			{
+				maxSample = std::max(maxSample, std::abs(x));
+			}
+		}
+		interpolate = maxSample * m_truePeakFilterGain > m_truePeak;
+	}
+
+	for(uint32 frame = 0; frame < count; frame++)
+	{
+		double energy = 0.0;
+		for(uint32 channel = 0; channel < channels; channel++)
+		{
+			const double x = *buffer++ * scale;
+			ChannelState &state = m_channelState[channel];
+			ProcessTruePeak(state, x, interpolate);
+			const double y = state.highpass.Process(state.shelf.Process(x));
+			// Surround channels are weighted +1.5 dB
+			energy += (channel >= 2 ? 1.41 : 1.0) * y * y;
+		}
+		m_subblockEnergy += energy;
+		if(++m_subblockPos == m_subblockLength)
+			FinishSubblock();
+	}
+}
+
+
+double LoudnessMeter::GetIntegratedLoudness() const
+{
+	const std::vector<double> gated = GateBlocks(m_momentaryBlocks, IntegratedRelativeGate);
+	if(gated.empty())
+		return -std::numeric_limits<double>::infinity();
+	double sum = 0.0;
+	for(double energy : gated)
+	{
+		sum += energy;
+	}
+	return EnergyToLoudness(sum / gated.size());
+}
+
+
+double LoudnessMeter::GetLoudnessRange() const
+{
+	std::vector<double> gated = GateBlocks(m_shortTermBlocks, RangeRelativeGate);
+	if(gated.empty())
+		return 0.0;
+	// Difference between the 10th and the 95th percentile of the short-term loudness distribution
+	std::sort(gated.begin(), gated.end());
+	const double low = gated[static_cast<size_t>((gated.size() - 1) * 0.10 + 0.5)];
+	const double high = gated[static_cast<size_t>((gated.size() - 1) * 0.95 + 0.5)];
+	return EnergyToLoudness(high) - EnergyToLoudness(low);
+}
+
+
+OPENMPT_NAMESPACE_END
@@ -0,0 +1,98 @@
+/*
+ * Loudness.h
+ * ----------
+ * Purpose: Loudness analysis according to ITU-R BS.1770 / EBU R128.
+ * Notes  : Measures integrated loudness, loudness range and true peak of the final mix while it is being rendered.
+ * Authors: OpenMPT Devs
+ * The OpenMPT source code is released under the BSD license. Read LICENSE for more details.
+ */
+
+
+#pragma once
+
+#include "BuildSettings.h"
+
+#include "../soundlib/Mixer.h"
+
+#include <array>
+#include <vector>
+
+
+OPENMPT_NAMESPACE_BEGIN
+
+
+class LoudnessMeter
+{
+public:
+	static constexpr uint32 MaxChannels = 4;
+
+private:
+	struct Biquad
+	{
+		double b0 = 1.0, b1 = 0.0, b2 = 0.0, a1 = 0.0, a2 = 0.0;
+		double z1 = 0.0, z2 = 0.0;
+
+		double Process(double x)
+		{
+			const double y = b0 * x + z1;
+			z1 = b1 * x - a1 * y + z2;
+			z2 = b2 * x - a2 * y;
+			return y;
+		}
+	};
+
+	// Number of input samples each phase of the true peak interpolation filter looks at
+	static constexpr uint32 TruePeakTaps = 12;
+
+	struct ChannelState
+	{
+		Biquad shelf, highpass;
+		// The last TruePeakTaps input samples, stored twice so that they can always be read as one contiguous block
+		std::array<double, TruePeakTaps * 2> history;
+		uint32 historyPos = 0;
+	};
+
+	uint32 m_sampleRate = 0;
+	uint32 m_channels = 0;
+	std::array<ChannelState, MaxChannels> m_channelState;
+
+	// 100ms subblocks, of which 4 make up a momentary (400ms) and 30 a short-term (3s) gating block
+	uint32 m_subblockLength = 0;
+	uint32 m_subblockPos = 0;
+	double m_subblockEnergy = 0.0;
+	std::array<double, 30> m_subblocks;
+	uint64 m_numSubblocks = 0;
+
+	std::vector<double> m_momentaryBlocks;  // Mean square energy of each momentary block
+	std::vector<double> m_shortTermBlocks;  // Mean square energy of each short-term block
+
+	// Polyphase interpolation filter for true peak measurement, m_oversampling phases of TruePeakTaps coefficients each
+	uint32 m_oversampling = 1;
+	std::vector<double> m_truePeakFilter;
+	double m_truePeakFilterGain = 1.0;  // Upper bound for the ratio between an interpolated value and the largest input sample
+	double m_truePeak = 0.0;
+
+public:
+	LoudnessMeter();
+
+	// Measurements are discarded if the sample rate changes
+	void Initialize(uint32 sampleRate);
+	// Discards all measurements
+	void Reset();
+
+	void Process(const mixsample_t *buffer, uint32 channels, uint32 count);
+
+	// Integrated loudness in LUFS, or -infinity if nothing loud enough has been measured yet
+	double GetIntegratedLoudness() const;
+	// Loudness range in LU
+	double GetLoudnessRange() const;
+	// Maximum true peak as a linear amplitude
+	double GetTruePeak() const { return m_truePeak; }
+
+private:
+	void ProcessTruePeak(ChannelState &state, double x, bool interpolate);
+	void FinishSubblock();
+};
+
+
+OPENMPT_NAMESPACE_END
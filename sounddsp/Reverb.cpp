@@ -39,6 +39,13 @@ static MPT_FORCEINLINE void Store64SSE(LR16 (&dst)[2], __m128i src) { return _mm
 #endif
 
 
+// Reverb output below this level is rounded away when converting the mix to 16-bit.
+static constexpr int32 RVB_SILENCE_THRESHOLD = 1 << (MixSampleIntTraits::mix_fractional_bits - 16);
+// The reverb output has to stay below the noise floor for at least this many samples without any input before it is shut down early.
+// This is longer than it takes for anything still stored in the delay lines to reach the output.
+static constexpr uint32 RVB_SILENCE_SAMPLES = (SNDMIX_PREDIFFUSION_DELAY_MASK + 1) + (SNDMIX_REFLECTIONS_DELAY_MASK + 1) + (SNDMIX_REVERB_DELAY_MASK + 1) + (RVBDLY_MASK + 1);
+
+
 CReverb::CReverb()
 {
 	// Shared reverb state
@@ -249,6 +256,7 @@ static void I3dl2_to_Generic(
 void CReverb::Shutdown()
 {
 	gnReverbSend = 0;
+	gnReverbSilentSamples = 0;
 
 	gnRvbLOfsVol = 0;
 	gnRvbROfsVol = 0;
@@ -424,9 +432,8 @@ void CReverb::Process(MixSampleInt *MixSoundBuffer, uint32 nSamples)
 	if (lDryVol < 8) lDryVol = 8;
 	if (lDryVol > 16) lDryVol = 16;
 	lDryVol = 16 - (((16-lDryVol) * lMaxRvbGain) >> 15);
-	ReverbDryMix(MixSoundBuffer, MixReverbBuffer, lDryVol, nSamples);
-	// Downsample 2x + 1st stage of lowpass filter
-	nIn = ReverbProcessPreFiltering1x(MixReverbBuffer, nSamples);
+	// Dry mix + 1st stage of lowpass filter
+	nIn = ReverbDryMixPreFiltering1x(MixSoundBuffer, MixReverbBuffer, lDryVol, nSamples);
 	nOut = nIn;
 	// Main reverb processing: split into small chunks (needed for short reverb delays)
 	// Reverb Input + Low-Pass stage #2 + Pre-diffusion
@@ -457,12 +464,15 @@ void CReverb::Process(MixSampleInt *MixSoundBuffer, uint32 nSamples)
 	}
 	// Adjust nDelayPos, in case nIn != nOut
 	g_RefDelay.nDelayPos = (g_RefDelay.nDelayPos - nOut + nIn) & SNDMIX_REFLECTIONS_DELAY_MASK;
-	// Upsample 2x
-	ReverbProcessPostFiltering1x(MixReverbBuffer, MixSoundBuffer, nSamples);
+	// Add to dry mix + DC removal
+	const bool rvbAudible = ReverbProcessPostFiltering1x(MixReverbBuffer, MixSoundBuffer, nSamples);
+	// Keep track of how long the tail has been inaudible without any new input
+	if(gnReverbSend || rvbAudible || gnRvbLOfsVol || gnRvbROfsVol) gnReverbSilentSamples = 0;
+	else gnReverbSilentSamples += nSamples;
 	// Automatically shut down if needed
 	if(gnReverbSend) gnReverbSamples = gnReverbDecaySamples; // reset decay counter
-	else if(gnReverbSamples > nSamples) gnReverbSamples -= nSamples; // decay
-	else // decayed
+	else if(gnReverbSamples > nSamples && gnReverbSilentSamples < RVB_SILENCE_SAMPLES) gnReverbSamples -= nSamples; // decay
+	else // decayed, or tail is below the noise floor
 	{
 		Shutdown();
 		gnReverbSamples = 0;
@@ -471,16 +481,6 @@ void CReverb::Process(MixSampleInt *MixSoundBuffer, uint32 nSamples)
 }
 
 
-void CReverb::ReverbDryMix(int32 * MPT_RESTRICT pDry, int32 * MPT_RESTRICT pWet, int lDryVol, uint32 nSamples)
-{
-	for (uint32 i=0; i<nSamples; i++)
-	{
-		pDry[i*2] += (pWet[i*2]>>4) * lDryVol;
-		pDry[i*2+1] += (pWet[i*2+1]>>4) * lDryVol;
-	}
-}
-
-
 uint32 CReverb::ReverbProcessPreFiltering2x(int32 * MPT_RESTRICT pWet, uint32 nSamples)
 {
 	uint32 nOutSamples = 0;
@@ -530,15 +530,44 @@ uint32 CReverb::ReverbProcessPreFiltering2x(int32 * MPT_RESTRICT pWet, uint32 nS
 }
 
 
-uint32 CReverb::ReverbProcessPreFiltering1x(int32 * MPT_RESTRICT pWet, uint32 nSamples)
+// Dry mix + 1st stage of lowpass filter, in a single pass over the reverb send buffer
+uint32 CReverb::ReverbDryMixPreFiltering1x(int32 * MPT_RESTRICT pDry, int32 * MPT_RESTRICT pWet, int lDryVol, uint32 nSamples)
 {
 	int lowpass = g_RefDelay.nCoeffs.c.l;
 	int y1_l = g_nLastRvbIn_yl, y1_r = g_nLastRvbIn_yr;
 
+#ifdef ENABLE_SSE2
+	if(CPU::HasFeatureSet(CPU::feature::sse2))
+	{
+		// Left and right channel are kept in lanes 0 and 2, so that _mm_mul_epu32 can be used for the 32-bit multiplications.
+		// The lower 32 bits of the product are the same for signed and unsigned operands.
+		const __m128i coeffs = _mm_set_epi32(0, lowpass, 0, lowpass);
+		const __m128i dryVol = _mm_set_epi32(0, lDryVol, 0, lDryVol);
+		__m128i y1 = _mm_set_epi32(0, y1_r, 0, y1_l);
+		for(uint32 i = 0; i < nSamples; i++)
+		{
+			__m128i wet = _mm_shuffle_epi32(Load64SSE(pWet), _MM_SHUFFLE(1, 1, 0, 0));
+			__m128i x = _mm_srai_epi32(wet, 12);
+			y1 = _mm_add_epi32(x, _mm_srai_epi32(_mm_mul_epu32(_mm_sub_epi32(x, y1), coeffs), 15));
+			__m128i dry = _mm_mul_epu32(_mm_srai_epi32(wet, 4), dryVol);
+			Store64SSE(pDry, _mm_add_epi32(Load64SSE(pDry), _mm_shuffle_epi32(dry, _MM_SHUFFLE(2, 0, 2, 0))));
+			Store64SSE(pWet, _mm_shuffle_epi32(y1, _MM_SHUFFLE(2, 0, 2, 0)));
+			pDry += 2;
+			pWet += 2;
+		}
+		g_nLastRvbIn_yl = _mm_cvtsi128_si32(y1);
+		g_nLastRvbIn_yr = _mm_cvtsi128_si32(_mm_srli_si128(y1, 8));
+		return nSamples;
+	}
+#endif
+
 	for (uint32 i=0; i<nSamples; i++)
 	{
-		int x_l = pWet[i*2] >> 12;
-		int x_r = pWet[i*2+1] >> 12;
+		int wet_l = pWet[i*2], wet_r = pWet[i*2+1];
+		pDry[i*2] += (wet_l>>4) * lDryVol;
+		pDry[i*2+1] += (wet_r>>4) * lDryVol;
+		int x_l = wet_l >> 12;
+		int x_r = wet_r >> 12;
 		y1_l = x_l + (((x_l - y1_l)*lowpass)>>15);
 		y1_r = x_r + (((x_r - y1_r)*lowpass)>>15);
 		pWet[i*2] = y1_l;
@@ -591,7 +620,8 @@ void CReverb::ReverbProcessPostFiltering2x(const int32 * MPT_RESTRICT pRvb, int3
 #define DCR_AMOUNT		9
 
 // Stereo Add + DC removal
-void CReverb::ReverbProcessPostFiltering1x(const int32 * MPT_RESTRICT pRvb, int32 * MPT_RESTRICT pDry, uint32 nSamples)
+// Returns true if any of the added reverb samples is above the 16-bit noise floor.
+bool CReverb::ReverbProcessPostFiltering1x(const int32 * MPT_RESTRICT pRvb, int32 * MPT_RESTRICT pDry, uint32 nSamples)
 {
 #ifdef ENABLE_SSE2
 	if(CPU::HasFeatureSet(CPU::feature::sse2))
@@ -599,6 +629,8 @@ void CReverb::ReverbProcessPostFiltering1x(const int32 * MPT_RESTRICT pRvb, int3
 		__m128i nDCRRvb_Y1 = Load64SSE(gnDCRRvb_Y1);
 		__m128i nDCRRvb_X1 = Load64SSE(gnDCRRvb_X1);
 		__m128i in = _mm_set1_epi32(0);
+		const __m128i silenceMax = _mm_set1_epi32(RVB_SILENCE_THRESHOLD - 1), silenceMin = _mm_set1_epi32(1 - RVB_SILENCE_THRESHOLD);
+		__m128i audible = _mm_setzero_si128();
 		while(nSamples--)
 		{
 			in = Load64SSE(pRvb);
@@ -607,6 +639,7 @@ void CReverb::ReverbProcessPostFiltering1x(const int32 * MPT_RESTRICT pRvb, int3
 			__m128i diff = _mm_sub_epi32(nDCRRvb_X1, in);
 			nDCRRvb_X1 = _mm_add_epi32(nDCRRvb_Y1, _mm_sub_epi32(_mm_srai_epi32(diff, DCR_AMOUNT + 1), diff));
 			__m128i out = _mm_add_epi32(Load64SSE(pDry), nDCRRvb_X1);
+			audible = _mm_or_si128(audible, _mm_or_si128(_mm_cmpgt_epi32(nDCRRvb_X1, silenceMax), _mm_cmplt_epi32(nDCRRvb_X1, silenceMin)));
 			nDCRRvb_Y1 = _mm_sub_epi32(nDCRRvb_X1, _mm_srai_epi32(nDCRRvb_X1, DCR_AMOUNT));
 			nDCRRvb_X1 = in;
 			Store64SSE(pDry, out);
@@ -614,12 +647,13 @@ void CReverb::ReverbProcessPostFiltering1x(const int32 * MPT_RESTRICT pRvb, int3
 		}
 		Store64SSE(gnDCRRvb_X1, in);
 		Store64SSE(gnDCRRvb_Y1, nDCRRvb_Y1);
-		return;
+		return _mm_movemask_epi8(audible) != 0;
 	}
 #endif
 	int32 X1L = gnDCRRvb_X1[0], X1R = gnDCRRvb_X1[1];
 	int32 Y1L = gnDCRRvb_Y1[0], Y1R = gnDCRRvb_Y1[1];
 	int32 inL = 0, inR = 0;
+	bool audible = false;
 	while(nSamples--)
 	{
 		inL = pRvb[0];
@@ -637,6 +671,7 @@ void CReverb::ReverbProcessPostFiltering1x(const int32 * MPT_RESTRICT pRvb, int3
 		// add to dry mix
 		outL += Y1L;
 		outR += Y1R;
+		audible |= (Y1L >= RVB_SILENCE_THRESHOLD) | (Y1L <= -RVB_SILENCE_THRESHOLD) | (Y1R >= RVB_SILENCE_THRESHOLD) | (Y1R <= -RVB_SILENCE_THRESHOLD);
 		Y1L -= Y1L / (1 << DCR_AMOUNT);
 		Y1R -= Y1R / (1 << DCR_AMOUNT);
 		X1L = inL;
@@ -650,6 +685,7 @@ void CReverb::ReverbProcessPostFiltering1x(const int32 * MPT_RESTRICT pRvb, int3
 	gnDCRRvb_Y1[1] = Y1R;
 	gnDCRRvb_X1[0] = inL;
 	gnDCRRvb_X1[1] = inR;
+	return audible;
 }
 
 
@@ -149,6 +149,7 @@ private:
 
 	uint32 gnReverbSamples = 0;
 	uint32 gnReverbDecaySamples = 0;
+	uint32 gnReverbSilentSamples = 0;
 
 	// Internal reverb state
 	bool g_bLastInPresent = 0;
@@ -180,12 +181,11 @@ public:
 private:
 	void Shutdown();
 	// Pre/Post resampling and filtering
-	uint32 ReverbProcessPreFiltering1x(int32 *pWet, uint32 nSamples);
+	uint32 ReverbDryMixPreFiltering1x(int32 *pDry, int32 *pWet, int lDryVol, uint32 nSamples);
 	uint32 ReverbProcessPreFiltering2x(int32 *pWet, uint32 nSamples);
-	void ReverbProcessPostFiltering1x(const int32 *pRvb, int32 *pDry, uint32 nSamples);
+	bool ReverbProcessPostFiltering1x(const int32 *pRvb, int32 *pDry, uint32 nSamples);
 	void ReverbProcessPostFiltering2x(const int32 *pRvb, int32 *pDry, uint32 nSamples);
 	void ReverbDCRemoval(int32 *pBuffer, uint32 nSamples);
-	void ReverbDryMix(int32 *pDry, int32 *pWet, int lDryVol, uint32 nSamples);
 	// Process pre-diffusion and pre-delay
 	static void ProcessPreDelay(SWRvbRefDelay *pPreDelay, const int32 *pIn, uint32 nSamples);
 	// Process reflections
@@ -24,6 +24,42 @@
 OPENMPT_NAMESPACE_BEGIN
 
 
+// Block-wise conversion of the fixed-point mix buffer to 16-bit or float output
+inline void ConvertMixToOutput(const MixSampleInt *src, std::size_t srcStride, int16 *dst, std::size_t count)
+{
+	ConvertMixToInt16(src, srcStride, dst, count);
+}
+
+inline void ConvertMixToOutput(const MixSampleInt *src, std::size_t srcStride, float *dst, std::size_t count)
+{
+	ConvertMixToFloat(src, srcStride, dst, count);
+}
+
+template<typename Tsample>
+void ConvertMixToOutput(audio_buffer_interleaved<Tsample> outputBuffer, std::size_t offset, const MixSampleInt *mixBuffer, std::size_t channels, std::size_t countChunk)
+{
+	if(outputBuffer.size_channels() == channels)
+	{
+		ConvertMixToOutput(mixBuffer, 1, &outputBuffer(0, offset), channels * countChunk);
+	} else
+	{
+		for(std::size_t frame = 0; frame < countChunk; ++frame)
+		{
+			ConvertMixToOutput(mixBuffer + frame * channels, 1, &outputBuffer(0, offset + frame), channels);
+		}
+	}
+}
+
+template<typename Tsample>
+void ConvertMixToOutput(audio_buffer_planar<Tsample> outputBuffer, std::size_t offset, const MixSampleInt *mixBuffer, std::size_t channels, std::size_t countChunk)
+{
+	for(std::size_t channel = 0; channel < channels; ++channel)
+	{
+		ConvertMixToOutput(mixBuffer + channel, channels, &outputBuffer(channel, offset), countChunk);
+	}
+}
+
+
 template<typename Tbuffer>
 class AudioReadTargetBuffer
 	: public IAudioReadTarget
@@ -45,12 +81,30 @@ public:
 public:
 	void DataCallback(MixSampleInt *MixSoundBuffer, std::size_t channels, std::size_t countChunk) override
 	{
-		dither.WithDither(
-			[&](auto &ditherInstance)
-			{
-				ConvertBufferMixFixedToBuffer<MixSampleIntTraits::mix_fractional_bits, false>(make_audio_buffer_with_offset(outputBuffer, countRendered), audio_buffer_interleaved<MixSampleInt>(MixSoundBuffer, channels, countChunk), ditherInstance, channels, countChunk);
-			}
-		);
+		using Tsample = typename Tbuffer::sample_type;
+		if constexpr(std::is_same<Tsample, int16>::value || std::is_same<Tsample, float>::value)
+		{
+			// Dither the whole chunk in place first, then convert it in one go.
+			// This gives exactly the same result as dithering and converting sample by sample.
+			MPT_ASSERT(outputBuffer.size_channels() >= channels);
+			MPT_ASSERT(outputBuffer.size_frames() >= countRendered + countChunk);
+			constexpr uint32 ditherBits = std::is_same<Tsample, int16>::value ? 16 : 0;
+			dither.WithDither(
+				[&](auto &ditherInstance)
+				{
+					ditherInstance.template process<ditherBits>(MixSoundBuffer, channels, countChunk);
+				}
+			);
+			ConvertMixToOutput(outputBuffer, countRendered, MixSoundBuffer, channels, countChunk);
+		} else
+		{
+			dither.WithDither(
+				[&](auto &ditherInstance)
+				{
+					ConvertBufferMixFixedToBuffer<MixSampleIntTraits::mix_fractional_bits, false>(make_audio_buffer_with_offset(outputBuffer, countRendered), audio_buffer_interleaved<MixSampleInt>(MixSoundBuffer, channels, countChunk), ditherInstance, channels, countChunk);
+				}
+			);
+		}
 		countRendered += countChunk;
 	}
 	void DataCallback(MixSampleFloat *MixSoundBuffer, std::size_t channels, std::size_t countChunk) override
@@ -141,6 +195,125 @@ public:
 };
 
 
+// Renders stems into interleaved stereo float buffers and discards the regular mix
+class AudioReadTargetStems
+	: public IAudioReadTarget
+{
+private:
+	const StemLayout layout;
+	float * const *stems;
+	const float gainFactor;
+	std::size_t countRendered = 0;
+public:
+	AudioReadTargetStems(StemLayout layout_, float * const *stems_, float gainFactor_)
+		: layout(layout_)
+		, stems(stems_)
+		, gainFactor(gainFactor_)
+	{
+		return;
+	}
+public:
+	StemLayout GetStemLayout() const override { return layout; }
+	void StemCallback(MixSampleInt *stemBuffer, std::size_t stem, std::size_t countChunk) override
+	{
+		if(!stems[stem])
+			return;
+		audio_buffer_interleaved<float> outputBuffer(stems[stem], 2, countRendered + countChunk);
+		ConvertMixToOutput(outputBuffer, countRendered, stemBuffer, 2, countChunk);
+		ApplyGain(outputBuffer, countRendered, 2, countChunk, gainFactor);
+	}
+	void StemCallback(MixSampleFloat *stemBuffer, std::size_t stem, std::size_t countChunk) override
+	{
+		if(!stems[stem])
+			return;
+		ApplyGain(stemBuffer, 2, countChunk, gainFactor);
+		std::copy(stemBuffer, stemBuffer + countChunk * 2, stems[stem] + countRendered * 2);
+	}
+	void DataCallback(MixSampleInt * /*MixSoundBuffer*/, std::size_t /*channels*/, std::size_t countChunk) override
+	{
+		countRendered += countChunk;
+	}
+	void DataCallback(MixSampleFloat * /*MixSoundBuffer*/, std::size_t /*channels*/, std::size_t countChunk) override
+	{
+		countRendered += countChunk;
+	}
+};
+
+
+// Reduces the mix to its minimum and maximum sample value per block of framesPerPeak frames and discards the PCM data
+class AudioReadTargetPeaks
+	: public IAudioReadTarget
+{
+private:
+	const std::size_t framesPerPeak;
+	float *minPeaks;
+	float *maxPeaks;
+	const float gainFactor;
+	std::size_t countRendered = 0;
+	float blockMin = 0.0f, blockMax = 0.0f;
+
+	static float ToFloat(MixSampleInt value)
+	{
+		float result;
+		ConvertMixToFloat(&value, 1, &result, 1);
+		return result;
+	}
+	static float ToFloat(MixSampleFloat value) { return value; }
+
+	template<typename Tsample>
+	void ProcessPeaks(const Tsample *mixBuffer, std::size_t channels, std::size_t countChunk)
+	{
+		while(countChunk > 0)
+		{
+			const std::size_t blockPos = countRendered % framesPerPeak;
+			const std::size_t count = std::min(countChunk, framesPerPeak - blockPos);
+			// The conversion is monotonic, so only the extremes of each block need to be converted
+			const auto [minSample, maxSample] = std::minmax_element(mixBuffer, mixBuffer + count * channels);
+			const float minValue = ToFloat(*minSample) * gainFactor, maxValue = ToFloat(*maxSample) * gainFactor;
+			blockMin = (blockPos == 0) ? minValue : std::min(blockMin, minValue);
+			blockMax = (blockPos == 0) ? maxValue : std::max(blockMax, maxValue);
+			mixBuffer += count * channels;
+			countChunk -= count;
+			countRendered += count;
+			if(blockPos + count == framesPerPeak)
+				Flush();
+		}
+	}
+	void Flush()
+	{
+		const std::size_t peak = (countRendered - 1) / framesPerPeak;
+		minPeaks[peak] = blockMin;
+		maxPeaks[peak] = blockMax;
+	}
+
+public:
+	AudioReadTargetPeaks(std::size_t framesPerPeak_, float *minPeaks_, float *maxPeaks_, float gainFactor_)
+		: framesPerPeak(framesPerPeak_)
+		, minPeaks(minPeaks_)
+		, maxPeaks(maxPeaks_)
+		, gainFactor(gainFactor_)
+	{
+		MPT_ASSERT(framesPerPeak > 0);
+	}
+	// Write out the last, incomplete block. Returns the number of peaks written.
+	std::size_t Finish()
+	{
+		if(countRendered % framesPerPeak != 0)
+			Flush();
+		return (countRendered + framesPerPeak - 1) / framesPerPeak;
+	}
+public:
+	void DataCallback(MixSampleInt *MixSoundBuffer, std::size_t channels, std::size_t countChunk) override
+	{
+		ProcessPeaks(MixSoundBuffer, channels, countChunk);
+	}
+	void DataCallback(MixSampleFloat *MixSoundBuffer, std::size_t channels, std::size_t countChunk) override
+	{
+		ProcessPeaks(MixSoundBuffer, channels, countChunk);
+	}
+};
+
+
 #endif // LIBOPENMPT_BUILD
 
 
@@ -20,6 +20,7 @@
 #include "Sndfile.h"
 #include "MixerLoops.h"
 #include "MixFuncTable.h"
+#include "SampleStream.h"
 #include "plugins/PlugInterface.h"
 #include <cfloat>  // For FLT_EPSILON
 #include <algorithm>
@@ -28,6 +29,25 @@
 OPENMPT_NAMESPACE_BEGIN
 
 
+/////////////////////////////////////////////////////////////////////////
+
+// Decode the part of a streamed sample that is going to be read while rendering count samples, and point the channel to it.
+// The channel position is made relative to the decoded data; the returned offset must be added to it again after rendering.
+static SamplePosition PrepareSampleStream(ModChannel &chn, SampleStreamCursor &cursor, uint32 count)
+{
+	const int32 startPos = chn.position.GetInt();
+	const int32 endPos = (chn.position + chn.increment * (count - 1)).GetInt();
+	int32 base = 0;
+	chn.pCurrentSample = cursor.Prepare(chn.pModSample->stream,
+		std::min(startPos, endPos) - static_cast<int32>(InterpolationMaxLookahead),
+		std::max(startPos, endPos) + static_cast<int32>(InterpolationMaxLookahead) + 1,
+		base);
+	const SamplePosition offset(base, 0);
+	chn.position -= offset;
+	return offset;
+}
+
+
 /////////////////////////////////////////////////////////////////////////
 
 struct MixLoopState
@@ -70,7 +90,16 @@ struct MixLoopState
 			const bool inSustainLoop = chn.InSustainLoop() && chn.nLoopStart == chn.pModSample->nSustainStart && chn.nLoopEnd == chn.pModSample->nSustainEnd;
 
 			// Do not enable wraparound magic if we're previewing a custom loop!
-			if(inSustainLoop || chn.nLoopEnd == chn.pModSample->nLoopEnd)
+			if((inSustainLoop || chn.nLoopEnd == chn.pModSample->nLoopEnd) && chn.pModSample->IsStreamed())
+			{
+				// Streamed samples keep their wraparound buffer separately, and only for cached loops.
+				// The pointer is set up such that it can be indexed with the same positions as the wraparound buffer of a sample in memory.
+				const std::byte *lookahead = chn.pModSample->stream->GetLoopLookahead(inSustainLoop);
+				if(lookahead != nullptr)
+				{
+					lookaheadPointer = reinterpret_cast<const int8 *>(lookahead) + (2 * static_cast<ptrdiff_t>(InterpolationMaxLookahead) - static_cast<ptrdiff_t>(chn.nLoopEnd)) * chn.pModSample->GetBytesPerSample();
+				}
+			} else if(inSustainLoop || chn.nLoopEnd == chn.pModSample->nLoopEnd)
 			{
 				SmpLength lookaheadOffset = 3 * InterpolationMaxLookahead + chn.pModSample->nLength - chn.nLoopEnd;
 				if(inSustainLoop)
@@ -275,6 +304,38 @@ struct MixLoopState
 };
 
 
+// Get the stem that a voice is mixed into with the current stem layout, or uint32_max if it is part of the regular mix
+uint32 CSoundFile::GetVoiceStem(CHANNELINDEX nChn) const
+{
+	const ModChannel &chn = m_PlayState.Chn[nChn];
+	if(m_stemLayout == StemLayout::Channels)
+	{
+		if(nChn < GetNumChannels())
+			return nChn;
+		if(chn.nMasterChn > 0 && chn.nMasterChn <= GetNumChannels())
+			return chn.nMasterChn - 1;
+	} else if(m_stemLayout == StemLayout::Instruments)
+	{
+		if(GetNumInstruments())
+		{
+			// If the same instrument is found in several slots, this picks the lowest one
+			const auto ins = std::lower_bound(m_instrumentStems.begin(), m_instrumentStems.end(), chn.pModInstrument, [](const auto &entry, const ModInstrument *instr)
+			{
+				return std::less<const ModInstrument *>()(entry.first, instr);
+			});
+			if(chn.pModInstrument != nullptr && ins != m_instrumentStems.end() && ins->first == chn.pModInstrument)
+				return ins->second;
+		} else if(chn.pModSample != nullptr)
+		{
+			const size_t smp = std::distance(static_cast<const ModSample *>(Samples), chn.pModSample);
+			if(smp >= 1 && smp <= GetNumSamples())
+				return static_cast<uint32>(smp - 1);
+		}
+	}
+	return uint32_max;
+}
+
+
 // Render count * number of channels samples
 void CSoundFile::CreateStereoMix(int count)
 {
@@ -287,8 +348,16 @@ void CSoundFile::CreateStereoMix(int count)
 	StereoFill(MixSoundBuffer, count, m_dryROfsVol, m_dryLOfsVol);
 	if(m_MixerSettings.gnChannels > 2)
 		StereoFill(MixRearBuffer, count, m_surroundROfsVol, m_surroundLOfsVol);
+	if(m_stemLayout != StemLayout::None)
+	{
+		for(uint32 stem = 0; stem < m_stemOfsVol.size(); stem++)
+		{
+			StereoFill(GetStemBuffer(stem), count, m_stemOfsVol[stem].second, m_stemOfsVol[stem].first);
+		}
+	}
 
 	CHANNELINDEX nchmixed = 0;
+	const uint32 maxMixChannels = std::min(m_MixerSettings.m_nMaxMixChannels, uint32(m_voiceBudget.maxVoices));
 
 	const bool ITPingPongMode = m_playBehaviour[kITPingPongMode];
 
@@ -311,7 +380,7 @@ void CSoundFile::CreateStereoMix(int count)
 
 		mixsample_t *pbuffer = MixSoundBuffer;
 #ifndef NO_REVERB
-		if(((m_MixerSettings.DSPMask & SNDDSP_REVERB) && !chn.dwFlags[CHN_NOREVERB]) || chn.dwFlags[CHN_REVERB])
+		if((((m_MixerSettings.DSPMask & SNDDSP_REVERB) && !chn.dwFlags[CHN_NOREVERB]) || chn.dwFlags[CHN_REVERB]) && !m_previewRender)
 		{
 			pbuffer = m_Reverb.GetReverbSendBuffer(count);
 			pOfsR = &m_Reverb.gnRvbROfsVol;
@@ -324,12 +393,23 @@ void CSoundFile::CreateStereoMix(int count)
 			pOfsR = &m_surroundROfsVol;
 			pOfsL = &m_surroundLOfsVol;
 		}
+		if(m_stemLayout != StemLayout::None)
+		{
+			// Stems are dry, but voices routed to a plugin still go through the plugin below
+			const uint32 stem = GetVoiceStem(m_PlayState.ChnMix[nChn]);
+			if(stem < m_stemOfsVol.size())
+			{
+				pbuffer = GetStemBuffer(stem);
+				pOfsR = &m_stemOfsVol[stem].second;
+				pOfsL = &m_stemOfsVol[stem].first;
+			}
+		}
 
 		//Look for plugins associated with this implicit tracker channel.
 #ifndef NO_PLUGINS
 		PLUGINDEX nMixPlugin = GetBestPlugin(m_PlayState.ChnMix[nChn], PrioritiseInstrument, RespectMutes);
 
-		if ((nMixPlugin > 0) && (nMixPlugin <= MAX_MIXPLUGINS) && m_MixPlugins[nMixPlugin - 1].pMixPlugin != nullptr)
+		if ((nMixPlugin > 0) && (nMixPlugin <= MAX_MIXPLUGINS) && m_MixPlugins[nMixPlugin - 1].pMixPlugin != nullptr && !m_previewRender)
 		{
 			// Render into plugin buffer instead of global buffer
 			SNDMIXPLUGINSTATE &mixState = m_MixPlugins[nMixPlugin - 1].pMixPlugin->m_MixState;
@@ -378,7 +458,7 @@ void CSoundFile::CreateStereoMix(int count)
 			}
 
 			// Should we mix this channel ?
-			if((nchmixed >= m_MixerSettings.m_nMaxMixChannels)				// Too many channels
+			if((nchmixed >= maxMixChannels)								// Too many channels
 				|| (!chn.nRampLength && !(chn.leftVol | chn.rightVol)))		// Channel is completely silent
 			{
 				chn.position += chn.increment * nSmpCount;
@@ -408,7 +488,15 @@ void CSoundFile::CreateStereoMix(int count)
 #ifdef MPT_BUILD_DEBUG
 				SamplePosition targetpos = chn.position + chn.increment * nSmpCount;
 #endif
+				SamplePosition streamOffset(0);
+				if(chn.pModSample != nullptr && chn.pModSample->IsStreamed() && chn.pCurrentSample == chn.pModSample->GetPlaybackPointer())
+				{
+					// Cursors are allocated when loading the module, see CSoundFile::Create
+					MPT_ASSERT(m_sampleStreamCursors.size() == MAX_CHANNELS);
+					streamOffset = PrepareSampleStream(chn, m_sampleStreamCursors[m_PlayState.ChnMix[nChn]], nSmpCount);
+				}
 				MixFuncTable::Functions[functionNdx | (chn.nRampLength ? MixFuncTable::ndxRamp : 0)](chn, m_Resampler, pbuffer, nSmpCount);
+				chn.position += streamOffset;
 #ifdef MPT_BUILD_DEBUG
 				MPT_ASSERT(chn.position.GetUInt() == targetpos.GetUInt());
 #endif
@@ -449,7 +537,7 @@ void CSoundFile::CreateStereoMix(int count)
 				// Test case: PTInstrSwap.mod, PTSwapNoLoop.mod
 				const ModSample &smp = Samples[chn.nNewIns];
 				chn.pModSample = &smp;
-				chn.pCurrentSample = smp.samplev();
+				chn.pCurrentSample = smp.GetPlaybackPointer();
 				chn.dwFlags = (chn.dwFlags & CHN_CHANNELFLAGS) | smp.uFlags;
 				chn.nLength = smp.uFlags[CHN_LOOP] ? smp.nLoopEnd : 0; // non-looping sample continue in oneshot mode (i.e. they will most probably just play silence)
 				chn.nLoopStart = smp.nLoopStart;
@@ -680,7 +768,9 @@ void CSoundFile::ProcessPlugins(uint32 nCount)
 				pObject->Process(pOutL, pOutR, nCount);
 
 				state.inputSilenceCount += nCount;
-				if(plugin.IsAutoSuspendable() && pObject->GetNumOutputChannels() > 0 && state.inputSilenceCount >= m_MixerSettings.gdwMixingFreq * 4)
+				const bool canSuspend = plugin.IsAutoSuspendable() && pObject->GetNumOutputChannels() > 0;
+				const uint32 tailSize = pObject->GetTailSize();
+				if(canSuspend && tailSize == 0 && state.inputSilenceCount >= m_MixerSettings.gdwMixingFreq * 4)
 				{
 					bool isSilent = true;
 					for(uint32 i = 0; i < nCount; i++)
@@ -699,6 +789,27 @@ void CSoundFile::ProcessPlugins(uint32 nCount)
 					{
 						state.inputSilenceCount = 0;
 					}
+				} else if(canSuspend && tailSize > 0 && !(state.dwFlags & SNDMIXPLUGINSTATE::psfHasInput))
+				{
+					// The plugin knows how long its tail is, so it can be suspended as soon as the tail has decayed completely.
+					// Check the plugin's own output, as the output buffer also contains the output of other plugins and channels.
+					bool isSilent = true;
+					for(int chn = 0; chn < std::min(pObject->GetNumOutputChannels(), 2) && isSilent; chn++)
+					{
+						const float *plugOutput = pObject->m_mixBuffer.GetOutputBuffer(chn);
+						for(uint32 i = 0; i < nCount; i++)
+						{
+							if(plugOutput[i] >= FLT_EPSILON || plugOutput[i] <= -FLT_EPSILON)
+							{
+								isSilent = false;
+								break;
+							}
+						}
+					}
+					if(!isSilent)
+						state.tailSilenceCount = 0;
+					else if((state.tailSilenceCount += nCount) >= tailSize)
+						state.dwFlags |= SNDMIXPLUGINSTATE::psfSilenceBypass;
 				}
 			}
 			state.dwFlags &= ~SNDMIXPLUGINSTATE::psfHasInput;
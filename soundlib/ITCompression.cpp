@@ -10,6 +10,7 @@
 
 
 #include "stdafx.h"
+#include <algorithm>
 #include <ostream>
 #include "ITCompression.h"
 #include "../common/misc_util.h"
@@ -309,14 +310,15 @@ void ITCompression::WriteByte(uint8 v)
 // IT 2.14 decompression
 
 
-ITDecompression::ITDecompression(FileReader &file, ModSample &sample, bool it215)
-    : mptSample(sample)
+ITDecompression::ITDecompression(FileReader &file, ModSample &mptSample, bool it215)
+    : length(mptSample.nLength)
+    , numChannels(mptSample.GetNumChannels())
     , is215(it215)
 {
 	for(uint8 chn = 0; chn < mptSample.GetNumChannels(); chn++)
 	{
 		writtenSamples = writePos = 0;
-		while(writtenSamples < sample.nLength && file.CanRead(sizeof(uint16)))
+		while(writtenSamples < length && file.CanRead(sizeof(uint16)))
 		{
 			uint16 compressedSize = file.ReadUint16LE();
 			if(!compressedSize)
@@ -342,10 +344,28 @@ ITDecompression::ITDecompression(FileReader &file, ModSample &sample, bool it215
 }
 
 
+SmpLength ITDecompression::DecodeBlock(FileReader block, void *target, SmpLength maxLength, bool is16Bit, bool it215)
+{
+	ITDecompression decompression(it215);
+	decompression.length = maxLength;
+	decompression.bitFile = block;
+	try
+	{
+		if(is16Bit)
+			decompression.Uncompress<IT16BitParams>(static_cast<int16 *>(target));
+		else
+			decompression.Uncompress<IT8BitParams>(static_cast<int8 *>(target));
+	} catch(const BitReader::eof &)
+	{
+	}
+	return decompression.writtenSamples;
+}
+
+
 template<typename Properties>
 void ITDecompression::Uncompress(typename Properties::sample_t *target)
 {
-	curLength = std::min(mptSample.nLength - writtenSamples, SmpLength(ITCompression::blockSize / sizeof(typename Properties::sample_t)));
+	curLength = std::min(length - writtenSamples, SmpLength(ITCompression::blockSize / sizeof(typename Properties::sample_t)));
 
 	int width = Properties::defWidth;
 	while(curLength > 0)
@@ -402,9 +422,135 @@ void ITDecompression::Write(int v, int topBit, typename Properties::sample_t *ta
 	mem2 += mem1;
 	target[writePos] = static_cast<typename Properties::sample_t>(static_cast<int>(is215 ? mem2 : mem1));
 	writtenSamples++;
-	writePos += mptSample.GetNumChannels();
+	writePos += numChannels;
 	curLength--;
 }
 
 
+//////////////////////////////////////////////////////////////////////////////
+// IT 2.14 decompression during playback
+
+
+ITSampleDecoder::ITSampleDecoder(FileReader &file, const ModSample &sample, bool it215)
+{
+	auto index = std::make_shared<Index>();
+	index->length = sample.nLength;
+	index->numChannels = std::min(sample.GetNumChannels(), uint8(2));
+	index->is16Bit = sample.GetElementarySampleSize() > 1;
+	index->it215 = it215;
+
+	// Walk through the blocks exactly like ITDecompression does. A truncated block makes all following blocks start earlier,
+	// so the only way to know where a block's sampling points end up is to decode it.
+	const FileReader::off_t dataStart = file.GetPosition();
+	const SmpLength blockLength = static_cast<SmpLength>(ITCompression::blockSize / (index->is16Bit ? 2 : 1));
+	std::vector<std::byte> scratch(ITCompression::blockSize);
+	for(uint8 chn = 0; chn < index->numChannels; chn++)
+	{
+		SmpLength written = 0;
+		while(written < index->length && file.CanRead(sizeof(uint16)))
+		{
+			uint16 compressedSize = file.ReadUint16LE();
+			if(!compressedSize)
+				continue;
+			Block block;
+			block.offset = static_cast<std::size_t>(file.GetPosition() - dataStart);
+			FileReader blockFile = file.ReadChunk(compressedSize);
+			block.size = static_cast<std::size_t>(blockFile.GetLength());
+			block.start = written;
+			block.length = ITDecompression::DecodeBlock(blockFile, scratch.data(), std::min(index->length - written, blockLength), index->is16Bit, it215);
+			if(block.length)
+				index->blocks[chn].push_back(block);
+			written += block.length;
+		}
+	}
+
+	const std::size_t dataSize = static_cast<std::size_t>(file.GetPosition() - dataStart);
+	file.Seek(dataStart);
+	FileReader::PinnedRawDataView dataView = file.ReadPinnedRawDataView(dataSize);
+	index->data.assign(dataView.data(), dataView.data() + dataView.size());
+	m_index = std::move(index);
+}
+
+
+std::unique_ptr<ISampleDecoder> ITSampleDecoder::Clone() const
+{
+	return std::unique_ptr<ISampleDecoder>(new ITSampleDecoder(m_index));
+}
+
+
+std::unique_ptr<ISampleDecoder> ITSampleDecoder::CloneState() const
+{
+	// The decoded blocks are not copied, they are cheap to decode again.
+	std::unique_ptr<ITSampleDecoder> decoder(new ITSampleDecoder(m_index));
+	decoder->m_pos = m_pos;
+	return decoder;
+}
+
+
+SmpLength ITSampleDecoder::Decode(void *dest, SmpLength count)
+{
+	const Index &index = *m_index;
+	count = std::min(count, index.length - std::min(m_pos, index.length));
+	for(uint8 chn = 0; chn < index.numChannels; chn++)
+	{
+		if(index.is16Bit)
+			DecodeChannel(static_cast<int16 *>(dest) + chn, chn, count);
+		else
+			DecodeChannel(static_cast<int8 *>(dest) + chn, chn, count);
+	}
+	m_pos += count;
+	return count;
+}
+
+
+SmpLength ITSampleDecoder::Skip(void *, SmpLength count)
+{
+	count = std::min(count, m_index->length - std::min(m_pos, m_index->length));
+	m_pos += count;
+	return count;
+}
+
+
+template<typename T>
+void ITSampleDecoder::DecodeChannel(T *dest, uint8 chn, SmpLength count)
+{
+	const Index &index = *m_index;
+	const std::vector<Block> &blocks = index.blocks[chn];
+	ChannelState &state = m_channels[chn];
+	SmpLength pos = m_pos;
+	const SmpLength end = m_pos + count;
+	// First block that ends after pos
+	auto block = std::upper_bound(blocks.begin(), blocks.end(), pos, [](SmpLength p, const Block &b) { return p < b.start + b.length; });
+	while(pos < end)
+	{
+		// Sampling points that no block was decoded to are silent, just like in a sample that is decoded while loading
+		const SmpLength silenceEnd = (block == blocks.end()) ? end : std::min(end, std::max(pos, block->start));
+		for(; pos < silenceEnd; pos++)
+		{
+			*dest = 0;
+			dest += index.numChannels;
+		}
+		if(pos >= end)
+			break;
+
+		const std::size_t blockIndex = static_cast<std::size_t>(block - blocks.begin());
+		if(state.decodedBlock != blockIndex)
+		{
+			state.buffer.resize(ITCompression::blockSize);
+			FileReader blockFile(mpt::as_span(index.data.data() + block->offset, block->size));
+			ITDecompression::DecodeBlock(blockFile, state.buffer.data(), block->length, index.is16Bit, index.it215);
+			state.decodedBlock = blockIndex;
+		}
+		const T *src = reinterpret_cast<const T *>(state.buffer.data()) + (pos - block->start);
+		const SmpLength blockEnd = std::min(end, block->start + block->length);
+		for(; pos < blockEnd; pos++)
+		{
+			*dest = *src++;
+			dest += index.numChannels;
+		}
+		++block;
+	}
+}
+
+
 OPENMPT_NAMESPACE_END
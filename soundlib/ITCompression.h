@@ -12,10 +12,12 @@
 
 #include "BuildSettings.h"
 
+#include <memory>
 #include <vector>
 #include <iosfwd>
 #include "Snd_defs.h"
 #include "BitReader.h"
+#include "SampleStream.h"
 
 
 OPENMPT_NAMESPACE_BEGIN
@@ -78,10 +80,17 @@ class ITDecompression
 public:
 	ITDecompression(FileReader &file, ModSample &sample, bool it215);
 
+	// Decode a single compressed block (without its size prefix) of one channel into target, which has room for maxLength sampling points.
+	// Returns the number of sampling points that were decoded, which is less than a full block if the block is truncated or invalid.
+	static SmpLength DecodeBlock(FileReader block, void *target, SmpLength maxLength, bool is16Bit, bool it215);
+
 protected:
+	ITDecompression(bool it215) : is215(it215) { }
+
 	BitReader bitFile;
-	ModSample &mptSample;  // Sample that is being processed
 
+	SmpLength length = 0;             // Number of sampling points per channel
+	uint8 numChannels = 1;            // Distance between two sampling points of a channel in the target buffer
 	SmpLength writtenSamples = 0;     // Number of samples so far written on this channel
 	SmpLength writePos = 0;           // Absolut write position in sample (for stereo samples)
 	SmpLength curLength = 0;          // Length of currently processed block
@@ -98,4 +107,55 @@ protected:
 };
 
 
+// Decodes an IT 2.14 / 2.15 compressed sample during playback.
+// Compressed blocks are independent from each other, so after indexing them once while loading, the decoder can jump to any position.
+class ITSampleDecoder : public ISampleDecoder
+{
+public:
+	// Index the compressed data of sample starting at the current position of file, which is advanced to the end of the compressed data.
+	ITSampleDecoder(FileReader &file, const ModSample &sample, bool it215);
+
+	std::unique_ptr<ISampleDecoder> Clone() const override;
+	std::unique_ptr<ISampleDecoder> CloneState() const override;
+	SmpLength Decode(void *dest, SmpLength count) override;
+	SmpLength Skip(void *scratch, SmpLength count) override;
+
+protected:
+	struct Block
+	{
+		std::size_t offset = 0;  // Offset of the compressed data
+		std::size_t size = 0;    // Size of the compressed data
+		SmpLength start = 0;     // First sampling point decoded from this block
+		SmpLength length = 0;    // Number of sampling points decoded from this block
+	};
+
+	// Everything that does not change during decoding, shared between all clones
+	struct Index
+	{
+		std::vector<std::byte> data;
+		std::vector<Block> blocks[2];
+		SmpLength length = 0;
+		uint8 numChannels = 1;
+		bool is16Bit = false;
+		bool it215 = false;
+	};
+
+	struct ChannelState
+	{
+		std::vector<std::byte> buffer;
+		std::size_t decodedBlock = SIZE_MAX;  // Block that is currently held in buffer
+	};
+
+	ITSampleDecoder(std::shared_ptr<const Index> index) : m_index(std::move(index)) { }
+
+	// Decode count sampling points of channel chn into dest, starting at m_pos
+	template<typename T>
+	void DecodeChannel(T *dest, uint8 chn, SmpLength count);
+
+	std::shared_ptr<const Index> m_index;
+	ChannelState m_channels[2];
+	SmpLength m_pos = 0;
+};
+
+
 OPENMPT_NAMESPACE_END
@@ -51,7 +51,7 @@ struct AmigaBlepInterpolation
 {
 	SamplePosition subIncrement;
 	Paula::State *paula;
-	const Paula::BlepArray *WinSincIntegral;
+	const Paula::BlepTable *WinSincIntegral;
 	int numSteps;
 
 	MPT_FORCEINLINE void Start(ModChannel &chn, const CResampler &resampler)
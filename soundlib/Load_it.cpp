@@ -29,6 +29,9 @@
 #include <sstream>
 #include "../common/version.h"
 #include "ITTools.h"
+#include "ITCompression.h"
+#include "ParallelSampleReader.h"
+#include "SampleCache.h"
 
 
 OPENMPT_NAMESPACE_BEGIN
@@ -339,6 +342,22 @@ static void CopyPatternName(CPattern &pattern, FileReader &file)
 }
 
 
+// Keep the compressed data of an IT-compressed sample and decode it during playback.
+static void StreamITSample(ModSample &sample, const SampleIO &sampleIO, FileReader &file)
+{
+	// Same length limits as in SampleIO::ReadSample
+	LimitMax(sample.nLength, MAX_SAMPLE_LENGTH);
+	LimitMax(sample.nLength, mpt::saturate_cast<SmpLength>(static_cast<uint64>(file.BytesLeft()) * (8u / sampleIO.GetNumChannels())));
+	sample.uFlags.set(CHN_16BIT, sampleIO.GetBitDepth() >= 16);
+	sample.uFlags.set(CHN_STEREO, sampleIO.GetChannelFormat() != SampleIO::mono);
+	if(sample.nLength < 1)
+		return;
+	auto decoder = std::make_unique<ITSampleDecoder>(file, sample, sampleIO.GetEncoding() == SampleIO::IT215);
+	sample.FreeSample();
+	sample.stream = std::make_shared<SampleStream>(std::move(decoder), sample);
+}
+
+
 // Get version of Schism Tracker that was used to create an IT/S3M file.
 mpt::ustring CSoundFile::GetSchismTrackerVersion(uint16 cwtv, uint32 reserved)
 {
@@ -771,6 +790,10 @@ bool CSoundFile::ReadIT(FileReader &file, ModLoadingFlags loadFlags)
 	// Reading Samples
 	m_nSamples = std::min(static_cast<SAMPLEINDEX>(fileHeader.smpnum), static_cast<SAMPLEINDEX>(MAX_SAMPLES - 1));
 	bool lastSampleCompressed = false;
+	DecodedSampleCache::Key cacheKey;
+	bool cacheKeyValid = false;
+	ParallelSampleReader sampleReader(file, (loadFlags & loadSampleData) ? m_loadThreads : 1);
+	std::vector<FileReader::off_t> compressedSampleEnd(GetNumSamples(), 0);
 	for(SAMPLEINDEX i = 0; i < GetNumSamples(); i++)
 	{
 		ITSample sampleHeader;
@@ -797,7 +820,37 @@ bool CSoundFile::ReadIT(FileReader &file, ModLoadingFlags loadFlags)
 			} else if(!sample.uFlags[SMP_KEEPONDISK])
 			{
 				SampleIO sampleIO = sampleHeader.GetSampleFormat(fileHeader.cwtv);
-				if(loadFlags & loadSampleData)
+				const bool itCompressed = sampleIO.GetEncoding() == SampleIO::IT214 || sampleIO.GetEncoding() == SampleIO::IT215;
+				if((loadFlags & loadSampleData) && itCompressed && m_sampleStreamThreshold != 0
+					&& static_cast<uint64>(sample.nLength) * sampleIO.GetNumChannels() * (sampleIO.GetBitDepth() / 8u) > m_sampleStreamThreshold)
+				{
+					// Very long sample: Decode it while playing instead
+					StreamITSample(sample, sampleIO, file);
+					compressedSampleEnd[i] = file.GetPosition();
+				} else if((loadFlags & loadSampleData) && sampleIO.IsVariableLengthEncoded())
+				{
+					// Compressed samples are expensive to decode, so try to get them from the shared cache first
+					const bool useCache = DecodedSampleCache::IsEnabled();
+					if(useCache && !cacheKeyValid)
+					{
+						cacheKey.fileHash = DecodedSampleCache::HashFile(file);
+						cacheKey.fileSize = file.GetLength();
+						cacheKeyValid = true;
+					}
+					cacheKey.sampleIndex = i + 1;
+					// The size of compressed samples is only known after decoding them,
+					// so the decoder job has to tell us where the sample data ended.
+					FileReader sampleFile = sampleReader.GetFile();
+					sampleFile.Seek(file.GetPosition());
+					sampleReader.Add([&sample, &sampleEnd = compressedSampleEnd[i], sampleIO, sampleFile, key = cacheKey, useCache]() mutable
+					{
+						if(useCache)
+							DecodedSampleCache::ReadSample(sampleIO, sample, sampleFile, key);
+						else
+							sampleIO.ReadSample(sample, sampleFile);
+						sampleEnd = sampleFile.GetPosition();
+					});
+				} else if(loadFlags & loadSampleData)
 				{
 					sampleIO.ReadSample(sample, file);
 				} else
@@ -835,6 +888,11 @@ bool CSoundFile::ReadIT(FileReader &file, ModLoadingFlags loadFlags)
 			lastSampleOffset = std::max(lastSampleOffset, file.GetPosition());
 		}
 	}
+	sampleReader.Run();
+	for(const auto sampleEnd : compressedSampleEnd)
+	{
+		lastSampleOffset = std::max(lastSampleOffset, sampleEnd);
+	}
 	m_nSamples = std::max(SAMPLEINDEX(1), GetNumSamples());
 
 	if(possibleXMconversion && fileHeader.cwtv == 0x0204 && fileHeader.cmwt == 0x0200 && fileHeader.special == 0 && fileHeader.reserved == 0
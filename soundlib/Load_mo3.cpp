@@ -21,6 +21,8 @@
 
 #include "MPEGFrame.h"
 #include "OggStream.h"
+#include "ParallelSampleReader.h"
+#include "SampleCache.h"
 
 #if defined(MPT_WITH_VORBIS) && defined(MPT_WITH_VORBISFILE)
 #include <sstream>
@@ -1301,6 +1303,18 @@ bool CSoundFile::ReadMO3(FileReader &file, ModLoadingFlags loadFlags)
 
 	std::vector<MO3SampleChunk> sampleChunks(m_nSamples);
 
+	// Decoding Vorbis / MP3 / delta-compressed samples is expensive, so share the decoded samples between instances of the same file if possible
+	const bool useSampleCache = (loadFlags & loadSampleData) && DecodedSampleCache::IsEnabled();
+	DecodedSampleCache::Key cacheKey;
+	if(useSampleCache)
+	{
+		cacheKey.fileHash = DecodedSampleCache::HashFile(file);
+		cacheKey.fileSize = file.GetLength();
+	}
+
+	// Delta-compressed and Ogg samples do not depend on each other, so they can be decoded in parallel.
+	ParallelSampleReader sampleReader(file, (loadFlags & loadSampleData) ? m_loadThreads : 1);
+
 	const bool frequencyIsHertz = (version >= 5 || !(fileHeader.flags & MO3FileHeader::linearSlides));
 	bool unsupportedSamples = false;
 	for(SAMPLEINDEX smp = 1; smp <= m_nSamples; smp++)
@@ -1341,7 +1355,8 @@ bool CSoundFile::ReadMO3(FileReader &file, ModLoadingFlags loadFlags)
 			    .ReadSample(Samples[smp], file);
 		} else if(smpHeader.compressedSize < 0 && (smp + smpHeader.compressedSize) > 0)
 		{
-			// Duplicate sample
+			// Duplicate sample; the original sample might still be decoding
+			sampleReader.Run();
 			sample.CopyWaveform(Samples[smp + smpHeader.compressedSize]);
 		} else if(smpHeader.compressedSize > 0)
 		{
@@ -1350,7 +1365,8 @@ bool CSoundFile::ReadMO3(FileReader &file, ModLoadingFlags loadFlags)
 			if(smpHeader.flags & MO3Sample::smpStereo)
 				sample.uFlags.set(CHN_STEREO);
 
-			FileReader sampleData = file.ReadChunk(smpHeader.compressedSize);
+			FileReader sampleData = sampleReader.GetChunk(file.GetPosition(), smpHeader.compressedSize);
+			file.Skip(smpHeader.compressedSize);
 			const uint8 numChannels = sample.GetNumChannels();
 
 			if(compression == MO3Sample::smpDeltaCompression || compression == MO3Sample::smpDeltaPrediction)
@@ -1366,24 +1382,42 @@ bool CSoundFile::ReadMO3(FileReader &file, ModLoadingFlags loadFlags)
 				LimitMax(sample.nLength, mpt::saturate_cast<SmpLength>(maxLength));
 			}
 
-			if(compression == MO3Sample::smpDeltaCompression)
+			const bool cacheable = useSampleCache && (compression == MO3Sample::smpDeltaCompression || compression == MO3Sample::smpDeltaPrediction || compression == MO3Sample::smpCompressionMPEG);
+			bool cacheHit = false;
+			if(cacheable)
 			{
-				if(sample.AllocateSample())
-				{
-					if(smpHeader.flags & MO3Sample::smp16Bit)
-						UnpackMO3DeltaSample<MO3Delta16BitParams>(sampleData, sample.sample16(), sample.nLength, numChannels);
-					else
-						UnpackMO3DeltaSample<MO3Delta8BitParams>(sampleData, sample.sample8(), sample.nLength, numChannels);
-				}
-			} else if(compression == MO3Sample::smpDeltaPrediction)
+				cacheKey.sampleIndex = smp;
+				cacheKey.format = compression;
+				cacheKey.length = sample.nLength;
+				uint64 encodedSize = 0;
+				cacheHit = DecodedSampleCache::Lookup(cacheKey, sample, encodedSize);
+			}
+
+			if(cacheHit)
+			{
+				// Sample data has already been restored from the cache
+			} else if(compression == MO3Sample::smpDeltaCompression || compression == MO3Sample::smpDeltaPrediction)
 			{
-				if(sample.AllocateSample())
+				sampleReader.Add([&sample, sampleData, compression, numChannels, is16Bit = (smpHeader.flags & MO3Sample::smp16Bit) != 0, encodedSize = static_cast<uint64>(smpHeader.compressedSize), key = cacheKey, cacheable]() mutable
 				{
-					if(smpHeader.flags & MO3Sample::smp16Bit)
-						UnpackMO3DeltaPredictionSample<MO3Delta16BitParams>(sampleData, sample.sample16(), sample.nLength, numChannels);
-					else
-						UnpackMO3DeltaPredictionSample<MO3Delta8BitParams>(sampleData, sample.sample8(), sample.nLength, numChannels);
-				}
+					if(!sample.AllocateSample())
+						return;
+					if(compression == MO3Sample::smpDeltaCompression)
+					{
+						if(is16Bit)
+							UnpackMO3DeltaSample<MO3Delta16BitParams>(sampleData, sample.sample16(), sample.nLength, numChannels);
+						else
+							UnpackMO3DeltaSample<MO3Delta8BitParams>(sampleData, sample.sample8(), sample.nLength, numChannels);
+					} else
+					{
+						if(is16Bit)
+							UnpackMO3DeltaPredictionSample<MO3Delta16BitParams>(sampleData, sample.sample16(), sample.nLength, numChannels);
+						else
+							UnpackMO3DeltaPredictionSample<MO3Delta8BitParams>(sampleData, sample.sample8(), sample.nLength, numChannels);
+					}
+					if(cacheable)
+						DecodedSampleCache::Store(key, sample, encodedSize);
+				});
 			} else if(compression == MO3Sample::smpCompressionOgg || compression == MO3Sample::smpSharedOgg)
 			{
 				// Since shared Ogg headers can stem from a sample that has not been read yet, postpone Ogg import.
@@ -1431,332 +1465,376 @@ bool CSoundFile::ReadMO3(FileReader &file, ModLoadingFlags loadFlags)
 			{
 				unsupportedSamples = true;
 			}
+
+			if(cacheable && !cacheHit && compression == MO3Sample::smpCompressionMPEG)
+			{
+				DecodedSampleCache::Store(cacheKey, sample, smpHeader.compressedSize);
+			}
 		}
 	}
 
+	sampleReader.Run();
+
 	// Now we can load Ogg samples with shared headers.
+	// Messages and errors are collected per sample, as they cannot be logged from the decoder threads.
+	struct OggSampleStatus
+	{
+		std::vector<std::pair<LogLevel, mpt::ustring>> messages;
+		bool unsupported = false;
+	};
+	std::vector<OggSampleStatus> oggStatus(m_nSamples);
 	if(loadFlags & loadSampleData)
 	{
 		for(SAMPLEINDEX smp = 1; smp <= m_nSamples; smp++)
 		{
-			MO3SampleChunk &sampleChunk = sampleChunks[smp - 1];
 			// Is this an Ogg sample?
-			if(!sampleChunk.chunk.IsValid())
+			if(!sampleChunks[smp - 1].chunk.IsValid())
 				continue;
 
-			SAMPLEINDEX sharedOggHeader = smp + sampleChunk.sharedHeader;
+			if(useSampleCache)
+			{
+				cacheKey.sampleIndex = smp;
+				cacheKey.format = MO3Sample::smpCompressionOgg;
+				cacheKey.length = Samples[smp].nLength;
+				uint64 encodedSize = 0;
+				if(DecodedSampleCache::Lookup(cacheKey, Samples[smp], encodedSize))
+					continue;
+			}
+
+			SAMPLEINDEX sharedOggHeader = smp + sampleChunks[smp - 1].sharedHeader;
 			// Which chunk are we going to read the header from?
 			// Note: Every Ogg stream has a unique serial number.
 			// stb_vorbis (currently) ignores this serial number so we can just stitch
 			// together our sample without adjusting the shared header's serial number.
 			const bool sharedHeader = sharedOggHeader != smp && sharedOggHeader > 0 && sharedOggHeader <= m_nSamples;
+			// Every job reads from its own copy of the shared header chunk.
+			FileReader sharedHeaderChunk = sharedHeader ? sampleChunks[sharedOggHeader - 1].chunk : FileReader();
+
+			sampleReader.Add([this, smp, sampleChunk = sampleChunks[smp - 1], sharedHeader, sharedHeaderChunk, &status = oggStatus[smp - 1], useSampleCache, key = cacheKey]() mutable
+			{
 
 #if defined(MPT_WITH_VORBIS) && defined(MPT_WITH_VORBISFILE)
 
-			std::vector<char> mergedData;
-			if(sharedHeader)
-			{
-				// Prepend the shared header to the actual sample data and adjust bitstream serial numbers.
-				// We do not handle multiple muxed logical streams as they do not exist in practice in mo3.
-				// We assume sequence numbers are consecutive at the end of the headers.
-				// Corrupted pages get dropped as required by Ogg spec. We cannot do any further sane parsing on them anyway.
-				// We do not match up multiple muxed stream properly as this would need parsing of actual packet data to determine or guess the codec.
-				// Ogg Vorbis files may contain at least an additional Ogg Skeleton stream. It is not clear whether these actually exist in MO3.
-				// We do not validate packet structure or logical bitstream structure (i.e. sequence numbers and granule positions).
+				std::vector<char> mergedData;
+				if(sharedHeader)
+				{
+					// Prepend the shared header to the actual sample data and adjust bitstream serial numbers.
+					// We do not handle multiple muxed logical streams as they do not exist in practice in mo3.
+					// We assume sequence numbers are consecutive at the end of the headers.
+					// Corrupted pages get dropped as required by Ogg spec. We cannot do any further sane parsing on them anyway.
+					// We do not match up multiple muxed stream properly as this would need parsing of actual packet data to determine or guess the codec.
+					// Ogg Vorbis files may contain at least an additional Ogg Skeleton stream. It is not clear whether these actually exist in MO3.
+					// We do not validate packet structure or logical bitstream structure (i.e. sequence numbers and granule positions).
 
-				// TODO: At least handle Skeleton streams here, as they violate our stream ordering assumptions here.
+					// TODO: At least handle Skeleton streams here, as they violate our stream ordering assumptions here.
 
 #if 0
-				// This block may still turn out to be useful as it does a more thourough validation of the stream than the optimized version below.
+					// This block may still turn out to be useful as it does a more thourough validation of the stream than the optimized version below.
 
-				// We copy the whole data into a single consecutive buffer in order to keep things simple when interfacing libvorbisfile.
-				// We could in theory only adjust the header and pass 2 chunks to libvorbisfile.
-				// Another option would be to demux both chunks on our own (or using libogg) and pass the raw packet data to libvorbis directly.
+					// We copy the whole data into a single consecutive buffer in order to keep things simple when interfacing libvorbisfile.
+					// We could in theory only adjust the header and pass 2 chunks to libvorbisfile.
+					// Another option would be to demux both chunks on our own (or using libogg) and pass the raw packet data to libvorbis directly.
 
-				std::ostringstream mergedStream(std::ios::binary);
-				mergedStream.imbue(std::locale::classic());
+					std::ostringstream mergedStream(std::ios::binary);
+					mergedStream.imbue(std::locale::classic());
 
-				sampleChunks[sharedOggHeader - 1].chunk.Rewind();
-				FileReader sharedChunk = sampleChunks[sharedOggHeader - 1].chunk.ReadChunk(sampleChunk.headerSize);
-				sharedChunk.Rewind();
+					sharedHeaderChunk.Rewind();
+					FileReader sharedChunk = sharedHeaderChunk.ReadChunk(sampleChunk.headerSize);
+					sharedChunk.Rewind();
 
-				std::vector<uint32> streamSerials;
-				Ogg::PageInfo oggPageInfo;
-				std::vector<uint8> oggPageData;
+					std::vector<uint32> streamSerials;
+					Ogg::PageInfo oggPageInfo;
+					std::vector<uint8> oggPageData;
 
-				streamSerials.clear();
-				while(Ogg::ReadPageAndSkipJunk(sharedChunk, oggPageInfo, oggPageData))
-				{
-					auto it = std::find(streamSerials.begin(), streamSerials.end(), oggPageInfo.header.bitstream_serial_number);
-					if(it == streamSerials.end())
+					streamSerials.clear();
+					while(Ogg::ReadPageAndSkipJunk(sharedChunk, oggPageInfo, oggPageData))
 					{
-						streamSerials.push_back(oggPageInfo.header.bitstream_serial_number);
-						it = streamSerials.begin() + (streamSerials.size() - 1);
+						auto it = std::find(streamSerials.begin(), streamSerials.end(), oggPageInfo.header.bitstream_serial_number);
+						if(it == streamSerials.end())
+						{
+							streamSerials.push_back(oggPageInfo.header.bitstream_serial_number);
+							it = streamSerials.begin() + (streamSerials.size() - 1);
+						}
+						uint32 newSerial = it - streamSerials.begin() + 1;
+						oggPageInfo.header.bitstream_serial_number = newSerial;
+						Ogg::UpdatePageCRC(oggPageInfo, oggPageData);
+						Ogg::WritePage(mergedStream, oggPageInfo, oggPageData);
 					}
-					uint32 newSerial = it - streamSerials.begin() + 1;
-					oggPageInfo.header.bitstream_serial_number = newSerial;
-					Ogg::UpdatePageCRC(oggPageInfo, oggPageData);
-					Ogg::WritePage(mergedStream, oggPageInfo, oggPageData);
-				}
 
-				streamSerials.clear();
-				while(Ogg::ReadPageAndSkipJunk(sampleChunk.chunk, oggPageInfo, oggPageData))
-				{
-					auto it = std::find(streamSerials.begin(), streamSerials.end(), oggPageInfo.header.bitstream_serial_number);
-					if(it == streamSerials.end())
+					streamSerials.clear();
+					while(Ogg::ReadPageAndSkipJunk(sampleChunk.chunk, oggPageInfo, oggPageData))
 					{
-						streamSerials.push_back(oggPageInfo.header.bitstream_serial_number);
-						it = streamSerials.begin() + (streamSerials.size() - 1);
+						auto it = std::find(streamSerials.begin(), streamSerials.end(), oggPageInfo.header.bitstream_serial_number);
+						if(it == streamSerials.end())
+						{
+							streamSerials.push_back(oggPageInfo.header.bitstream_serial_number);
+							it = streamSerials.begin() + (streamSerials.size() - 1);
+						}
+						uint32 newSerial = it - streamSerials.begin() + 1;
+						oggPageInfo.header.bitstream_serial_number = newSerial;
+						Ogg::UpdatePageCRC(oggPageInfo, oggPageData);
+						Ogg::WritePage(mergedStream, oggPageInfo, oggPageData);
 					}
-					uint32 newSerial = it - streamSerials.begin() + 1;
-					oggPageInfo.header.bitstream_serial_number = newSerial;
-					Ogg::UpdatePageCRC(oggPageInfo, oggPageData);
-					Ogg::WritePage(mergedStream, oggPageInfo, oggPageData);
-				}
 
-				std::string mergedStreamData = mergedStream.str();
-				mergedData.insert(mergedData.end(), mergedStreamData.begin(), mergedStreamData.end());
+					std::string mergedStreamData = mergedStream.str();
+					mergedData.insert(mergedData.end(), mergedStreamData.begin(), mergedStreamData.end());
 
 #else
 
-				// We assume same ordering of streams in both header and data if
-				// multiple streams are present.
+					// We assume same ordering of streams in both header and data if
+					// multiple streams are present.
 
-				std::ostringstream mergedStream(std::ios::binary);
-				mergedStream.imbue(std::locale::classic());
+					std::ostringstream mergedStream(std::ios::binary);
+					mergedStream.imbue(std::locale::classic());
 
-				sampleChunks[sharedOggHeader - 1].chunk.Rewind();
-				FileReader sharedChunk = sampleChunks[sharedOggHeader - 1].chunk.ReadChunk(sampleChunk.headerSize);
-				sharedChunk.Rewind();
+					sharedHeaderChunk.Rewind();
+					FileReader sharedChunk = sharedHeaderChunk.ReadChunk(sampleChunk.headerSize);
+					sharedChunk.Rewind();
 
-				std::vector<uint32> dataStreamSerials;
-				std::vector<uint32> headStreamSerials;
-				Ogg::PageInfo oggPageInfo;
-				std::vector<uint8> oggPageData;
+					std::vector<uint32> dataStreamSerials;
+					std::vector<uint32> headStreamSerials;
+					Ogg::PageInfo oggPageInfo;
+					std::vector<uint8> oggPageData;
 
-				// Gather bitstream serial numbers form sample data chunk
-				dataStreamSerials.clear();
-				while(Ogg::ReadPageAndSkipJunk(sampleChunk.chunk, oggPageInfo, oggPageData))
-				{
-					if(!mpt::contains(dataStreamSerials, oggPageInfo.header.bitstream_serial_number))
+					// Gather bitstream serial numbers form sample data chunk
+					dataStreamSerials.clear();
+					while(Ogg::ReadPageAndSkipJunk(sampleChunk.chunk, oggPageInfo, oggPageData))
 					{
-						dataStreamSerials.push_back(oggPageInfo.header.bitstream_serial_number);
+						if(!mpt::contains(dataStreamSerials, oggPageInfo.header.bitstream_serial_number))
+						{
+							dataStreamSerials.push_back(oggPageInfo.header.bitstream_serial_number);
+						}
 					}
-				}
 
-				// Apply the data bitstream serial numbers to the header
-				headStreamSerials.clear();
-				while(Ogg::ReadPageAndSkipJunk(sharedChunk, oggPageInfo, oggPageData))
-				{
-					auto it = std::find(headStreamSerials.begin(), headStreamSerials.end(), oggPageInfo.header.bitstream_serial_number);
-					if(it == headStreamSerials.end())
+					// Apply the data bitstream serial numbers to the header
+					headStreamSerials.clear();
+					while(Ogg::ReadPageAndSkipJunk(sharedChunk, oggPageInfo, oggPageData))
 					{
-						headStreamSerials.push_back(oggPageInfo.header.bitstream_serial_number);
-						it = headStreamSerials.begin() + (headStreamSerials.size() - 1);
-					}
-					uint32 newSerial = 0;
-					if(dataStreamSerials.size() >= static_cast<std::size_t>(it - headStreamSerials.begin()))
-					{
-						// Found corresponding stream in data chunk.
-						newSerial = dataStreamSerials[it - headStreamSerials.begin()];
-					} else
-					{
-						// No corresponding stream in data chunk. Find a free serialno.
-						std::size_t extraIndex = (it - headStreamSerials.begin()) - dataStreamSerials.size();
-						for(newSerial = 1; newSerial < 0xffffffffu; ++newSerial)
+						auto it = std::find(headStreamSerials.begin(), headStreamSerials.end(), oggPageInfo.header.bitstream_serial_number);
+						if(it == headStreamSerials.end())
 						{
-							if(!mpt::contains(dataStreamSerials, newSerial))
-							{
-								extraIndex -= 1;
-							}
-							if(extraIndex == 0)
+							headStreamSerials.push_back(oggPageInfo.header.bitstream_serial_number);
+							it = headStreamSerials.begin() + (headStreamSerials.size() - 1);
+						}
+						uint32 newSerial = 0;
+						if(dataStreamSerials.size() >= static_cast<std::size_t>(it - headStreamSerials.begin()))
+						{
+							// Found corresponding stream in data chunk.
+							newSerial = dataStreamSerials[it - headStreamSerials.begin()];
+						} else
+						{
+							// No corresponding stream in data chunk. Find a free serialno.
+							std::size_t extraIndex = (it - headStreamSerials.begin()) - dataStreamSerials.size();
+							for(newSerial = 1; newSerial < 0xffffffffu; ++newSerial)
 							{
-								break;
+								if(!mpt::contains(dataStreamSerials, newSerial))
+								{
+									extraIndex -= 1;
+								}
+								if(extraIndex == 0)
+								{
+									break;
+								}
 							}
 						}
+						oggPageInfo.header.bitstream_serial_number = newSerial;
+						Ogg::UpdatePageCRC(oggPageInfo, oggPageData);
+						Ogg::WritePage(mergedStream, oggPageInfo, oggPageData);
 					}
-					oggPageInfo.header.bitstream_serial_number = newSerial;
-					Ogg::UpdatePageCRC(oggPageInfo, oggPageData);
-					Ogg::WritePage(mergedStream, oggPageInfo, oggPageData);
-				}
 
-				if(headStreamSerials.size() > 1)
-				{
-					AddToLog(LogWarning, MPT_UFORMAT("Sample {}: Ogg Vorbis data with shared header and multiple logical bitstreams in header chunk found. This may be handled incorrectly.")(smp));
-				} else if(dataStreamSerials.size() > 1)
-				{
-					AddToLog(LogWarning, MPT_UFORMAT("Sample {}: Ogg Vorbis sample with shared header and multiple logical bitstreams found. This may be handled incorrectly.")(smp));
-				} else if((dataStreamSerials.size() == 1) && (headStreamSerials.size() == 1) && (dataStreamSerials[0] != headStreamSerials[0]))
-				{
-					AddToLog(LogInformation, MPT_UFORMAT("Sample {}: Ogg Vorbis data with shared header and different logical bitstream serials found.")(smp));
-				}
+					if(headStreamSerials.size() > 1)
+					{
+						status.messages.emplace_back(LogWarning, MPT_UFORMAT("Sample {}: Ogg Vorbis data with shared header and multiple logical bitstreams in header chunk found. This may be handled incorrectly.")(smp));
+					} else if(dataStreamSerials.size() > 1)
+					{
+						status.messages.emplace_back(LogWarning, MPT_UFORMAT("Sample {}: Ogg Vorbis sample with shared header and multiple logical bitstreams found. This may be handled incorrectly.")(smp));
+					} else if((dataStreamSerials.size() == 1) && (headStreamSerials.size() == 1) && (dataStreamSerials[0] != headStreamSerials[0]))
+					{
+						status.messages.emplace_back(LogInformation, MPT_UFORMAT("Sample {}: Ogg Vorbis data with shared header and different logical bitstream serials found.")(smp));
+					}
 
-				std::string mergedStreamData = mergedStream.str();
-				mergedData.insert(mergedData.end(), mergedStreamData.begin(), mergedStreamData.end());
+					std::string mergedStreamData = mergedStream.str();
+					mergedData.insert(mergedData.end(), mergedStreamData.begin(), mergedStreamData.end());
 
-				sampleChunk.chunk.Rewind();
-				FileReader::PinnedRawDataView sampleChunkView = sampleChunk.chunk.GetPinnedRawDataView();
-				mpt::span<const char> sampleChunkViewSpan = mpt::byte_cast<mpt::span<const char>>(sampleChunkView.span());
-				mergedData.insert(mergedData.end(), sampleChunkViewSpan.begin(), sampleChunkViewSpan.end());
+					sampleChunk.chunk.Rewind();
+					FileReader::PinnedRawDataView sampleChunkView = sampleChunk.chunk.GetPinnedRawDataView();
+					mpt::span<const char> sampleChunkViewSpan = mpt::byte_cast<mpt::span<const char>>(sampleChunkView.span());
+					mergedData.insert(mergedData.end(), sampleChunkViewSpan.begin(), sampleChunkViewSpan.end());
 
 #endif
-			}
-			FileReader mergedDataChunk(mpt::byte_cast<mpt::const_byte_span>(mpt::as_span(mergedData)));
+				}
+				FileReader mergedDataChunk(mpt::byte_cast<mpt::const_byte_span>(mpt::as_span(mergedData)));
 
-			FileReader &sampleData = sharedHeader ? mergedDataChunk : sampleChunk.chunk;
-			FileReader &headerChunk = sampleData;
+				FileReader &sampleData = sharedHeader ? mergedDataChunk : sampleChunk.chunk;
+				FileReader &headerChunk = sampleData;
 
 #else  // !(MPT_WITH_VORBIS && MPT_WITH_VORBISFILE)
 
-			FileReader &sampleData = sampleChunk.chunk;
-			FileReader &headerChunk = sharedHeader ? sampleChunks[sharedOggHeader - 1].chunk : sampleData;
+				FileReader &sampleData = sampleChunk.chunk;
+				FileReader &headerChunk = sharedHeader ? sharedHeaderChunk : sampleData;
 #if defined(MPT_WITH_STBVORBIS)
-			std::size_t initialRead = sharedHeader ? sampleChunk.headerSize : headerChunk.GetLength();
+				std::size_t initialRead = sharedHeader ? sampleChunk.headerSize : headerChunk.GetLength();
 #endif  // MPT_WITH_STBVORBIS
 
 #endif  // MPT_WITH_VORBIS && MPT_WITH_VORBISFILE
 
-			headerChunk.Rewind();
-			if(sharedHeader && !headerChunk.CanRead(sampleChunk.headerSize))
-				continue;
+				headerChunk.Rewind();
+				if(sharedHeader && !headerChunk.CanRead(sampleChunk.headerSize))
+					return;
 
 #if defined(MPT_WITH_VORBIS) && defined(MPT_WITH_VORBISFILE)
 
-			ov_callbacks callbacks = {
-			    &VorbisfileFilereaderRead,
-			    &VorbisfileFilereaderSeek,
-			    nullptr,
-			    &VorbisfileFilereaderTell};
-			OggVorbis_File vf;
-			MemsetZero(vf);
-			if(ov_open_callbacks(&sampleData, &vf, nullptr, 0, callbacks) == 0)
-			{
-				if(ov_streams(&vf) == 1)
-				{  // we do not support chained vorbis samples
-					vorbis_info *vi = ov_info(&vf, -1);
-					if(vi && vi->rate > 0 && vi->channels > 0)
-					{
-						ModSample &sample = Samples[smp];
-						sample.AllocateSample();
-						SmpLength offset = 0;
-						int channels = vi->channels;
-						int current_section = 0;
-						long decodedSamples = 0;
-						bool eof = false;
-						while(!eof && offset < sample.nLength && sample.HasSampleData())
+				ov_callbacks callbacks = {
+				    &VorbisfileFilereaderRead,
+				    &VorbisfileFilereaderSeek,
+				    nullptr,
+				    &VorbisfileFilereaderTell};
+				OggVorbis_File vf;
+				MemsetZero(vf);
+				if(ov_open_callbacks(&sampleData, &vf, nullptr, 0, callbacks) == 0)
+				{
+					if(ov_streams(&vf) == 1)
+					{  // we do not support chained vorbis samples
+						vorbis_info *vi = ov_info(&vf, -1);
+						if(vi && vi->rate > 0 && vi->channels > 0)
 						{
-							float **output = nullptr;
-							long ret = ov_read_float(&vf, &output, 1024, &current_section);
-							if(ret == 0)
-							{
-								eof = true;
-							} else if(ret < 0)
+							ModSample &sample = Samples[smp];
+							sample.AllocateSample();
+							SmpLength offset = 0;
+							int channels = vi->channels;
+							int current_section = 0;
+							long decodedSamples = 0;
+							bool eof = false;
+							while(!eof && offset < sample.nLength && sample.HasSampleData())
 							{
-								// stream error, just try to continue
-							} else
-							{
-								decodedSamples = ret;
-								LimitMax(decodedSamples, mpt::saturate_cast<long>(sample.nLength - offset));
-								if(decodedSamples > 0 && channels == sample.GetNumChannels())
+								float **output = nullptr;
+								long ret = ov_read_float(&vf, &output, 1024, &current_section);
+								if(ret == 0)
+								{
+									eof = true;
+								} else if(ret < 0)
+								{
+									// stream error, just try to continue
+								} else
 								{
-									for(int chn = 0; chn < channels; chn++)
+									decodedSamples = ret;
+									LimitMax(decodedSamples, mpt::saturate_cast<long>(sample.nLength - offset));
+									if(decodedSamples > 0 && channels == sample.GetNumChannels())
 									{
-										if(sample.uFlags[CHN_16BIT])
+										for(int chn = 0; chn < channels; chn++)
 										{
-											CopyChannelToInterleaved<SC::Convert<int16, float>>(sample.sample16() + offset * sample.GetNumChannels(), output[chn], channels, decodedSamples, chn);
-										} else
-										{
-											CopyChannelToInterleaved<SC::Convert<int8, float>>(sample.sample8() + offset * sample.GetNumChannels(), output[chn], channels, decodedSamples, chn);
+											if(sample.uFlags[CHN_16BIT])
+											{
+												CopyChannelToInterleaved<SC::Convert<int16, float>>(sample.sample16() + offset * sample.GetNumChannels(), output[chn], channels, decodedSamples, chn);
+											} else
+											{
+												CopyChannelToInterleaved<SC::Convert<int8, float>>(sample.sample8() + offset * sample.GetNumChannels(), output[chn], channels, decodedSamples, chn);
+											}
 										}
 									}
+									offset += decodedSamples;
 								}
-								offset += decodedSamples;
 							}
+						} else
+						{
+							status.unsupported = true;
 						}
 					} else
 					{
-						unsupportedSamples = true;
+						status.messages.emplace_back(LogWarning, MPT_UFORMAT("Sample {}: Unsupported Ogg Vorbis chained stream found.")(smp));
+						status.unsupported = true;
 					}
+					ov_clear(&vf);
 				} else
 				{
-					AddToLog(LogWarning, MPT_UFORMAT("Sample {}: Unsupported Ogg Vorbis chained stream found.")(smp));
-					unsupportedSamples = true;
+					status.unsupported = true;
 				}
-				ov_clear(&vf);
-			} else
-			{
-				unsupportedSamples = true;
-			}
 
 #elif defined(MPT_WITH_STBVORBIS)
 
-			// NOTE/TODO: stb_vorbis does not handle inferred negative PCM sample
-			// position at stream start. (See
-			// <https://www.xiph.org/vorbis/doc/Vorbis_I_spec.html#x1-132000A.2>).
-			// This means that, for remuxed and re-aligned/cutted (at stream start)
-			// Vorbis files, stb_vorbis will include superfluous samples at the
-			// beginning. MO3 files with this property are yet to be spotted in the
-			// wild, thus, this behaviour is currently not problematic.
-
-			int consumed = 0, error = 0;
-			stb_vorbis *vorb = nullptr;
-			if(sharedHeader)
-			{
-				FileReader::PinnedRawDataView headChunkView = headerChunk.GetPinnedRawDataView(initialRead);
-				vorb = stb_vorbis_open_pushdata(mpt::byte_cast<const unsigned char *>(headChunkView.data()), mpt::saturate_cast<int>(headChunkView.size()), &consumed, &error, nullptr);
-				headerChunk.Skip(consumed);
-			}
-			FileReader::PinnedRawDataView sampleDataView = sampleData.GetPinnedRawDataView();
-			const std::byte *data = sampleDataView.data();
-			std::size_t dataLeft = sampleDataView.size();
-			if(!sharedHeader)
-			{
-				vorb = stb_vorbis_open_pushdata(mpt::byte_cast<const unsigned char *>(data), mpt::saturate_cast<int>(dataLeft), &consumed, &error, nullptr);
-				sampleData.Skip(consumed);
-				data += consumed;
-				dataLeft -= consumed;
-			}
-			if(vorb)
-			{
-				// Header has been read, proceed to reading the sample data
-				ModSample &sample = Samples[smp];
-				sample.AllocateSample();
-				SmpLength offset = 0;
-				while((error == VORBIS__no_error || (error == VORBIS_need_more_data && dataLeft > 0))
-				      && offset < sample.nLength && sample.HasSampleData())
+				// NOTE/TODO: stb_vorbis does not handle inferred negative PCM sample
+				// position at stream start. (See
+				// <https://www.xiph.org/vorbis/doc/Vorbis_I_spec.html#x1-132000A.2>).
+				// This means that, for remuxed and re-aligned/cutted (at stream start)
+				// Vorbis files, stb_vorbis will include superfluous samples at the
+				// beginning. MO3 files with this property are yet to be spotted in the
+				// wild, thus, this behaviour is currently not problematic.
+
+				int consumed = 0, error = 0;
+				stb_vorbis *vorb = nullptr;
+				if(sharedHeader)
+				{
+					FileReader::PinnedRawDataView headChunkView = headerChunk.GetPinnedRawDataView(initialRead);
+					vorb = stb_vorbis_open_pushdata(mpt::byte_cast<const unsigned char *>(headChunkView.data()), mpt::saturate_cast<int>(headChunkView.size()), &consumed, &error, nullptr);
+					headerChunk.Skip(consumed);
+				}
+				FileReader::PinnedRawDataView sampleDataView = sampleData.GetPinnedRawDataView();
+				const std::byte *data = sampleDataView.data();
+				std::size_t dataLeft = sampleDataView.size();
+				if(!sharedHeader)
 				{
-					int channels = 0, decodedSamples = 0;
-					float **output;
-					consumed = stb_vorbis_decode_frame_pushdata(vorb, mpt::byte_cast<const unsigned char *>(data), mpt::saturate_cast<int>(dataLeft), &channels, &output, &decodedSamples);
+					vorb = stb_vorbis_open_pushdata(mpt::byte_cast<const unsigned char *>(data), mpt::saturate_cast<int>(dataLeft), &consumed, &error, nullptr);
 					sampleData.Skip(consumed);
 					data += consumed;
 					dataLeft -= consumed;
-					LimitMax(decodedSamples, mpt::saturate_cast<int>(sample.nLength - offset));
-					if(decodedSamples > 0 && channels == sample.GetNumChannels())
+				}
+				if(vorb)
+				{
+					// Header has been read, proceed to reading the sample data
+					ModSample &sample = Samples[smp];
+					sample.AllocateSample();
+					SmpLength offset = 0;
+					while((error == VORBIS__no_error || (error == VORBIS_need_more_data && dataLeft > 0))
+					      && offset < sample.nLength && sample.HasSampleData())
 					{
-						for(int chn = 0; chn < channels; chn++)
+						int channels = 0, decodedSamples = 0;
+						float **output;
+						consumed = stb_vorbis_decode_frame_pushdata(vorb, mpt::byte_cast<const unsigned char *>(data), mpt::saturate_cast<int>(dataLeft), &channels, &output, &decodedSamples);
+						sampleData.Skip(consumed);
+						data += consumed;
+						dataLeft -= consumed;
+						LimitMax(decodedSamples, mpt::saturate_cast<int>(sample.nLength - offset));
+						if(decodedSamples > 0 && channels == sample.GetNumChannels())
 						{
-							if(sample.uFlags[CHN_16BIT])
-								CopyChannelToInterleaved<SC::Convert<int16, float>>(sample.sample16() + offset * sample.GetNumChannels(), output[chn], channels, decodedSamples, chn);
-							else
-								CopyChannelToInterleaved<SC::Convert<int8, float>>(sample.sample8() + offset * sample.GetNumChannels(), output[chn], channels, decodedSamples, chn);
+							for(int chn = 0; chn < channels; chn++)
+							{
+								if(sample.uFlags[CHN_16BIT])
+									CopyChannelToInterleaved<SC::Convert<int16, float>>(sample.sample16() + offset * sample.GetNumChannels(), output[chn], channels, decodedSamples, chn);
+								else
+									CopyChannelToInterleaved<SC::Convert<int8, float>>(sample.sample8() + offset * sample.GetNumChannels(), output[chn], channels, decodedSamples, chn);
+							}
 						}
+						offset += decodedSamples;
+						error = stb_vorbis_get_error(vorb);
 					}
-					offset += decodedSamples;
-					error = stb_vorbis_get_error(vorb);
+					stb_vorbis_close(vorb);
+				} else
+				{
+					status.unsupported = true;
 				}
-				stb_vorbis_close(vorb);
-			} else
-			{
-				unsupportedSamples = true;
-			}
 
 #else  // !VORBIS
 
-			unsupportedSamples = true;
+				status.unsupported = true;
 
 #endif  // VORBIS
+
+				if(useSampleCache)
+				{
+					DecodedSampleCache::Store(key, Samples[smp], sampleChunk.chunk.GetLength());
+				}
+			});
+		}
+		sampleReader.Run();
+	}
+	for(const auto &status : oggStatus)
+	{
+		for(const auto &[level, text] : status.messages)
+		{
+			AddToLog(level, text);
 		}
+		if(status.unsupported)
+			unsupportedSamples = true;
 	}
 
 	if(m_nType == MOD_TYPE_XM)
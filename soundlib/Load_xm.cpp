@@ -139,6 +139,175 @@ static long VorbisfileFilereaderTell(void *datasource)
 #endif // MPT_WITH_VORBIS && MPT_WITH_VORBISFILE
 
 
+#if defined(MPT_WITH_STBVORBIS) && !(defined(MPT_WITH_VORBIS) && defined(MPT_WITH_VORBISFILE))
+
+// Decodes an OggVorbis sample during playback, producing the same data as the full decode in ReadSampleData.
+class XMVorbisSampleDecoder : public ISampleDecoder
+{
+protected:
+	std::shared_ptr<const std::vector<std::byte>> m_data;  // Shared between all clones, as the module file may be gone by the time the sample is played
+	std::shared_ptr<const stb_vorbis> m_setup;  // Decoder right after reading the headers. Never decoded with, only copied.
+	stb_vorbis *m_vorb = nullptr;  // Copy of m_setup's state, see stb_vorbis_copy_pushdata_state
+	std::size_t m_dataPos = 0, m_headerSize = 0;
+	int m_error = VORBIS__no_error;
+	// Decoded frames of the current Vorbis packet that have not been returned yet
+	float **m_output = nullptr;
+	int m_outputFrames = 0, m_outputPos = 0, m_outputChannels = 0;
+	const bool m_is16Bit;
+	const uint8 m_numChannels;
+
+public:
+	XMVorbisSampleDecoder(std::shared_ptr<const std::vector<std::byte>> data, bool is16Bit, uint8 numChannels)
+		: m_data(std::move(data))
+		, m_is16Bit(is16Bit)
+		, m_numChannels(numChannels)
+	{
+		int consumed = 0;
+		stb_vorbis *setup = stb_vorbis_open_pushdata(mpt::byte_cast<const unsigned char *>(m_data->data()), mpt::saturate_cast<int>(m_data->size()), &consumed, &m_error, nullptr);
+		if(!setup)
+			return;
+		m_setup.reset(setup, [](const stb_vorbis *vorb) { stb_vorbis_close(const_cast<stb_vorbis *>(vorb)); });
+		m_dataPos = m_headerSize = consumed;
+		m_vorb = stb_vorbis_copy_pushdata_state(m_setup.get(), nullptr);
+	}
+
+	// Create a decoder at the sample start (copyState = false) or at the current position of another decoder (copyState = true)
+	XMVorbisSampleDecoder(const XMVorbisSampleDecoder &other, bool copyState)
+		: m_data(other.m_data)
+		, m_setup(other.m_setup)
+		, m_headerSize(other.m_headerSize)
+		, m_is16Bit(other.m_is16Bit)
+		, m_numChannels(other.m_numChannels)
+	{
+		if(!copyState)
+		{
+			m_vorb = m_setup ? stb_vorbis_copy_pushdata_state(m_setup.get(), nullptr) : nullptr;
+			m_dataPos = m_headerSize;
+			m_error = m_setup ? VORBIS__no_error : other.m_error;
+		} else if(other.m_vorb)
+		{
+			float **output = nullptr;
+			m_vorb = stb_vorbis_copy_pushdata_state(other.m_vorb, &output);
+			m_dataPos = other.m_dataPos;
+			m_error = other.m_error;
+			if(other.m_output)
+				m_output = output;
+			m_outputFrames = other.m_outputFrames;
+			m_outputPos = other.m_outputPos;
+			m_outputChannels = other.m_outputChannels;
+		}
+	}
+
+	XMVorbisSampleDecoder(const XMVorbisSampleDecoder &) = delete;
+
+	XMVorbisSampleDecoder &operator=(const XMVorbisSampleDecoder &) = delete;
+
+	~XMVorbisSampleDecoder() override
+	{
+		if(m_vorb)
+			stb_vorbis_close_pushdata_state(m_vorb);
+	}
+
+	bool IsValid() const noexcept { return m_vorb != nullptr; }
+
+	std::unique_ptr<ISampleDecoder> Clone() const override
+	{
+		return std::make_unique<XMVorbisSampleDecoder>(*this, false);
+	}
+
+	std::unique_ptr<ISampleDecoder> CloneState() const override
+	{
+		auto decoder = std::make_unique<XMVorbisSampleDecoder>(*this, true);
+		if(!decoder->IsValid())
+			return nullptr;
+		return decoder;
+	}
+
+	SmpLength Decode(void *dest, SmpLength count) override
+	{
+		const std::size_t bytesPerFrame = (m_is16Bit ? 2 : 1) * m_numChannels;
+		SmpLength decoded = 0;
+		while(decoded < count)
+		{
+			if(m_outputPos >= m_outputFrames && !DecodePacket())
+				break;
+			const int frames = std::min(m_outputFrames - m_outputPos, mpt::saturate_cast<int>(count - decoded));
+			if(m_outputChannels == m_numChannels)
+			{
+				for(int chn = 0; chn < m_outputChannels; chn++)
+				{
+					if(m_is16Bit)
+						CopyChannelToInterleaved<SC::Convert<int16, float> >(static_cast<int16 *>(dest) + decoded * m_numChannels, m_output[chn] + m_outputPos, m_numChannels, frames, chn);
+					else
+						CopyChannelToInterleaved<SC::Convert<int8, float> >(static_cast<int8 *>(dest) + decoded * m_numChannels, m_output[chn] + m_outputPos, m_numChannels, frames, chn);
+				}
+			} else
+			{
+				std::memset(static_cast<std::byte *>(dest) + decoded * bytesPerFrame, 0, frames * bytesPerFrame);
+			}
+			m_outputPos += frames;
+			decoded += frames;
+		}
+		return decoded;
+	}
+
+	SmpLength Skip(void *, SmpLength count) override
+	{
+		// Packets still have to be decoded, but there is no need to convert them
+		SmpLength skipped = 0;
+		while(skipped < count)
+		{
+			if(m_outputPos >= m_outputFrames && !DecodePacket())
+				break;
+			const int frames = std::min(m_outputFrames - m_outputPos, mpt::saturate_cast<int>(count - skipped));
+			m_outputPos += frames;
+			skipped += frames;
+		}
+		return skipped;
+	}
+
+protected:
+	bool DecodePacket()
+	{
+		if(!m_vorb)
+			return false;
+		while(m_error == VORBIS__no_error || (m_error == VORBIS_need_more_data && m_dataPos < m_data->size()))
+		{
+			int channels = 0, decodedSamples = 0;
+			float **output = nullptr;
+			int consumed = stb_vorbis_decode_frame_pushdata(m_vorb, mpt::byte_cast<const unsigned char *>(m_data->data() + m_dataPos), mpt::saturate_cast<int>(m_data->size() - m_dataPos), &channels, &output, &decodedSamples);
+			m_dataPos += consumed;
+			m_error = stb_vorbis_get_error(m_vorb);
+			if(decodedSamples > 0)
+			{
+				m_output = output;
+				m_outputFrames = decodedSamples;
+				m_outputPos = 0;
+				m_outputChannels = channels;
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+
+// Keep the compressed data of an OggVorbis sample and decode it during playback.
+static bool StreamVorbisSample(ModSample &sample, FileReader &sampleData)
+{
+	FileReader::PinnedRawDataView sampleDataView = sampleData.GetPinnedRawDataView();
+	auto data = std::make_shared<const std::vector<std::byte>>(sampleDataView.data(), sampleDataView.data() + sampleDataView.size());
+	auto decoder = std::make_unique<XMVorbisSampleDecoder>(std::move(data), sample.uFlags[CHN_16BIT], sample.GetNumChannels());
+	if(!decoder->IsValid())
+		return false;
+	sample.FreeSample();
+	sample.stream = std::make_shared<SampleStream>(std::move(decoder), sample);
+	return true;
+}
+
+#endif // MPT_WITH_STBVORBIS && !(MPT_WITH_VORBIS && MPT_WITH_VORBISFILE)
+
+
 // Allocate samples for an instrument
 static std::vector<SAMPLEINDEX> AllocateXMSamples(CSoundFile &sndFile, SAMPLEINDEX numSamples)
 {
@@ -408,7 +577,7 @@ CSoundFile::ProbeResult CSoundFile::ProbeFileHeaderXM(MemoryFileReader file, con
 }
 
 
-static bool ReadSampleData(ModSample &sample, SampleIO sampleFlags, FileReader &sampleChunk, bool &isOXM)
+static bool ReadSampleData(ModSample &sample, SampleIO sampleFlags, FileReader &sampleChunk, bool &isOXM, uint64 streamThreshold)
 {
 	bool unsupportedSample = false;
 
@@ -441,6 +610,16 @@ static bool ReadSampleData(ModSample &sample, SampleIO sampleFlags, FileReader &
 		sample.uFlags.set(CHN_STEREO, sampleFlags.GetChannelFormat() != SampleIO::mono);
 		sample.nLength = originalSize / (sample.uFlags[CHN_16BIT] ? 2 : 1) / (sample.uFlags[CHN_STEREO] ? 2 : 1);
 
+#if defined(MPT_WITH_STBVORBIS) && !(defined(MPT_WITH_VORBIS) && defined(MPT_WITH_VORBISFILE))
+		if(streamThreshold != 0 && static_cast<uint64>(sample.nLength) * sample.GetBytesPerSample() > streamThreshold)
+		{
+			// Very long sample: Decode it while playing instead
+			return StreamVorbisSample(sample, sampleData);
+		}
+#else
+		MPT_UNREFERENCED_PARAMETER(streamThreshold);
+#endif
+
 #if defined(MPT_WITH_VORBIS) && defined(MPT_WITH_VORBISFILE)
 
 		ov_callbacks callbacks = {
@@ -833,7 +1012,7 @@ bool CSoundFile::ReadXM(FileReader &file, ModLoadingFlags loadFlags)
 					FileReader sampleChunk = file.ReadChunk(sampleFlags[sample].GetEncoding() != SampleIO::ADPCM ? sampleSize[sample] : (16 + (sampleSize[sample] + 1) / 2));
 					if(sample < sampleSlots.size() && (loadFlags & loadSampleData))
 					{
-						if(!ReadSampleData(Samples[sampleSlots[sample]], sampleFlags[sample], sampleChunk, isOXM))
+						if(!ReadSampleData(Samples[sampleSlots[sample]], sampleFlags[sample], sampleChunk, isOXM, m_sampleStreamThreshold))
 						{
 							unsupportedSamples = true;
 						}
@@ -418,4 +418,70 @@ std::string MIDIMacroConfig::GetSafeMacro(const Macro &macro) const
 }
 
 
+void MIDIMacroProgram::Compile(const MIDIMacroConfigData::Macro &macro)
+{
+	if(!memcmp(m_source, macro, sizeof(m_source)))
+		return;
+	memcpy(m_source, macro, sizeof(m_source));
+	m_length = 0;
+
+	// While this is true, we know at compile time whether the next nibble starts a new byte.
+	// Only a SysEx checksum that is skipped at runtime in the middle of a byte can make this unknown.
+	bool phaseKnown = true, firstNibble = true;
+	for(uint32 pos = 0; pos < (MACRO_LENGTH - 1) && macro[pos]; pos++)
+	{
+		const char c = macro[pos];
+		uint8 nibble = 0xFF;
+		if(c >= '0' && c <= '9')
+			nibble = static_cast<uint8>(c - '0');
+		else if(c >= 'A' && c <= 'F')
+			nibble = static_cast<uint8>(c - 'A' + 0x0A);
+
+		if(nibble != 0xFF)
+		{
+			if(phaseKnown && !firstNibble && m_length > 0 && m_code[m_length - 1].opcode == Opcode::Nibble)
+			{
+				// Merge with the previous nibble, which started a new byte
+				m_code[m_length - 1] = {Opcode::Byte, static_cast<uint8>((m_code[m_length - 1].value << 4) | nibble)};
+			} else
+			{
+				m_code[m_length++] = {Opcode::Nibble, nibble};
+			}
+			firstNibble = !firstNibble;
+			continue;
+		}
+
+		Opcode opcode;
+		switch(c)
+		{
+		case 'c': opcode = Opcode::MIDIChannel; break;
+		case 'n': opcode = Opcode::Note; break;
+		case 'v': opcode = Opcode::Velocity; break;
+		case 'u': opcode = Opcode::CalcVolume; break;
+		case 'x': opcode = Opcode::Pan; break;
+		case 'y': opcode = Opcode::CalcPan; break;
+		case 'a': opcode = Opcode::BankHigh; break;
+		case 'b': opcode = Opcode::BankLow; break;
+		case 'o': opcode = Opcode::Offset; break;
+		case 'h': opcode = Opcode::HostChannel; break;
+		case 'm': opcode = Opcode::LoopDirection; break;
+		case 'p': opcode = Opcode::Program; break;
+		case 'z': opcode = Opcode::ZxxParam; break;
+		case 's': opcode = Opcode::Checksum; break;
+		default:
+			// Unrecognized byte (e.g. space char)
+			continue;
+		}
+		m_code[m_length++] = {opcode, 0};
+
+		if(opcode == Opcode::MIDIChannel)
+			firstNibble = !firstNibble;
+		else if(opcode == Opcode::Checksum && !firstNibble)
+			phaseKnown = false;
+		else
+			firstNibble = true;
+	}
+}
+
+
 OPENMPT_NAMESPACE_END
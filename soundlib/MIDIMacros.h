@@ -12,6 +12,8 @@
 
 #include "BuildSettings.h"
 
+#include <array>
+
 OPENMPT_NAMESPACE_BEGIN
 
 enum
@@ -174,4 +176,69 @@ protected:
 static_assert(sizeof(MIDIMacroConfig) == sizeof(MIDIMacroConfigData)); // this is directly written to files, so the size must be correct!
 
 
+// A macro string translated into a sequence of simple instructions, so that it does not have to be parsed again every time it is evaluated.
+class MIDIMacroProgram
+{
+public:
+	enum class Opcode : uint8
+	{
+		Nibble,         // Constant nibble (0-9, A-F)
+		Byte,           // Two constant nibbles that are known to start at a byte boundary
+		MIDIChannel,    // c: MIDI channel (nibble)
+		Note,           // n: Last triggered note
+		Velocity,       // v: Velocity
+		CalcVolume,     // u: Calculated volume
+		Pan,            // x: Pan set
+		CalcPan,        // y: Calculated pan
+		BankHigh,       // a: High byte of bank select
+		BankLow,        // b: Low byte of bank select
+		Offset,         // o: Sample offset
+		HostChannel,    // h: Host channel number
+		LoopDirection,  // m: Loop direction
+		Program,        // p: Program select
+		ZxxParam,       // z: Zxx parameter
+		Checksum,       // s: SysEx checksum
+	};
+
+	struct Instruction
+	{
+		Opcode opcode;
+		uint8 value;  // Only used by constant nibbles and bytes
+	};
+
+	// Translate a macro string. Does nothing if the program has already been compiled from the same string.
+	void Compile(const MIDIMacroConfigData::Macro &macro);
+
+	const Instruction *begin() const { return m_code.data(); }
+	const Instruction *end() const { return m_code.data() + m_length; }
+
+protected:
+	std::array<Instruction, MACRO_LENGTH> m_code;
+	MIDIMacroConfigData::Macro m_source = {};
+	uint8 m_length = 0;
+};
+
+
+// Compiled versions of the parametered and fixed macros of a MIDIMacroConfig.
+// Macros are compiled when they are first used and recompiled whenever their string has been changed.
+class MIDIMacroProgramCache
+{
+public:
+	const MIDIMacroProgram &GetParameteredMacro(const MIDIMacroConfig &config, uint32 macroIndex)
+	{
+		m_parameteredMacros[macroIndex].Compile(config.szMidiSFXExt[macroIndex]);
+		return m_parameteredMacros[macroIndex];
+	}
+	const MIDIMacroProgram &GetFixedMacro(const MIDIMacroConfig &config, uint32 macroIndex)
+	{
+		m_fixedMacros[macroIndex].Compile(config.szMidiZXXExt[macroIndex]);
+		return m_fixedMacros[macroIndex];
+	}
+
+protected:
+	std::array<MIDIMacroProgram, NUM_MACROS> m_parameteredMacros;
+	std::array<MIDIMacroProgram, 128> m_fixedMacros;
+};
+
+
 OPENMPT_NAMESPACE_END
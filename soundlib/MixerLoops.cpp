@@ -13,6 +13,7 @@
 #include "stdafx.h"
 #include "MixerLoops.h"
 #include "..//soundbase/SampleBuffer.h"
+#include "../soundbase/SampleFormatConverters.h"
 #include "Snd_defs.h"
 #include "ModChannel.h"
 #ifdef ENABLE_SSE2
@@ -249,6 +250,106 @@ void FloatToMonoMix(const float *pIn, int32 *pOut, uint32 nCount, const float _f
 
 
 
+//////////////////////////////////////////////////////////////////////////////////////////
+// Output conversion
+
+
+#ifdef ENABLE_SSE2
+
+// Load four consecutive samples with a distance of srcStride (1 or 2) between them
+static MPT_FORCEINLINE __m128i SSE2_LoadMixSamples(const int32 *src, std::size_t srcStride)
+{
+	if(srcStride == 1)
+		return _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+	const __m128 a = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src)));
+	const __m128 b = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 4)));
+	return _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+
+// Returns number of processed samples
+static std::size_t SSE2_ConvertMixToInt16(const int32 *src, std::size_t srcStride, int16 *dst, std::size_t count)
+{
+	if(srcStride > 2)
+		return 0;
+	constexpr int shiftBits = MIXING_FRACTIONAL_BITS + 1 - 16;
+	const __m128i round = _mm_set1_epi32(1 << (shiftBits - 1));
+	// With a stride of 2, the last block would read one sample past the end
+	const std::size_t numBlocks = (srcStride == 1) ? (count / 8) : (count > 0 ? (count - 1) / 8 : 0);
+	for(std::size_t i = 0; i < numBlocks; i++)
+	{
+		__m128i lo = _mm_srai_epi32(_mm_add_epi32(SSE2_LoadMixSamples(src, srcStride), round), shiftBits);
+		__m128i hi = _mm_srai_epi32(_mm_add_epi32(SSE2_LoadMixSamples(src + 4 * srcStride, srcStride), round), shiftBits);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm_packs_epi32(lo, hi));  // Saturates to int16 range
+		src += 8 * srcStride;
+		dst += 8;
+	}
+	return numBlocks * 8;
+}
+
+
+// Returns number of processed samples
+static std::size_t SSE2_ConvertMixToFloat(const int32 *src, std::size_t srcStride, float *dst, std::size_t count)
+{
+	if(srcStride > 2)
+		return 0;
+	const __m128 factor = _mm_set1_ps(1.0f / static_cast<float>(1 << MIXING_FRACTIONAL_BITS));
+	// With a stride of 2, the last block would read one sample past the end
+	const std::size_t numBlocks = (srcStride == 1) ? (count / 4) : (count > 0 ? (count - 1) / 4 : 0);
+	for(std::size_t i = 0; i < numBlocks; i++)
+	{
+		_mm_storeu_ps(dst, _mm_mul_ps(_mm_cvtepi32_ps(SSE2_LoadMixSamples(src, srcStride)), factor));
+		src += 4 * srcStride;
+		dst += 4;
+	}
+	return numBlocks * 4;
+}
+
+#endif // ENABLE_SSE2
+
+
+void ConvertMixToInt16(const MixSampleInt *src, std::size_t srcStride, int16 *dst, std::size_t count)
+{
+	#ifdef ENABLE_SSE2
+	if(CPU::HasFeatureSet(CPU::feature::sse2))
+	{
+		const std::size_t done = SSE2_ConvertMixToInt16(src, srcStride, dst, count);
+		src += done * srcStride;
+		dst += done;
+		count -= done;
+	}
+	#endif // ENABLE_SSE2
+
+	SC::ConvertFixedPoint<int16, MixSampleInt, MIXING_FRACTIONAL_BITS> conv;
+	for(std::size_t i = 0; i < count; i++)
+	{
+		dst[i] = conv(*src);
+		src += srcStride;
+	}
+}
+
+
+void ConvertMixToFloat(const MixSampleInt *src, std::size_t srcStride, float *dst, std::size_t count)
+{
+	#ifdef ENABLE_SSE2
+	if(CPU::HasFeatureSet(CPU::feature::sse2))
+	{
+		const std::size_t done = SSE2_ConvertMixToFloat(src, srcStride, dst, count);
+		src += done * srcStride;
+		dst += done;
+		count -= done;
+	}
+	#endif // ENABLE_SSE2
+
+	SC::ConvertFixedPoint<float, MixSampleInt, MIXING_FRACTIONAL_BITS> conv;
+	for(std::size_t i = 0; i < count; i++)
+	{
+		dst[i] = conv(*src);
+		src += srcStride;
+	}
+}
+
+
 //////////////////////////////////////////////////////////////////////////////////////////
 
 
@@ -318,50 +419,6 @@ void InterleaveFrontRear(mixsample_t *pFrontBuf, mixsample_t *pRearBuf, uint32 n
 }
 
 
-#ifdef ENABLE_X86
-static void X86_MonoFromStereo(int32 *pMixBuf, uint32 nSamples)
-{
-	_asm {
-	mov ecx, nSamples
-	mov esi, pMixBuf
-	mov edi, esi
-stloop:
-	mov eax, dword ptr [esi]
-	mov edx, dword ptr [esi+4]
-	add edi, 4
-	add esi, 8
-	add eax, edx
-	sar eax, 1
-	dec ecx
-	mov dword ptr [edi-4], eax
-	jnz stloop
-	}
-}
-#endif
-
-static void C_MonoFromStereo(mixsample_t *pMixBuf, uint32 nSamples)
-{
-	for(uint32 i=0; i<nSamples; ++i)
-	{
-		pMixBuf[i] = (pMixBuf[i*2] + pMixBuf[i*2+1]) / 2;
-	}
-}
-
-void MonoFromStereo(mixsample_t *pMixBuf, uint32 nSamples)
-{
-	#if defined(ENABLE_X86) && defined(MPT_INTMIXER)
-		if(CPU::HasFeatureSet(CPU::feature::asm_intrinsics))
-		{
-			X86_MonoFromStereo(pMixBuf, nSamples);
-			return;
-		}
-	#endif
-	{
-		C_MonoFromStereo(pMixBuf, nSamples);
-	}
-}
-
-
 #define OFSDECAYSHIFT	8
 #define OFSDECAYMASK	0xFF
 #define OFSTHRESHOLD	static_cast<mixsample_t>(1.0 / (1 << 20))	// Decay threshold for floating point mixer
@@ -32,9 +32,13 @@ void ApplyGain(audio_buffer_interleaved<float> outputBuffer, std::size_t offset,
 void ApplyGain(audio_buffer_planar<float> outputBuffer, std::size_t offset, std::size_t channels, std::size_t countChunk, float gainFactor);
 #endif // !MODPLUG_TRACKER
 
+// Convert fixed-point mix samples to output samples. Rounding and saturation are the same as with SC::ConvertFixedPoint.
+// srcStride is the distance between two consecutive input samples, e.g. the channel count for extracting one channel from an interleaved buffer.
+void ConvertMixToInt16(const MixSampleInt *src, std::size_t srcStride, int16 *dst, std::size_t count);
+void ConvertMixToFloat(const MixSampleInt *src, std::size_t srcStride, float *dst, std::size_t count);
+
 void InitMixBuffer(mixsample_t *pBuffer, uint32 nSamples);
 void InterleaveFrontRear(mixsample_t *pFrontBuf, mixsample_t *pRearBuf, uint32 nFrames);
-void MonoFromStereo(mixsample_t *pMixBuf, uint32 nSamples);
 
 void InterleaveStereo(const mixsample_t *inputL, const mixsample_t *inputR, mixsample_t *output, size_t numSamples);
 void DeinterleaveStereo(const mixsample_t *input, mixsample_t *outputL, mixsample_t *outputR, size_t numSamples);
@@ -0,0 +1,276 @@
+/*
+ * ModFingerprint.cpp
+ * ------------------
+ * Purpose: Content fingerprints of modules for detecting duplicates without rendering them.
+ * Notes  : Fingerprints only depend on musical content. Names, messages and format-specific padding are ignored.
+ * Authors: OpenMPT Devs
+ * The OpenMPT source code is released under the BSD license. Read LICENSE for more details.
+ */
+
+
+#include "stdafx.h"
+#include "ModFingerprint.h"
+#include "Sndfile.h"
+#include "SampleStream.h"
+#include "../common/mptCRC.h"
+
+#include <algorithm>
+#include <vector>
+
+
+OPENMPT_NAMESPACE_BEGIN
+
+
+namespace
+{
+
+// Hashes integers in little-endian byte order, so that fingerprints are the same on all platforms
+class FingerprintHash
+{
+	mpt::checksum::crc64_jones crc;
+
+public:
+	template <typename T>
+	void Add(T value)
+	{
+		static_assert(std::is_integral<T>::value);
+		const auto bits = static_cast<std::make_unsigned_t<T>>(value);
+		for(std::size_t i = 0; i < sizeof(T); i++)
+		{
+			crc(static_cast<uint8>(bits >> (i * 8)));
+		}
+	}
+
+	void Add(const std::byte *data, std::size_t size)
+	{
+		crc(data, data + size);
+	}
+
+	uint64 Result() const { return crc.result(); }
+};
+
+
+// Calls process(data, frames) for consecutive blocks of the sample's data in its storage format.
+// Streamed samples are decoded, so that fingerprints do not depend on whether a sample was streamed or not.
+template <typename Func>
+void ForEachSampleBlock(const ModSample &sample, Func process)
+{
+	if(sample.HasSampleData())
+	{
+		process(static_cast<const std::byte *>(sample.samplev()), sample.nLength);
+		return;
+	}
+	if(!sample.IsStreamed())
+		return;
+	constexpr SmpLength blockLength = 4096;
+	std::unique_ptr<ISampleDecoder> decoder = sample.stream->CreateDecoder();
+	std::vector<std::byte> block(blockLength * sample.GetBytesPerSample());
+	for(SmpLength pos = 0; pos < sample.nLength;)
+	{
+		const SmpLength count = std::min(blockLength, sample.nLength - pos);
+		SmpLength decoded = 0;
+		while(decoder && decoded < count)
+		{
+			const SmpLength frames = decoder->Decode(block.data() + decoded * sample.GetBytesPerSample(), count - decoded);
+			if(!frames)
+				break;
+			decoded += frames;
+		}
+		if(decoded < count)
+		{
+			// Missing data is played as silence
+			std::fill(block.begin() + decoded * sample.GetBytesPerSample(), block.end(), std::byte{0});
+			decoder.reset();
+		}
+		process(block.data(), count);
+		pos += count;
+	}
+}
+
+
+void HashSampleData(FingerprintHash &hash, const ModSample &sample)
+{
+	const bool swapBytes = sample.uFlags[CHN_16BIT] && !mpt::endian_is_little();
+	ForEachSampleBlock(sample, [&](const std::byte *data, SmpLength frames)
+	{
+		if(swapBytes)
+		{
+			const int16 *data16 = reinterpret_cast<const int16 *>(data);
+			for(SmpLength i = 0; i < frames * sample.GetNumChannels(); i++)
+			{
+				hash.Add(data16[i]);
+			}
+		} else
+		{
+			hash.Add(data, frames * sample.GetBytesPerSample());
+		}
+	});
+}
+
+
+// Only the 6 most significant bits of the first channel, which are the same for a 16-bit sample and its 8-bit truncation
+uint64 HashSampleDataCoarse(const ModSample &sample)
+{
+	FingerprintHash hash;
+	hash.Add(sample.nLength);
+	ForEachSampleBlock(sample, [&](const std::byte *data, SmpLength frames)
+	{
+		const uint8 numChannels = sample.GetNumChannels();
+		if(sample.uFlags[CHN_16BIT])
+		{
+			const int16 *data16 = reinterpret_cast<const int16 *>(data);
+			for(SmpLength i = 0; i < frames; i++)
+			{
+				hash.Add(static_cast<int8>(data16[i * numChannels] >> 10));
+			}
+		} else
+		{
+			const int8 *data8 = reinterpret_cast<const int8 *>(data);
+			for(SmpLength i = 0; i < frames; i++)
+			{
+				hash.Add(static_cast<int8>(data8[i * numChannels] >> 2));
+			}
+		}
+	});
+	return hash.Result();
+}
+
+}  // namespace
+
+
+uint64 ModFingerprint::CalculateExact(const CSoundFile &sndFile)
+{
+	FingerprintHash hash;
+
+	// Formats with a fixed channel count pad the pattern data with empty channels
+	CHANNELINDEX numChannels = 0;
+	for(const auto &pattern : sndFile.Patterns)
+	{
+		if(!pattern.IsValid())
+			continue;
+		for(ROWINDEX row = 0; row < pattern.GetNumRows(); row++)
+		{
+			for(CHANNELINDEX chn = numChannels; chn < pattern.GetNumChannels(); chn++)
+			{
+				if(!pattern.GetpModCommand(row, chn)->IsEmpty())
+					numChannels = chn + 1;
+			}
+		}
+	}
+	hash.Add(numChannels);
+
+	for(PATTERNINDEX pat = 0; pat < sndFile.Patterns.Size(); pat++)
+	{
+		const CPattern &pattern = sndFile.Patterns[pat];
+		if(!pattern.IsValid())
+			continue;
+		hash.Add(pat);
+		hash.Add(pattern.GetNumRows());
+		for(ROWINDEX row = 0; row < pattern.GetNumRows(); row++)
+		{
+			const ModCommand *m = pattern.GetpModCommand(row, 0);
+			for(CHANNELINDEX chn = 0; chn < numChannels; chn++, m++)
+			{
+				// Parameters without a command are not used (see ModCommand::operator==)
+				hash.Add(m->note);
+				hash.Add(m->instr);
+				hash.Add(m->volcmd);
+				hash.Add((m->volcmd != VOLCMD_NONE || m->IsPcNote()) ? m->vol : uint8(0));
+				hash.Add(m->command);
+				hash.Add((m->command != CMD_NONE || m->IsPcNote()) ? m->param : uint8(0));
+			}
+		}
+	}
+
+	for(SEQUENCEINDEX seq = 0; seq < sndFile.Order.GetNumSequences(); seq++)
+	{
+		const ModSequence &order = sndFile.Order(seq);
+		const ORDERINDEX length = order.GetLengthTailTrimmed();
+		hash.Add(length);
+		for(ORDERINDEX ord = 0; ord < length; ord++)
+		{
+			hash.Add(order[ord]);
+		}
+	}
+
+	for(SAMPLEINDEX smp = 1; smp <= sndFile.GetNumSamples(); smp++)
+	{
+		const ModSample &sample = sndFile.GetSample(smp);
+		if(!sample.HasPlayableData())
+			continue;
+		hash.Add(smp);
+		hash.Add(sample.nLength);
+		hash.Add(sample.GetElementarySampleSize());
+		hash.Add(sample.GetNumChannels());
+		hash.Add(static_cast<uint8>(sample.uFlags[CHN_LOOP] ? (sample.uFlags[CHN_PINGPONGLOOP] ? 2 : 1) : 0));
+		hash.Add(sample.uFlags[CHN_LOOP] ? sample.nLoopStart : 0);
+		hash.Add(sample.uFlags[CHN_LOOP] ? sample.nLoopEnd : 0);
+		hash.Add(static_cast<uint8>(sample.uFlags[CHN_SUSTAINLOOP] ? (sample.uFlags[CHN_PINGPONGSUSTAIN] ? 2 : 1) : 0));
+		hash.Add(sample.uFlags[CHN_SUSTAINLOOP] ? sample.nSustainStart : 0);
+		hash.Add(sample.uFlags[CHN_SUSTAINLOOP] ? sample.nSustainEnd : 0);
+		HashSampleData(hash, sample);
+	}
+
+	return hash.Result();
+}
+
+
+uint64 ModFingerprint::CalculateFuzzy(const CSoundFile &sndFile)
+{
+	FingerprintHash hash;
+
+	// Notes of each row in playback order, preceded by the number of rows since the previous row with notes.
+	// Pattern boundaries are ignored because converters may split or merge patterns,
+	// and notes are sorted because they may end up in different channels.
+	std::vector<ModCommand::NOTE> notes;
+	uint32 rowDistance = 0;
+	const ModSequence &order = sndFile.Order(0);
+	for(PATTERNINDEX pat : order)
+	{
+		if(pat == order.GetInvalidPatIndex())
+			break;
+		if(!sndFile.Patterns.IsValidPat(pat))
+			continue;
+		const CPattern &pattern = sndFile.Patterns[pat];
+		for(ROWINDEX row = 0; row < pattern.GetNumRows(); row++)
+		{
+			rowDistance++;
+			notes.clear();
+			const ModCommand *m = pattern.GetpModCommand(row, 0);
+			for(CHANNELINDEX chn = 0; chn < pattern.GetNumChannels(); chn++, m++)
+			{
+				if(m->IsNote())
+					notes.push_back(m->note);
+			}
+			if(notes.empty())
+				continue;
+			std::sort(notes.begin(), notes.end());
+			hash.Add(rowDistance);
+			hash.Add(static_cast<uint8>(notes.size()));
+			for(auto note : notes)
+			{
+				hash.Add(note);
+			}
+			rowDistance = 0;
+		}
+	}
+
+	// Sample slots may be rearranged, so the order of samples does not matter
+	std::vector<uint64> samples;
+	for(SAMPLEINDEX smp = 1; smp <= sndFile.GetNumSamples(); smp++)
+	{
+		const ModSample &sample = sndFile.GetSample(smp);
+		if(sample.HasPlayableData())
+			samples.push_back(HashSampleDataCoarse(sample));
+	}
+	std::sort(samples.begin(), samples.end());
+	for(uint64 sampleHash : samples)
+	{
+		hash.Add(sampleHash);
+	}
+
+	return hash.Result();
+}
+
+
+OPENMPT_NAMESPACE_END
@@ -0,0 +1,38 @@
+/*
+ * ModFingerprint.h
+ * ----------------
+ * Purpose: Content fingerprints of modules for detecting duplicates without rendering them.
+ * Notes  : Fingerprints only depend on musical content. Names, messages and format-specific padding are ignored.
+ * Authors: OpenMPT Devs
+ * The OpenMPT source code is released under the BSD license. Read LICENSE for more details.
+ */
+
+
+#pragma once
+
+#include "BuildSettings.h"
+
+
+OPENMPT_NAMESPACE_BEGIN
+
+
+class CSoundFile;
+
+
+class ModFingerprint
+{
+public:
+	// Covers pattern data, all order lists and the sample data and loops.
+	// Unused trailing channels, trailing empty order list entries, empty sample slots and the unused
+	// volume and effect parameters of a pattern cell are ignored.
+	static uint64 CalculateExact(const CSoundFile &sndFile);
+
+	// Only covers the notes of the first order list in playback order, the number of rows between them and a coarse
+	// representation of the sample data.
+	// It stays the same after conversion to another format (e.g. MOD to XM), which may change effects, channel and
+	// pattern layout, sample slots, loop types and sample resolution.
+	static uint64 CalculateFuzzy(const CSoundFile &sndFile);
+};
+
+
+OPENMPT_NAMESPACE_END
@@ -12,6 +12,8 @@
 #include "Sndfile.h"
 #include "ModSample.h"
 #include "modsmp_ctrl.h"
+#include "SampleStore.h"
+#include "SampleStream.h"
 
 #include <cmath>
 
@@ -254,18 +256,36 @@ void ModSample::FreeSample()
 {
 	FreeSample(pData.pSample);
 	pData.pSample = nullptr;
+	stream.reset();
 }
 
 
 void ModSample::FreeSample(void *samplePtr)
 {
-	if(samplePtr)
+	if(samplePtr && !SampleStore::Release(samplePtr))
 	{
 		delete[](((char *)samplePtr) - (InterpolationMaxLookahead * MaxSamplingPointSize));
 	}
 }
 
 
+bool ModSample::MakeSampleDataUnique(CSoundFile &sndFile)
+{
+	const void *oldData = samplev();
+	if(!SampleStore::MakeUnique(*this))
+		return false;
+	if(samplev() != oldData)
+	{
+		for(auto &chn : sndFile.m_PlayState.Chn)
+		{
+			if(chn.pModSample == this && chn.pCurrentSample == oldData)
+				chn.pCurrentSample = samplev();
+		}
+	}
+	return true;
+}
+
+
 // Set loop points and update loop wrap-around buffer
 void ModSample::SetLoop(SmpLength start, SmpLength end, bool enable, bool pingpong, CSoundFile &sndFile)
 {
@@ -422,10 +442,56 @@ void PrecomputeLoopsImpl(ModSample &smp, const CSoundFile &sndFile)
 	}
 }
 
+
+// Streamed samples keep their loop wrap-around buffers next to the cached loop data
+template <typename T>
+void PrecomputeStreamLoopsImpl(ModSample &smp, const CSoundFile &sndFile)
+{
+	SampleStream &stream = *smp.stream;
+	if(smp.uFlags[CHN_LOOP] && stream.GetCachedLoop(false) != nullptr)
+	{
+		PrecomputeLoop<T>(reinterpret_cast<T *>(stream.GetLoopLookahead(false)),
+			reinterpret_cast<const T *>(stream.GetCachedLoop(false)),
+			smp.nLoopEnd - smp.nLoopStart,
+			smp.GetNumChannels(),
+			smp.uFlags[CHN_PINGPONGLOOP],
+			sndFile.m_playBehaviour[kITPingPongMode]);
+	}
+	if(smp.uFlags[CHN_SUSTAINLOOP] && stream.GetCachedLoop(true) != nullptr)
+	{
+		PrecomputeLoop<T>(reinterpret_cast<T *>(stream.GetLoopLookahead(true)),
+			reinterpret_cast<const T *>(stream.GetCachedLoop(true)),
+			smp.nSustainEnd - smp.nSustainStart,
+			smp.GetNumChannels(),
+			smp.uFlags[CHN_PINGPONGSUSTAIN],
+			sndFile.m_playBehaviour[kITPingPongMode]);
+	}
+}
+
 }  // unnamed namespace
 
 
 void ModSample::PrecomputeLoops(CSoundFile &sndFile, bool updateChannels)
+{
+	if(IsStreamed())
+	{
+		SanitizeLoops();
+		if(updateChannels)
+			ctrlSmp::UpdateLoopPoints(*this, sndFile);
+		stream->UpdateLoopCache(*this);
+		if(GetElementarySampleSize() == 2)
+			PrecomputeStreamLoopsImpl<int16>(*this, sndFile);
+		else if(GetElementarySampleSize() == 1)
+			PrecomputeStreamLoopsImpl<int8>(*this, sndFile);
+		return;
+	}
+	if(!HasSampleData() || !MakeSampleDataUnique(sndFile))
+		return;
+	PrecomputeLoopsUnshared(sndFile, updateChannels);
+}
+
+
+void ModSample::PrecomputeLoopsUnshared(CSoundFile &sndFile, bool updateChannels)
 {
 	if(!HasSampleData())
 		return;
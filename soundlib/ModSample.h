@@ -12,9 +12,12 @@
 
 #include "BuildSettings.h"
 
+#include <memory>
+
 OPENMPT_NAMESPACE_BEGIN
 
 class CSoundFile;
+class SampleStream;
 
 // Sample Struct
 struct ModSample
@@ -28,6 +31,7 @@ struct ModSample
 		int8  *pSample8;					// Pointer to 8-bit sample data
 		int16 *pSample16;					// Pointer to 16-bit sample data
 	} pData;
+	std::shared_ptr<SampleStream> stream;	// Sample data that is decoded during playback instead of being stored in pData
 	uint32 nC5Speed;						// Frequency of middle-C, in Hz (for IT/S3M/MPTM)
 	uint16 nPan;							// Default sample panning (if pan flag is set), 0...256
 	uint16 nVolume;							// Default volume, 0...256 (ignored if uFlags[SMP_NODEFAULTVOLUME] is set)
@@ -63,6 +67,24 @@ struct ModSample
 		return pData.pSample != nullptr && nLength != 0;
 	}
 
+	// Check if the sample's data is decoded during playback. Such samples have no data in pData.
+	bool IsStreamed() const noexcept
+	{
+		return stream != nullptr && nLength != 0;
+	}
+
+	// Check if the sample can be played, i.e. it has sample data in memory or is streamed.
+	bool HasPlayableData() const noexcept
+	{
+		return HasSampleData() || IsStreamed();
+	}
+
+	// Sample pointer for the mixer. For streamed samples, this is only a placeholder that must not be dereferenced.
+	const void *GetPlaybackPointer() const noexcept
+	{
+		return stream ? static_cast<const void *>(stream.get()) : pData.pSample;
+	}
+
 	MPT_FORCEINLINE const void *samplev() const noexcept
 	{
 		return pData.pSample;
@@ -136,12 +158,19 @@ struct ModSample
 	void FreeSample();
 	static void FreeSample(void *samplePtr);
 
+	// Copy-on-write for sample data that is shared through the SampleStore: Give this sample its own copy, so that it can be modified.
+	// Channels playing the sample are moved to the copy. Returns false if the sample data must not be modified.
+	bool MakeSampleDataUnique(CSoundFile &sndFile);
+
 	// Set loop points and update loop wrap-around buffer
 	void SetLoop(SmpLength start, SmpLength end, bool enable, bool pingpong, CSoundFile &sndFile);
 	// Set sustain loop points and update loop wrap-around buffer
 	void SetSustainLoop(SmpLength start, SmpLength end, bool enable, bool pingpong, CSoundFile &sndFile);
 	// Update loop wrap-around buffer
 	void PrecomputeLoops(CSoundFile &sndFile, bool updateChannels = true);
+	// Update loop wrap-around buffer of sample data that is known not to be shared, without looking it up in the SampleStore.
+	// Safe to call from the mixer thread.
+	void PrecomputeLoopsUnshared(CSoundFile &sndFile, bool updateChannels = true);
 
 	constexpr bool HasLoop() const noexcept { return uFlags[CHN_LOOP] && nLoopEnd > nLoopStart; }
 	constexpr bool HasSustainLoop() const noexcept { return uFlags[CHN_SUSTAINLOOP] && nSustainEnd > nSustainStart; }
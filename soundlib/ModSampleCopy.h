@@ -14,6 +14,7 @@
 
 
 #include "../soundbase/SampleFormatCopy.h"
+#include "SampleCopyLoops.h"
 
 
 OPENMPT_NAMESPACE_BEGIN
@@ -34,6 +35,11 @@ size_t CopyMonoSample(ModSample &sample, const Tbyte *sourceBuffer, size_t sourc
 	SampleConversion sampleConv(conv);
 	const std::byte * MPT_RESTRICT inBuf = mpt::byte_cast<const std::byte*>(sourceBuffer);
 	typename SampleConversion::output_t * MPT_RESTRICT outBuf = static_cast<typename SampleConversion::output_t *>(sample.samplev());
+	if constexpr(SampleBlockConverter<SampleConversion>::available)
+	{
+		ConvertSampleBlock(SampleBlockConverter<SampleConversion>::format, inBuf, outBuf, countFrames);
+		return frameSize * countFrames;
+	}
 	while(numFrames--)
 	{
 		*outBuf = sampleConv(inBuf);
@@ -58,6 +64,12 @@ size_t CopyStereoInterleavedSample(ModSample &sample, const Tbyte *sourceBuffer,
 	SampleConversion sampleConvRight(conv);
 	const std::byte * MPT_RESTRICT inBuf = mpt::byte_cast<const std::byte*>(sourceBuffer);
 	typename SampleConversion::output_t * MPT_RESTRICT outBuf = static_cast<typename SampleConversion::output_t *>(sample.samplev());
+	if constexpr(SampleBlockConverter<SampleConversion>::available)
+	{
+		// Stateless conversion, so both channels can be converted in one go
+		ConvertSampleBlock(SampleBlockConverter<SampleConversion>::format, inBuf, outBuf, countFrames * 2);
+		return frameSize * countFrames;
+	}
 	while(numFrames--)
 	{
 		*outBuf = sampleConvLeft(inBuf);
@@ -84,6 +96,16 @@ size_t CopyStereoSplitSample(ModSample &sample, const Tbyte *sourceBuffer, size_
 	const size_t countSamplesLeft = sourceSizeLeft / sampleSize;
 	const size_t countSamplesRight = sourceSizeRight / sampleSize;
 
+	if constexpr(SampleBlockConverter<SampleConversion>::available)
+	{
+		if(countSamplesLeft == countSamplesRight)
+		{
+			const std::byte *inBuf = mpt::byte_cast<const std::byte*>(sourceBuffer);
+			ConvertSampleBlockStereoSplit(SampleBlockConverter<SampleConversion>::format, inBuf, inBuf + sample.nLength * SampleConversion::input_inc, sample.samplev(), countSamplesLeft);
+			return (countSamplesLeft + countSamplesRight) * sampleSize;
+		}
+	}
+
 	size_t numSamplesLeft = countSamplesLeft;
 	SampleConversion sampleConvLeft(conv);
 	const std::byte * MPT_RESTRICT inBufLeft = mpt::byte_cast<const std::byte*>(sourceBuffer);
@@ -0,0 +1,147 @@
+/*
+ * ParallelSampleReader.cpp
+ * ------------------------
+ * Purpose: Decode independent compressed samples on multiple threads while loading a module.
+ * Notes  : Threads are only used if the standard library provides std::thread.
+ * Authors: OpenMPT Devs
+ * The OpenMPT source code is released under the BSD license. Read LICENSE for more details.
+ */
+
+
+#include "stdafx.h"
+#include "ParallelSampleReader.h"
+#include "../common/mptMutex.h"
+
+#if MPT_PLATFORM_MULTITHREADED && MPT_MUTEX_STD
+#define MPT_PARALLEL_SAMPLE_READER 1
+#include <atomic>
+#include <exception>
+#include <system_error>
+#if !MPT_COMPILER_GENERIC && (defined(__MINGW32__) || defined(__MINGW64__)) && !defined(_GLIBCXX_HAS_GTHREADS) && defined(MPT_WITH_MINGWSTDTHREADS)
+#include <mingw.thread.h>
+#else
+#include <thread>
+#endif
+#else
+#define MPT_PARALLEL_SAMPLE_READER 0
+#endif
+
+
+OPENMPT_NAMESPACE_BEGIN
+
+
+ParallelSampleReader::ParallelSampleReader(const FileReader &file, uint32 numThreads)
+	: m_file(file)
+{
+#if MPT_PARALLEL_SAMPLE_READER
+	m_numThreads = (numThreads == 0) ? GetDefaultNumThreads() : numThreads;
+	if(m_numThreads > 1)
+	{
+		// Stream-backed file readers cannot be shared between threads, so work on an in-memory view of the whole file instead.
+		FileReader wholeFile = file;
+		wholeFile.Rewind();
+		m_fileView = wholeFile.GetPinnedRawDataView();
+		m_file = FileReader(m_fileView.span());
+	}
+#else
+	MPT_UNREFERENCED_PARAMETER(numThreads);
+	m_numThreads = 1;
+#endif
+}
+
+
+ParallelSampleReader::~ParallelSampleReader()
+{
+	// Jobs may reference the file view, so do not leave any behind.
+	m_jobs.clear();
+}
+
+
+FileReader ParallelSampleReader::GetChunk(FileReader::off_t offset, FileReader::off_t length) const
+{
+	FileReader file = m_file;
+	if(!file.Seek(offset))
+		return FileReader();
+	return file.ReadChunk(length);
+}
+
+
+void ParallelSampleReader::Add(Job job)
+{
+	if(IsParallel())
+		m_jobs.push_back(std::move(job));
+	else
+		job();
+}
+
+
+void ParallelSampleReader::Run()
+{
+	std::vector<Job> jobs;
+	std::swap(jobs, m_jobs);
+	if(jobs.empty())
+		return;
+#if MPT_PARALLEL_SAMPLE_READER
+	std::vector<std::exception_ptr> exceptions(jobs.size());
+	std::atomic<std::size_t> nextJob{0};
+	auto worker = [&]()
+	{
+		std::size_t job;
+		while((job = nextJob.fetch_add(1)) < jobs.size())
+		{
+			try
+			{
+				jobs[job]();
+			} catch(...)
+			{
+				exceptions[job] = std::current_exception();
+			}
+		}
+	};
+
+	const std::size_t numWorkers = std::min(static_cast<std::size_t>(m_numThreads), jobs.size()) - 1;
+	std::vector<std::thread> threads;
+	threads.reserve(numWorkers);
+	for(std::size_t i = 0; i < numWorkers; i++)
+	{
+		try
+		{
+			threads.emplace_back(worker);
+		} catch(const std::system_error &)
+		{
+			// Could not create any more threads, use the ones we already have.
+			break;
+		}
+	}
+	// The calling thread does its share of the work as well.
+	worker();
+	for(auto &thread : threads)
+	{
+		thread.join();
+	}
+
+	for(const auto &e : exceptions)
+	{
+		if(e)
+			std::rethrow_exception(e);
+	}
+#else
+	for(auto &job : jobs)
+	{
+		job();
+	}
+#endif
+}
+
+
+uint32 ParallelSampleReader::GetDefaultNumThreads()
+{
+#if MPT_PARALLEL_SAMPLE_READER
+	return std::max(std::thread::hardware_concurrency(), 1u);
+#else
+	return 1;
+#endif
+}
+
+
+OPENMPT_NAMESPACE_END
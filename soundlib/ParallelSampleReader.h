@@ -0,0 +1,62 @@
+/*
+ * ParallelSampleReader.h
+ * ----------------------
+ * Purpose: Decode independent compressed samples on multiple threads while loading a module.
+ * Notes  : With only one thread (the default), jobs are run immediately when they are added,
+ *          so loaders behave exactly as if they decoded their samples directly.
+ * Authors: OpenMPT Devs
+ * The OpenMPT source code is released under the BSD license. Read LICENSE for more details.
+ */
+
+
+#pragma once
+
+#include "BuildSettings.h"
+
+#include "../common/FileReader.h"
+
+#include <functional>
+
+
+OPENMPT_NAMESPACE_BEGIN
+
+
+class ParallelSampleReader
+{
+public:
+	using Job = std::function<void()>;
+
+	// numThreads = 0 uses one thread per CPU core.
+	ParallelSampleReader(const FileReader &file, uint32 numThreads);
+	~ParallelSampleReader();
+
+	ParallelSampleReader(const ParallelSampleReader &) = delete;
+	ParallelSampleReader &operator=(const ParallelSampleReader &) = delete;
+
+	// Returns true if jobs are deferred until Run() is called.
+	bool IsParallel() const noexcept { return m_numThreads > 1; }
+
+	// Returns a reader for the whole file that can safely be used from several threads at once.
+	// Jobs must only read sample data through file readers obtained from this function.
+	FileReader GetFile() const { return m_file; }
+	FileReader GetChunk(FileReader::off_t offset, FileReader::off_t length) const;
+
+	// Add a decoding job. Jobs must not touch any state that is shared with other jobs.
+	void Add(Job job);
+
+	// Run all pending jobs and wait for them to finish.
+	// If any of the jobs threw an exception, the first exception is rethrown after all jobs have finished.
+	void Run();
+
+	// Number of threads that should be used when the user requests automatic thread count.
+	static uint32 GetDefaultNumThreads();
+
+protected:
+	FileReader::PinnedRawDataView m_fileView;
+	FileReader m_file;
+	std::vector<Job> m_jobs;
+	uint32 m_numThreads = 1;
+};
+
+
+OPENMPT_NAMESPACE_END
@@ -15,6 +15,9 @@
 
 #include <complex>
 #include <numeric>
+#ifdef ENABLE_SSE2
+#include <emmintrin.h>
+#endif
 
 OPENMPT_NAMESPACE_BEGIN
 
@@ -177,8 +180,9 @@ MPT_NOINLINE void Integrate(std::vector<double> &table)
 }
 
 
-MPT_NOINLINE void Quantize(const std::vector<double> &in, Paula::BlepArray &quantized)
+MPT_NOINLINE void Quantize(const std::vector<double> &in, Paula::BlepTable &table)
 {
+	Paula::BlepArray &quantized = table.WinSincIntegral;
 	MPT_ASSERT(in.size() == Paula::BLEP_SIZE);
 	constexpr int fact = 1 << Paula::BLEP_SCALE;
 	const double cv = fact / (in.back() - in.front());
@@ -191,6 +195,68 @@ MPT_NOINLINE void Quantize(const std::vector<double> &in, Paula::BlepArray &quan
 #endif
 		quantized[i] = static_cast<mixsample_t>(-val);
 	}
+
+	table.activeLength = Paula::BLEP_SIZE;
+	while(table.activeLength > 0 && quantized[table.activeLength - 1] == 0)
+		table.activeLength--;
+}
+
+
+// Sum up the contribution of count bleps, which are stored in contiguous memory.
+int C_AccumulateBleps(const Paula::BlepArray &WinSincIntegral, const int16 *level, const uint16 *start, uint16 clock, uint32 count)
+{
+	int output = 0;
+	for(uint32 i = 0; i < count; i++)
+	{
+		output += WinSincIntegral[static_cast<uint16>(clock - start[i])] * level[i];
+	}
+	return output;
+}
+
+
+#ifdef ENABLE_SSE2
+
+// SSE2 has no 32-bit multiplication that keeps the lower half of the result, so emulate it (the lower half is the same for signed and unsigned operands)
+MPT_FORCEINLINE __m128i SSE2_MulLo32(__m128i a, __m128i b)
+{
+	const __m128i even = _mm_mul_epu32(a, b);
+	const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+
+int SSE2_AccumulateBleps(const Paula::BlepArray &WinSincIntegral, const int16 *level, const uint16 *start, uint16 clock, uint32 count)
+{
+	// There is no gather instruction in SSE2, but the ages can be computed and the products summed up four bleps at a time.
+	const __m128i clockVec = _mm_set1_epi16(static_cast<int16>(clock));
+	__m128i sum = _mm_setzero_si128();
+	uint32 i = 0;
+	for(; i + 4 <= count; i += 4)
+	{
+		alignas(16) uint16 age[8];
+		_mm_storel_epi64(reinterpret_cast<__m128i *>(age), _mm_sub_epi16(clockVec, _mm_loadl_epi64(reinterpret_cast<const __m128i *>(start + i))));
+		const __m128i table = _mm_setr_epi32(WinSincIntegral[age[0]], WinSincIntegral[age[1]], WinSincIntegral[age[2]], WinSincIntegral[age[3]]);
+		const __m128i levels16 = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(level + i));
+		const __m128i levels = _mm_srai_epi32(_mm_unpacklo_epi16(levels16, levels16), 16);
+		sum = _mm_add_epi32(sum, SSE2_MulLo32(table, levels));
+	}
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(sum) + C_AccumulateBleps(WinSincIntegral, level + i, start + i, clock, count - i);
+}
+
+#endif // ENABLE_SSE2
+
+
+int AccumulateBleps(const Paula::BlepArray &WinSincIntegral, const int16 *level, const uint16 *start, uint16 clock, uint32 count)
+{
+#ifdef ENABLE_SSE2
+	if(CPU::HasFeatureSet(CPU::feature::sse2))
+	{
+		return SSE2_AccumulateBleps(WinSincIntegral, level, start, clock, count);
+	}
+#endif // ENABLE_SSE2
+	return C_AccumulateBleps(WinSincIntegral, level, start, clock, count);
 }
 
 }  // namespace
@@ -249,7 +315,7 @@ void BlepTables::InitTables()
 }
 
 
-const Paula::BlepArray &BlepTables::GetAmigaTable(Resampling::AmigaFilter amigaType, bool enableFilter) const
+const Paula::BlepTable &BlepTables::GetAmigaTable(Resampling::AmigaFilter amigaType, bool enableFilter) const
 {
 	if(amigaType == Resampling::AmigaFilter::A500)
 		return enableFilter ? WinSincIntegral[A500On] : WinSincIntegral[A500Off];
@@ -279,53 +345,25 @@ void State::Reset()
 }
 
 
-void State::InputSample(int16 sample)
-{
-	if(sample != globalOutputLevel)
-	{
-		// Start a new blep: level is the difference, age (or phase) is 0 clocks.
-		firstBlep = (firstBlep - 1u) % MAX_BLEPS;
-		if(activeBleps < std::size(blepState))
-			activeBleps++;
-		blepState[firstBlep].age = 0;
-		blepState[firstBlep].level = sample - globalOutputLevel;
-		globalOutputLevel = sample;
-	}
-}
-
-
 // Return output simulated as series of bleps
-int State::OutputSample(const BlepArray &WinSincIntegral)
+int State::OutputSample(const BlepTable &table)
 {
+	// Bleps that are so old that their table entry is zero do not contribute anything, but they are still kept around
+	// in case the channel switches to a table with a longer tail (e.g. when toggling the LED filter).
+	uint32 numBleps = activeBleps;
+	while(numBleps > 0 && static_cast<uint16>(clock - blepStart[(firstBlep + numBleps - 1u) % MAX_BLEPS]) >= table.activeLength)
+		numBleps--;
+
+	// The active bleps are stored in a ring buffer, so they may be split into two contiguous parts
+	const uint32 numFirst = std::min(numBleps, static_cast<uint32>(MAX_BLEPS - firstBlep));
 	int output = globalOutputLevel * (1 << Paula::BLEP_SCALE);
-	uint32 lastBlep = firstBlep + activeBleps;
-	for(uint32 i = firstBlep; i != lastBlep; i++)
-	{
-		const auto &blep = blepState[i % MAX_BLEPS];
-		output -= WinSincIntegral[blep.age] * blep.level;
-	}
+	output -= AccumulateBleps(table.WinSincIntegral, blepLevel + firstBlep, blepStart + firstBlep, clock, numFirst);
+	output -= AccumulateBleps(table.WinSincIntegral, blepLevel, blepStart, clock, numBleps - numFirst);
 	output /= (1 << (Paula::BLEP_SCALE - 2));	// - 2 to compensate for the fact that we reduced the input sample bit depth
 
 	return output;
 }
 
-
-// Advance the simulation by given number of clock ticks
-void State::Clock(int cycles)
-{
-	uint32 lastBlep = firstBlep + activeBleps;
-	for(uint32 i = firstBlep; i != lastBlep; i++)
-	{
-		auto &blep = blepState[i % MAX_BLEPS];
-		blep.age += static_cast<uint16>(cycles);
-		if(blep.age >= Paula::BLEP_SIZE)
-		{
-			activeBleps = static_cast<uint16>(i - firstBlep);
-			return;
-		}
-	}
-}
-
 }
 
 OPENMPT_NAMESPACE_END
@@ -28,6 +28,13 @@ inline constexpr int BLEP_SIZE = 2048;
 using BlepArray = std::array<mixsample_t, BLEP_SIZE>;
 
 
+struct BlepTable
+{
+	BlepArray WinSincIntegral;
+	int activeLength = BLEP_SIZE;  // All table entries starting at this index are zero, i.e. older bleps no longer contribute to the output
+};
+
+
 class BlepTables
 {
 	enum AmigaFilter
@@ -40,11 +47,11 @@ class BlepTables
 		NumFilterTypes
 	};
 
-	std::array<Paula::BlepArray, AmigaFilter::NumFilterTypes> WinSincIntegral;
+	std::array<Paula::BlepTable, AmigaFilter::NumFilterTypes> WinSincIntegral;
 
 public:
 	void InitTables();
-	const Paula::BlepArray &GetAmigaTable(Resampling::AmigaFilter amigaType, bool enableFilter) const;
+	const Paula::BlepTable &GetAmigaTable(Resampling::AmigaFilter amigaType, bool enableFilter) const;
 };
 
 
@@ -58,27 +65,66 @@ class State
 	// Hence 128 is chosen as a tradeoff between quality and memory consumption.
 	static constexpr uint16 MAX_BLEPS = 128;
 
-	struct Blep
-	{
-		int16 level;
-		uint16 age;
-	};
-
 public:
 	SamplePosition remainder, stepRemainder;
 	int numSteps;  // Number of full-length steps
 private:
 	uint16 activeBleps = 0, firstBlep = 0;  // Count of simultaneous bleps to keep track of
+	uint16 clock = 0;                       // Number of elapsed clock ticks (wrapping). Blep ages are derived from this, so that clocking does not have to touch every blep.
 	int16 globalOutputLevel = 0;            // The instantenous value of Paula output
-	Blep blepState[MAX_BLEPS];
+	// Bleps are stored as structure of arrays so that they can be summed up using vector instructions.
+	// The newest blep is found at firstBlep, so the ages of all active bleps are sorted in ascending order.
+	alignas(16) int16 blepLevel[MAX_BLEPS];
+	alignas(16) uint16 blepStart[MAX_BLEPS];  // Value of clock when the blep was started
 
 public:
 	State(uint32 sampleRate = 48000);
 
 	void Reset();
-	void InputSample(int16 sample);
-	int OutputSample(const BlepArray &WinSincIntegral);
-	void Clock(int cycles);
+	int OutputSample(const BlepTable &table);
+
+	// Calls add(value) for everything that influences future output, so that two states can be compared through a hash.
+	// Expired bleps and the absolute clock value do not matter.
+	template <typename Func>
+	void ForEachStateValue(Func add) const
+	{
+		add(remainder.GetRaw());
+		add(stepRemainder.GetRaw());
+		add(numSteps);
+		add(globalOutputLevel);
+		for(uint16 i = 0; i < activeBleps; i++)
+		{
+			const uint16 blep = (firstBlep + i) % MAX_BLEPS;
+			const uint16 age = static_cast<uint16>(clock - blepStart[blep]);
+			if(age >= Paula::BLEP_SIZE)
+				break;
+			add(age);
+			add(blepLevel[blep]);
+		}
+	}
+
+	MPT_FORCEINLINE void InputSample(int16 sample)
+	{
+		if(sample != globalOutputLevel)
+		{
+			// Start a new blep: level is the difference, age (or phase) is 0 clocks.
+			firstBlep = (firstBlep - 1u) % MAX_BLEPS;
+			if(activeBleps < MAX_BLEPS)
+				activeBleps++;
+			blepStart[firstBlep] = clock;
+			blepLevel[firstBlep] = sample - globalOutputLevel;
+			globalOutputLevel = sample;
+		}
+	}
+
+	// Advance the simulation by given number of clock ticks
+	MPT_FORCEINLINE void Clock(int cycles)
+	{
+		clock += static_cast<uint16>(cycles);
+		// As the bleps are sorted by age, only the oldest ones at the end of the list can have expired.
+		while(activeBleps > 0 && static_cast<uint16>(clock - blepStart[(firstBlep + activeBleps - 1u) % MAX_BLEPS]) >= Paula::BLEP_SIZE)
+			activeBleps--;
+	}
 };
 
 }
@@ -0,0 +1,294 @@
+/*
+ * PlayBehaviour.h
+ * ---------------
+ * Purpose: Playback behaviour flag sets of the supported format families, and accessors for using them in the per-tick playback code.
+ * Notes  : The per-tick channel processing is instantiated for the most common format configurations, in which case all flag
+ *          lookups are resolved at compile time. Any other combination of format and flags goes through DynamicPlayBehaviour.
+ * Authors: OpenMPT Devs
+ * The OpenMPT source code is released under the BSD license. Read LICENSE for more details.
+ */
+
+
+#pragma once
+
+#include "BuildSettings.h"
+
+#include "Snd_defs.h"
+
+#include <array>
+#include <bitset>
+
+
+OPENMPT_NAMESPACE_BEGIN
+
+
+using PlayBehaviourSet = std::bitset<kMaxPlayBehaviours>;
+
+
+// Playback behaviours supported by the IT format (also supported by MPTM)
+inline constexpr PlayBehaviour ITPlayBehaviours[] =
+{
+	MSF_COMPATIBLE_PLAY,
+	kHertzInLinearMode,
+	kTempoClamp,
+	kPerChannelGlobalVolSlide,
+	kPanOverride,
+	kITInstrWithoutNote,
+	kITVolColFinePortamento,
+	kITArpeggio,
+	kITOutOfRangeDelay,
+	kITPortaMemoryShare,
+	kITPatternLoopTargetReset,
+	kITFT2PatternLoop,
+	kITPingPongNoReset,
+	kITEnvelopeReset,
+	kITClearOldNoteAfterCut,
+	kITVibratoTremoloPanbrello,
+	kITTremor,
+	kITRetrigger,
+	kITMultiSampleBehaviour,
+	kITPortaTargetReached,
+	kITPatternLoopBreak,
+	kITOffset,
+	kITSwingBehaviour,
+	kITNNAReset,
+	kITSCxStopsSample,
+	kITEnvelopePositionHandling,
+	kITPortamentoInstrument,
+	kITPingPongMode,
+	kITRealNoteMapping,
+	kITHighOffsetNoRetrig,
+	kITFilterBehaviour,
+	kITNoSurroundPan,
+	kITShortSampleRetrig,
+	kITPortaNoNote,
+	kITFT2DontResetNoteOffOnPorta,
+	kITVolColMemory,
+	kITPortamentoSwapResetsPos,
+	kITEmptyNoteMapSlot,
+	kITFirstTickHandling,
+	kITSampleAndHoldPanbrello,
+	kITClearPortaTarget,
+	kITPanbrelloHold,
+	kITPanningReset,
+	kITPatternLoopWithJumps,
+	kITInstrWithNoteOff,
+	kITMultiSampleInstrumentNumber,
+	kRowDelayWithNoteDelay,
+	kITInstrWithNoteOffOldEffects,
+	kITDoNotOverrideChannelPan,
+	kITDCTBehaviour,
+};
+
+// Default playback behaviours of newly created MPTM files
+inline constexpr PlayBehaviour MPTDefaultPlayBehaviours[] =
+{
+	kHertzInLinearMode,
+	kPerChannelGlobalVolSlide,
+	kPanOverride,
+	kITArpeggio,
+	kITPortaMemoryShare,
+	kITPatternLoopTargetReset,
+	kITFT2PatternLoop,
+	kITPingPongNoReset,
+	kITClearOldNoteAfterCut,
+	kITVibratoTremoloPanbrello,
+	kITMultiSampleBehaviour,
+	kITPortaTargetReached,
+	kITPatternLoopBreak,
+	kITSwingBehaviour,
+	kITSCxStopsSample,
+	kITEnvelopePositionHandling,
+	kITPingPongMode,
+	kITRealNoteMapping,
+	kITPortaNoNote,
+	kITVolColMemory,
+	kITFirstTickHandling,
+	kITClearPortaTarget,
+	kITSampleAndHoldPanbrello,
+	kITPanbrelloHold,
+	kITPanningReset,
+	kITInstrWithNoteOff,
+	kOPLFlexibleNoteOff,
+	kITDoNotOverrideChannelPan,
+	kITDCTBehaviour,
+	kOPLwithNNA,
+	kOPLRealRetrig,
+};
+
+// Playback behaviours supported by the XM format
+inline constexpr PlayBehaviour XMPlayBehaviours[] =
+{
+	MSF_COMPATIBLE_PLAY,
+	kFT2VolumeRamping,
+	kTempoClamp,
+	kPerChannelGlobalVolSlide,
+	kPanOverride,
+	kITFT2PatternLoop,
+	kITFT2DontResetNoteOffOnPorta,
+	kFT2Arpeggio,
+	kFT2Retrigger,
+	kFT2VolColVibrato,
+	kFT2PortaNoNote,
+	kFT2KeyOff,
+	kFT2PanSlide,
+	kFT2ST3OffsetOutOfRange,
+	kFT2RestrictXCommand,
+	kFT2RetrigWithNoteDelay,
+	kFT2SetPanEnvPos,
+	kFT2PortaIgnoreInstr,
+	kFT2VolColMemory,
+	kFT2LoopE60Restart,
+	kFT2ProcessSilentChannels,
+	kFT2ReloadSampleSettings,
+	kFT2PortaDelay,
+	kFT2Transpose,
+	kFT2PatternLoopWithJumps,
+	kFT2PortaTargetNoReset,
+	kFT2EnvelopeEscape,
+	kFT2Tremor,
+	kFT2OutOfRangeDelay,
+	kFT2Periods,
+	kFT2PanWithDelayedNoteOff,
+	kFT2VolColDelay,
+	kFT2FinetunePrecision,
+	kFT2NoteOffFlags,
+	kRowDelayWithNoteDelay,
+	kFT2MODTremoloRampWaveform,
+	kFT2PortaUpDownMemory,
+	kFT2PanSustainRelease,
+	kFT2NoteDelayWithoutInstr,
+};
+
+// Playback behaviours supported by the S3M format
+inline constexpr PlayBehaviour S3MPlayBehaviours[] =
+{
+	MSF_COMPATIBLE_PLAY,
+	kTempoClamp,
+	kPanOverride,
+	kITPanbrelloHold,
+	kFT2ST3OffsetOutOfRange,
+	kST3NoMutedChannels,
+	kST3PortaSampleChange,
+	kST3EffectMemory,
+	kST3VibratoMemory,
+	KST3PortaAfterArpeggio,
+	kRowDelayWithNoteDelay,
+	kST3OffsetWithoutInstrument,
+	kST3RetrigAfterNoteCut,
+	kST3SampleSwap,
+};
+
+// Playback behaviours supported by the MOD format
+inline constexpr PlayBehaviour MODPlayBehaviours[] =
+{
+	kMODVBlankTiming,
+	kMODOneShotLoops,
+	kMODIgnorePanning,
+	kMODSampleSwap,
+	kMODOutOfRangeNoteDelay,
+	kMODTempoOnSecondTick,
+	kRowDelayWithNoteDelay,
+	kFT2MODTremoloRampWaveform,
+};
+
+
+using PlayBehaviourTable = std::array<bool, kMaxPlayBehaviours>;
+
+template<std::size_t N>
+constexpr PlayBehaviourTable MakePlayBehaviourTable(const PlayBehaviour (&behaviours)[N], PlayBehaviour excluded = kMaxPlayBehaviours)
+{
+	PlayBehaviourTable table{};
+	for(const auto b : behaviours)
+	{
+		if(b != excluded)
+			table[b] = true;
+	}
+	return table;
+}
+
+
+// Playback behaviour of the current module, looked up at runtime. Works for every format and flag combination.
+class DynamicPlayBehaviour
+{
+	const PlayBehaviourSet &m_flags;
+	const MODTYPE m_type;
+
+public:
+	DynamicPlayBehaviour(const PlayBehaviourSet &flags, MODTYPE type)
+		: m_flags{flags}, m_type{type}
+	{ }
+
+	bool operator[](PlayBehaviour b) const { return m_flags[b]; }
+	MODTYPE GetType() const { return m_type; }
+};
+
+
+// Playback behaviour known at compile time. Traits must provide the module type and a PlayBehaviourTable.
+template<typename Traits>
+class StaticPlayBehaviour
+{
+public:
+	constexpr bool operator[](PlayBehaviour b) const { return Traits::flags[b]; }
+	constexpr MODTYPE GetType() const { return Traits::type; }
+
+	// Check if a module with the given type and flags can be played with this behaviour
+	static bool Matches(MODTYPE type, const PlayBehaviourSet &flags)
+	{
+		static const PlayBehaviourSet staticFlags = []()
+		{
+			PlayBehaviourSet set;
+			for(std::size_t i = 0; i < kMaxPlayBehaviours; i++)
+				set.set(i, Traits::flags[i]);
+			return set;
+		}();
+		return type == Traits::type && flags == staticFlags;
+	}
+};
+
+
+// The common format configurations for which the per-tick channel processing is specialized
+
+struct ITPlayBehaviourTraits
+{
+	// IT files saved with Impulse Tracker and compatible trackers
+	static constexpr MODTYPE type = MOD_TYPE_IT;
+	static constexpr PlayBehaviourTable flags = MakePlayBehaviourTable(ITPlayBehaviours);
+};
+
+struct MPTPlayBehaviourTraits
+{
+	// MPTM files using the default playback behaviour
+	static constexpr MODTYPE type = MOD_TYPE_MPT;
+	static constexpr PlayBehaviourTable flags = MakePlayBehaviourTable(MPTDefaultPlayBehaviours);
+};
+
+struct XMPlayBehaviourTraits
+{
+	// XM files saved with FastTracker 2
+	static constexpr MODTYPE type = MOD_TYPE_XM;
+	static constexpr PlayBehaviourTable flags = MakePlayBehaviourTable(XMPlayBehaviours);
+};
+
+struct S3MPlayBehaviourTraits
+{
+	// S3M files saved with Scream Tracker 3 (GUS behaviour)
+	static constexpr MODTYPE type = MOD_TYPE_S3M;
+	static constexpr PlayBehaviourTable flags = MakePlayBehaviourTable(S3MPlayBehaviours, kST3SampleSwap);
+};
+
+struct MODPlayBehaviourTraits
+{
+	// ProTracker M.K. files with CIA timing
+	static constexpr MODTYPE type = MOD_TYPE_MOD;
+	static constexpr PlayBehaviourTable flags = MakePlayBehaviourTable(MODPlayBehaviours, kMODVBlankTiming);
+};
+
+using ITPlayBehaviour = StaticPlayBehaviour<ITPlayBehaviourTraits>;
+using MPTPlayBehaviour = StaticPlayBehaviour<MPTPlayBehaviourTraits>;
+using XMPlayBehaviour = StaticPlayBehaviour<XMPlayBehaviourTraits>;
+using S3MPlayBehaviour = StaticPlayBehaviour<S3MPlayBehaviourTraits>;
+using MODPlayBehaviour = StaticPlayBehaviour<MODPlayBehaviourTraits>;
+
+
+OPENMPT_NAMESPACE_END
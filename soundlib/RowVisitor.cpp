@@ -65,7 +65,34 @@ RowVisitor::RowVisitor(const CSoundFile &sndFile, SEQUENCEINDEX sequence)
 void RowVisitor::MoveVisitedRowsFrom(RowVisitor &other) noexcept
 {
 	m_visitedRows = std::move(other.m_visitedRows);
-	m_visitedLoopStates = std::move(other.m_visitedLoopStates);
+	m_orderOffsets = std::move(other.m_orderOffsets);
+	m_loopStateSlots = std::move(other.m_loopStateSlots);
+	m_loopStateSets = std::move(other.m_loopStateSets);
+}
+
+
+uint64 RowVisitor::GetStateHash() const noexcept
+{
+	uint64 hash = LoopState::FNV1a_BASIS;
+	for(bool visited : m_visitedRows)
+	{
+		hash = (hash ^ (visited ? 1u : 0u)) * LoopState::FNV1a_PRIME;
+	}
+	// The layout of the hash table depends on the order in which rows were visited, so only the sum of its entries is used
+	uint64 loopStates = 0;
+	for(const auto &slot : m_loopStateSlots)
+	{
+		if(slot.key == LoopStateSlot::EMPTY)
+			continue;
+		uint64 entry = slot.key * LoopState::FNV1a_PRIME;
+		for(const auto &loopState : m_loopStateSets[slot.index])
+		{
+			entry += loopState.GetHash();
+		}
+		loopStates += entry * LoopState::FNV1a_PRIME;
+	}
+	hash = (hash ^ loopStates) * LoopState::FNV1a_PRIME;
+	return hash;
 }
 
 
@@ -84,77 +111,82 @@ void RowVisitor::Initialize(bool reset)
 {
 	auto &order = Order();
 	const ORDERINDEX endOrder = order.GetLengthTailTrimmed();
-	m_visitedRows.resize(endOrder);
-	if(reset)
+
+	std::vector<uint32> orderOffsets(endOrder + 1);
+	uint32 numRowsTotal = 0;
+	for(ORDERINDEX ord = 0; ord < endOrder; ord++)
 	{
-		m_visitedLoopStates.clear();
-		m_rowsSpentInLoops = 0;
+		orderOffsets[ord] = numRowsTotal;
+		numRowsTotal += VisitedRowsVectorSize(order[ord]);
 	}
+	orderOffsets[endOrder] = numRowsTotal;
 
-	std::vector<uint8> loopCount;
-	std::vector<ORDERINDEX> visitedPatterns(m_sndFile.Patterns.GetNumPatterns(), ORDERINDEX_INVALID);
-	for(ORDERINDEX ord = 0; ord < endOrder; ord++)
+	if(!reset)
 	{
-		const PATTERNINDEX pat = order[ord];
-		const ROWINDEX numRows = VisitedRowsVectorSize(pat);
-		auto &visitedRows = m_visitedRows[ord];
+		// Keep the visited state of all rows that still exist.
+		// Loop states are only pre-allocated when resetting, they are created on demand otherwise.
+		std::vector<bool> visitedRows(numRowsTotal, false);
+		const ORDERINDEX keepOrders = std::min(endOrder, NumInitializedOrders());
+		for(ORDERINDEX ord = 0; ord < keepOrders; ord++)
+		{
+			const auto oldRows = m_visitedRows.begin() + m_orderOffsets[ord];
+			std::copy(oldRows, oldRows + std::min(NumInitializedRows(ord), orderOffsets[ord + 1] - orderOffsets[ord]), visitedRows.begin() + orderOffsets[ord]);
+		}
+		m_visitedRows = std::move(visitedRows);
+		m_orderOffsets = std::move(orderOffsets);
+		return;
+	}
 
-		if(reset)
-			visitedRows.assign(numRows, false);
-		else
-			visitedRows.resize(numRows, false);
+	m_visitedRows.assign(numRowsTotal, false);
+	m_orderOffsets = std::move(orderOffsets);
+	ClearLoopStates();
+	m_rowsSpentInLoops = 0;
 
+	// For every pattern, rows that are part of a pattern loop and how many loop states they can have at most
+	std::vector<std::vector<std::pair<ROWINDEX, uint32>>> patternLoopRows(m_sndFile.Patterns.GetNumPatterns());
+	std::vector<bool> patternParsed(m_sndFile.Patterns.GetNumPatterns(), false);
+	std::vector<uint8> loopCount;
+	for(ORDERINDEX ord = 0; ord < endOrder; ord++)
+	{
 		if(!order.IsValidPat(ord))
 			continue;
 
-		const ROWINDEX startRow = std::min(static_cast<ROWINDEX>(reset ? 0 : visitedRows.size()), numRows);
-		auto insertionHint = m_visitedLoopStates.end();
-
-		if(visitedPatterns[pat] != ORDERINDEX_INVALID)
+		const PATTERNINDEX pat = order[ord];
+		auto &loopRows = patternLoopRows[pat];
+		if(!patternParsed[pat])
 		{
-			// We visited this pattern before, copy over the results
-			const auto begin = m_visitedLoopStates.lower_bound({visitedPatterns[pat], startRow});
-			const auto end = (begin != m_visitedLoopStates.end()) ? m_visitedLoopStates.lower_bound({visitedPatterns[pat], numRows}) : m_visitedLoopStates.end();
-			for(auto pos = begin; pos != end; ++pos)
+			// Pre-compute loop count state
+			patternParsed[pat] = true;
+			const auto &pattern = m_sndFile.Patterns[pat];
+			loopCount.assign(pattern.GetNumChannels(), 0);
+			for(ROWINDEX row = pattern.GetNumRows(); row-- > 0;)
 			{
-				LoopStateSet loopStates;
-				loopStates.reserve(pos->second.capacity());
-				insertionHint = ++m_visitedLoopStates.insert_or_assign(insertionHint, {ord, pos->first.second}, std::move(loopStates));
+				uint32 maxLoopStates = 1;
+				auto m = pattern.GetRow(row);
+				// Break condition: If it's more than 16, it's probably wrong :) exact loop count depends on how loops overlap.
+				for(CHANNELINDEX chn = 0; chn < pattern.GetNumChannels() && maxLoopStates < 16; chn++, m++)
+				{
+					auto count = loopCount[chn];
+					if((m->command == CMD_S3MCMDEX && (m->param & 0xF0) == 0xB0) || (m->command == CMD_MODCMDEX && (m->param & 0xF0) == 0x60))
+					{
+						loopCount[chn] = (m->param & 0x0F);
+						if(loopCount[chn])
+							count = loopCount[chn];
+					}
+					if(count)
+						maxLoopStates *= (count + 1);
+				}
+				if(maxLoopStates > 1)
+					loopRows.emplace_back(row, maxLoopStates);
 			}
-			continue;
 		}
 
-		// Pre-allocate loop count state
-		const auto &pattern = m_sndFile.Patterns[pat];
-		loopCount.assign(pattern.GetNumChannels(), 0);
-		for(ROWINDEX i = numRows; i != startRow; i--)
+		for(const auto &[row, maxLoopStates] : loopRows)
 		{
-			const ROWINDEX row = i - 1;
-			uint32 maxLoopStates = 1;
-			auto m = pattern.GetRow(row);
-			// Break condition: If it's more than 16, it's probably wrong :) exact loop count depends on how loops overlap.
-			for(CHANNELINDEX chn = 0; chn < pattern.GetNumChannels() && maxLoopStates < 16; chn++, m++)
-			{
-				auto count = loopCount[chn];
-				if((m->command == CMD_S3MCMDEX && (m->param & 0xF0) == 0xB0) || (m->command == CMD_MODCMDEX && (m->param & 0xF0) == 0x60))
-				{
-					loopCount[chn] = (m->param & 0x0F);
-					if(loopCount[chn])
-						count = loopCount[chn];
-				}
-				if(count)
-					maxLoopStates *= (count + 1);
-			}
-			if(maxLoopStates > 1)
-			{
-				LoopStateSet loopStates;
-				loopStates.reserve(maxLoopStates);
-				insertionHint = m_visitedLoopStates.insert_or_assign(insertionHint, {ord, row}, std::move(loopStates));
-			}
+			LoopStateSet loopStates;
+			loopStates.reserve(maxLoopStates);
+			InsertLoopStates(ord, row, std::move(loopStates));
 		}
-		// Only use this order as a blueprint for other orders using the same pattern if we fully parsed the pattern.
-		if(startRow == 0)
-			visitedPatterns[pat] = ord;
 	}
 }
 
@@ -167,25 +199,26 @@ bool RowVisitor::Visit(ORDERINDEX ord, ROWINDEX row, const ChannelStates &chnSta
 		return false;
 
 	// The module might have been edited in the meantime - so we have to extend this a bit.
-	if(ord >= m_visitedRows.size() || row >= m_visitedRows[ord].size())
+	if(ord >= NumInitializedOrders() || row >= NumInitializedRows(ord))
 	{
 		Initialize(false);
 		// If it's still past the end of the vector, this means that ord >= order.GetLengthTailTrimmed(), i.e. we are trying to play an empty order.
-		if(ord >= m_visitedRows.size())
+		if(ord >= NumInitializedOrders())
 			return false;
 	}
 
 	MPT_ASSERT(chnState.size() >= m_sndFile.GetNumChannels());
 	LoopState newState{chnState.first(m_sndFile.GetNumChannels()), ignoreRow};
-	const auto rowLoopState = m_visitedLoopStates.find({ord, row});
-	const bool oldHadLoops = (rowLoopState != m_visitedLoopStates.end() && !rowLoopState->second.empty());
+	LoopStateSet *rowLoopStates = FindLoopStates(ord, row);
+	const bool oldHadLoops = (rowLoopStates != nullptr && !rowLoopStates->empty());
 	const bool newHasLoops = newState.HasLoops();
-	const bool wasVisited = m_visitedRows[ord][row];
+	const auto visitedRow = m_visitedRows.begin() + m_orderOffsets[ord] + row;
+	const bool wasVisited = *visitedRow;
 	
 	// Check if new state is part of row state already. If so, we visited this row already and thus the module must be looping
 	if(!oldHadLoops && !newHasLoops && wasVisited)
 		return true;
-	if(oldHadLoops && mpt::contains(rowLoopState->second, newState))
+	if(oldHadLoops && mpt::contains(*rowLoopStates, newState))
 		return true;
 
 	if(newHasLoops)
@@ -193,16 +226,80 @@ bool RowVisitor::Visit(ORDERINDEX ord, ROWINDEX row, const ChannelStates &chnSta
 
 	if(oldHadLoops || newHasLoops)
 	{
+		if(rowLoopStates == nullptr)
+			rowLoopStates = &InsertLoopStates(ord, row, {});
 		// Convert to set representation if it isn't already
 		if(!oldHadLoops && wasVisited)
-			m_visitedLoopStates[{ord, row}].emplace_back();
-		m_visitedLoopStates[{ord, row}].emplace_back(std::move(newState));
+			rowLoopStates->emplace_back();
+		rowLoopStates->emplace_back(std::move(newState));
 	}
-	m_visitedRows[ord][row] = true;
+	*visitedRow = true;
 	return false;
 }
 
 
+// Returns the hash table slot containing the given key, or the empty slot where it would be inserted.
+size_t RowVisitor::FindLoopStateSlot(uint64 key) const noexcept
+{
+	MPT_ASSERT(!m_loopStateSlots.empty());
+	const size_t mask = m_loopStateSlots.size() - 1;
+	size_t slot = static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+	while(m_loopStateSlots[slot].key != key && m_loopStateSlots[slot].key != LoopStateSlot::EMPTY)
+	{
+		slot = (slot + 1) & mask;
+	}
+	return slot;
+}
+
+
+RowVisitor::LoopStateSet *RowVisitor::FindLoopStates(ORDERINDEX ord, ROWINDEX row) noexcept
+{
+	if(m_loopStateSets.empty())
+		return nullptr;
+	const LoopStateSlot &slot = m_loopStateSlots[FindLoopStateSlot(LoopStateKey(ord, row))];
+	if(slot.key == LoopStateSlot::EMPTY)
+		return nullptr;
+	return &m_loopStateSets[slot.index];
+}
+
+
+// Add or replace the loop states of a row.
+RowVisitor::LoopStateSet &RowVisitor::InsertLoopStates(ORDERINDEX ord, ROWINDEX row, LoopStateSet &&loopStates)
+{
+	// Keep the load factor at 50% or less
+	if((m_loopStateSets.size() + 1) * 2 > m_loopStateSlots.size())
+	{
+		std::vector<LoopStateSlot> oldSlots(std::max(m_loopStateSlots.size() * 2, size_t(16)));
+		std::swap(oldSlots, m_loopStateSlots);
+		for(const auto &oldSlot : oldSlots)
+		{
+			if(oldSlot.key != LoopStateSlot::EMPTY)
+				m_loopStateSlots[FindLoopStateSlot(oldSlot.key)] = oldSlot;
+		}
+	}
+
+	const uint64 key = LoopStateKey(ord, row);
+	LoopStateSlot &slot = m_loopStateSlots[FindLoopStateSlot(key)];
+	if(slot.key == key)
+	{
+		m_loopStateSets[slot.index] = std::move(loopStates);
+	} else
+	{
+		slot.key = key;
+		slot.index = static_cast<uint32>(m_loopStateSets.size());
+		m_loopStateSets.push_back(std::move(loopStates));
+	}
+	return m_loopStateSets[slot.index];
+}
+
+
+void RowVisitor::ClearLoopStates() noexcept
+{
+	m_loopStateSlots.clear();
+	m_loopStateSets.clear();
+}
+
+
 // Get the needed vector size for a given pattern.
 ROWINDEX RowVisitor::VisitedRowsVectorSize(PATTERNINDEX pattern) const noexcept
 {
@@ -226,16 +323,17 @@ bool RowVisitor::GetFirstUnvisitedRow(ORDERINDEX &ord, ROWINDEX &row, bool onlyU
 		if(!order.IsValidPat(ord))
 			continue;
 
-		if(ord >= m_visitedRows.size())
+		if(ord >= NumInitializedOrders())
 		{
 			// Not yet initialized => unvisited
 			row = 0;
 			return true;
 		}
 
-		const auto &visitedRows = m_visitedRows[ord];
-		const auto firstUnplayedRow = std::find(visitedRows.begin(), visitedRows.end(), onlyUnplayedPatterns);
-		if(onlyUnplayedPatterns && firstUnplayedRow == visitedRows.end())
+		const auto visitedRowsBegin = m_visitedRows.begin() + m_orderOffsets[ord];
+		const auto visitedRowsEnd = m_visitedRows.begin() + m_orderOffsets[ord + 1];
+		const auto firstUnplayedRow = std::find(visitedRowsBegin, visitedRowsEnd, onlyUnplayedPatterns);
+		if(onlyUnplayedPatterns && firstUnplayedRow == visitedRowsEnd)
 		{
 			// No row of this pattern has been played yet.
 			row = 0;
@@ -243,15 +341,15 @@ bool RowVisitor::GetFirstUnvisitedRow(ORDERINDEX &ord, ROWINDEX &row, bool onlyU
 		} else if(!onlyUnplayedPatterns)
 		{
 			// Return the first unplayed row in this pattern
-			if(firstUnplayedRow != visitedRows.end())
+			if(firstUnplayedRow != visitedRowsEnd)
 			{
-				row = static_cast<ROWINDEX>(std::distance(visitedRows.begin(), firstUnplayedRow));
+				row = static_cast<ROWINDEX>(std::distance(visitedRowsBegin, firstUnplayedRow));
 				return true;
 			}
-			if(visitedRows.size() < m_sndFile.Patterns[order[ord]].GetNumRows())
+			if(NumInitializedRows(ord) < m_sndFile.Patterns[order[ord]].GetNumRows())
 			{
 				// History is not fully initialized
-				row = static_cast<ROWINDEX>(visitedRows.size());
+				row = NumInitializedRows(ord);
 				return true;
 			}
 		}
@@ -15,7 +15,7 @@
 #include "../common/mptSpan.h"
 #include "Snd_defs.h"
 
-#include <map>
+#include <vector>
 
 OPENMPT_NAMESPACE_BEGIN
 
@@ -34,8 +34,11 @@ protected:
 
 	class LoopState
 	{
+	public:
 		static constexpr uint64 FNV1a_BASIS = 14695981039346656037ull;
 		static constexpr uint64 FNV1a_PRIME = 1099511628211ull;
+
+	private:
 		uint64 m_hash = FNV1a_BASIS;
 #ifdef MPT_VERIFY_ROWVISITOR_LOOPSTATE
 		std::vector<std::pair<uint8, uint8>> m_counts;  // Actual loop counts to verify equality of hash-based implementation
@@ -66,14 +69,27 @@ protected:
 #endif
 			return m_hash != FNV1a_BASIS;
 		}
+
+		[[nodiscard]] uint64 GetHash() const noexcept { return m_hash; }
 	};
 
 	using LoopStateSet = std::vector<LoopState>;
 
+	// Slot of the open-addressing hash table that maps (order, row) to an entry in m_loopStateSets.
+	struct LoopStateSlot
+	{
+		static constexpr uint64 EMPTY = uint64_max;
+		uint64 key = EMPTY;
+		uint32 index = 0;
+	};
+
 	// Stores for every (order, row) combination in the sequence if it has been visited or not.
-	std::vector<std::vector<bool>> m_visitedRows;
-	// Map for each row that's part of a pattern loop which loop states have been visited. Held in a separate data structure because it is sparse data in typical modules.
-	std::map<std::pair<ORDERINDEX, ROWINDEX>, LoopStateSet> m_visitedLoopStates;
+	// The rows of all orders are stored in one flat bitmap, the rows of order n start at m_orderOffsets[n].
+	std::vector<bool> m_visitedRows;
+	std::vector<uint32> m_orderOffsets;
+	// For each row that's part of a pattern loop, stores which loop states have been visited. Held in a separate data structure because it is sparse data in typical modules.
+	std::vector<LoopStateSlot> m_loopStateSlots;
+	std::vector<LoopStateSet> m_loopStateSets;
 
 	const CSoundFile &m_sndFile;
 	ROWINDEX m_rowsSpentInLoops = 0;
@@ -102,10 +118,24 @@ public:
 	[[nodiscard]] bool ModuleTooComplex(ROWINDEX threshold) const noexcept { return m_rowsSpentInLoops >= threshold; }
 	void ResetComplexity() { m_rowsSpentInLoops = 0; }
 
+	// Hash of all visited rows and loop states, for checking if two instances of the same module will detect the song end at the same point.
+	[[nodiscard]] uint64 GetStateHash() const noexcept;
+
 protected:
 	// Get the needed vector size for a given pattern.
 	[[nodiscard]] ROWINDEX VisitedRowsVectorSize(PATTERNINDEX pattern) const noexcept;
 
+	// Number of orders and rows of an order that the visited rows bitmap is currently initialized for.
+	[[nodiscard]] ORDERINDEX NumInitializedOrders() const noexcept { return m_orderOffsets.empty() ? ORDERINDEX(0) : static_cast<ORDERINDEX>(m_orderOffsets.size() - 1); }
+	[[nodiscard]] ROWINDEX NumInitializedRows(ORDERINDEX ord) const noexcept { return m_orderOffsets[ord + 1] - m_orderOffsets[ord]; }
+
+	// Loop state hash table access
+	[[nodiscard]] static uint64 LoopStateKey(ORDERINDEX ord, ROWINDEX row) noexcept { return (static_cast<uint64>(ord) << 32) | row; }
+	[[nodiscard]] size_t FindLoopStateSlot(uint64 key) const noexcept;
+	[[nodiscard]] LoopStateSet *FindLoopStates(ORDERINDEX ord, ROWINDEX row) noexcept;
+	LoopStateSet &InsertLoopStates(ORDERINDEX ord, ROWINDEX row, LoopStateSet &&loopStates);
+	void ClearLoopStates() noexcept;
+
 	[[nodiscard]] const ModSequence &Order() const;
 };
 
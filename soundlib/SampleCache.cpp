@@ -0,0 +1,191 @@
+/*
+ * SampleCache.cpp
+ * ---------------
+ * Purpose: Process-wide cache of decoded sample data for compressed sample formats.
+ * Notes  : Least recently used samples are evicted first once the maximum size is exceeded.
+ * Authors: OpenMPT Devs
+ * The OpenMPT source code is released under the BSD license. Read LICENSE for more details.
+ */
+
+
+#include "stdafx.h"
+#include "SampleCache.h"
+#include "ModSample.h"
+#include "SampleIO.h"
+#include "../common/FileReader.h"
+#include "../common/mptCRC.h"
+#include "../common/mptMutex.h"
+
+#include <list>
+#include <map>
+#include <tuple>
+
+
+OPENMPT_NAMESPACE_BEGIN
+
+
+namespace
+{
+
+struct CacheEntry
+{
+	DecodedSampleCache::Key key;
+	std::vector<std::byte> data;
+	uint64 encodedSize = 0;
+	SmpLength length = 0;
+	bool is16Bit = false;
+	bool isStereo = false;
+};
+
+struct CacheState
+{
+	mpt::mutex mutex;
+	std::list<CacheEntry> entries;  // Most recently used entry first
+	std::map<DecodedSampleCache::Key, std::list<CacheEntry>::iterator> index;
+	std::size_t size = 0;
+	std::size_t maxSize = 0;
+
+	void Evict(std::size_t targetSize)
+	{
+		while(size > targetSize && !entries.empty())
+		{
+			size -= entries.back().data.size();
+			index.erase(entries.back().key);
+			entries.pop_back();
+		}
+	}
+};
+
+CacheState &GetCacheState()
+{
+	static CacheState state;
+	return state;
+}
+
+}  // namespace
+
+
+bool DecodedSampleCache::Key::operator<(const Key &other) const noexcept
+{
+	return std::tie(fileHash, fileSize, sampleIndex, format, length) < std::tie(other.fileHash, other.fileSize, other.sampleIndex, other.format, other.length);
+}
+
+
+bool DecodedSampleCache::Key::operator==(const Key &other) const noexcept
+{
+	return std::tie(fileHash, fileSize, sampleIndex, format, length) == std::tie(other.fileHash, other.fileSize, other.sampleIndex, other.format, other.length);
+}
+
+
+void DecodedSampleCache::SetMaxSize(std::size_t bytes)
+{
+	CacheState &state = GetCacheState();
+	mpt::lock_guard<mpt::mutex> lock(state.mutex);
+	state.maxSize = bytes;
+	state.Evict(bytes);
+}
+
+
+std::size_t DecodedSampleCache::GetMaxSize()
+{
+	CacheState &state = GetCacheState();
+	mpt::lock_guard<mpt::mutex> lock(state.mutex);
+	return state.maxSize;
+}
+
+
+std::size_t DecodedSampleCache::GetSize()
+{
+	CacheState &state = GetCacheState();
+	mpt::lock_guard<mpt::mutex> lock(state.mutex);
+	return state.size;
+}
+
+
+uint64 DecodedSampleCache::HashFile(FileReader file)
+{
+	file.Rewind();
+	FileReader::PinnedRawDataView view = file.GetPinnedRawDataView();
+	mpt::checksum::crc64_jones crc;
+	crc(view.begin(), view.end());
+	return crc.result();
+}
+
+
+bool DecodedSampleCache::Lookup(const Key &key, ModSample &sample, uint64 &encodedSize)
+{
+	CacheState &state = GetCacheState();
+	mpt::lock_guard<mpt::mutex> lock(state.mutex);
+	auto it = state.index.find(key);
+	if(it == state.index.end())
+		return false;
+	const CacheEntry &entry = *it->second;
+
+	sample.nLength = entry.length;
+	sample.uFlags.set(CHN_16BIT, entry.is16Bit);
+	sample.uFlags.set(CHN_STEREO, entry.isStereo);
+	if(!sample.AllocateSample())
+	{
+		sample.nLength = 0;
+		return false;
+	}
+	MPT_ASSERT(sample.GetSampleSizeInBytes() == entry.data.size());
+	std::copy(entry.data.begin(), entry.data.end(), sample.sampleb());
+	encodedSize = entry.encodedSize;
+
+	state.entries.splice(state.entries.begin(), state.entries, it->second);
+	return true;
+}
+
+
+void DecodedSampleCache::Store(const Key &key, const ModSample &sample, uint64 encodedSize)
+{
+	if(!sample.HasSampleData())
+		return;
+	const std::size_t dataSize = sample.GetSampleSizeInBytes();
+
+	CacheState &state = GetCacheState();
+	mpt::lock_guard<mpt::mutex> lock(state.mutex);
+	if(dataSize > state.maxSize || state.index.count(key))
+		return;
+	state.Evict(state.maxSize - dataSize);
+
+	CacheEntry entry;
+	entry.key = key;
+	entry.data.assign(sample.sampleb(), sample.sampleb() + dataSize);
+	entry.encodedSize = encodedSize;
+	entry.length = sample.nLength;
+	entry.is16Bit = sample.uFlags[CHN_16BIT];
+	entry.isStereo = sample.uFlags[CHN_STEREO];
+	state.entries.push_front(std::move(entry));
+	state.index[key] = state.entries.begin();
+	state.size += dataSize;
+}
+
+
+size_t DecodedSampleCache::ReadSample(const SampleIO &sampleIO, ModSample &sample, FileReader &file, Key key)
+{
+	key.format = (uint32(sampleIO.GetBitDepth()) << 24) | (uint32(sampleIO.GetChannelFormat()) << 16) | (uint32(sampleIO.GetEndianness()) << 8) | uint32(sampleIO.GetEncoding());
+	key.length = sample.nLength;
+	uint64 encodedSize = 0;
+	if(Lookup(key, sample, encodedSize))
+	{
+		file.Skip(mpt::saturate_cast<FileReader::off_t>(encodedSize));
+		return mpt::saturate_cast<size_t>(encodedSize);
+	}
+	const FileReader::off_t startPos = file.GetPosition();
+	const size_t result = sampleIO.ReadSample(sample, file);
+	Store(key, sample, file.GetPosition() - startPos);
+	return result;
+}
+
+
+void DecodedSampleCache::Clear()
+{
+	CacheState &state = GetCacheState();
+	mpt::lock_guard<mpt::mutex> lock(state.mutex);
+	state.Evict(0);
+}
+
+
+OPENMPT_NAMESPACE_END
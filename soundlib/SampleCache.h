@@ -0,0 +1,69 @@
+/*
+ * SampleCache.h
+ * -------------
+ * Purpose: Process-wide cache of decoded sample data for compressed sample formats.
+ * Notes  : The cache is disabled by default (maximum size 0).
+ *          It is shared between all CSoundFile instances and thus must be thread-safe.
+ * Authors: OpenMPT Devs
+ * The OpenMPT source code is released under the BSD license. Read LICENSE for more details.
+ */
+
+
+#pragma once
+
+#include "BuildSettings.h"
+
+#include "Snd_defs.h"
+#include "../common/FileReaderFwd.h"
+
+
+OPENMPT_NAMESPACE_BEGIN
+
+
+struct ModSample;
+class SampleIO;
+
+
+class DecodedSampleCache
+{
+public:
+	// Identifies one decoded sample. The file hash covers the complete module file,
+	// so the sample index and format are sufficient to tell samples apart within it.
+	struct Key
+	{
+		uint64 fileHash = 0;
+		uint64 fileSize = 0;
+		uint32 sampleIndex = 0;
+		uint32 format = 0;       // Loader-specific description of the encoding
+		SmpLength length = 0;    // Requested sample length before decoding
+
+		bool operator<(const Key &other) const noexcept;
+		bool operator==(const Key &other) const noexcept;
+	};
+
+	// Set maximum amount of memory in bytes used by decoded sample data. 0 disables (and empties) the cache.
+	static void SetMaxSize(std::size_t bytes);
+	static std::size_t GetMaxSize();
+	// Amount of memory in bytes currently used by decoded sample data.
+	static std::size_t GetSize();
+	static bool IsEnabled() { return GetMaxSize() != 0; }
+
+	// Hash the complete file contents. Only call this when the cache is enabled, as it reads the whole file.
+	static uint64 HashFile(FileReader file);
+
+	// If the sample is found in the cache, its length, format flags and sample data are restored,
+	// encodedSize is set to the number of bytes the original decoder consumed from the file, and true is returned.
+	static bool Lookup(const Key &key, ModSample &sample, uint64 &encodedSize);
+	// Store a decoded sample. Samples larger than the maximum cache size are ignored.
+	static void Store(const Key &key, const ModSample &sample, uint64 encodedSize);
+
+	// Read a sample using SampleIO, going through the cache. key.format and key.length are filled in from the sample format.
+	// The file cursor is left at the same position as if the sample was decoded.
+	static size_t ReadSample(const SampleIO &sampleIO, ModSample &sample, FileReader &file, Key key);
+
+	// Remove all cached samples.
+	static void Clear();
+};
+
+
+OPENMPT_NAMESPACE_END
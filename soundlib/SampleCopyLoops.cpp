@@ -0,0 +1,297 @@
+/*
+ * SampleCopyLoops.cpp
+ * -------------------
+ * Purpose: Block-wise inner loops for converting raw sample data to ModSample storage.
+ * Notes  : This file contains performance-critical loops with variants
+ *          optimized for various instruction sets.
+ * Authors: OpenMPT Devs
+ * The OpenMPT source code is released under the BSD license. Read LICENSE for more details.
+ */
+
+
+#include "stdafx.h"
+#include "SampleCopyLoops.h"
+#ifdef ENABLE_SSE2
+#include <emmintrin.h>
+#endif
+
+
+OPENMPT_NAMESPACE_BEGIN
+
+
+///////////////////////////////////////////////////////////////////////////////////////
+// Reference implementation using the scalar sample conversion functors
+
+template <typename SampleConversion>
+static void C_ConvertSampleBlock(const std::byte *src, typename SampleConversion::output_t *dst, std::size_t count, std::size_t dstStride)
+{
+	SampleConversion conv;
+	for(std::size_t i = 0; i < count; i++)
+	{
+		*dst = conv(src);
+		src += SampleConversion::input_inc;
+		dst += dstStride;
+	}
+}
+
+
+static void C_ConvertSampleBlock(SampleBlockFormat format, const std::byte *src, void *dst, std::size_t count, std::size_t dstStride)
+{
+	switch(format)
+	{
+	case SampleBlockFormat::Int8:
+		C_ConvertSampleBlock<SC::DecodeInt8>(src, static_cast<int8 *>(dst), count, dstStride);
+		break;
+	case SampleBlockFormat::Uint8:
+		C_ConvertSampleBlock<SC::DecodeUint8>(src, static_cast<int8 *>(dst), count, dstStride);
+		break;
+	case SampleBlockFormat::Int16LE:
+		C_ConvertSampleBlock<SC::DecodeInt16<0, littleEndian16>>(src, static_cast<int16 *>(dst), count, dstStride);
+		break;
+	case SampleBlockFormat::Int16BE:
+		C_ConvertSampleBlock<SC::DecodeInt16<0, bigEndian16>>(src, static_cast<int16 *>(dst), count, dstStride);
+		break;
+	case SampleBlockFormat::Uint16LE:
+		C_ConvertSampleBlock<SC::DecodeInt16<0x8000u, littleEndian16>>(src, static_cast<int16 *>(dst), count, dstStride);
+		break;
+	case SampleBlockFormat::Uint16BE:
+		C_ConvertSampleBlock<SC::DecodeInt16<0x8000u, bigEndian16>>(src, static_cast<int16 *>(dst), count, dstStride);
+		break;
+	case SampleBlockFormat::Int24LEToInt16:
+		C_ConvertSampleBlock<SC::ConversionChain<SC::Convert<int16, int32>, SC::DecodeInt24<0, littleEndian24>>>(src, static_cast<int16 *>(dst), count, dstStride);
+		break;
+	case SampleBlockFormat::Int24BEToInt16:
+		C_ConvertSampleBlock<SC::ConversionChain<SC::Convert<int16, int32>, SC::DecodeInt24<0, bigEndian24>>>(src, static_cast<int16 *>(dst), count, dstStride);
+		break;
+	case SampleBlockFormat::Int32LEToInt16:
+		C_ConvertSampleBlock<SC::ConversionChain<SC::Convert<int16, int32>, SC::DecodeInt32<0, littleEndian32>>>(src, static_cast<int16 *>(dst), count, dstStride);
+		break;
+	case SampleBlockFormat::Int32BEToInt16:
+		C_ConvertSampleBlock<SC::ConversionChain<SC::Convert<int16, int32>, SC::DecodeInt32<0, bigEndian32>>>(src, static_cast<int16 *>(dst), count, dstStride);
+		break;
+	case SampleBlockFormat::Float32LEToInt16:
+		C_ConvertSampleBlock<SC::ConversionChain<SC::Convert<int16, float32>, SC::DecodeFloat32<littleEndian32>>>(src, static_cast<int16 *>(dst), count, dstStride);
+		break;
+	case SampleBlockFormat::Float32BEToInt16:
+		C_ConvertSampleBlock<SC::ConversionChain<SC::Convert<int16, float32>, SC::DecodeFloat32<bigEndian32>>>(src, static_cast<int16 *>(dst), count, dstStride);
+		break;
+	}
+}
+
+
+static std::size_t GetInputSize(SampleBlockFormat format)
+{
+	switch(format)
+	{
+	case SampleBlockFormat::Int8:
+	case SampleBlockFormat::Uint8:
+		return 1;
+	case SampleBlockFormat::Int16LE:
+	case SampleBlockFormat::Int16BE:
+	case SampleBlockFormat::Uint16LE:
+	case SampleBlockFormat::Uint16BE:
+		return 2;
+	case SampleBlockFormat::Int24LEToInt16:
+	case SampleBlockFormat::Int24BEToInt16:
+		return 3;
+	case SampleBlockFormat::Int32LEToInt16:
+	case SampleBlockFormat::Int32BEToInt16:
+	case SampleBlockFormat::Float32LEToInt16:
+	case SampleBlockFormat::Float32BEToInt16:
+		return 4;
+	}
+	return 1;
+}
+
+
+static std::size_t GetOutputSize(SampleBlockFormat format)
+{
+	return (format == SampleBlockFormat::Int8 || format == SampleBlockFormat::Uint8) ? 1 : 2;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////
+// SSE2 Optimizations
+
+#ifdef ENABLE_SSE2
+
+// Swap the bytes of each 16-bit lane
+static MPT_FORCEINLINE __m128i SSE2_ByteSwap16(__m128i v)
+{
+	return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+
+// Swap the bytes of each 32-bit lane
+static MPT_FORCEINLINE __m128i SSE2_ByteSwap32(__m128i v)
+{
+	v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+	v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+	return SSE2_ByteSwap16(v);
+}
+
+
+// Convert eight 32-bit integers to int16 by taking their upper 16 bits
+static MPT_FORCEINLINE __m128i SSE2_Int32ToInt16(__m128i lo, __m128i hi)
+{
+	return _mm_packs_epi32(_mm_srai_epi32(lo, 16), _mm_srai_epi32(hi, 16));
+}
+
+
+// Same as SC::Convert<int16, float32> with MPT_SC_AVOID_ROUND, i.e. floor(x * 32768 + 0.5) with clipping
+static MPT_FORCEINLINE __m128i SSE2_FloatToInt32(__m128 v)
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 minusOne = _mm_set1_ps(-1.0f);
+	// With NaN as the first argument, maxps returns the second one, so NaN ends up as -32768 just like in the scalar conversion.
+	v = _mm_max_ps(v, minusOne);
+	v = _mm_min_ps(v, one);
+	v = _mm_add_ps(_mm_mul_ps(v, _mm_set1_ps(32768.0f)), _mm_set1_ps(0.5f));
+	__m128i truncated = _mm_cvttps_epi32(v);
+	// Truncation rounds towards zero, correct negative values to get floor()
+	__m128i correction = _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(truncated), v));
+	return _mm_add_epi32(truncated, correction);
+}
+
+
+static std::size_t SSE2_ConvertSampleBlock(SampleBlockFormat format, const std::byte *src, void *dst, std::size_t count)
+{
+	std::size_t done = 0;
+	switch(format)
+	{
+	case SampleBlockFormat::Uint8:
+	{
+		const __m128i signBit = _mm_set1_epi8(-128);
+		for(; done + 16 <= count; done += 16)
+		{
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + done));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(static_cast<int8 *>(dst) + done), _mm_xor_si128(v, signBit));
+		}
+		break;
+	}
+	case SampleBlockFormat::Int16BE:
+	case SampleBlockFormat::Uint16LE:
+	case SampleBlockFormat::Uint16BE:
+	{
+		const bool swap = (format != SampleBlockFormat::Uint16LE);
+		const __m128i signBit = _mm_set1_epi16((format == SampleBlockFormat::Int16BE) ? 0 : -32768);
+		for(; done + 8 <= count; done += 8)
+		{
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + done * 2));
+			if(swap)
+				v = SSE2_ByteSwap16(v);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(static_cast<int16 *>(dst) + done), _mm_xor_si128(v, signBit));
+		}
+		break;
+	}
+	case SampleBlockFormat::Int32LEToInt16:
+	case SampleBlockFormat::Int32BEToInt16:
+	{
+		const bool swap = (format == SampleBlockFormat::Int32BEToInt16);
+		for(; done + 8 <= count; done += 8)
+		{
+			__m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + done * 4));
+			__m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + done * 4 + 16));
+			if(swap)
+			{
+				lo = SSE2_ByteSwap32(lo);
+				hi = SSE2_ByteSwap32(hi);
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(static_cast<int16 *>(dst) + done), SSE2_Int32ToInt16(lo, hi));
+		}
+		break;
+	}
+	case SampleBlockFormat::Float32LEToInt16:
+	case SampleBlockFormat::Float32BEToInt16:
+	{
+		const bool swap = (format == SampleBlockFormat::Float32BEToInt16);
+		for(; done + 8 <= count; done += 8)
+		{
+			__m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + done * 4));
+			__m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + done * 4 + 16));
+			if(swap)
+			{
+				lo = SSE2_ByteSwap32(lo);
+				hi = SSE2_ByteSwap32(hi);
+			}
+			__m128i out = _mm_packs_epi32(SSE2_FloatToInt32(_mm_castsi128_ps(lo)), SSE2_FloatToInt32(_mm_castsi128_ps(hi)));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(static_cast<int16 *>(dst) + done), out);
+		}
+		break;
+	}
+	default:
+		// Plain copies are already handled well by the scalar code, and 24-bit gathering needs SSSE3 to be worthwhile.
+		break;
+	}
+	return done;
+}
+
+
+// Interleave two planar int16 blocks
+static std::size_t SSE2_InterleaveInt16(const int16 *left, const int16 *right, int16 *dst, std::size_t count)
+{
+	std::size_t done = 0;
+	for(; done + 8 <= count; done += 8)
+	{
+		__m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i *>(left + done));
+		__m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i *>(right + done));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + done * 2), _mm_unpacklo_epi16(l, r));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + done * 2 + 8), _mm_unpackhi_epi16(l, r));
+	}
+	return done;
+}
+
+#endif // ENABLE_SSE2
+
+
+void ConvertSampleBlock(SampleBlockFormat format, const std::byte *src, void *dst, std::size_t count)
+{
+	std::size_t done = 0;
+
+	#ifdef ENABLE_SSE2
+	if(CPU::HasFeatureSet(CPU::feature::sse2))
+	{
+		done = SSE2_ConvertSampleBlock(format, src, dst, count);
+	}
+	#endif // ENABLE_SSE2
+
+	C_ConvertSampleBlock(format, src + done * GetInputSize(format), static_cast<std::byte *>(dst) + done * GetOutputSize(format), count - done, 1);
+}
+
+
+void ConvertSampleBlockStereoSplit(SampleBlockFormat format, const std::byte *srcLeft, const std::byte *srcRight, void *dst, std::size_t count)
+{
+	#ifdef ENABLE_SSE2
+	if(CPU::HasFeatureSet(CPU::feature::sse2) && GetOutputSize(format) == 2)
+	{
+		// Convert planar data in cache-sized chunks, then interleave it
+		constexpr std::size_t chunkSize = 1024;
+		int16 left[chunkSize], right[chunkSize];
+		int16 *out = static_cast<int16 *>(dst);
+		const std::size_t inputSize = GetInputSize(format);
+		while(count > 0)
+		{
+			const std::size_t chunk = std::min(count, chunkSize);
+			ConvertSampleBlock(format, srcLeft, left, chunk);
+			ConvertSampleBlock(format, srcRight, right, chunk);
+			const std::size_t interleaved = SSE2_InterleaveInt16(left, right, out, chunk);
+			for(std::size_t i = interleaved; i < chunk; i++)
+			{
+				out[i * 2] = left[i];
+				out[i * 2 + 1] = right[i];
+			}
+			srcLeft += chunk * inputSize;
+			srcRight += chunk * inputSize;
+			out += chunk * 2;
+			count -= chunk;
+		}
+		return;
+	}
+	#endif // ENABLE_SSE2
+
+	C_ConvertSampleBlock(format, srcLeft, dst, count, 2);
+	C_ConvertSampleBlock(format, srcRight, static_cast<std::byte *>(dst) + GetOutputSize(format), count, 2);
+}
+
+
+OPENMPT_NAMESPACE_END
@@ -0,0 +1,74 @@
+/*
+ * SampleCopyLoops.h
+ * -----------------
+ * Purpose: Block-wise inner loops for converting raw sample data to ModSample storage.
+ * Notes  : The scalar sample conversion functors from SampleFormatConverters.h are the reference implementation.
+ *          The block converters produce exactly the same results, but may use vector instructions where available.
+ * Authors: OpenMPT Devs
+ * The OpenMPT source code is released under the BSD license. Read LICENSE for more details.
+ */
+
+
+#pragma once
+
+#include "BuildSettings.h"
+
+#include "../soundbase/SampleFormatConverters.h"
+
+
+OPENMPT_NAMESPACE_BEGIN
+
+
+// Source formats that have a block converter. All of them are stateless, i.e. every output sample only depends on its own input bytes.
+enum class SampleBlockFormat
+{
+	Int8,               // 8-bit signed -> int8
+	Uint8,              // 8-bit unsigned -> int8
+	Int16LE,            // 16-bit signed little-endian -> int16
+	Int16BE,            // 16-bit signed big-endian -> int16
+	Uint16LE,           // 16-bit unsigned little-endian -> int16
+	Uint16BE,           // 16-bit unsigned big-endian -> int16
+	Int24LEToInt16,     // 24-bit signed little-endian -> int16
+	Int24BEToInt16,     // 24-bit signed big-endian -> int16
+	Int32LEToInt16,     // 32-bit signed little-endian -> int16
+	Int32BEToInt16,     // 32-bit signed big-endian -> int16
+	Float32LEToInt16,   // 32-bit float little-endian -> int16
+	Float32BEToInt16,   // 32-bit float big-endian -> int16
+};
+
+
+// Convert count contiguous source samples to contiguous output samples.
+void ConvertSampleBlock(SampleBlockFormat format, const std::byte *src, void *dst, std::size_t count);
+// Convert two planar source channels of count samples each to interleaved stereo output.
+void ConvertSampleBlockStereoSplit(SampleBlockFormat format, const std::byte *srcLeft, const std::byte *srcRight, void *dst, std::size_t count);
+
+
+// Maps sample conversion functors to their block converter, if there is one.
+template <typename SampleConversion>
+struct SampleBlockConverter
+{
+	static constexpr bool available = false;
+};
+
+template <SampleBlockFormat blockFormat>
+struct SampleBlockConverterFor
+{
+	static constexpr bool available = true;
+	static constexpr SampleBlockFormat format = blockFormat;
+};
+
+template <> struct SampleBlockConverter<SC::DecodeInt8> : SampleBlockConverterFor<SampleBlockFormat::Int8> {};
+template <> struct SampleBlockConverter<SC::DecodeUint8> : SampleBlockConverterFor<SampleBlockFormat::Uint8> {};
+template <> struct SampleBlockConverter<SC::DecodeInt16<0, littleEndian16>> : SampleBlockConverterFor<SampleBlockFormat::Int16LE> {};
+template <> struct SampleBlockConverter<SC::DecodeInt16<0, bigEndian16>> : SampleBlockConverterFor<SampleBlockFormat::Int16BE> {};
+template <> struct SampleBlockConverter<SC::DecodeInt16<0x8000u, littleEndian16>> : SampleBlockConverterFor<SampleBlockFormat::Uint16LE> {};
+template <> struct SampleBlockConverter<SC::DecodeInt16<0x8000u, bigEndian16>> : SampleBlockConverterFor<SampleBlockFormat::Uint16BE> {};
+template <> struct SampleBlockConverter<SC::ConversionChain<SC::Convert<int16, int32>, SC::DecodeInt24<0, littleEndian24>>> : SampleBlockConverterFor<SampleBlockFormat::Int24LEToInt16> {};
+template <> struct SampleBlockConverter<SC::ConversionChain<SC::Convert<int16, int32>, SC::DecodeInt24<0, bigEndian24>>> : SampleBlockConverterFor<SampleBlockFormat::Int24BEToInt16> {};
+template <> struct SampleBlockConverter<SC::ConversionChain<SC::Convert<int16, int32>, SC::DecodeInt32<0, littleEndian32>>> : SampleBlockConverterFor<SampleBlockFormat::Int32LEToInt16> {};
+template <> struct SampleBlockConverter<SC::ConversionChain<SC::Convert<int16, int32>, SC::DecodeInt32<0, bigEndian32>>> : SampleBlockConverterFor<SampleBlockFormat::Int32BEToInt16> {};
+template <> struct SampleBlockConverter<SC::ConversionChain<SC::Convert<int16, float32>, SC::DecodeFloat32<littleEndian32>>> : SampleBlockConverterFor<SampleBlockFormat::Float32LEToInt16> {};
+template <> struct SampleBlockConverter<SC::ConversionChain<SC::Convert<int16, float32>, SC::DecodeFloat32<bigEndian32>>> : SampleBlockConverterFor<SampleBlockFormat::Float32BEToInt16> {};
+
+
+OPENMPT_NAMESPACE_END
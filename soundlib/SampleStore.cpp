@@ -0,0 +1,211 @@
+/*
+ * SampleStore.cpp
+ * ---------------
+ * Purpose: Process-wide store of sample data buffers, which allows identical samples to share their memory.
+ * Notes  : Buffers are looked up by a hash of their contents and reference-counted. Samples keep pointing directly
+ *          to the shared buffer, so playback does not need to know about the store.
+ * Authors: OpenMPT Devs
+ * The OpenMPT source code is released under the BSD license. Read LICENSE for more details.
+ */
+
+
+#include "stdafx.h"
+#include "SampleStore.h"
+#include "ModSample.h"
+#include "Mixer.h"
+#include "../common/mptCRC.h"
+#include "../common/mptMutex.h"
+
+#include <atomic>
+#include <map>
+
+
+OPENMPT_NAMESPACE_BEGIN
+
+
+namespace
+{
+
+struct StoreEntry
+{
+	uint64 hash = 0;
+	std::size_t size = 0;  // Size of the complete allocation, see ModSample::GetRealSampleBufferSize
+	SmpLength length = 0;
+	uint8 bytesPerSample = 0;
+	uint8 numChannels = 0;
+	uint32 refCount = 0;
+};
+
+struct StoreState
+{
+	mpt::mutex mutex;
+	std::map<const void *, StoreEntry> buffers;  // Indexed by sample data pointer (not the start of the allocation)
+	std::multimap<uint64, const void *> index;   // Content hash to sample data pointer
+	std::size_t size = 0;
+	std::size_t savedSize = 0;
+
+	void Remove(std::map<const void *, StoreEntry>::iterator it)
+	{
+		const auto range = index.equal_range(it->second.hash);
+		for(auto indexIt = range.first; indexIt != range.second; indexIt++)
+		{
+			if(indexIt->second == it->first)
+			{
+				index.erase(indexIt);
+				break;
+			}
+		}
+		size -= it->second.size;
+		buffers.erase(it);
+	}
+};
+
+StoreState &GetStoreState()
+{
+	static StoreState state;
+	return state;
+}
+
+// Number of buffers in the store, so that freeing or modifying samples does not need to lock the store if nothing was ever shared.
+std::atomic<std::size_t> s_numBuffers{0};
+
+
+// The sample buffer includes the lookahead area before the actual sample start (see ModSample::AllocateSample)
+const std::byte *GetAllocationStart(const void *sampleData)
+{
+	return static_cast<const std::byte *>(sampleData) - InterpolationMaxLookahead * MaxSamplingPointSize;
+}
+
+}  // namespace
+
+
+void SampleStore::Share(ModSample &sample)
+{
+	if(!sample.HasSampleData())
+		return;
+	const std::size_t size = ModSample::GetRealSampleBufferSize(sample.nLength, sample.GetBytesPerSample());
+	const std::byte *allocation = GetAllocationStart(sample.samplev());
+
+	mpt::checksum::crc64_jones crc;
+	crc(allocation, allocation + size);
+	const uint64 hash = crc.result();
+
+	void *ownData = sample.samplev();
+	{
+		StoreState &state = GetStoreState();
+		mpt::lock_guard<mpt::mutex> lock(state.mutex);
+		if(state.buffers.count(ownData))
+			return;
+
+		const auto range = state.index.equal_range(hash);
+		for(auto it = range.first; it != range.second; it++)
+		{
+			StoreEntry &entry = state.buffers.at(it->second);
+			if(entry.size == size && entry.length == sample.nLength && entry.bytesPerSample == sample.GetBytesPerSample() && entry.numChannels == sample.GetNumChannels()
+				&& !memcmp(GetAllocationStart(it->second), allocation, size))
+			{
+				entry.refCount++;
+				state.savedSize += size;
+				sample.pData.pSample = const_cast<void *>(it->second);
+				break;
+			}
+		}
+		if(sample.samplev() == ownData)
+		{
+			StoreEntry entry;
+			entry.hash = hash;
+			entry.size = size;
+			entry.length = sample.nLength;
+			entry.bytesPerSample = sample.GetBytesPerSample();
+			entry.numChannels = sample.GetNumChannels();
+			entry.refCount = 1;
+			state.buffers[ownData] = entry;
+			state.index.insert(std::make_pair(hash, ownData));
+			state.size += size;
+			s_numBuffers++;
+			return;
+		}
+	}
+	// Not freed while holding the lock, because FreeSample looks up the buffer in the store as well
+	ModSample::FreeSample(ownData);
+}
+
+
+bool SampleStore::MakeUnique(ModSample &sample)
+{
+	if(!s_numBuffers || !sample.HasSampleData())
+		return true;
+	StoreState &state = GetStoreState();
+	mpt::lock_guard<mpt::mutex> lock(state.mutex);
+	auto it = state.buffers.find(sample.samplev());
+	if(it == state.buffers.end())
+		return true;
+	StoreEntry &entry = it->second;
+	if(entry.refCount == 1)
+	{
+		// Nobody else uses this buffer, so the sample can simply take it back
+		state.Remove(it);
+		s_numBuffers--;
+		return true;
+	}
+
+	void *copy = ModSample::AllocateSample(sample.nLength, sample.GetBytesPerSample());
+	if(copy == nullptr)
+		return false;
+	memcpy(const_cast<std::byte *>(GetAllocationStart(copy)), GetAllocationStart(sample.samplev()), entry.size);
+	entry.refCount--;
+	state.savedSize -= entry.size;
+	sample.pData.pSample = copy;
+	return true;
+}
+
+
+bool SampleStore::Release(const void *sampleData)
+{
+	if(!s_numBuffers)
+		return false;
+	StoreState &state = GetStoreState();
+	mpt::lock_guard<mpt::mutex> lock(state.mutex);
+	auto it = state.buffers.find(sampleData);
+	if(it == state.buffers.end())
+		return false;
+	if(it->second.refCount > 1)
+	{
+		it->second.refCount--;
+		state.savedSize -= it->second.size;
+		return true;
+	}
+	state.Remove(it);
+	s_numBuffers--;
+	return false;
+}
+
+
+bool SampleStore::IsShared(const void *sampleData)
+{
+	if(!s_numBuffers)
+		return false;
+	StoreState &state = GetStoreState();
+	mpt::lock_guard<mpt::mutex> lock(state.mutex);
+	auto it = state.buffers.find(sampleData);
+	return it != state.buffers.end() && it->second.refCount > 1;
+}
+
+
+std::size_t SampleStore::GetSize()
+{
+	StoreState &state = GetStoreState();
+	mpt::lock_guard<mpt::mutex> lock(state.mutex);
+	return state.size;
+}
+
+
+std::size_t SampleStore::GetSavedSize()
+{
+	StoreState &state = GetStoreState();
+	mpt::lock_guard<mpt::mutex> lock(state.mutex);
+	return state.savedSize;
+}
+
+
+OPENMPT_NAMESPACE_END
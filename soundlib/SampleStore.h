@@ -0,0 +1,50 @@
+/*
+ * SampleStore.h
+ * -------------
+ * Purpose: Process-wide store of sample data buffers, which allows identical samples to share their memory.
+ * Notes  : Only samples of modules that opted in (CSoundFile::m_shareSamples) are added to the store.
+ *          It is shared between all CSoundFile instances and thus must be thread-safe.
+ * Authors: OpenMPT Devs
+ * The OpenMPT source code is released under the BSD license. Read LICENSE for more details.
+ */
+
+
+#pragma once
+
+#include "BuildSettings.h"
+
+#include "Snd_defs.h"
+
+
+OPENMPT_NAMESPACE_BEGIN
+
+
+struct ModSample;
+
+
+class SampleStore
+{
+public:
+	// Replace the sample's data by an identical buffer from the store, or add the sample's buffer to the store if there is none.
+	// Buffers are identical if the sample format and all of their contents, including the precomputed loop wrap-around buffers, match.
+	static void Share(ModSample &sample);
+
+	// Copy-on-write: Give the sample its own copy of a shared buffer. Must be called before modifying the sample data of a
+	// module that has shared samples. Returns false if the copy could not be allocated, in which case the data must not be modified.
+	static bool MakeUnique(ModSample &sample);
+
+	// Drop one reference to a sample buffer. Returns true if the buffer is in the store and still used by other samples,
+	// false if the caller owns the buffer and has to free it.
+	static bool Release(const void *sampleData);
+
+	// Check if the buffer is in the store and used by more than one sample.
+	static bool IsShared(const void *sampleData);
+
+	// Amount of memory in bytes used by buffers in the store.
+	static std::size_t GetSize();
+	// Amount of memory in bytes that would be used in addition to GetSize() if no buffers were shared.
+	static std::size_t GetSavedSize();
+};
+
+
+OPENMPT_NAMESPACE_END
@@ -0,0 +1,324 @@
+/*
+ * SampleStream.cpp
+ * ----------------
+ * Purpose: Playback of long compressed samples that are decoded while playing instead of while loading.
+ * Notes  : Only the parts of a streamed sample that are currently needed by the mixer are kept in memory.
+ *          Loop regions are decoded once and cached, so that looping does not require decoding the sample again.
+ * Authors: OpenMPT Devs
+ * The OpenMPT source code is released under the BSD license. Read LICENSE for more details.
+ */
+
+
+#include "stdafx.h"
+#include "SampleStream.h"
+#include "ModSample.h"
+#include "Mixer.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+OPENMPT_NAMESPACE_BEGIN
+
+
+// Frames around a loop that are needed for interpolating the loop boundaries
+static constexpr int32 LoopCacheMargin = InterpolationMaxLookahead + 1;
+
+
+SampleStream::SampleStream(std::unique_ptr<ISampleDecoder> decoder, const ModSample &sample)
+	: m_decoder(std::move(decoder))
+	, m_length(sample.nLength)
+	, m_bytesPerFrame(sample.GetBytesPerSample())
+{
+	BuildSeekPoints();
+}
+
+
+void SampleStream::BuildSeekPoints()
+{
+	std::unique_ptr<ISampleDecoder> decoder = m_decoder->Clone();
+	if(m_length <= SeekPointInterval || !decoder->CloneState())
+		return;
+	constexpr SmpLength scratchLength = 4096;
+	std::vector<std::byte> scratch(scratchLength * m_bytesPerFrame);
+	SmpLength pos = 0;
+	while(m_length - pos > SeekPointInterval)
+	{
+		const SmpLength target = pos + SeekPointInterval;
+		while(pos < target)
+		{
+			const SmpLength skipped = decoder->Skip(scratch.data(), std::min(scratchLength, target - pos));
+			if(skipped == 0)
+				return;
+			pos += skipped;
+		}
+		SeekPoint seekPoint;
+		seekPoint.position = pos;
+		seekPoint.decoder = decoder->CloneState();
+		if(!seekPoint.decoder)
+			return;
+		m_seekPoints.push_back(std::move(seekPoint));
+	}
+}
+
+
+SmpLength SampleStream::GetSeekPosition(SmpLength frame) const noexcept
+{
+	auto it = std::upper_bound(m_seekPoints.begin(), m_seekPoints.end(), frame, [](SmpLength f, const SeekPoint &seekPoint) { return f < seekPoint.position; });
+	return (it == m_seekPoints.begin()) ? 0 : std::prev(it)->position;
+}
+
+
+std::unique_ptr<ISampleDecoder> SampleStream::CreateDecoderAt(SmpLength frame, SmpLength &position) const
+{
+	auto it = std::upper_bound(m_seekPoints.begin(), m_seekPoints.end(), frame, [](SmpLength f, const SeekPoint &seekPoint) { return f < seekPoint.position; });
+	if(it != m_seekPoints.begin())
+	{
+		--it;
+		if(auto decoder = it->decoder->CloneState())
+		{
+			position = it->position;
+			return decoder;
+		}
+	}
+	position = 0;
+	return m_decoder->Clone();
+}
+
+
+void SampleStream::PrepareDecoder(std::unique_ptr<ISampleDecoder> &decoder, SmpLength &decodedPos, int32 start) const
+{
+	const SmpLength decodeStart = static_cast<SmpLength>(std::max(start, int32(0)));
+	if(decoder && decodeStart >= m_length)
+		return;  // Nothing to decode
+	if(!decoder || decodeStart < decodedPos || GetSeekPosition(decodeStart) > decodedPos)
+	{
+		// The decoder is already past the requested position, or jumping to a seek point is quicker than skipping
+		decoder = CreateDecoderAt(decodeStart, decodedPos);
+	}
+}
+
+
+void SampleStream::UpdateLoopCache(const ModSample &sample)
+{
+	m_cache.clear();
+
+	std::vector<CachedRegion> regions;
+	const auto addRegion = [&](SmpLength start, SmpLength end, bool sustainLoop)
+	{
+		if(end - start > MaxCachedLoopLength)
+			return;
+		CachedRegion region;
+		region.start = static_cast<int32>(start) - LoopCacheMargin;
+		region.length = end - start + 2 * LoopCacheMargin;
+		region.sustainLoop = sustainLoop;
+		region.lookahead.resize(4 * InterpolationMaxLookahead * m_bytesPerFrame);
+		regions.push_back(std::move(region));
+	};
+	if(sample.HasLoop())
+		addRegion(sample.nLoopStart, sample.nLoopEnd, false);
+	if(sample.HasSustainLoop())
+		addRegion(sample.nSustainStart, sample.nSustainEnd, true);
+	if(regions.empty())
+		return;
+
+	// Decode all regions in a single pass if possible
+	std::sort(regions.begin(), regions.end(), [](const CachedRegion &l, const CachedRegion &r) { return l.start < r.start; });
+	std::unique_ptr<ISampleDecoder> decoder;
+	SmpLength decodedPos = 0;
+	for(auto &region : regions)
+	{
+		region.data.resize(region.length * m_bytesPerFrame);
+		PrepareDecoder(decoder, decodedPos, region.start);
+		Fill(*decoder, decodedPos, region.data.data(), region.start, region.length);
+		HoldEdges(region.data.data(), region.start, region.length);
+	}
+	m_cache = std::move(regions);
+}
+
+
+const SampleStream::CachedRegion *SampleStream::FindLoop(bool sustainLoop) const noexcept
+{
+	for(const auto &region : m_cache)
+	{
+		if(region.sustainLoop == sustainLoop)
+			return &region;
+	}
+	return nullptr;
+}
+
+
+const std::byte *SampleStream::GetCachedLoop(bool sustainLoop) const noexcept
+{
+	const CachedRegion *region = FindLoop(sustainLoop);
+	return region ? region->data.data() + LoopCacheMargin * m_bytesPerFrame : nullptr;
+}
+
+
+const std::byte *SampleStream::GetLoopLookahead(bool sustainLoop) const noexcept
+{
+	const CachedRegion *region = FindLoop(sustainLoop);
+	return region ? region->lookahead.data() : nullptr;
+}
+
+
+std::byte *SampleStream::GetLoopLookahead(bool sustainLoop) noexcept
+{
+	return const_cast<std::byte *>(static_cast<const SampleStream *>(this)->GetLoopLookahead(sustainLoop));
+}
+
+
+std::size_t SampleStream::GetCacheSize() const noexcept
+{
+	std::size_t size = 0;
+	for(const auto &region : m_cache)
+	{
+		size += region.data.size() + region.lookahead.size();
+	}
+	return size;
+}
+
+
+bool SampleStream::Fill(ISampleDecoder &decoder, SmpLength &decodedPos, std::byte *dest, int32 start, SmpLength count) const
+{
+	const int64 end = static_cast<int64>(start) + count;
+	const int64 decodeStart = std::max(int64(0), static_cast<int64>(start));
+	const int64 decodeEnd = std::min(static_cast<int64>(m_length), end);
+	if(decodeStart < decodeEnd && decodeStart < static_cast<int64>(decodedPos))
+		return false;
+
+	std::byte *out = dest;
+	// Silence before the sample start
+	if(start < 0)
+	{
+		const SmpLength silence = static_cast<SmpLength>(std::min(end, int64(0)) - start);
+		std::memset(out, 0, silence * m_bytesPerFrame);
+		out += silence * m_bytesPerFrame;
+	}
+	if(decodeStart < decodeEnd)
+	{
+		bool endOfData = false;
+		// Skip over frames in front of the requested range, using the destination buffer as scratch space
+		while(static_cast<int64>(decodedPos) < decodeStart)
+		{
+			const SmpLength skip = static_cast<SmpLength>(std::min(static_cast<int64>(count), decodeStart - decodedPos));
+			const SmpLength skipped = decoder.Skip(out, skip);
+			if(skipped == 0)
+			{
+				endOfData = true;
+				break;
+			}
+			decodedPos += skipped;
+		}
+		SmpLength remain = static_cast<SmpLength>(decodeEnd - decodeStart);
+		while(remain > 0 && !endOfData)
+		{
+			const SmpLength decoded = decoder.Decode(out, remain);
+			if(decoded == 0)
+				break;
+			decodedPos += decoded;
+			out += decoded * m_bytesPerFrame;
+			remain -= decoded;
+		}
+	}
+	// Silence after the sample end, or if the encoded data ended prematurely
+	std::memset(out, 0, (dest + count * m_bytesPerFrame) - out);
+	return true;
+}
+
+
+void SampleStream::HoldEdges(std::byte *data, int32 start, SmpLength count) const
+{
+	const int64 end = static_cast<int64>(start) + count;
+	if(start < 0 && end > 0)
+	{
+		const std::byte *first = data + (0 - start) * m_bytesPerFrame;
+		for(std::byte *frame = data; frame != first; frame += m_bytesPerFrame)
+		{
+			std::memcpy(frame, first, m_bytesPerFrame);
+		}
+	}
+	if(m_length > 0 && end > m_length && start < static_cast<int64>(m_length))
+	{
+		const std::byte *last = data + (m_length - 1 - start) * m_bytesPerFrame;
+		for(std::byte *frame = data + (m_length - start) * m_bytesPerFrame; frame != data + count * m_bytesPerFrame; frame += m_bytesPerFrame)
+		{
+			std::memcpy(frame, last, m_bytesPerFrame);
+		}
+	}
+}
+
+
+void SampleStreamCursor::Reset()
+{
+	m_stream.reset();
+	m_decoder.reset();
+	m_decodedPos = 0;
+	m_windowStart = 0;
+	m_windowLength = 0;
+}
+
+
+const std::byte *SampleStreamCursor::Prepare(const std::shared_ptr<const SampleStream> &stream, int32 first, int32 last, int32 &base)
+{
+	MPT_ASSERT(stream != nullptr && first < last);
+	if(stream != m_stream)
+	{
+		Reset();
+		m_stream = stream;
+	}
+
+	for(const auto &region : stream->m_cache)
+	{
+		if(first >= region.start && static_cast<int64>(last) <= static_cast<int64>(region.start) + region.length)
+		{
+			base = region.start;
+			return region.data.data();
+		}
+	}
+
+	if(m_windowLength && first >= m_windowStart && static_cast<int64>(last) <= static_cast<int64>(m_windowStart) + m_windowLength)
+	{
+		base = m_windowStart;
+		return m_window.data();
+	}
+
+	const uint8 bytesPerFrame = stream->GetBytesPerFrame();
+	const SmpLength capacity = std::max(WindowLength, static_cast<SmpLength>(last - first));
+	if(m_window.size() < capacity * bytesPerFrame)
+	{
+		m_window.resize(capacity * bytesPerFrame);
+	}
+
+	int32 newStart;
+	SmpLength keep = 0;
+	if(m_windowLength && first >= m_windowStart)
+	{
+		// Moving forward: Keep whatever is still needed from the current window.
+		newStart = first;
+		const int64 windowEnd = static_cast<int64>(m_windowStart) + m_windowLength;
+		if(newStart < windowEnd)
+		{
+			keep = static_cast<SmpLength>(windowEnd - newStart);
+			std::memmove(m_window.data(), m_window.data() + (newStart - m_windowStart) * bytesPerFrame, keep * bytesPerFrame);
+		}
+	} else
+	{
+		// Moving backwards or jumping: Place the window such that it also covers the following frames if the channel keeps moving in the same direction.
+		newStart = std::max(static_cast<int32>(last - capacity), std::min(first, int32(0)));
+	}
+
+	std::byte *fillDest = m_window.data() + keep * bytesPerFrame;
+	const int32 fillStart = static_cast<int32>(newStart + keep);
+	stream->PrepareDecoder(m_decoder, m_decodedPos, fillStart);
+	stream->Fill(*m_decoder, m_decodedPos, fillDest, fillStart, capacity - keep);
+	stream->HoldEdges(m_window.data(), newStart, capacity);
+	m_windowStart = newStart;
+	m_windowLength = capacity;
+
+	base = m_windowStart;
+	return m_window.data();
+}
+
+
+OPENMPT_NAMESPACE_END
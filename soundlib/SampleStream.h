@@ -0,0 +1,145 @@
+/*
+ * SampleStream.h
+ * --------------
+ * Purpose: Playback of long compressed samples that are decoded while playing instead of while loading.
+ * Notes  : Only the parts of a streamed sample that are currently needed by the mixer are kept in memory.
+ *          Loop regions are decoded once and cached, so that looping does not require decoding the sample again.
+ * Authors: OpenMPT Devs
+ * The OpenMPT source code is released under the BSD license. Read LICENSE for more details.
+ */
+
+
+#pragma once
+
+#include "BuildSettings.h"
+
+#include "Snd_defs.h"
+
+#include <memory>
+#include <vector>
+
+
+OPENMPT_NAMESPACE_BEGIN
+
+
+struct ModSample;
+
+
+// Decodes a sample sequentially from its start.
+// Decoded frames are interleaved and in the sample's storage format (8-bit or 16-bit, mono or stereo).
+class ISampleDecoder
+{
+public:
+	virtual ~ISampleDecoder() = default;
+
+	// Create an independent decoder for the same sample, positioned at the sample start.
+	virtual std::unique_ptr<ISampleDecoder> Clone() const = 0;
+	// Decode up to count frames into dest. Returns the number of frames decoded, 0 if the end of the encoded data has been reached.
+	virtual SmpLength Decode(void *dest, SmpLength count) = 0;
+	// Skip up to count frames. scratch can hold count frames and may be used as temporary decoding space. Returns the number of frames skipped.
+	virtual SmpLength Skip(void *scratch, SmpLength count) { return Decode(scratch, count); }
+	// Create an independent decoder at the current position of this decoder, or nullptr if the decoder state cannot be copied.
+	// Samples whose decoder supports this get seek points, so that playback can jump backwards without decoding from the sample start again.
+	virtual std::unique_ptr<ISampleDecoder> CloneState() const { return nullptr; }
+};
+
+
+// The shared part of a streamed sample: The decoder from which all channels playing this sample start, and the decoded loop regions.
+class SampleStream
+{
+public:
+	// Loop regions longer than this are not cached, playing them requires decoding the sample again on every loop iteration,
+	// and their loop boundaries are interpolated with the data following the loop end instead of using a wrap-around buffer.
+	static constexpr SmpLength MaxCachedLoopLength = 1u << 18;
+	// Distance between two seek points in frames
+	static constexpr SmpLength SeekPointInterval = 1u << 17;
+
+	SampleStream(std::unique_ptr<ISampleDecoder> decoder, const ModSample &sample);
+
+	// Decode and cache the loop regions of the sample. Must be called whenever the sample's loop points change.
+	void UpdateLoopCache(const ModSample &sample);
+
+	// Decoded data of a cached loop, starting at the loop start. nullptr if the loop is not cached.
+	const std::byte *GetCachedLoop(bool sustainLoop) const noexcept;
+	// Loop wrap-around buffer of a cached loop (see ModSample::PrecomputeLoops). nullptr if the loop is not cached.
+	const std::byte *GetLoopLookahead(bool sustainLoop) const noexcept;
+	std::byte *GetLoopLookahead(bool sustainLoop) noexcept;
+
+	// Create a decoder positioned at the sample start, e.g. for reading through the complete sample once.
+	std::unique_ptr<ISampleDecoder> CreateDecoder() const { return m_decoder->Clone(); }
+	// Create a decoder positioned at the last seek point at or before frame. position receives the position of the new decoder.
+	std::unique_ptr<ISampleDecoder> CreateDecoderAt(SmpLength frame, SmpLength &position) const;
+	// Position of the last seek point at or before frame (0 if there is none).
+	SmpLength GetSeekPosition(SmpLength frame) const noexcept;
+	std::size_t GetNumSeekPoints() const noexcept { return m_seekPoints.size(); }
+
+	SmpLength GetLength() const noexcept { return m_length; }
+	uint8 GetBytesPerFrame() const noexcept { return m_bytesPerFrame; }
+
+	// Amount of memory used by decoded sample data, not including any channel windows.
+	std::size_t GetCacheSize() const noexcept;
+
+protected:
+	friend class SampleStreamCursor;
+
+	struct CachedRegion
+	{
+		int32 start = 0;  // First frame of the region, may be negative
+		SmpLength length = 0;
+		bool sustainLoop = false;
+		std::vector<std::byte> data;
+		std::vector<std::byte> lookahead;
+	};
+
+	struct SeekPoint
+	{
+		SmpLength position = 0;
+		std::unique_ptr<ISampleDecoder> decoder;  // Only ever copied with CloneState, never used for decoding itself
+	};
+
+	const CachedRegion *FindLoop(bool sustainLoop) const noexcept;
+	// Walk through the whole sample once and remember the decoder state every SeekPointInterval frames, if the decoder supports it.
+	void BuildSeekPoints();
+	// Make sure that decoder can fill frames starting at frame start with Fill, replacing it with a decoder at a closer seek point if possible.
+	void PrepareDecoder(std::unique_ptr<ISampleDecoder> &decoder, SmpLength &decodedPos, int32 start) const;
+
+	// Fill count frames starting at frame start into dest. Frames that lie outside of the sample are silent.
+	// The decoder must be positioned at frame decodedPos, which is updated accordingly. Returns false if the decoder needs to be reset first.
+	bool Fill(ISampleDecoder &decoder, SmpLength &decodedPos, std::byte *dest, int32 start, SmpLength count) const;
+	// Like ModSample::PrecomputeLoops, hold the first and last sampling point outside of the sample, if they are part of the count frames starting at frame start.
+	void HoldEdges(std::byte *data, int32 start, SmpLength count) const;
+
+	std::unique_ptr<ISampleDecoder> m_decoder;
+	std::vector<SeekPoint> m_seekPoints;
+	std::vector<CachedRegion> m_cache;
+	SmpLength m_length = 0;
+	uint8 m_bytesPerFrame = 1;
+};
+
+
+// The per-channel part of a streamed sample: A window of decoded frames around the channel's play position.
+class SampleStreamCursor
+{
+public:
+	// Capacity of the decoded window in frames. This must be large enough to hold one mixer chunk (see MixLoopState::maxSamples) plus interpolation lookahead.
+	static constexpr SmpLength WindowLength = 32768;
+
+	// Make frames [first, last) of the stream available. Returns a pointer to the frame at position base, which is at most first.
+	const std::byte *Prepare(const std::shared_ptr<const SampleStream> &stream, int32 first, int32 last, int32 &base);
+
+	// Decoded memory used by this cursor in bytes.
+	std::size_t GetMemoryUsage() const noexcept { return m_window.size(); }
+
+	void Reset();
+
+protected:
+	std::shared_ptr<const SampleStream> m_stream;
+	std::unique_ptr<ISampleDecoder> m_decoder;
+	SmpLength m_decodedPos = 0;
+	std::vector<std::byte> m_window;
+	int32 m_windowStart = 0;
+	SmpLength m_windowLength = 0;
+};
+
+
+OPENMPT_NAMESPACE_END
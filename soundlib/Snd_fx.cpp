@@ -110,7 +110,6 @@ public:
 		}
 
 		const SmpLength sampleEnd = chn.dwFlags[CHN_LOOP] ? chn.nLoopEnd : chn.nLength;
-		const SmpLength loopLength = chn.nLoopEnd - chn.nLoopStart;
 		const bool itEnvMode = sndFile.m_playBehaviour[kITEnvelopePositionHandling];
 		const bool updatePitchEnv = (chn.PitchEnv.flags & (ENV_ENABLED | ENV_FILTER)) == ENV_ENABLED;
 		bool stopNote = false;
@@ -120,6 +119,19 @@ public:
 
 		for(uint32 i = 0; i < numTicks; i++)
 		{
+			if(!updatePitchEnv && !chnSettings[channel].incChanged && i < portaStart)
+			{
+				// Nothing can change the sample increment until the next portamento tick, so skip ahead in one go.
+				uint32 spanTicks = std::min(numTicks, portaStart) - i;
+				if(!chn.dwFlags[CHN_ADLIB])
+					spanTicks = AdvanceSamplePosition(chn, inc, sampleEnd, spanTicks, stopNote);
+				AdvanceEnvelopes(chn, spanTicks);
+				if(stopNote)
+					break;
+				i += spanTicks - 1;
+				continue;
+			}
+
 			bool updateInc = (chn.PitchEnv.flags & (ENV_ENABLED | ENV_FILTER)) == ENV_ENABLED;
 			if(i >= portaStart)
 			{
@@ -170,55 +182,10 @@ public:
 				if(chn.dwFlags[CHN_PINGPONGFLAG]) inc.Negate();
 			}
 
-			chn.position += inc;
-
-			if(chn.position.GetUInt() >= sampleEnd)
+			if(!IncrementSamplePosition(chn, inc, sampleEnd))
 			{
-				if(chn.dwFlags[CHN_LOOP])
-				{
-					// We exceeded the sample loop, go back to loop start.
-					if(chn.dwFlags[CHN_PINGPONGLOOP])
-					{
-						if(chn.position < SamplePosition(chn.nLoopStart, 0))
-						{
-							chn.position = SamplePosition(chn.nLoopStart + chn.nLoopStart, 0) - chn.position;
-							chn.dwFlags.flip(CHN_PINGPONGFLAG);
-							inc.Negate();
-						}
-						SmpLength posInt = chn.position.GetUInt() - chn.nLoopStart;
-						SmpLength pingpongLength = loopLength * 2;
-						if(sndFile.m_playBehaviour[kITPingPongMode]) pingpongLength--;
-						posInt %= pingpongLength;
-						bool forward = (posInt < loopLength);
-						if(forward)
-							chn.position.SetInt(chn.nLoopStart + posInt);
-						else
-							chn.position.SetInt(chn.nLoopEnd - (posInt - loopLength));
-						if(forward == chn.dwFlags[CHN_PINGPONGFLAG])
-						{
-							chn.dwFlags.flip(CHN_PINGPONGFLAG);
-							inc.Negate();
-						}
-					} else
-					{
-						SmpLength posInt = chn.position.GetUInt();
-						if(posInt >= chn.nLoopEnd + loopLength)
-						{
-							const SmpLength overshoot = posInt - chn.nLoopEnd;
-							posInt -= (overshoot / loopLength) * loopLength;
-						}
-						while(posInt >= chn.nLoopEnd)
-						{
-							posInt -= loopLength;
-						}
-						chn.position.SetInt(posInt);
-					}
-				} else
-				{
-					// Past sample end.
-					stopNote = true;
-					break;
-				}
+				stopNote = true;
+				break;
 			}
 		}
 
@@ -229,6 +196,133 @@ public:
 		}
 		chnSettings[channel].ticksToRender = 0;
 	}
+
+protected:
+	// Advance sample position by one tick. Returns false if the end of the sample has been reached.
+	bool IncrementSamplePosition(ModChannel &chn, SamplePosition &inc, SmpLength sampleEnd) const
+	{
+		chn.position += inc;
+
+		if(chn.position.GetUInt() < sampleEnd)
+			return true;
+		if(!chn.dwFlags[CHN_LOOP])
+			return false;  // Past sample end.
+
+		// We exceeded the sample loop, go back to loop start.
+		const SmpLength loopLength = chn.nLoopEnd - chn.nLoopStart;
+		if(chn.dwFlags[CHN_PINGPONGLOOP])
+		{
+			if(chn.position < SamplePosition(chn.nLoopStart, 0))
+			{
+				chn.position = SamplePosition(chn.nLoopStart + chn.nLoopStart, 0) - chn.position;
+				chn.dwFlags.flip(CHN_PINGPONGFLAG);
+				inc.Negate();
+			}
+			SmpLength posInt = chn.position.GetUInt() - chn.nLoopStart;
+			SmpLength pingpongLength = loopLength * 2;
+			if(sndFile.m_playBehaviour[kITPingPongMode]) pingpongLength--;
+			posInt %= pingpongLength;
+			bool forward = (posInt < loopLength);
+			if(forward)
+				chn.position.SetInt(chn.nLoopStart + posInt);
+			else
+				chn.position.SetInt(chn.nLoopEnd - (posInt - loopLength));
+			if(forward == chn.dwFlags[CHN_PINGPONGFLAG])
+			{
+				chn.dwFlags.flip(CHN_PINGPONGFLAG);
+				inc.Negate();
+			}
+		} else
+		{
+			SmpLength posInt = chn.position.GetUInt();
+			if(posInt >= chn.nLoopEnd + loopLength)
+			{
+				const SmpLength overshoot = posInt - chn.nLoopEnd;
+				posInt -= (overshoot / loopLength) * loopLength;
+			}
+			while(posInt >= chn.nLoopEnd)
+			{
+				posInt -= loopLength;
+			}
+			chn.position.SetInt(posInt);
+		}
+		return true;
+	}
+
+	// Advance sample position by up to numTicks ticks with a constant increment.
+	// Instead of stepping through every tick, the position jumps straight to the next tick at which the sample or loop end is crossed.
+	// Once inside a forward loop, the remaining ticks are resolved in closed form.
+	// Returns the number of ticks that have been rendered, which is less than numTicks if the end of the sample has been reached.
+	uint32 AdvanceSamplePosition(ModChannel &chn, SamplePosition &inc, SmpLength sampleEnd, uint32 numTicks, bool &stopNote) const
+	{
+		const int64 end = static_cast<int64>(sampleEnd) << 32;
+		const bool forwardLoop = chn.dwFlags[CHN_LOOP] && !chn.dwFlags[CHN_PINGPONGLOOP] && chn.nLoopEnd > chn.nLoopStart;
+		uint32 ticksRendered = 0;
+		while(ticksRendered < numTicks)
+		{
+			const int64 pos = chn.position.GetRaw(), step = inc.GetRaw();
+			const uint32 remaining = numTicks - ticksRendered;
+
+			// Number of ticks after which the position is out of the [0, sampleEnd[ range
+			uint64 ticksToEnd = uint64_max;
+			if(pos + step < 0 || pos + step >= end)
+				ticksToEnd = 1;
+			else if(step > 0)
+				ticksToEnd = static_cast<uint64>((end - pos + step - 1) / step);
+			else if(step < 0)
+				ticksToEnd = static_cast<uint64>(pos / -step) + 1;
+
+			if(ticksToEnd > remaining)
+			{
+				chn.position = SamplePosition(pos + step * remaining);
+				return numTicks;
+			}
+
+			chn.position = SamplePosition(pos + step * static_cast<int64>(ticksToEnd - 1));
+			ticksRendered += static_cast<uint32>(ticksToEnd);
+			if(!IncrementSamplePosition(chn, inc, sampleEnd))
+			{
+				stopNote = true;
+				return ticksRendered;
+			}
+
+			if(forwardLoop && step >= 0 && ticksRendered < numTicks)
+			{
+				// The position is now inside the loop and stays there, so the remaining ticks just advance it modulo the loop length.
+				// The fractional part is carried separately to avoid overflowing the 32.32 fixed-point range.
+				const uint64 loopTicks = numTicks - ticksRendered;
+				const uint64 loopLength = chn.nLoopEnd - chn.nLoopStart;
+				const uint64 fract = chn.position.GetFract() + loopTicks * static_cast<uint32>(step);
+				uint64 posInt = chn.position.GetUInt() - chn.nLoopStart;
+				posInt += ((loopTicks % loopLength) * ((static_cast<uint64>(step) >> 32) % loopLength)) % loopLength;
+				posInt += (fract >> 32) % loopLength;
+				chn.position.Set(static_cast<int32>(chn.nLoopStart + posInt % loopLength), static_cast<uint32>(fract));
+				return numTicks;
+			}
+		}
+		return numTicks;
+	}
+
+	// Increment envelope positions and instrument fade-out by numTicks ticks. The pitch envelope must not be active.
+	void AdvanceEnvelopes(ModChannel &chn, uint32 numTicks) const
+	{
+		if(chn.pModInstrument == nullptr)
+			return;
+		if(chn.VolEnv.flags[ENV_ENABLED] || chn.PanEnv.flags[ENV_ENABLED] || chn.PitchEnv.flags[ENV_ENABLED])
+		{
+			for(uint32 i = 0; i < numTicks; i++)
+			{
+				sndFile.IncrementEnvelopePositions(chn);
+				int vol = 0;
+				sndFile.ProcessInstrumentFade(chn, vol);
+			}
+		} else if(chn.dwFlags[CHN_NOTEFADE] && chn.pModInstrument->nFadeOut)
+		{
+			// Without envelopes, nothing else can change during these ticks
+			const int64 fadeOutVol = chn.nFadeOutVol - static_cast<int64>(chn.pModInstrument->nFadeOut) * 2 * numTicks;
+			chn.nFadeOutVol = static_cast<int32>(std::max(fadeOutVol, int64(0)));
+		}
+	}
 };
 
 
@@ -912,6 +1006,13 @@ std::vector<GetLengthType> CSoundFile::GetLength(enmGetLengthResetMode adjustMod
 				const ModCommand &m = chn.rowCommand;
 				if(!chn.nPeriod && m.IsEmpty())
 					continue;
+				if(m.IsEmpty() && (oldTickDuration == tickDuration || oldTickDuration == 0))
+				{
+					// Nothing happens on this row, the sample just keeps playing
+					chn.isFirstTick = true;
+					memory.chnSettings[nChn].ticksToRender += numTicks;
+					continue;
+				}
 
 				uint32 paramHi = m.param >> 4, paramLo = m.param & 0x0F;
 				uint32 startTick = 0;
@@ -1337,7 +1438,7 @@ void CSoundFile::InstrumentChange(ModChannel &chn, uint32 instr, bool bPorta, bo
 	}
 
 	// Update Volume
-	if (bUpdVol && (!(GetType() & (MOD_TYPE_MOD | MOD_TYPE_S3M)) || ((pSmp != nullptr && pSmp->HasSampleData()) || chn.HasMIDIOutput())))
+	if (bUpdVol && (!(GetType() & (MOD_TYPE_MOD | MOD_TYPE_S3M)) || ((pSmp != nullptr && pSmp->HasPlayableData()) || chn.HasMIDIOutput())))
 	{
 		if(pSmp)
 		{
@@ -1360,7 +1461,7 @@ void CSoundFile::InstrumentChange(ModChannel &chn, uint32 instr, bool bPorta, bo
 			chn.nFineTune = pSmp->nFineTune;
 		// ST3 does it similarly for middle-C speed.
 		// Test case: PortaSwap.s3m, SampleSwap.s3m
-		if(GetType() == MOD_TYPE_S3M && pSmp->HasSampleData())
+		if(GetType() == MOD_TYPE_S3M && pSmp->HasPlayableData())
 			chn.nC5Speed = pSmp->nC5Speed;
 	}
 
@@ -2038,6 +2139,109 @@ CHANNELINDEX CSoundFile::GetNNAChannel(CHANNELINDEX nChn) const
 }
 
 
+// Same choice as GetNNAChannel, but while the pattern effects of a tick are processed, the background channels are only examined once
+// and then taken from m_nnaChannelCache, so that many new notes on the same tick do not have to scan all background channels each.
+CHANNELINDEX CSoundFile::AllocateNNAChannel(CHANNELINDEX nChn)
+{
+	NNAChannelCache &cache = m_nnaChannelCache;
+	// OPL voices can stop on their own at any time, so there is nothing to cache.
+	if(!cache.active || m_opl)
+		return GetNNAChannel(nChn);
+
+	if(!cache.valid || cache.candidates.size() >= MAX_CHANNELS * 2)
+	{
+		RebuildNNAChannelCache();
+	} else
+	{
+		for(std::size_t word = 0; word < cache.dirtyChannels.size(); word++)
+		{
+			while(cache.dirtyChannels[word])
+			{
+				const CHANNELINDEX chn = static_cast<CHANNELINDEX>(word * 64 + mpt::countr_zero(cache.dirtyChannels[word]));
+				cache.dirtyChannels[word] &= cache.dirtyChannels[word] - 1;
+				if(ExamineNNAChannel(chn))
+					std::push_heap(cache.candidates.begin(), cache.candidates.end());
+			}
+		}
+	}
+
+	CHANNELINDEX result = NNAChannelCache::FirstChannel(cache.freeChannels);
+	if(result == CHANNELINDEX_INVALID)
+	{
+		uint32 vol = 0x800000;
+		if(nChn < MAX_CHANNELS)
+		{
+			const ModChannel &srcChn = m_PlayState.Chn[nChn];
+			if(!srcChn.nFadeOutVol && srcChn.nLength)
+				return CHANNELINDEX_INVALID;
+			vol = (srcChn.nRealVolume << 9) | srcChn.nVolume;
+		}
+		result = NNAChannelCache::FirstChannel(cache.cutChannels);
+		if(result == CHANNELINDEX_INVALID)
+		{
+			while(!cache.candidates.empty() && cache.candidates.front().generation != cache.generation[cache.candidates.front().channel])
+			{
+				std::pop_heap(cache.candidates.begin(), cache.candidates.end());
+				cache.candidates.pop_back();
+			}
+			if(!cache.candidates.empty())
+			{
+				const auto &best = cache.candidates.front();
+				if(best.volume < vol || (best.volume == vol && best.envPos > 0))
+					result = best.channel;
+			}
+		}
+	}
+	// The chosen channel receives the new voice and a background source channel is stopped
+	cache.Invalidate(result);
+	if(nChn >= GetNumChannels())
+		cache.Invalidate(nChn);
+	return result;
+}
+
+
+void CSoundFile::RebuildNNAChannelCache()
+{
+	NNAChannelCache &cache = m_nnaChannelCache;
+	cache.freeChannels.fill(0);
+	cache.cutChannels.fill(0);
+	cache.dirtyChannels.fill(0);
+	cache.candidates.clear();
+	for(CHANNELINDEX i = GetNumChannels(); i < MAX_CHANNELS; i++)
+	{
+		ExamineNNAChannel(i);
+	}
+	std::make_heap(cache.candidates.begin(), cache.candidates.end());
+	cache.valid = true;
+}
+
+
+// Puts a background channel into the category in which GetNNAChannel would consider it.
+// Returns true if the channel was appended to the candidates, in which case the caller has to restore the heap order.
+bool CSoundFile::ExamineNNAChannel(CHANNELINDEX chn)
+{
+	NNAChannelCache &cache = m_nnaChannelCache;
+	const ModChannel &c = m_PlayState.Chn[chn];
+	cache.generation[chn]++;
+	NNAChannelCache::ResetChannel(cache.freeChannels, chn);
+	NNAChannelCache::ResetChannel(cache.cutChannels, chn);
+	if((!c.nLength && (!c.HasMIDIOutput() || c.dwFlags[CHN_KEYOFF | CHN_NOTEFADE])) || c.dwFlags[CHN_ADLIB])
+	{
+		NNAChannelCache::SetChannel(cache.freeChannels, chn);
+		return false;
+	} else if(c.nLength && !c.nFadeOutVol)
+	{
+		NNAChannelCache::SetChannel(cache.cutChannels, chn);
+		return false;
+	}
+	uint32 v = (c.nRealVolume << 9) | c.nVolume;
+	if(c.dwFlags[CHN_LOOP])
+		v /= 2;
+	cache.candidates.push_back({v, c.VolEnv.nEnvPosition, cache.generation[chn], chn});
+	return true;
+}
+
+
 CHANNELINDEX CSoundFile::CheckNNA(CHANNELINDEX nChn, uint32 instr, int note, bool forceCut)
 {
 	ModChannel &srcChn = m_PlayState.Chn[nChn];
@@ -2051,12 +2255,15 @@ CHANNELINDEX CSoundFile::CheckNNA(CHANNELINDEX nChn, uint32 instr, int note, boo
 		if(!srcChn.nLength || srcChn.dwFlags[CHN_MUTE] || !(srcChn.rightVol | srcChn.leftVol))
 			return CHANNELINDEX_INVALID;
 
-		const CHANNELINDEX nnaChn = GetNNAChannel(nChn);
+		const CHANNELINDEX nnaChn = AllocateNNAChannel(nChn);
 		if(nnaChn == CHANNELINDEX_INVALID)
 			return CHANNELINDEX_INVALID;
 		ModChannel &chn = m_PlayState.Chn[nnaChn];
 		// Copy Channel
 		chn = srcChn;
+		// The new channel continues where the old one was, so it also takes over its decoded sample stream window
+		if(!m_sampleStreamCursors.empty())
+			std::swap(m_sampleStreamCursors[nChn], m_sampleStreamCursors[nnaChn]);
 		chn.dwFlags.reset(CHN_VIBRATO | CHN_TREMOLO | CHN_MUTE | CHN_PORTAMENTO);
 		chn.nPanbrelloOffset = 0;
 		chn.nMasterChn = nChn + 1;
@@ -2115,6 +2322,8 @@ CHANNELINDEX CSoundFile::CheckNNA(CHANNELINDEX nChn, uint32 instr, int note, boo
 		bool applyDNAtoPlug = false;
 		if((chn.nMasterChn == nChn + 1 || i == nChn) && chn.pModInstrument != nullptr)
 		{
+			if(i >= GetNumChannels())
+				InvalidateNNAChannel(i);
 			bool applyDNA = false;
 			// Duplicate Check Type
 			switch(chn.pModInstrument->nDCT)
@@ -2227,7 +2436,7 @@ CHANNELINDEX CSoundFile::CheckNNA(CHANNELINDEX nChn, uint32 instr, int note, boo
 	if(!srcChn.IsSamplePlaying() && !applyNNAtoPlug)
 		return CHANNELINDEX_INVALID;
 
-	CHANNELINDEX nnaChn = GetNNAChannel(nChn);
+	CHANNELINDEX nnaChn = AllocateNNAChannel(nChn);
 	if(nnaChn == CHANNELINDEX_INVALID)
 		return CHANNELINDEX_INVALID;
 
@@ -2236,6 +2445,8 @@ CHANNELINDEX CSoundFile::CheckNNA(CHANNELINDEX nChn, uint32 instr, int note, boo
 		m_opl->NoteCut(nnaChn);
 	// Copy Channel
 	chn = srcChn;
+	if(!m_sampleStreamCursors.empty())
+		std::swap(m_sampleStreamCursors[nChn], m_sampleStreamCursors[nnaChn]);
 	chn.dwFlags.reset(CHN_VIBRATO | CHN_TREMOLO | CHN_PORTAMENTO);
 	chn.nPanbrelloOffset = 0;
 
@@ -2311,6 +2522,7 @@ bool CSoundFile::ProcessEffects()
 	m_PlayState.m_breakRow = ROWINDEX_INVALID;    // Is changed if a break to row command is encountered
 	m_PlayState.m_patLoopRow = ROWINDEX_INVALID;  // Is changed if a pattern loop jump-back is executed
 	m_PlayState.m_posJump = ORDERINDEX_INVALID;
+	BeginNNAChannelAllocation();
 
 	for(CHANNELINDEX nChn = 0; nChn < GetNumChannels(); nChn++)
 	{
@@ -2570,7 +2782,7 @@ bool CSoundFile::ProcessEffects()
 			// Test case: PTSwapEmpty.mod, PTInstrVolume.mod, SampleSwap.s3m
 			bool keepInstr = (GetType() & (MOD_TYPE_IT | MOD_TYPE_MPT))
 				|| m_playBehaviour[kST3SampleSwap]
-				|| (m_playBehaviour[kMODSampleSwap] && !chn.IsSamplePlaying() && (chn.pModSample == nullptr || !chn.pModSample->HasSampleData()));
+				|| (m_playBehaviour[kMODSampleSwap] && !chn.IsSamplePlaying() && (chn.pModSample == nullptr || !chn.pModSample->HasPlayableData()));
 
 			// Now it's time for some FT2 crap...
 			if (GetType() & (MOD_TYPE_XM | MOD_TYPE_MT2))
@@ -2640,7 +2852,7 @@ bool CSoundFile::ProcessEffects()
 
 				if(oldSample != nullptr)
 				{
-					if(!oldSample->uFlags[SMP_NODEFAULTVOLUME] && (GetType() != MOD_TYPE_S3M || oldSample->HasSampleData()))
+					if(!oldSample->uFlags[SMP_NODEFAULTVOLUME] && (GetType() != MOD_TYPE_S3M || oldSample->HasPlayableData()))
 						chn.nVolume = oldSample->nVolume;
 					if(reloadSampleSettings)
 					{
@@ -3401,6 +3613,7 @@ bool CSoundFile::ProcessEffects()
 		}
 
 	} // for(...) end
+	EndNNAChannelAllocation();
 
 	// Navigation Effects
 	if(m_SongFlags[SONG_FIRSTTICK])
@@ -4609,6 +4822,7 @@ void CSoundFile::ExtendedS3MCommands(CHANNELINDEX nChn, ModCommand::PARAM param)
 							ModChannel &bkChn = m_PlayState.Chn[i];
 							if (bkChn.nMasterChn == nChn + 1)
 							{
+								InvalidateNNAChannel(i);
 								if (param == 1)
 								{
 									KeyOff(bkChn);
@@ -4786,6 +5000,8 @@ void CSoundFile::InvertLoop(ModChannel &chn)
 	if (++chn.nEFxOffset >= pModSample->nLoopEnd - pModSample->nLoopStart)
 		chn.nEFxOffset = 0;
 
+	// Samples used with this effect are never shared through the SampleStore (see CSoundFile::UsesInvertLoop),
+	// so other samples (possibly in other modules) are not trashed along with this one.
 	// TRASH IT!!! (Yes, the sample!)
 	const uint8 bps = pModSample->GetBytesPerSample();
 	uint8 *begin = mpt::byte_cast<uint8 *>(pModSample->sampleb()) + (pModSample->nLoopStart + chn.nEFxOffset) * bps;
@@ -4793,7 +5009,7 @@ void CSoundFile::InvertLoop(ModChannel &chn)
 	{
 		sample = ~sample;
 	}
-	pModSample->PrecomputeLoops(*this, false);
+	pModSample->PrecomputeLoopsUnshared(*this, false);
 }
 
 
@@ -4801,10 +5017,10 @@ void CSoundFile::InvertLoop(ModChannel &chn)
 // Parameters:
 // [in] nChn: Mod channel to apply macro on
 // [in] isSmooth: If true, internal macros are interpolated between two rows
-// [in] macro: Actual MIDI Macro string
+// [in] macro: Compiled MIDI Macro string
 // [in] param: Parameter for parametric macros (Z00 - Z7F)
 // [in] plugin: Plugin to send MIDI message to (if not specified but needed, it is autodetected)
-void CSoundFile::ProcessMIDIMacro(CHANNELINDEX nChn, bool isSmooth, const char *macro, uint8 param, PLUGINDEX plugin)
+void CSoundFile::ProcessMIDIMacro(CHANNELINDEX nChn, bool isSmooth, const MIDIMacroProgram &macro, uint8 param, PLUGINDEX plugin)
 {
 	ModChannel &chn = m_PlayState.Chn[nChn];
 	const ModInstrument *pIns = GetNumInstruments() ? chn.pModInstrument : nullptr;
@@ -4813,109 +5029,117 @@ void CSoundFile::ProcessMIDIMacro(CHANNELINDEX nChn, bool isSmooth, const char *
 	uint32 outPos = 0;	// output buffer position, which also equals the number of complete bytes
 	const uint8 lastZxxParam = chn.lastZxxParam;
 	bool firstNibble = true;
+	uint8 midiChannel = 0xFF;	// Looked up on first use
 
-	for(uint32 pos = 0; pos < (MACRO_LENGTH - 1) && macro[pos]; pos++)
+	for(const auto &instr : macro)
 	{
 		bool isNibble = false;  // did we parse a nibble or a byte value?
 		uint8 data = 0;         // data that has just been parsed
 
-		// Parse next macro byte... See Impulse Tracker's MIDI.TXT for detailed information on each possible character.
-		if(macro[pos] >= '0' && macro[pos] <= '9')
-		{
-			isNibble = true;
-			data = static_cast<uint8>(macro[pos] - '0');
-		}
-		else if(macro[pos] >= 'A' && macro[pos] <= 'F')
+		// Evaluate next macro byte... See Impulse Tracker's MIDI.TXT for detailed information on each possible character.
+		switch(instr.opcode)
 		{
+		case MIDIMacroProgram::Opcode::Byte:
+			// Two constant nibbles at a byte boundary
+			out[outPos++] = instr.value;
+			continue;
+		case MIDIMacroProgram::Opcode::Nibble:
 			isNibble = true;
-			data = static_cast<uint8>(macro[pos] - 'A' + 0x0A);
-		} else if(macro[pos] == 'c')
-		{
+			data = instr.value;
+			break;
+		case MIDIMacroProgram::Opcode::MIDIChannel:
 			// MIDI channel
 			isNibble = true;
-			data = 0xFF;
-#ifndef NO_PLUGINS
-			const PLUGINDEX plug = (plugin != 0) ? plugin : GetBestPlugin(nChn, PrioritiseChannel, EvenIfMuted);
-			if(plug > 0 && plug <= MAX_MIXPLUGINS)
+			if(midiChannel == 0xFF)
 			{
-				auto midiPlug = dynamic_cast<const IMidiPlugin *>(m_MixPlugins[plug - 1u].pMixPlugin);
-				if(midiPlug)
-					data = midiPlug->GetMidiChannel(nChn);
-			}
+#ifndef NO_PLUGINS
+				const PLUGINDEX plug = (plugin != 0) ? plugin : GetBestPlugin(nChn, PrioritiseChannel, EvenIfMuted);
+				if(plug > 0 && plug <= MAX_MIXPLUGINS)
+				{
+					auto midiPlug = dynamic_cast<const IMidiPlugin *>(m_MixPlugins[plug - 1u].pMixPlugin);
+					if(midiPlug)
+						midiChannel = midiPlug->GetMidiChannel(nChn);
+				}
 #endif // NO_PLUGINS
-			if(data == 0xFF)
-			{
-				// Fallback if no plugin was found
-				if(pIns)
-					data = pIns->GetMIDIChannel(*this, nChn);
-				else
-					data = 0;
+				if(midiChannel == 0xFF)
+				{
+					// Fallback if no plugin was found
+					if(pIns)
+						midiChannel = pIns->GetMIDIChannel(*this, nChn);
+					else
+						midiChannel = 0;
+				}
 			}
-		} else if(macro[pos] == 'n')
-		{
+			data = midiChannel;
+			break;
+		case MIDIMacroProgram::Opcode::Note:
 			// Last triggered note
 			if(ModCommand::IsNote(chn.nLastNote))
 			{
 				data = chn.nLastNote - NOTE_MIN;
 			}
-		} else if(macro[pos] == 'v')
-		{
-			// Velocity
-			// This is "almost" how IT does it - apparently, IT seems to lag one row behind on global volume or channel volume changes.
-			const int swing = (m_playBehaviour[kITSwingBehaviour] || m_playBehaviour[kMPTOldSwingBehaviour]) ? chn.nVolSwing : 0;
-			const int vol = Util::muldiv((chn.nVolume + swing) * m_PlayState.m_nGlobalVolume, chn.nGlobalVol * chn.nInsVol, 1 << 20);
-			data = static_cast<uint8>(Clamp(vol / 2, 1, 127));
-			//data = (unsigned char)std::min((chn.nVolume * chn.nGlobalVol * m_nGlobalVolume) >> (1 + 6 + 8), 127);
-		} else if(macro[pos] == 'u')
-		{
-			// Calculated volume
-			// Same note as with velocity applies here, but apparently also for instrument / sample volumes?
-			const int vol = Util::muldiv(chn.nCalcVolume * m_PlayState.m_nGlobalVolume, chn.nGlobalVol * chn.nInsVol, 1 << 26);
-			data = static_cast<uint8>(Clamp(vol / 2, 1, 127));
-			//data = (unsigned char)std::min((chn.nCalcVolume * chn.nGlobalVol * m_nGlobalVolume) >> (7 + 6 + 8), 127);
-		} else if(macro[pos] == 'x')
-		{
+			break;
+		case MIDIMacroProgram::Opcode::Velocity:
+			{
+				// Velocity
+				// This is "almost" how IT does it - apparently, IT seems to lag one row behind on global volume or channel volume changes.
+				const int swing = (m_playBehaviour[kITSwingBehaviour] || m_playBehaviour[kMPTOldSwingBehaviour]) ? chn.nVolSwing : 0;
+				const int vol = Util::muldiv((chn.nVolume + swing) * m_PlayState.m_nGlobalVolume, chn.nGlobalVol * chn.nInsVol, 1 << 20);
+				data = static_cast<uint8>(Clamp(vol / 2, 1, 127));
+				//data = (unsigned char)std::min((chn.nVolume * chn.nGlobalVol * m_nGlobalVolume) >> (1 + 6 + 8), 127);
+			}
+			break;
+		case MIDIMacroProgram::Opcode::CalcVolume:
+			{
+				// Calculated volume
+				// Same note as with velocity applies here, but apparently also for instrument / sample volumes?
+				const int vol = Util::muldiv(chn.nCalcVolume * m_PlayState.m_nGlobalVolume, chn.nGlobalVol * chn.nInsVol, 1 << 26);
+				data = static_cast<uint8>(Clamp(vol / 2, 1, 127));
+				//data = (unsigned char)std::min((chn.nCalcVolume * chn.nGlobalVol * m_nGlobalVolume) >> (7 + 6 + 8), 127);
+			}
+			break;
+		case MIDIMacroProgram::Opcode::Pan:
 			// Pan set
 			data = static_cast<uint8>(std::min(static_cast<int>(chn.nPan / 2), 127));
-		} else if(macro[pos] == 'y')
-		{
+			break;
+		case MIDIMacroProgram::Opcode::CalcPan:
 			// Calculated pan
 			data = static_cast<uint8>(std::min(static_cast<int>(chn.nRealPan / 2), 127));
-		} else if(macro[pos] == 'a')
-		{
+			break;
+		case MIDIMacroProgram::Opcode::BankHigh:
 			// High byte of bank select
 			if(pIns && pIns->wMidiBank)
 			{
 				data = static_cast<uint8>(((pIns->wMidiBank - 1) >> 7) & 0x7F);
 			}
-		} else if(macro[pos] == 'b')
-		{
+			break;
+		case MIDIMacroProgram::Opcode::BankLow:
 			// Low byte of bank select
 			if(pIns && pIns->wMidiBank)
 			{
 				data = static_cast<uint8>((pIns->wMidiBank - 1) & 0x7F);
 			}
-		} else if(macro[pos] == 'o')
-		{
+			break;
+		case MIDIMacroProgram::Opcode::Offset:
 			// Offset (ignoring high offset)
 			data = static_cast<uint8>((chn.oldOffset >> 8) & 0xFF);
-		} else if(macro[pos] == 'h')
-		{
+			break;
+		case MIDIMacroProgram::Opcode::HostChannel:
 			// Host channel number
 			data = static_cast<uint8>((nChn >= GetNumChannels() ? (chn.nMasterChn - 1) : nChn) & 0x7F);
-		} else if(macro[pos] == 'm')
-		{
+			break;
+		case MIDIMacroProgram::Opcode::LoopDirection:
 			// Loop direction (judging from the character, it was supposed to be loop type, though)
 			data = chn.dwFlags[CHN_PINGPONGFLAG] ? 1 : 0;
-		} else if(macro[pos] == 'p')
-		{
+			break;
+		case MIDIMacroProgram::Opcode::Program:
 			// Program select
 			if(pIns && pIns->nMidiProgram)
 			{
 				data = static_cast<uint8>((pIns->nMidiProgram - 1) & 0x7F);
 			}
-		} else if(macro[pos] == 'z')
-		{
+			break;
+		case MIDIMacroProgram::Opcode::ZxxParam:
 			// Zxx parameter
 			data = param & 0x7F;
 			if(isSmooth && chn.lastZxxParam < 0x80
@@ -4926,24 +5150,23 @@ void CSoundFile::ProcessMIDIMacro(CHANNELINDEX nChn, bool isSmooth, const char *
 				data = static_cast<uint8>(CalculateSmoothParamChange(lastZxxParam, data));
 			}
 			chn.lastZxxParam = data;
-		} else if(macro[pos] == 's')
-		{
-			// SysEx Checksum (not an original Impulse Tracker macro variable, but added for convenience)
-			uint32 startPos = outPos;
-			while(startPos > 0 && out[--startPos] != 0xF0);
-			if(outPos - startPos < 5 || out[startPos] != 0xF0)
-			{
-				continue;
-			}
-			for(uint32 p = startPos + 5; p != outPos; p++)
+			break;
+		case MIDIMacroProgram::Opcode::Checksum:
 			{
-				data += out[p];
+				// SysEx Checksum (not an original Impulse Tracker macro variable, but added for convenience)
+				uint32 startPos = outPos;
+				while(startPos > 0 && out[--startPos] != 0xF0);
+				if(outPos - startPos < 5 || out[startPos] != 0xF0)
+				{
+					continue;
+				}
+				for(uint32 p = startPos + 5; p != outPos; p++)
+				{
+					data += out[p];
+				}
+				data = (~data + 1) & 0x7F;
 			}
-			data = (~data + 1) & 0x7F;
-		} else
-		{
-			// Unrecognized byte (e.g. space char)
-			continue;
+			break;
 		}
 
 		// Append parsed data
@@ -34,11 +34,15 @@
 #include "../common/FileReader.h"
 #include "Container.h"
 #include "OPL.h"
+#include "SampleStore.h"
+#include "../common/mptCRC.h"
 
 #ifndef NO_ARCHIVE_SUPPORT
 #include "../unarchiver/unarchiver.h"
 #endif // NO_ARCHIVE_SUPPORT
 
+#include <set>
+
 
 OPENMPT_NAMESPACE_BEGIN
 
@@ -492,6 +496,7 @@ bool CSoundFile::Create(FileReader file, ModLoadingFlags loadFlags)
 	}
 
 	// Checking samples, load external samples
+	const bool invertLoop = m_shareSamples && UsesInvertLoop();
 	for(SAMPLEINDEX nSmp = 1; nSmp <= m_nSamples; nSmp++)
 	{
 		ModSample &sample = Samples[nSmp];
@@ -520,9 +525,14 @@ bool CSoundFile::Create(FileReader file, ModLoadingFlags loadFlags)
 		}
 #endif // MPT_EXTERNAL_SAMPLES
 
-		if(sample.HasSampleData())
+		if(sample.HasPlayableData())
 		{
 			sample.PrecomputeLoops(*this, false);
+			if(m_shareSamples && !(invertLoop && sample.uFlags[CHN_LOOP]))
+				SampleStore::Share(sample);
+			// Stream cursors hold the decoded window of every channel; allocate them here so that the mixer never has to.
+			if(sample.IsStreamed() && m_sampleStreamCursors.empty())
+				m_sampleStreamCursors.resize(MAX_CHANNELS);
 		} else if(!sample.uFlags[SMP_KEEPONDISK])
 		{
 			sample.nLength = 0;
@@ -1006,56 +1016,8 @@ PlayBehaviourSet CSoundFile::GetSupportedPlaybackBehaviour(MODTYPE type)
 	{
 	case MOD_TYPE_MPT:
 	case MOD_TYPE_IT:
-		playBehaviour.set(MSF_COMPATIBLE_PLAY);
-		playBehaviour.set(kHertzInLinearMode);
-		playBehaviour.set(kTempoClamp);
-		playBehaviour.set(kPerChannelGlobalVolSlide);
-		playBehaviour.set(kPanOverride);
-		playBehaviour.set(kITInstrWithoutNote);
-		playBehaviour.set(kITVolColFinePortamento);
-		playBehaviour.set(kITArpeggio);
-		playBehaviour.set(kITOutOfRangeDelay);
-		playBehaviour.set(kITPortaMemoryShare);
-		playBehaviour.set(kITPatternLoopTargetReset);
-		playBehaviour.set(kITFT2PatternLoop);
-		playBehaviour.set(kITPingPongNoReset);
-		playBehaviour.set(kITEnvelopeReset);
-		playBehaviour.set(kITClearOldNoteAfterCut);
-		playBehaviour.set(kITVibratoTremoloPanbrello);
-		playBehaviour.set(kITTremor);
-		playBehaviour.set(kITRetrigger);
-		playBehaviour.set(kITMultiSampleBehaviour);
-		playBehaviour.set(kITPortaTargetReached);
-		playBehaviour.set(kITPatternLoopBreak);
-		playBehaviour.set(kITOffset);
-		playBehaviour.set(kITSwingBehaviour);
-		playBehaviour.set(kITNNAReset);
-		playBehaviour.set(kITSCxStopsSample);
-		playBehaviour.set(kITEnvelopePositionHandling);
-		playBehaviour.set(kITPortamentoInstrument);
-		playBehaviour.set(kITPingPongMode);
-		playBehaviour.set(kITRealNoteMapping);
-		playBehaviour.set(kITHighOffsetNoRetrig);
-		playBehaviour.set(kITFilterBehaviour);
-		playBehaviour.set(kITNoSurroundPan);
-		playBehaviour.set(kITShortSampleRetrig);
-		playBehaviour.set(kITPortaNoNote);
-		playBehaviour.set(kITFT2DontResetNoteOffOnPorta);
-		playBehaviour.set(kITVolColMemory);
-		playBehaviour.set(kITPortamentoSwapResetsPos);
-		playBehaviour.set(kITEmptyNoteMapSlot);
-		playBehaviour.set(kITFirstTickHandling);
-		playBehaviour.set(kITSampleAndHoldPanbrello);
-		playBehaviour.set(kITClearPortaTarget);
-		playBehaviour.set(kITPanbrelloHold);
-		playBehaviour.set(kITPanningReset);
-		playBehaviour.set(kITPatternLoopWithJumps);
-		playBehaviour.set(kITInstrWithNoteOff);
-		playBehaviour.set(kITMultiSampleInstrumentNumber);
-		playBehaviour.set(kRowDelayWithNoteDelay);
-		playBehaviour.set(kITInstrWithNoteOffOldEffects);
-		playBehaviour.set(kITDoNotOverrideChannelPan);
-		playBehaviour.set(kITDCTBehaviour);
+		for(const auto b : ITPlayBehaviours)
+			playBehaviour.set(b);
 		if(type == MOD_TYPE_MPT)
 		{
 			playBehaviour.set(kOPLFlexibleNoteOff);
@@ -1065,73 +1027,18 @@ PlayBehaviourSet CSoundFile::GetSupportedPlaybackBehaviour(MODTYPE type)
 		break;
 
 	case MOD_TYPE_XM:
-		playBehaviour.set(MSF_COMPATIBLE_PLAY);
-		playBehaviour.set(kFT2VolumeRamping);
-		playBehaviour.set(kTempoClamp);
-		playBehaviour.set(kPerChannelGlobalVolSlide);
-		playBehaviour.set(kPanOverride);
-		playBehaviour.set(kITFT2PatternLoop);
-		playBehaviour.set(kITFT2DontResetNoteOffOnPorta);
-		playBehaviour.set(kFT2Arpeggio);
-		playBehaviour.set(kFT2Retrigger);
-		playBehaviour.set(kFT2VolColVibrato);
-		playBehaviour.set(kFT2PortaNoNote);
-		playBehaviour.set(kFT2KeyOff);
-		playBehaviour.set(kFT2PanSlide);
-		playBehaviour.set(kFT2ST3OffsetOutOfRange);
-		playBehaviour.set(kFT2RestrictXCommand);
-		playBehaviour.set(kFT2RetrigWithNoteDelay);
-		playBehaviour.set(kFT2SetPanEnvPos);
-		playBehaviour.set(kFT2PortaIgnoreInstr);
-		playBehaviour.set(kFT2VolColMemory);
-		playBehaviour.set(kFT2LoopE60Restart);
-		playBehaviour.set(kFT2ProcessSilentChannels);
-		playBehaviour.set(kFT2ReloadSampleSettings);
-		playBehaviour.set(kFT2PortaDelay);
-		playBehaviour.set(kFT2Transpose);
-		playBehaviour.set(kFT2PatternLoopWithJumps);
-		playBehaviour.set(kFT2PortaTargetNoReset);
-		playBehaviour.set(kFT2EnvelopeEscape);
-		playBehaviour.set(kFT2Tremor);
-		playBehaviour.set(kFT2OutOfRangeDelay);
-		playBehaviour.set(kFT2Periods);
-		playBehaviour.set(kFT2PanWithDelayedNoteOff);
-		playBehaviour.set(kFT2VolColDelay);
-		playBehaviour.set(kFT2FinetunePrecision);
-		playBehaviour.set(kFT2NoteOffFlags);
-		playBehaviour.set(kRowDelayWithNoteDelay);
-		playBehaviour.set(kFT2MODTremoloRampWaveform);
-		playBehaviour.set(kFT2PortaUpDownMemory);
-		playBehaviour.set(kFT2PanSustainRelease);
-		playBehaviour.set(kFT2NoteDelayWithoutInstr);
+		for(const auto b : XMPlayBehaviours)
+			playBehaviour.set(b);
 		break;
 
 	case MOD_TYPE_S3M:
-		playBehaviour.set(MSF_COMPATIBLE_PLAY);
-		playBehaviour.set(kTempoClamp);
-		playBehaviour.set(kPanOverride);
-		playBehaviour.set(kITPanbrelloHold);
-		playBehaviour.set(kFT2ST3OffsetOutOfRange);
-		playBehaviour.set(kST3NoMutedChannels);
-		playBehaviour.set(kST3PortaSampleChange);
-		playBehaviour.set(kST3EffectMemory);
-		playBehaviour.set(kST3VibratoMemory);
-		playBehaviour.set(KST3PortaAfterArpeggio);
-		playBehaviour.set(kRowDelayWithNoteDelay);
-		playBehaviour.set(kST3OffsetWithoutInstrument);
-		playBehaviour.set(kST3RetrigAfterNoteCut);
-		playBehaviour.set(kST3SampleSwap);
+		for(const auto b : S3MPlayBehaviours)
+			playBehaviour.set(b);
 		break;
 
 	case MOD_TYPE_MOD:
-		playBehaviour.set(kMODVBlankTiming);
-		playBehaviour.set(kMODOneShotLoops);
-		playBehaviour.set(kMODIgnorePanning);
-		playBehaviour.set(kMODSampleSwap);
-		playBehaviour.set(kMODOutOfRangeNoteDelay);
-		playBehaviour.set(kMODTempoOnSecondTick);
-		playBehaviour.set(kRowDelayWithNoteDelay);
-		playBehaviour.set(kFT2MODTremoloRampWaveform);
+		for(const auto b : MODPlayBehaviours)
+			playBehaviour.set(b);
 		break;
 
 	default:
@@ -1151,37 +1058,8 @@ PlayBehaviourSet CSoundFile::GetDefaultPlaybackBehaviour(MODTYPE type)
 	switch(type)
 	{
 	case MOD_TYPE_MPT:
-		playBehaviour.set(kHertzInLinearMode);
-		playBehaviour.set(kPerChannelGlobalVolSlide);
-		playBehaviour.set(kPanOverride);
-		playBehaviour.set(kITArpeggio);
-		playBehaviour.set(kITPortaMemoryShare);
-		playBehaviour.set(kITPatternLoopTargetReset);
-		playBehaviour.set(kITFT2PatternLoop);
-		playBehaviour.set(kITPingPongNoReset);
-		playBehaviour.set(kITClearOldNoteAfterCut);
-		playBehaviour.set(kITVibratoTremoloPanbrello);
-		playBehaviour.set(kITMultiSampleBehaviour);
-		playBehaviour.set(kITPortaTargetReached);
-		playBehaviour.set(kITPatternLoopBreak);
-		playBehaviour.set(kITSwingBehaviour);
-		playBehaviour.set(kITSCxStopsSample);
-		playBehaviour.set(kITEnvelopePositionHandling);
-		playBehaviour.set(kITPingPongMode);
-		playBehaviour.set(kITRealNoteMapping);
-		playBehaviour.set(kITPortaNoNote);
-		playBehaviour.set(kITVolColMemory);
-		playBehaviour.set(kITFirstTickHandling);
-		playBehaviour.set(kITClearPortaTarget);
-		playBehaviour.set(kITSampleAndHoldPanbrello);
-		playBehaviour.set(kITPanbrelloHold);
-		playBehaviour.set(kITPanningReset);
-		playBehaviour.set(kITInstrWithNoteOff);
-		playBehaviour.set(kOPLFlexibleNoteOff);
-		playBehaviour.set(kITDoNotOverrideChannelPan);
-		playBehaviour.set(kITDCTBehaviour);
-		playBehaviour.set(kOPLwithNNA);
-		playBehaviour.set(kOPLRealRetrig);
+		for(const auto b : MPTDefaultPlayBehaviours)
+			playBehaviour.set(b);
 		break;
 
 	case MOD_TYPE_S3M:
@@ -1441,7 +1319,7 @@ bool CSoundFile::DestroySample(SAMPLEINDEX nSample)
 	{
 		return false;
 	}
-	if(!Samples[nSample].HasSampleData())
+	if(!Samples[nSample].HasPlayableData())
 	{
 		return true;
 	}
@@ -1477,6 +1355,306 @@ bool CSoundFile::DestroySampleThreadsafe(SAMPLEINDEX nSample)
 }
 
 
+std::size_t CSoundFile::GetSampleMemoryUsage(std::size_t *shared) const
+{
+	std::set<const void *> buffers;
+	std::size_t size = 0, sharedSize = 0;
+	for(SAMPLEINDEX smp = 1; smp <= GetNumSamples(); smp++)
+	{
+		const ModSample &sample = Samples[smp];
+		if(sample.IsStreamed())
+		{
+			if(buffers.insert(sample.stream.get()).second)
+				size += sample.stream->GetCacheSize();
+		} else if(sample.HasSampleData() && buffers.insert(sample.samplev()).second)
+		{
+			const std::size_t bufferSize = ModSample::GetRealSampleBufferSize(sample.nLength, sample.GetBytesPerSample());
+			size += bufferSize;
+			if(SampleStore::IsShared(sample.samplev()))
+				sharedSize += bufferSize;
+		}
+	}
+	if(shared)
+		*shared = sharedSize;
+	return size;
+}
+
+
+namespace
+{
+
+// Hashes the in-memory representation of values, which is only meaningful within the same process
+class StateHash
+{
+	mpt::checksum::crc64_jones crc;
+
+public:
+	template <typename T>
+	void operator()(const T &value)
+	{
+		static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value);
+		const std::byte *bytes = reinterpret_cast<const std::byte *>(&value);
+		crc(bytes, bytes + sizeof(T));
+	}
+
+	uint64 Result() const { return crc.result(); }
+};
+
+}  // namespace
+
+
+std::optional<uint64> CSoundFile::GetPlaybackStateHash() const
+{
+	if(m_MixerSettings.DSPMask || m_opl || m_stemLayout != StemLayout::None || !m_sampleStreamCursors.empty())
+		return std::nullopt;
+#ifndef NO_PLUGINS
+	for(const auto &plugin : m_MixPlugins)
+	{
+		if(plugin.pMixPlugin)
+			return std::nullopt;
+	}
+#endif  // NO_PLUGINS
+
+	StateHash hash;
+	const PlayState &state = m_PlayState;
+	hash(state.m_nBufferCount);
+	hash(state.m_dBufferDiff);
+	hash(state.m_nTickCount);
+	hash(state.m_nPatternDelay);
+	hash(state.m_nFrameDelay);
+	hash(state.m_nSamplesPerTick);
+	hash(state.m_nCurrentRowsPerBeat);
+	hash(state.m_nCurrentRowsPerMeasure);
+	hash(state.m_nMusicSpeed);
+	hash(state.m_nMusicTempo.GetRaw());
+	hash(state.m_nRow);
+	hash(state.m_nNextRow);
+	hash(state.m_nextPatStartRow);
+	hash(state.m_breakRow);
+	hash(state.m_patLoopRow);
+	hash(state.m_posJump);
+	hash(state.m_nPattern);
+	hash(state.m_nCurrentOrder);
+	hash(state.m_nNextOrder);
+	hash(state.m_nSeqOverride);
+	hash(state.m_nGlobalVolume);
+	hash(state.m_nSamplesToGlobalVolRampDest);
+	hash(state.m_nGlobalVolumeRampAmount);
+	hash(state.m_nGlobalVolumeDestination);
+	hash(state.m_lHighResRampingGlobalVolume);
+	hash(state.m_bPositionChanged);
+	hash(m_nMixChannels);
+	for(CHANNELINDEX i = 0; i < m_nMixChannels; i++)
+	{
+		hash(state.ChnMix[i]);
+	}
+	hash(m_SongFlags.GetRaw());
+	hash(m_nRepeatCount);
+	hash(m_dryLOfsVol);
+	hash(m_dryROfsVol);
+	hash(m_surroundLOfsVol);
+	hash(m_surroundROfsVol);
+	hash(m_voiceBudget.fullQualityVoices);
+	hash(m_voiceBudget.maxVoices);
+	hash(m_visitedRows.GetStateHash());
+
+	for(CHANNELINDEX i = 0; i < MAX_CHANNELS; i++)
+	{
+		const ModChannel &chn = state.Chn[i];
+		// Unused background channels are completely overwritten when they are allocated again, so only playing ones matter
+		if(i >= GetNumChannels() && !chn.nLength && !chn.nROfs && !chn.nLOfs)
+			continue;
+		hash(i);
+
+		// Pointers are replaced by slot indices and offsets, so that they can be compared between instances
+		SAMPLEINDEX smp = 0;
+		if(chn.pModSample)
+		{
+			if(chn.pModSample < std::begin(Samples) || chn.pModSample >= std::end(Samples))
+				return std::nullopt;
+			smp = static_cast<SAMPLEINDEX>(chn.pModSample - std::begin(Samples));
+		}
+		hash(smp);
+		if(chn.pCurrentSample)
+		{
+			if(!chn.pModSample || !chn.pModSample->HasSampleData())
+				return std::nullopt;
+			const auto address = reinterpret_cast<uintptr_t>(chn.pCurrentSample), base = reinterpret_cast<uintptr_t>(chn.pModSample->samplev());
+			const uintptr_t lookahead = InterpolationMaxLookahead * MaxSamplingPointSize;
+			if(address + lookahead < base || address >= base + ModSample::GetRealSampleBufferSize(chn.pModSample->nLength, chn.pModSample->GetBytesPerSample()))
+				return std::nullopt;
+			hash(static_cast<int64>(address - base));
+		} else
+		{
+			hash(int64_min);
+		}
+		INSTRUMENTINDEX ins = 0;
+		if(chn.pModInstrument)
+		{
+			while(ins < MAX_INSTRUMENTS && Instruments[ins] != chn.pModInstrument)
+				ins++;
+			if(ins == MAX_INSTRUMENTS)
+				return std::nullopt;
+		}
+		hash(ins);
+
+		hash(chn.position.GetRaw());
+		hash(chn.increment.GetRaw());
+		hash(chn.leftVol);
+		hash(chn.rightVol);
+		hash(chn.leftRamp);
+		hash(chn.rightRamp);
+		hash(chn.rampLeftVol);
+		hash(chn.rampRightVol);
+		for(const auto &history : chn.nFilter_Y)
+		{
+			hash(history[0]);
+			hash(history[1]);
+		}
+		hash(chn.nFilter_A0);
+		hash(chn.nFilter_B0);
+		hash(chn.nFilter_B1);
+		hash(chn.nFilter_HP);
+		hash(chn.nLength);
+		hash(chn.nLoopStart);
+		hash(chn.nLoopEnd);
+		hash(chn.dwFlags.GetRaw());
+		hash(chn.nROfs);
+		hash(chn.nLOfs);
+		hash(chn.nRampLength);
+		chn.paulaState.ForEachStateValue(std::ref(hash));
+
+		hash(chn.prevNoteOffset);
+		hash(chn.oldOffset);
+		hash(chn.dwOldFlags.GetRaw());
+		hash(chn.newLeftVol);
+		hash(chn.newRightVol);
+		hash(chn.nRealVolume);
+		hash(chn.nRealPan);
+		hash(chn.nVolume);
+		hash(chn.nPan);
+		hash(chn.nFadeOutVol);
+		hash(chn.nPeriod);
+		hash(chn.nC5Speed);
+		hash(chn.nPortamentoDest);
+		hash(chn.cachedPeriod);
+		hash(chn.glissandoPeriod);
+		hash(chn.nCalcVolume);
+		for(const ModChannel::EnvInfo *env : {&chn.VolEnv, &chn.PanEnv, &chn.PitchEnv})
+		{
+			hash(env->flags.GetRaw());
+			hash(env->nEnvPosition);
+			hash(env->nEnvValueAtReleaseJump);
+		}
+		hash(chn.nGlobalVol);
+		hash(chn.nInsVol);
+		hash(chn.nFineTune);
+		hash(chn.nTranspose);
+		hash(chn.nPortamentoSlide);
+		hash(chn.nAutoVibDepth);
+		hash(chn.nEFxOffset);
+		hash(chn.nVolSwing);
+		hash(chn.nPanSwing);
+		hash(chn.nCutSwing);
+		hash(chn.nResSwing);
+		hash(chn.nRestorePanOnNewNote);
+		hash(chn.nRetrigCount);
+		hash(chn.nRetrigParam);
+		hash(chn.nPatternLoop);
+		hash(chn.nMasterChn);
+		hash(chn.rowCommand.note);
+		hash(chn.rowCommand.instr);
+		hash(chn.rowCommand.volcmd);
+		hash(chn.rowCommand.command);
+		hash(chn.rowCommand.vol);
+		hash(chn.rowCommand.param);
+		hash(chn.resamplingMode);
+		hash(chn.nRestoreResonanceOnNewNote);
+		hash(chn.nRestoreCutoffOnNewNote);
+		hash(chn.nNote);
+		hash(chn.nNNA);
+		hash(chn.nLastNote);
+		hash(chn.nArpeggioLastNote);
+		hash(chn.nArpeggioBaseNote);
+		hash(chn.nNewNote);
+		hash(chn.nNewIns);
+		hash(chn.nOldIns);
+		hash(chn.nCommand);
+		hash(chn.nArpeggio);
+		hash(chn.nOldVolumeSlide);
+		hash(chn.nOldFineVolUpDown);
+		hash(chn.nOldPortaUp);
+		hash(chn.nOldPortaDown);
+		hash(chn.nOldFinePortaUpDown);
+		hash(chn.nOldExtraFinePortaUpDown);
+		hash(chn.nOldPanSlide);
+		hash(chn.nOldChnVolSlide);
+		hash(chn.nOldGlobalVolSlide);
+		hash(chn.nAutoVibPos);
+		hash(chn.nVibratoPos);
+		hash(chn.nTremoloPos);
+		hash(chn.nPanbrelloPos);
+		hash(chn.nVibratoType);
+		hash(chn.nVibratoSpeed);
+		hash(chn.nVibratoDepth);
+		hash(chn.nTremoloType);
+		hash(chn.nTremoloSpeed);
+		hash(chn.nTremoloDepth);
+		hash(chn.nPanbrelloType);
+		hash(chn.nPanbrelloSpeed);
+		hash(chn.nPanbrelloDepth);
+		hash(chn.nPanbrelloOffset);
+		hash(chn.nPanbrelloRandomMemory);
+		hash(chn.nOldCmdEx);
+		hash(chn.nOldVolParam);
+		hash(chn.nOldTempo);
+		hash(chn.nOldHiOffset);
+		hash(chn.nCutOff);
+		hash(chn.nResonance);
+		hash(chn.nTremorCount);
+		hash(chn.nTremorParam);
+		hash(chn.nPatternLoopCount);
+		hash(chn.nActiveMacro);
+		hash(chn.nFilterMode);
+		hash(chn.nEFxSpeed);
+		hash(chn.nEFxDelay);
+		hash(chn.nNoteSlideCounter);
+		hash(chn.nNoteSlideSpeed);
+		hash(chn.nNoteSlideStep);
+		hash(chn.lastZxxParam);
+		hash(static_cast<bool>(chn.isFirstTick));
+		hash(static_cast<bool>(chn.isPreviewNote));
+		hash(static_cast<bool>(chn.m_ReCalculateFreqOnFirstTick));
+		hash(static_cast<bool>(chn.m_CalculateFreq));
+		hash(chn.m_PortamentoFineSteps);
+		hash(chn.m_PortamentoTickSlide);
+		hash(chn.m_plugParamValueStep);
+		hash(chn.m_plugParamTargetValue);
+		hash(chn.m_RowPlugParam);
+		hash(chn.m_RowPlug);
+	}
+	return hash.Result();
+}
+
+
+bool CSoundFile::UsesInvertLoop() const
+{
+	if(GetType() != MOD_TYPE_MOD)
+		return false;
+	for(const auto &pattern : Patterns)
+	{
+		if(!pattern.IsValid())
+			continue;
+		for(const auto &m : pattern)
+		{
+			if(m.command == CMD_MODCMDEX && (m.param & 0xF0) == 0xF0 && (m.param & 0x0F))
+				return true;
+		}
+	}
+	return false;
+}
+
+
 std::unique_ptr<CTuning> CSoundFile::CreateTuning12TET(const mpt::ustring &name)
 {
 	std::unique_ptr<CTuning> pT = CTuning::CreateGeometric(name, 12, 2, 15);
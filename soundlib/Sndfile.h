@@ -20,8 +20,10 @@
 #include "../common/version.h"
 #include <vector>
 #include <bitset>
+#include <optional>
 #include <set>
 #include "Snd_defs.h"
+#include "PlayBehaviour.h"
 #include "tuningbase.h"
 #include "MIDIMacros.h"
 #ifdef MODPLUG_TRACKER
@@ -42,9 +44,11 @@
 #ifndef NO_EQ
 #include "../sounddsp/EQ.h"
 #endif
+#include "../sounddsp/Loudness.h"
 
 #include "modcommand.h"
 #include "ModSample.h"
+#include "SampleStream.h"
 #include "ModInstrument.h"
 #include "ModChannel.h"
 #include "plugins/PluginStructs.h"
@@ -86,8 +90,6 @@ class CVstPluginManager;
 #endif
 
 
-using PlayBehaviourSet = std::bitset<kMaxPlayBehaviours>;
-
 #ifdef MODPLUG_TRACKER
 
 // For WAV export (writing pattern positions to file)
@@ -265,6 +267,82 @@ enum class ModMessageHeuristicOrder
 	Default = InstrumentsSamples,
 };
 
+// Limits the number of voices that are mixed at full quality or mixed at all, e.g. to keep the CPU load of a player in check.
+// When limiting, pattern channels take precedence over NNA voices, which are ordered by volume and then by age (see CSoundFile::GetNNAChannel).
+struct VoiceBudget
+{
+	CHANNELINDEX fullQualityVoices = MAX_CHANNELS;  // Voices beyond this use linear interpolation instead of the configured resampler
+	CHANNELINDEX maxVoices = MAX_CHANNELS;          // Voices beyond this are not mixed
+
+	bool IsLimited() const noexcept { return fullQualityVoices < MAX_CHANNELS || maxVoices < MAX_CHANNELS; }
+};
+
+
+// Background channels that GetNNAChannel would consider for a new NNA voice, collected once per tick while the pattern effects are processed.
+// Further new notes on the same tick take the first free channel from a bitmap or the quietest playing channel from a heap instead of scanning all channels again.
+struct NNAChannelCache
+{
+	// Playing background channel, ordered like in GetNNAChannel: Lowest volume first, then furthest into the volume envelope, then lowest channel index
+	struct Candidate
+	{
+		uint32 volume;
+		uint32 envPos;
+		uint32 generation;  // Outdated if the channel has been examined again since
+		CHANNELINDEX channel;
+
+		// The best candidate is the "largest" one, so that it ends up on top of the heap
+		bool operator<(const Candidate &other) const noexcept
+		{
+			if(volume != other.volume)
+				return volume > other.volume;
+			if(envPos != other.envPos)
+				return envPos < other.envPos;
+			return channel > other.channel;
+		}
+	};
+
+	using ChannelMask = std::array<uint64, MAX_CHANNELS / 64>;
+
+	ChannelMask freeChannels{};   // Channels that could be used right away
+	ChannelMask cutChannels{};    // Channels that are already playing a note that has been cut
+	ChannelMask dirtyChannels{};  // Channels whose state has changed since they were last examined
+	std::vector<Candidate> candidates;  // Heap of all other background channels
+	std::array<uint32, MAX_CHANNELS> generation{};
+	bool active = false;  // Only used while the pattern effects of a tick are processed, as the mixer changes the channels in between
+	bool valid = false;
+
+	void Begin() noexcept { active = true; valid = false; }
+	void End() noexcept { active = false; }
+	// Must be called when a background channel is modified while the cache is active (pattern channels are never cached)
+	void Invalidate(CHANNELINDEX chn) noexcept
+	{
+		if(chn < MAX_CHANNELS)
+			SetChannel(dirtyChannels, chn);
+	}
+
+	static void SetChannel(ChannelMask &mask, CHANNELINDEX chn) noexcept { mask[chn / 64] |= uint64(1) << (chn % 64); }
+	static void ResetChannel(ChannelMask &mask, CHANNELINDEX chn) noexcept { mask[chn / 64] &= ~(uint64(1) << (chn % 64)); }
+	static CHANNELINDEX FirstChannel(const ChannelMask &mask) noexcept
+	{
+		for(std::size_t word = 0; word < mask.size(); word++)
+		{
+			if(mask[word])
+				return static_cast<CHANNELINDEX>(word * 64 + mpt::countr_zero(mask[word]));
+		}
+		return CHANNELINDEX_INVALID;
+	}
+};
+
+
+// Splits the mix into separate stereo outputs (stems), one per pattern channel or per instrument.
+enum class StemLayout
+{
+	None,         // Only render the regular mix
+	Channels,     // One stem per pattern channel, NNA voices go to the stem of their parent channel
+	Instruments,  // One stem per instrument, or per sample if the module has no instruments
+};
+
+
 struct ModFormatDetails
 {
 	mpt::ustring formatName;         // "FastTracker 2"
@@ -283,6 +361,11 @@ protected:
 public:
 	virtual void DataCallback(MixSampleInt *MixSoundBuffer, std::size_t channels, std::size_t countChunk) = 0;
 	virtual void DataCallback(MixSampleFloat *MixSoundBuffer, std::size_t channels, std::size_t countChunk) = 0;
+	// Voices that are routed to a stem are mixed into the stem's interleaved stereo buffer instead of the regular mix.
+	// Global volume and stereo separation are applied to stems, master DSP effects and plugins are not.
+	virtual StemLayout GetStemLayout() const { return StemLayout::None; }
+	virtual void StemCallback(MixSampleInt * /*stemBuffer*/, std::size_t /*stem*/, std::size_t /*countChunk*/) { }
+	virtual void StemCallback(MixSampleFloat * /*stemBuffer*/, std::size_t /*stem*/, std::size_t /*countChunk*/) { }
 };
 
 
@@ -394,6 +477,17 @@ private:
 	mixsample_t m_dryLOfsVol = 0, m_dryROfsVol = 0;
 	mixsample_t m_surroundLOfsVol = 0, m_surroundROfsVol = 0;
 
+	// Stem mix buffers (interleaved stereo, MIXBUFFERSIZE frames each) and their pop reduction tail levels
+	StemLayout m_stemLayout = StemLayout::None;
+	std::vector<mixsample_t> m_stemBuffers;
+	std::vector<std::pair<mixsample_t, mixsample_t>> m_stemOfsVol;
+	std::vector<std::pair<const ModInstrument *, uint32>> m_instrumentStems;  // Instrument stems, sorted by instrument address
+
+	// Decoding state of streamed samples, one per channel (only allocated when a streamed sample is played)
+	std::vector<SampleStreamCursor> m_sampleStreamCursors;
+
+	NNAChannelCache m_nnaChannelCache;
+
 public:
 	MixerSettings m_MixerSettings;
 	CResampler m_Resampler;
@@ -413,6 +507,7 @@ public:
 #ifndef NO_DSP
 	BitCrush m_BitCrush;
 #endif
+	LoudnessMeter m_LoudnessMeter;
 
 	using samplecount_t = uint32; // Number of rendered samples
 
@@ -454,6 +549,8 @@ public:
 	uint32 m_nTempoFactor = 65536; // Tempo factor (65536 = no tempo adjustment). Only used in libopenmpt (openmpt::ext::interactive::set_tempo_factor)
 #endif
 
+	VoiceBudget m_voiceBudget;
+
 	// Row swing factors for modern tempo mode
 	TempoSwing m_tempoSwing;
 
@@ -473,6 +570,7 @@ protected:
 public:
 	ModInstrument *Instruments[MAX_INSTRUMENTS];		// Instrument Headers
 	MIDIMacroConfig m_MidiCfg;							// MIDI Macro config table
+	MIDIMacroProgramCache m_MidiMacroPrograms;			// Compiled MIDI macros from m_MidiCfg
 #ifndef NO_PLUGINS
 	SNDMIXPLUGIN m_MixPlugins[MAX_MIXPLUGINS];			// Mix plugins
 #endif
@@ -618,7 +716,12 @@ public:
 #endif // MPT_EXTERNAL_SAMPLES
 
 	bool m_bIsRendering = false;
+	bool m_previewRender = false;  // Low-cost preview quality: At most linear interpolation, no reverb, plugins or DSP effects
+	bool m_analyzeLoudness = false;  // Feed the final mix into m_LoudnessMeter
 	TimingInfo m_TimingInfo; // only valid if !m_bIsRendering
+	uint32 m_loadThreads = 1;  // Number of threads used for decoding compressed samples while loading (0 = one per CPU core)
+	uint64 m_sampleStreamThreshold = 0;  // Compressed samples whose decoded size in bytes exceeds this are decoded during playback instead of while loading (0 = never)
+	bool m_shareSamples = false;  // Share identical sample data with other samples and modules through the SampleStore after loading
 
 private:
 	// logging
@@ -927,6 +1030,11 @@ public:
 	samplecount_t Read(samplecount_t count, IAudioReadTarget &target, IAudioSource &source);
 private:
 	void CreateStereoMix(int count);
+	void PrepareStems(StemLayout layout);
+	uint32 GetVoiceStem(CHANNELINDEX nChn) const;
+	mixsample_t *GetStemBuffer(uint32 stem) { return m_stemBuffers.data() + stem * MIXBUFFERSIZE * 2; }
+public:
+	uint32 GetNumStems(StemLayout layout) const;
 public:
 	bool FadeSong(uint32 msec);
 private:
@@ -952,11 +1060,20 @@ public:
 #endif // NO_EQ
 public:
 	bool ReadNote();
+	void ApplyVoiceBudget();
 	bool ProcessRow();
 	bool ProcessEffects();
 	std::pair<bool, bool> NextRow(PlayState &playState, const bool breakRow) const;
 	void SetupNextRow(PlayState &playState, const bool patternLoop) const;
 	CHANNELINDEX GetNNAChannel(CHANNELINDEX nChn) const;
+	CHANNELINDEX AllocateNNAChannel(CHANNELINDEX nChn);
+	void BeginNNAChannelAllocation() noexcept { m_nnaChannelCache.Begin(); }
+	void EndNNAChannelAllocation() noexcept { m_nnaChannelCache.End(); }
+	void InvalidateNNAChannel(CHANNELINDEX chn) noexcept { m_nnaChannelCache.Invalidate(chn); }
+protected:
+	void RebuildNNAChannelCache();
+	bool ExamineNNAChannel(CHANNELINDEX chn);
+public:
 	CHANNELINDEX CheckNNA(CHANNELINDEX nChn, uint32 instr, int note, bool forceCut);
 	void NoteChange(ModChannel &chn, int note, bool bPorta = false, bool bResetEnv = true, bool bManual = false, CHANNELINDEX channelHint = CHANNELINDEX_INVALID) const;
 	void InstrumentChange(ModChannel &chn, uint32 instr, bool bPorta = false, bool bUpdVol = true, bool bResetEnv = true) const;
@@ -977,31 +1094,54 @@ protected:
 	void InitializeChannels();
 
 	// Channel effect processing
-	int GetVibratoDelta(int type, int position) const;
-
-	void ProcessVolumeSwing(ModChannel &chn, int &vol) const;
-	void ProcessPanningSwing(ModChannel &chn) const;
-	void ProcessTremolo(ModChannel &chn, int &vol) const;
-	void ProcessTremor(CHANNELINDEX nChn, int &vol);
-
-	bool IsEnvelopeProcessed(const ModChannel &chn, EnvelopeType env) const;
-	void ProcessVolumeEnvelope(ModChannel &chn, int &vol) const;
-	void ProcessPanningEnvelope(ModChannel &chn) const;
+	// The per-tick processing functions are templates on the playback behaviour, see PlayBehaviour.h
+	template<typename TPlayBehaviour>
+	void UpdateChannels(uint32 nMasterVol, const TPlayBehaviour &playBehaviour);
+
+	template<typename TPlayBehaviour>
+	int GetVibratoDelta(int type, int position, const TPlayBehaviour &playBehaviour) const;
+
+	template<typename TPlayBehaviour>
+	void ProcessVolumeSwing(ModChannel &chn, int &vol, const TPlayBehaviour &playBehaviour) const;
+	template<typename TPlayBehaviour>
+	void ProcessPanningSwing(ModChannel &chn, const TPlayBehaviour &playBehaviour) const;
+	template<typename TPlayBehaviour>
+	void ProcessTremolo(ModChannel &chn, int &vol, const TPlayBehaviour &playBehaviour) const;
+	template<typename TPlayBehaviour>
+	void ProcessTremor(CHANNELINDEX nChn, int &vol, const TPlayBehaviour &playBehaviour);
+
+	template<typename TPlayBehaviour>
+	bool IsEnvelopeProcessed(const ModChannel &chn, EnvelopeType env, const TPlayBehaviour &playBehaviour) const;
+	template<typename TPlayBehaviour>
+	void ProcessVolumeEnvelope(ModChannel &chn, int &vol, const TPlayBehaviour &playBehaviour) const;
+	template<typename TPlayBehaviour>
+	void ProcessPanningEnvelope(ModChannel &chn, const TPlayBehaviour &playBehaviour) const;
 	int ProcessPitchFilterEnvelope(ModChannel &chn, int &period) const;
+	template<typename TPlayBehaviour>
+	int ProcessPitchFilterEnvelope(ModChannel &chn, int &period, const TPlayBehaviour &playBehaviour) const;
 
-	void IncrementEnvelopePosition(ModChannel &chn, EnvelopeType envType) const;
+	template<typename TPlayBehaviour>
+	void IncrementEnvelopePosition(ModChannel &chn, EnvelopeType envType, const TPlayBehaviour &playBehaviour) const;
 	void IncrementEnvelopePositions(ModChannel &chn) const;
+	template<typename TPlayBehaviour>
+	void IncrementEnvelopePositions(ModChannel &chn, const TPlayBehaviour &playBehaviour) const;
 
 	void ProcessInstrumentFade(ModChannel &chn, int &vol) const;
 
 	void ProcessPitchPanSeparation(ModChannel &chn) const;
 	void ProcessPanbrello(ModChannel &chn) const;
+	template<typename TPlayBehaviour>
+	void ProcessPanbrello(ModChannel &chn, const TPlayBehaviour &playBehaviour) const;
 
-	void ProcessArpeggio(CHANNELINDEX nChn, int &period, Tuning::NOTEINDEXTYPE &arpeggioSteps);
-	void ProcessVibrato(CHANNELINDEX nChn, int &period, Tuning::RATIOTYPE &vibratoFactor);
-	void ProcessSampleAutoVibrato(ModChannel &chn, int &period, Tuning::RATIOTYPE &vibratoFactor, int &nPeriodFrac) const;
+	template<typename TPlayBehaviour>
+	void ProcessArpeggio(CHANNELINDEX nChn, int &period, Tuning::NOTEINDEXTYPE &arpeggioSteps, const TPlayBehaviour &playBehaviour);
+	template<typename TPlayBehaviour>
+	void ProcessVibrato(CHANNELINDEX nChn, int &period, Tuning::RATIOTYPE &vibratoFactor, const TPlayBehaviour &playBehaviour);
+	template<typename TPlayBehaviour>
+	void ProcessSampleAutoVibrato(ModChannel &chn, int &period, Tuning::RATIOTYPE &vibratoFactor, int &nPeriodFrac, const TPlayBehaviour &playBehaviour) const;
 
-	void ProcessRamping(ModChannel &chn) const;
+	template<typename TPlayBehaviour>
+	void ProcessRamping(ModChannel &chn, const TPlayBehaviour &playBehaviour) const;
 
 	SamplePosition GetChannelIncrement(const ModChannel &chn, uint32 period, int periodFrac) const;
 
@@ -1054,7 +1194,7 @@ protected:
 	void GlobalVolSlide(ModCommand::PARAM param, uint8 &nOldGlobalVolSlide);
 
 	void ProcessMacroOnChannel(CHANNELINDEX nChn);
-	void ProcessMIDIMacro(CHANNELINDEX nChn, bool isSmooth, const char *macro, uint8 param = 0, PLUGINDEX plugin = 0);
+	void ProcessMIDIMacro(CHANNELINDEX nChn, bool isSmooth, const MIDIMacroProgram &macro, uint8 param = 0, PLUGINDEX plugin = 0);
 	float CalculateSmoothParamChange(float currentValue, float param) const;
 	uint32 SendMIDIData(CHANNELINDEX nChn, bool isSmooth, const unsigned char *macro, uint32 macroLen, PLUGINDEX plugin);
 	void SendMIDINote(CHANNELINDEX chn, uint16 note, uint16 volume);
@@ -1090,6 +1230,19 @@ public:
 	bool DestroySample(SAMPLEINDEX nSample);
 	bool DestroySampleThreadsafe(SAMPLEINDEX nSample);
 
+	// Amount of memory in bytes used by sample data, including streamed sample caches. Buffers shared between several sample slots
+	// are counted once, buffers shared with other modules are counted in full. If shared is not nullptr, it receives the amount of
+	// memory in bytes used by buffers that are shared with other samples through the SampleStore.
+	std::size_t GetSampleMemoryUsage(std::size_t *shared = nullptr) const;
+	// Check if the MOD invert loop effect (EFx) can modify the data of looped samples during playback.
+	// Such samples are not shared through the SampleStore, so that the mixer thread never has to copy them.
+	bool UsesInvertLoop() const;
+	// Hash of the playback and mixer state that determines all further output, for checking if two instances of the same module
+	// with the same settings render identically from here on. Returns std::nullopt if the state has parts that cannot be compared:
+	// DSP effects, plugins, OPL, stems, streamed samples or channels that point to sample data outside of the module's sample slots.
+	// The random generator is not covered, as it is seeded differently for every instance.
+	std::optional<uint64> GetPlaybackStateHash() const;
+
 	// Find an unused sample slot. If it is going to be assigned to an instrument, targetInstrument should be specified.
 	// SAMPLEINDEX_INVLAID is returned if no free sample slot could be found.
 	SAMPLEINDEX GetNextFreeSample(INSTRUMENTINDEX targetInstrument = INSTRUMENTINDEX_INVALID, SAMPLEINDEX start = 1) const;
@@ -1181,8 +1334,8 @@ public:
 	void ProcessMidiOut(CHANNELINDEX nChn);
 #endif // NO_PLUGINS
 
-	void ProcessGlobalVolume(long countChunk);
-	void ProcessStereoSeparation(long countChunk);
+	int32 PrepareGlobalVolumeRamp();
+	void ProcessMasterGain(uint32 countChunk);
 
 private:
 	PLUGINDEX GetChannelPlugin(CHANNELINDEX nChn, PluginMutePriority respectMutes) const;
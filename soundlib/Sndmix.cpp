@@ -106,6 +106,7 @@ void CSoundFile::InitPlayer(bool bReset)
 #ifndef NO_DSP
 	m_BitCrush.Initialize(bReset, m_MixerSettings.gdwMixingFreq);
 #endif
+	m_LoudnessMeter.Initialize(m_MixerSettings.gdwMixingFreq);
 	if(m_opl)
 	{
 		m_opl->Initialize(m_MixerSettings.gdwMixingFreq);
@@ -136,28 +137,33 @@ bool CSoundFile::FadeSong(uint32 msec)
 }
 
 
-// Apply stereo separation factor on an interleaved stereo/quad stream.
-// count = Number of stereo sample pairs to process
+// Stereo separation factor, applied as mid/side processing on stereo sample pairs.
 // separation = -256...256 (negative values = swap L/R, 0 = mono, 128 = normal)
-static void ApplyStereoSeparation(mixsample_t *mixBuf, std::size_t count, int32 separation)
+class StereoSeparation
 {
 #ifdef MPT_INTMIXER
-	const mixsample_t factor_num = separation; // 128 =^= 1.0f
-	const mixsample_t factor_den = MixerSettings::StereoSeparationScale; // 128
-	const mixsample_t normalize_den = 2; // mid/side pre/post normalization
-	const mixsample_t mid_den = normalize_den;
-	const mixsample_t side_num = factor_num;
-	const mixsample_t side_den = factor_den * normalize_den;
+	static constexpr mixsample_t factor_den = MixerSettings::StereoSeparationScale; // 128
+	static constexpr mixsample_t normalize_den = 2; // mid/side pre/post normalization
+	static constexpr mixsample_t mid_den = normalize_den;
+	static constexpr mixsample_t side_den = factor_den * normalize_den;
+	mixsample_t side_num; // 128 =^= 1.0f
 #else
-	const float normalize_factor = 0.5f; // cumulative mid/side normalization factor (1/sqrt(2))*(1/sqrt(2))
-	const float factor = static_cast<float>(separation) / static_cast<float>(MixerSettings::StereoSeparationScale); // sep / 128
-	const float mid_factor = normalize_factor;
-	const float side_factor = factor * normalize_factor;
+	static constexpr float normalize_factor = 0.5f; // cumulative mid/side normalization factor (1/sqrt(2))*(1/sqrt(2))
+	static constexpr float mid_factor = normalize_factor;
+	float side_factor;
 #endif
-	for(std::size_t i = 0; i < count; i++)
+
+public:
+	explicit StereoSeparation(int32 separation)
+#ifdef MPT_INTMIXER
+		: side_num(separation)
+#else
+		: side_factor(static_cast<float>(separation) / static_cast<float>(MixerSettings::StereoSeparationScale) * normalize_factor)
+#endif
+	{ }
+
+	MPT_FORCEINLINE void Apply(mixsample_t &l, mixsample_t &r) const
 	{
-		mixsample_t l = mixBuf[0];
-		mixsample_t r = mixBuf[1];
 		mixsample_t m = l + r;
 		mixsample_t s = l - r;
 #ifdef MPT_INTMIXER
@@ -169,21 +175,99 @@ static void ApplyStereoSeparation(mixsample_t *mixBuf, std::size_t count, int32
 #endif
 		l = m + s;
 		r = m - s;
-		mixBuf[0] = l;
-		mixBuf[1] = r;
-		mixBuf += 2;
+	}
+};
+
+
+// Master global volume and its ramping state, as prepared by CSoundFile::PrepareGlobalVolumeRamp
+struct GlobalVolumeRamp
+{
+	int32 globalVolume;
+	int32 step;
+	int32 samplesToRampDest;
+	int32 highResRampingGlobalVolume;
+};
+
+
+template<int channels, bool applyGlobalVolume, bool applySeparation>
+MPT_FORCEINLINE void ApplyMasterGainToFrame(mixsample_t *frontBuffer, mixsample_t *rearBuffer, uint32 pos, int32 volNum, int32 volDen, const StereoSeparation &separation)
+{
+	if constexpr(channels == 1)
+	{
+		// Downmix in-place: Frame pos is read from offset 2 * pos before sample pos is written.
+		mixsample_t m = (frontBuffer[pos * 2] + frontBuffer[pos * 2 + 1]) / 2;
+		if constexpr(applyGlobalVolume) m = Util::muldiv(m, volNum, volDen);
+		frontBuffer[pos] = m;
+		MPT_UNUSED_VARIABLE(rearBuffer);
+		MPT_UNUSED_VARIABLE(separation);
+	} else
+	{
+		mixsample_t l = frontBuffer[pos * 2], r = frontBuffer[pos * 2 + 1];
+		if constexpr(applyGlobalVolume) { l = Util::muldiv(l, volNum, volDen); r = Util::muldiv(r, volNum, volDen); }
+		if constexpr(applySeparation) separation.Apply(l, r);
+		frontBuffer[pos * 2] = l;
+		frontBuffer[pos * 2 + 1] = r;
+		if constexpr(channels == 4)
+		{
+			l = rearBuffer[pos * 2];
+			r = rearBuffer[pos * 2 + 1];
+			if constexpr(applyGlobalVolume) { l = Util::muldiv(l, volNum, volDen); r = Util::muldiv(r, volNum, volDen); }
+			if constexpr(applySeparation) separation.Apply(l, r);
+			rearBuffer[pos * 2] = l;
+			rearBuffer[pos * 2 + 1] = r;
+		} else
+		{
+			MPT_UNUSED_VARIABLE(rearBuffer);
+		}
+	}
+	if constexpr(!applyGlobalVolume)
+	{
+		MPT_UNUSED_VARIABLE(volNum);
+		MPT_UNUSED_VARIABLE(volDen);
 	}
 }
 
 
-static void ApplyStereoSeparation(mixsample_t *SoundFrontBuffer, mixsample_t *SoundRearBuffer, std::size_t channels, std::size_t countChunk, int32 separation)
+// Apply mono downmix (for channels == 1), ramped global volume and stereo separation to the stereo (or quad) mix buffer in a single pass.
+// Frames that are still ramping are processed first, the constant-volume remainder of the chunk runs without any per-frame state.
+template<int channels, bool applyGlobalVolume, bool applySeparation>
+static void ApplyMasterGain(mixsample_t *frontBuffer, mixsample_t *rearBuffer, uint32 count, GlobalVolumeRamp &volume, const StereoSeparation &separation)
 {
-	if(separation == MixerSettings::StereoSeparationScale)
-	{ // identity
-		return;
+	static_assert(channels == 1 || channels == 2 || channels == 4);
+	uint32 pos = 0;
+	if constexpr(applyGlobalVolume)
+	{
+		const uint32 rampFrames = std::min(count, static_cast<uint32>(std::max(volume.samplesToRampDest, int32(0))));
+		for(; pos < rampFrames; pos++)
+		{
+			volume.highResRampingGlobalVolume += volume.step;
+			ApplyMasterGainToFrame<channels, true, applySeparation>(frontBuffer, rearBuffer, pos, volume.highResRampingGlobalVolume, MAX_GLOBAL_VOLUME << VOLUMERAMPPRECISION, separation);
+		}
+		volume.samplesToRampDest -= rampFrames;
+		if(pos < count)
+		{
+			volume.highResRampingGlobalVolume = volume.globalVolume << VOLUMERAMPPRECISION;
+		}
 	}
-	if(channels >= 2) ApplyStereoSeparation(SoundFrontBuffer, countChunk, separation);
-	if(channels >= 4) ApplyStereoSeparation(SoundRearBuffer , countChunk, separation);
+	const int32 globalVolume = volume.globalVolume;
+	for(; pos < count; pos++)
+	{
+		ApplyMasterGainToFrame<channels, applyGlobalVolume, applySeparation>(frontBuffer, rearBuffer, pos, globalVolume, MAX_GLOBAL_VOLUME, separation);
+	}
+}
+
+
+template<int channels>
+static void ApplyMasterGain(mixsample_t *frontBuffer, mixsample_t *rearBuffer, uint32 count, bool applyGlobalVolume, bool applySeparation, GlobalVolumeRamp &volume, const StereoSeparation &separation)
+{
+	if(applyGlobalVolume && applySeparation)
+		ApplyMasterGain<channels, true, true>(frontBuffer, rearBuffer, count, volume, separation);
+	else if(applyGlobalVolume)
+		ApplyMasterGain<channels, true, false>(frontBuffer, rearBuffer, count, volume, separation);
+	else if(applySeparation)
+		ApplyMasterGain<channels, false, true>(frontBuffer, rearBuffer, count, volume, separation);
+	else
+		ApplyMasterGain<channels, false, false>(frontBuffer, rearBuffer, count, volume, separation);
 }
 
 
@@ -202,15 +286,57 @@ void CSoundFile::ProcessInputChannels(IAudioSource &source, std::size_t countChu
 }
 
 
+uint32 CSoundFile::GetNumStems(StemLayout layout) const
+{
+	switch(layout)
+	{
+	case StemLayout::Channels:
+		return GetNumChannels();
+	case StemLayout::Instruments:
+		return GetNumInstruments() ? GetNumInstruments() : GetNumSamples();
+	default:
+		return 0;
+	}
+}
+
+
+void CSoundFile::PrepareStems(StemLayout layout)
+{
+	m_stemLayout = layout;
+	const uint32 numStems = GetNumStems(layout);
+	if(layout != StemLayout::None && m_stemOfsVol.size() != numStems)
+	{
+		m_stemBuffers.assign(numStems * MIXBUFFERSIZE * 2, 0);
+		m_stemOfsVol.assign(numStems, {0, 0});
+	}
+	// Instruments may have been replaced since the last call (e.g. when editing in the tracker), so the lookup table is rebuilt every time.
+	m_instrumentStems.clear();
+	if(layout == StemLayout::Instruments)
+	{
+		for(INSTRUMENTINDEX ins = 1; ins <= GetNumInstruments(); ins++)
+		{
+			if(Instruments[ins] != nullptr)
+				m_instrumentStems.emplace_back(Instruments[ins], ins - 1);
+		}
+		std::sort(m_instrumentStems.begin(), m_instrumentStems.end(), [](const auto &l, const auto &r)
+		{
+			return std::less<const ModInstrument *>()(l.first, r.first) || (l.first == r.first && l.second < r.second);
+		});
+	}
+}
+
+
 CSoundFile::samplecount_t CSoundFile::Read(samplecount_t count, IAudioReadTarget &target, IAudioSource &source)
 {
 	MPT_ASSERT_ALWAYS(m_MixerSettings.IsValid());
 
+	PrepareStems(target.GetStemLayout());
+
 	bool mixPlugins = false;
 #ifndef NO_PLUGINS
 	for(const auto &plug : m_MixPlugins)
 	{
-		if(plug.pMixPlugin)
+		if(plug.pMixPlugin && !m_previewRender)
 		{
 			mixPlugins = true;
 			break;
@@ -304,7 +430,10 @@ CSoundFile::samplecount_t CSoundFile::Read(samplecount_t count, IAudioReadTarget
 		}
 
 		#ifndef NO_REVERB
-			m_Reverb.Process(MixSoundBuffer, countChunk);
+			if(!m_previewRender)
+			{
+				m_Reverb.Process(MixSoundBuffer, countChunk);
+			}
 		#endif // NO_REVERB
 
 		if(mixPlugins)
@@ -312,29 +441,30 @@ CSoundFile::samplecount_t CSoundFile::Read(samplecount_t count, IAudioReadTarget
 			ProcessPlugins(countChunk);
 		}
 
-		if(m_MixerSettings.gnChannels == 1)
-		{
-			MonoFromStereo(MixSoundBuffer, countChunk);
-		}
+		// Mono downmix, global volume and stereo separation
+		ProcessMasterGain(countChunk);
 
-		if(m_PlayConfig.getGlobalVolumeAppliesToMaster())
+		if(m_MixerSettings.DSPMask && !m_previewRender)
 		{
-			ProcessGlobalVolume(countChunk);
+			ProcessDSP(countChunk);
 		}
 
-		if(m_MixerSettings.m_nStereoSeparation != MixerSettings::StereoSeparationScale)
+		if(m_MixerSettings.gnChannels == 4)
 		{
-			ProcessStereoSeparation(countChunk);
+			InterleaveFrontRear(MixSoundBuffer, MixRearBuffer, countChunk);
 		}
 
-		if(m_MixerSettings.DSPMask)
+		if(m_analyzeLoudness)
 		{
-			ProcessDSP(countChunk);
+			m_LoudnessMeter.Process(MixSoundBuffer, m_MixerSettings.gnChannels, countChunk);
 		}
 
-		if(m_MixerSettings.gnChannels == 4)
+		if(m_stemLayout != StemLayout::None)
 		{
-			InterleaveFrontRear(MixSoundBuffer, MixRearBuffer, countChunk);
+			for(uint32 stem = 0; stem < m_stemOfsVol.size(); stem++)
+			{
+				target.StemCallback(GetStemBuffer(stem), stem, countChunk);
+			}
 		}
 
 		target.DataCallback(MixSoundBuffer, m_MixerSettings.gnChannels, countChunk);
@@ -793,10 +923,11 @@ void CSoundFile::SetupNextRow(PlayState &playState, const bool patternLoop) cons
 
 
 // Calculate delta for Vibrato / Tremolo / Panbrello effect
-int CSoundFile::GetVibratoDelta(int type, int position) const
+template<typename TPlayBehaviour>
+int CSoundFile::GetVibratoDelta(int type, int position, const TPlayBehaviour &playBehaviour) const
 {
 	// IT compatibility: IT has its own, more precise tables
-	if(m_playBehaviour[kITVibratoTremoloPanbrello])
+	if(playBehaviour[kITVibratoTremoloPanbrello])
 	{
 		position &= 0xFF;
 		switch(type & 0x03)
@@ -811,7 +942,7 @@ int CSoundFile::GetVibratoDelta(int type, int position) const
 		case 3:	// Random
 			return mpt::random<int, 7>(AccessPRNG()) - 0x40;
 		}
-	} else if(GetType() & (MOD_TYPE_DIGI | MOD_TYPE_DBM))
+	} else if(playBehaviour.GetType() & (MOD_TYPE_DIGI | MOD_TYPE_DBM))
 	{
 		// Other waveforms are not supported.
 		static constexpr int8 DBMSinus[] =
@@ -839,13 +970,14 @@ int CSoundFile::GetVibratoDelta(int type, int position) const
 }
 
 
-void CSoundFile::ProcessVolumeSwing(ModChannel &chn, int &vol) const
+template<typename TPlayBehaviour>
+void CSoundFile::ProcessVolumeSwing(ModChannel &chn, int &vol, const TPlayBehaviour &playBehaviour) const
 {
-	if(m_playBehaviour[kITSwingBehaviour])
+	if(playBehaviour[kITSwingBehaviour])
 	{
 		vol += chn.nVolSwing;
 		Limit(vol, 0, 64);
-	} else if(m_playBehaviour[kMPTOldSwingBehaviour])
+	} else if(playBehaviour[kMPTOldSwingBehaviour])
 	{
 		vol += chn.nVolSwing;
 		Limit(vol, 0, 256);
@@ -859,9 +991,10 @@ void CSoundFile::ProcessVolumeSwing(ModChannel &chn, int &vol) const
 }
 
 
-void CSoundFile::ProcessPanningSwing(ModChannel &chn) const
+template<typename TPlayBehaviour>
+void CSoundFile::ProcessPanningSwing(ModChannel &chn, const TPlayBehaviour &playBehaviour) const
 {
-	if(m_playBehaviour[kITSwingBehaviour] || m_playBehaviour[kMPTOldSwingBehaviour])
+	if(playBehaviour[kITSwingBehaviour] || playBehaviour[kMPTOldSwingBehaviour])
 	{
 		chn.nRealPan = chn.nPan + chn.nPanSwing;
 		Limit(chn.nRealPan, 0, 256);
@@ -875,7 +1008,8 @@ void CSoundFile::ProcessPanningSwing(ModChannel &chn) const
 }
 
 
-void CSoundFile::ProcessTremolo(ModChannel &chn, int &vol) const
+template<typename TPlayBehaviour>
+void CSoundFile::ProcessTremolo(ModChannel &chn, int &vol, const TPlayBehaviour &playBehaviour) const
 {
 	if (chn.dwFlags[CHN_TREMOLO])
 	{
@@ -887,13 +1021,13 @@ void CSoundFile::ProcessTremolo(ModChannel &chn, int &vol) const
 		}
 
 		// IT compatibility: Why would you not want to execute tremolo at volume 0?
-		if(vol > 0 || m_playBehaviour[kITVibratoTremoloPanbrello])
+		if(vol > 0 || playBehaviour[kITVibratoTremoloPanbrello])
 		{
 			// IT compatibility: We don't need a different attenuation here because of the different tables we're going to use
-			const uint8 attenuation = ((GetType() & (MOD_TYPE_XM | MOD_TYPE_MOD)) || m_playBehaviour[kITVibratoTremoloPanbrello]) ? 5 : 6;
+			const uint8 attenuation = ((playBehaviour.GetType() & (MOD_TYPE_XM | MOD_TYPE_MOD)) || playBehaviour[kITVibratoTremoloPanbrello]) ? 5 : 6;
 
-			int delta = GetVibratoDelta(chn.nTremoloType, chn.nTremoloPos);
-			if((chn.nTremoloType & 0x03) == 1 && m_playBehaviour[kFT2MODTremoloRampWaveform])
+			int delta = GetVibratoDelta(chn.nTremoloType, chn.nTremoloPos, playBehaviour);
+			if((chn.nTremoloType & 0x03) == 1 && playBehaviour[kFT2MODTremoloRampWaveform])
 			{
 				// FT2 compatibility: Tremolo ramp down / triangle implementation is weird and affected by vibrato position (copypaste bug)
 				// Test case: TremoloWaveforms.xm, TremoloVibrato.xm
@@ -909,7 +1043,7 @@ void CSoundFile::ProcessTremolo(ModChannel &chn, int &vol) const
 				else
 					delta = ramp;
 			}
-			if(GetType() != MOD_TYPE_DMF)
+			if(playBehaviour.GetType() != MOD_TYPE_DMF)
 			{
 				vol += (delta * chn.nTremoloDepth) / (1 << attenuation);
 			} else
@@ -918,10 +1052,10 @@ void CSoundFile::ProcessTremolo(ModChannel &chn, int &vol) const
 				vol -= (vol * chn.nTremoloDepth * (64 - delta)) / (128 * 64);
 			}
 		}
-		if(!m_SongFlags[SONG_FIRSTTICK] || ((GetType() & (MOD_TYPE_IT|MOD_TYPE_MPT)) && !m_SongFlags[SONG_ITOLDEFFECTS]))
+		if(!m_SongFlags[SONG_FIRSTTICK] || ((playBehaviour.GetType() & (MOD_TYPE_IT|MOD_TYPE_MPT)) && !m_SongFlags[SONG_ITOLDEFFECTS]))
 		{
 			// IT compatibility: IT has its own, more precise tables
-			if(m_playBehaviour[kITVibratoTremoloPanbrello])
+			if(playBehaviour[kITVibratoTremoloPanbrello])
 				chn.nTremoloPos += 4 * chn.nTremoloSpeed;
 			else
 				chn.nTremoloPos += chn.nTremoloSpeed;
@@ -930,11 +1064,12 @@ void CSoundFile::ProcessTremolo(ModChannel &chn, int &vol) const
 }
 
 
-void CSoundFile::ProcessTremor(CHANNELINDEX nChn, int &vol)
+template<typename TPlayBehaviour>
+void CSoundFile::ProcessTremor(CHANNELINDEX nChn, int &vol, const TPlayBehaviour &playBehaviour)
 {
 	ModChannel &chn = m_PlayState.Chn[nChn];
 
-	if(m_playBehaviour[kFT2Tremor])
+	if(playBehaviour[kFT2Tremor])
 	{
 		// FT2 Compatibility: Weird XM tremor.
 		// Test case: Tremor.xm
@@ -967,7 +1102,7 @@ void CSoundFile::ProcessTremor(CHANNELINDEX nChn, int &vol)
 	} else if(chn.nCommand == CMD_TREMOR)
 	{
 		// IT compatibility 12. / 13.: Tremor
-		if(m_playBehaviour[kITTremor])
+		if(playBehaviour[kITTremor])
 		{
 			if((chn.nTremorCount & 0x80) && chn.nLength)
 			{
@@ -985,13 +1120,13 @@ void CSoundFile::ProcessTremor(CHANNELINDEX nChn, int &vol)
 		{
 			uint8 ontime = chn.nTremorParam >> 4;
 			uint8 n = ontime + (chn.nTremorParam & 0x0F);	// Total tremor cycle time (On + Off)
-			if ((!(GetType() & (MOD_TYPE_IT | MOD_TYPE_MPT))) || m_SongFlags[SONG_ITOLDEFFECTS])
+			if ((!(playBehaviour.GetType() & (MOD_TYPE_IT | MOD_TYPE_MPT))) || m_SongFlags[SONG_ITOLDEFFECTS])
 			{
 				n += 2;
 				ontime++;
 			}
 			uint8 tremcount = chn.nTremorCount;
-			if(!(GetType() & MOD_TYPE_XM))
+			if(!(playBehaviour.GetType() & MOD_TYPE_XM))
 			{
 				if (tremcount >= n) tremcount = 0;
 				if (tremcount >= ontime) vol = 0;
@@ -1037,7 +1172,8 @@ void CSoundFile::ProcessTremor(CHANNELINDEX nChn, int &vol)
 }
 
 
-bool CSoundFile::IsEnvelopeProcessed(const ModChannel &chn, EnvelopeType env) const
+template<typename TPlayBehaviour>
+bool CSoundFile::IsEnvelopeProcessed(const ModChannel &chn, EnvelopeType env, const TPlayBehaviour &playBehaviour) const
 {
 	if(chn.pModInstrument == nullptr)
 	{
@@ -1047,24 +1183,25 @@ bool CSoundFile::IsEnvelopeProcessed(const ModChannel &chn, EnvelopeType env) co
 
 	// IT Compatibility: S77/S79/S7B do not disable the envelope, they just pause the counter
 	// Test cases: s77.it, EnvLoops.xm, PanSustainRelease.xm
-	bool playIfPaused = m_playBehaviour[kITEnvelopePositionHandling] || m_playBehaviour[kFT2PanSustainRelease];
+	bool playIfPaused = playBehaviour[kITEnvelopePositionHandling] || playBehaviour[kFT2PanSustainRelease];
 	return ((chn.GetEnvelope(env).flags[ENV_ENABLED] || (insEnv.dwFlags[ENV_ENABLED] && playIfPaused))
 		&& !insEnv.empty());
 }
 
 
-void CSoundFile::ProcessVolumeEnvelope(ModChannel &chn, int &vol) const
+template<typename TPlayBehaviour>
+void CSoundFile::ProcessVolumeEnvelope(ModChannel &chn, int &vol, const TPlayBehaviour &playBehaviour) const
 {
-	if(IsEnvelopeProcessed(chn, ENV_VOLUME))
+	if(IsEnvelopeProcessed(chn, ENV_VOLUME, playBehaviour))
 	{
 		const ModInstrument *pIns = chn.pModInstrument;
 
-		if(m_playBehaviour[kITEnvelopePositionHandling] && chn.VolEnv.nEnvPosition == 0)
+		if(playBehaviour[kITEnvelopePositionHandling] && chn.VolEnv.nEnvPosition == 0)
 		{
 			// If the envelope is disabled at the very same moment as it is triggered, we do not process anything.
 			return;
 		}
-		const int envpos = chn.VolEnv.nEnvPosition - (m_playBehaviour[kITEnvelopePositionHandling] ? 1 : 0);
+		const int envpos = chn.VolEnv.nEnvPosition - (playBehaviour[kITEnvelopePositionHandling] ? 1 : 0);
 		// Get values in [0, 256]
 		int envval = pIns->VolEnv.GetValueFromPosition(envpos, 256);
 
@@ -1083,7 +1220,7 @@ void CSoundFile::ProcessVolumeEnvelope(ModChannel &chn, int &vol) const
 			if(envpos == pIns->VolEnv[pIns->VolEnv.nReleaseNode].tick)
 				envval = envValueAtReleaseNode;
 
-			if(m_playBehaviour[kLegacyReleaseNode])
+			if(playBehaviour[kLegacyReleaseNode])
 			{
 				// Old, hard to grasp release node behaviour (additive)
 				int relativeVolumeChange = (envval - envValueAtReleaseNode) * 2;
@@ -1103,19 +1240,20 @@ void CSoundFile::ProcessVolumeEnvelope(ModChannel &chn, int &vol) const
 }
 
 
-void CSoundFile::ProcessPanningEnvelope(ModChannel &chn) const
+template<typename TPlayBehaviour>
+void CSoundFile::ProcessPanningEnvelope(ModChannel &chn, const TPlayBehaviour &playBehaviour) const
 {
-	if(IsEnvelopeProcessed(chn, ENV_PANNING))
+	if(IsEnvelopeProcessed(chn, ENV_PANNING, playBehaviour))
 	{
 		const ModInstrument *pIns = chn.pModInstrument;
 
-		if(m_playBehaviour[kITEnvelopePositionHandling] && chn.PanEnv.nEnvPosition == 0)
+		if(playBehaviour[kITEnvelopePositionHandling] && chn.PanEnv.nEnvPosition == 0)
 		{
 			// If the envelope is disabled at the very same moment as it is triggered, we do not process anything.
 			return;
 		}
 
-		const int envpos = chn.PanEnv.nEnvPosition - (m_playBehaviour[kITEnvelopePositionHandling] ? 1 : 0);
+		const int envpos = chn.PanEnv.nEnvPosition - (playBehaviour[kITEnvelopePositionHandling] ? 1 : 0);
 		// Get values in [-32, 32]
 		const int envval = pIns->PanEnv.GetValueFromPosition(envpos, 64) - 32;
 
@@ -1133,19 +1271,20 @@ void CSoundFile::ProcessPanningEnvelope(ModChannel &chn) const
 }
 
 
-int CSoundFile::ProcessPitchFilterEnvelope(ModChannel &chn, int &period) const
+template<typename TPlayBehaviour>
+int CSoundFile::ProcessPitchFilterEnvelope(ModChannel &chn, int &period, const TPlayBehaviour &playBehaviour) const
 {
-	if(IsEnvelopeProcessed(chn, ENV_PITCH))
+	if(IsEnvelopeProcessed(chn, ENV_PITCH, playBehaviour))
 	{
 		const ModInstrument *pIns = chn.pModInstrument;
 
-		if(m_playBehaviour[kITEnvelopePositionHandling] && chn.PitchEnv.nEnvPosition == 0)
+		if(playBehaviour[kITEnvelopePositionHandling] && chn.PitchEnv.nEnvPosition == 0)
 		{
 			// If the envelope is disabled at the very same moment as it is triggered, we do not process anything.
 			return -1;
 		}
 
-		const int envpos = chn.PitchEnv.nEnvPosition - (m_playBehaviour[kITEnvelopePositionHandling] ? 1 : 0);
+		const int envpos = chn.PitchEnv.nEnvPosition - (playBehaviour[kITEnvelopePositionHandling] ? 1 : 0);
 		// Get values in [-256, 256]
 #ifdef MODPLUG_TRACKER
 		const int32 range = ENVELOPE_MAX;
@@ -1153,9 +1292,9 @@ int CSoundFile::ProcessPitchFilterEnvelope(ModChannel &chn, int &period) const
 #else
 		// TODO: AMS2 envelopes behave differently when linear slides are off - emulate with 15 * (-128...127) >> 6
 		// Copy over vibrato behaviour for that?
-		const int32 range = GetType() == MOD_TYPE_AMS ? uint8_max : ENVELOPE_MAX;
+		const int32 range = playBehaviour.GetType() == MOD_TYPE_AMS ? uint8_max : ENVELOPE_MAX;
 		int32 amp;
-		switch(GetType())
+		switch(playBehaviour.GetType())
 		{
 		case MOD_TYPE_AMS: amp = 64; break;
 		case MOD_TYPE_MDL: amp = 192; break;
@@ -1205,7 +1344,14 @@ int CSoundFile::ProcessPitchFilterEnvelope(ModChannel &chn, int &period) const
 }
 
 
-void CSoundFile::IncrementEnvelopePosition(ModChannel &chn, EnvelopeType envType) const
+int CSoundFile::ProcessPitchFilterEnvelope(ModChannel &chn, int &period) const
+{
+	return ProcessPitchFilterEnvelope(chn, period, DynamicPlayBehaviour{m_playBehaviour, GetType()});
+}
+
+
+template<typename TPlayBehaviour>
+void CSoundFile::IncrementEnvelopePosition(ModChannel &chn, EnvelopeType envType, const TPlayBehaviour &playBehaviour) const
 {
 	ModChannel::EnvInfo &chnEnv = chn.GetEnvelope(envType);
 
@@ -1215,7 +1361,7 @@ void CSoundFile::IncrementEnvelopePosition(ModChannel &chn, EnvelopeType envType
 	}
 
 	// Increase position
-	uint32 position = chnEnv.nEnvPosition + (m_playBehaviour[kITEnvelopePositionHandling] ? 0 : 1);
+	uint32 position = chnEnv.nEnvPosition + (playBehaviour[kITEnvelopePositionHandling] ? 0 : 1);
 
 	const InstrumentEnvelope &insEnv = chn.pModInstrument->GetEnvelope(envType);
 	if(insEnv.empty())
@@ -1225,18 +1371,18 @@ void CSoundFile::IncrementEnvelopePosition(ModChannel &chn, EnvelopeType envType
 
 	bool endReached = false;
 
-	if(!m_playBehaviour[kITEnvelopePositionHandling])
+	if(!playBehaviour[kITEnvelopePositionHandling])
 	{
 		// FT2-style envelope processing.
 		if(insEnv.dwFlags[ENV_LOOP])
 		{
 			// Normal loop active
 			uint32 end = insEnv[insEnv.nLoopEnd].tick;
-			if(!(GetType() & (MOD_TYPE_XM | MOD_TYPE_MT2))) end++;
+			if(!(playBehaviour.GetType() & (MOD_TYPE_XM | MOD_TYPE_MT2))) end++;
 
 			// FT2 compatibility: If the sustain point is at the loop end and the sustain loop has been released, don't loop anymore.
 			// Test case: EnvLoops.xm
-			const bool escapeLoop = (insEnv.nLoopEnd == insEnv.nSustainEnd && insEnv.dwFlags[ENV_SUSTAIN] && chn.dwFlags[CHN_KEYOFF] && m_playBehaviour[kFT2EnvelopeEscape]);
+			const bool escapeLoop = (insEnv.nLoopEnd == insEnv.nSustainEnd && insEnv.dwFlags[ENV_SUSTAIN] && chn.dwFlags[CHN_KEYOFF] && playBehaviour[kFT2EnvelopeEscape]);
 
 			if(position == end && !escapeLoop)
 			{
@@ -1252,7 +1398,7 @@ void CSoundFile::IncrementEnvelopePosition(ModChannel &chn, EnvelopeType envType
 				position = insEnv[insEnv.nSustainStart].tick;
 				// FT2 compatibility: If the panning envelope reaches its sustain point before key-off, it stays there forever.
 				// Test case: PanSustainRelease.xm
-				if(m_playBehaviour[kFT2PanSustainRelease] && envType == ENV_PANNING && !chn.dwFlags[CHN_KEYOFF])
+				if(playBehaviour[kFT2PanSustainRelease] && envType == ENV_PANNING && !chn.dwFlags[CHN_KEYOFF])
 				{
 					chnEnv.flags.reset(ENV_ENABLED);
 				}
@@ -1275,7 +1421,7 @@ void CSoundFile::IncrementEnvelopePosition(ModChannel &chn, EnvelopeType envType
 
 		// IT compatiblity: OpenMPT processes the key-off flag earlier than IT. Grab the flag from the previous tick instead.
 		// Test case: EnvOffLength.it
-		if(insEnv.dwFlags[ENV_SUSTAIN] && !chn.dwOldFlags[CHN_KEYOFF] && (chnEnv.nEnvValueAtReleaseJump == NOT_YET_RELEASED || m_playBehaviour[kReleaseNodePastSustainBug]))
+		if(insEnv.dwFlags[ENV_SUSTAIN] && !chn.dwOldFlags[CHN_KEYOFF] && (chnEnv.nEnvValueAtReleaseJump == NOT_YET_RELEASED || playBehaviour[kReleaseNodePastSustainBug]))
 		{
 			// Envelope sustained
 			start = insEnv[insEnv.nSustainStart].tick;
@@ -1305,12 +1451,12 @@ void CSoundFile::IncrementEnvelopePosition(ModChannel &chn, EnvelopeType envType
 	if(envType == ENV_VOLUME && endReached)
 	{
 		// Special handling for volume envelopes at end of envelope
-		if((GetType() & (MOD_TYPE_IT | MOD_TYPE_MPT)) || (chn.dwFlags[CHN_KEYOFF] && GetType() != MOD_TYPE_MDL))
+		if((playBehaviour.GetType() & (MOD_TYPE_IT | MOD_TYPE_MPT)) || (chn.dwFlags[CHN_KEYOFF] && playBehaviour.GetType() != MOD_TYPE_MDL))
 		{
 			chn.dwFlags.set(CHN_NOTEFADE);
 		}
 
-		if(insEnv.back().value == 0 && (chn.nMasterChn > 0 || (GetType() & (MOD_TYPE_IT | MOD_TYPE_MPT))))
+		if(insEnv.back().value == 0 && (chn.nMasterChn > 0 || (playBehaviour.GetType() & (MOD_TYPE_IT | MOD_TYPE_MPT))))
 		{
 			// Stop channel if the last envelope node is silent anyway.
 			chn.dwFlags.set(CHN_NOTEFADE);
@@ -1320,18 +1466,25 @@ void CSoundFile::IncrementEnvelopePosition(ModChannel &chn, EnvelopeType envType
 		}
 	}
 
-	chnEnv.nEnvPosition = position + (m_playBehaviour[kITEnvelopePositionHandling] ? 1 : 0);
+	chnEnv.nEnvPosition = position + (playBehaviour[kITEnvelopePositionHandling] ? 1 : 0);
 
 }
 
 
-void CSoundFile::IncrementEnvelopePositions(ModChannel &chn) const
+template<typename TPlayBehaviour>
+void CSoundFile::IncrementEnvelopePositions(ModChannel &chn, const TPlayBehaviour &playBehaviour) const
 {
-	if (chn.isFirstTick && GetType() == MOD_TYPE_MED)
+	if (chn.isFirstTick && playBehaviour.GetType() == MOD_TYPE_MED)
 		return;
-	IncrementEnvelopePosition(chn, ENV_VOLUME);
-	IncrementEnvelopePosition(chn, ENV_PANNING);
-	IncrementEnvelopePosition(chn, ENV_PITCH);
+	IncrementEnvelopePosition(chn, ENV_VOLUME, playBehaviour);
+	IncrementEnvelopePosition(chn, ENV_PANNING, playBehaviour);
+	IncrementEnvelopePosition(chn, ENV_PITCH, playBehaviour);
+}
+
+
+void CSoundFile::IncrementEnvelopePositions(ModChannel &chn) const
+{
+	IncrementEnvelopePositions(chn, DynamicPlayBehaviour{m_playBehaviour, GetType()});
 }
 
 
@@ -1369,23 +1522,24 @@ void CSoundFile::ProcessPitchPanSeparation(ModChannel &chn) const
 }
 
 
-void CSoundFile::ProcessPanbrello(ModChannel &chn) const
+template<typename TPlayBehaviour>
+void CSoundFile::ProcessPanbrello(ModChannel &chn, const TPlayBehaviour &playBehaviour) const
 {
 	int pdelta = chn.nPanbrelloOffset;
 	if(chn.rowCommand.command == CMD_PANBRELLO)
 	{
 		uint32 panpos;
 		// IT compatibility: IT has its own, more precise tables
-		if(m_playBehaviour[kITVibratoTremoloPanbrello])
+		if(playBehaviour[kITVibratoTremoloPanbrello])
 			panpos = chn.nPanbrelloPos;
 		else
 			panpos = ((chn.nPanbrelloPos + 0x10) >> 2);
 
-		pdelta = GetVibratoDelta(chn.nPanbrelloType, panpos);
+		pdelta = GetVibratoDelta(chn.nPanbrelloType, panpos, playBehaviour);
 
 		// IT compatibility: Sample-and-hold style random panbrello (tremolo and vibrato don't use this mechanism in IT)
 		// Test case: RandomWaveform.it
-		if(m_playBehaviour[kITSampleAndHoldPanbrello] && chn.nPanbrelloType == 3)
+		if(playBehaviour[kITSampleAndHoldPanbrello] && chn.nPanbrelloType == 3)
 		{
 			if(chn.nPanbrelloPos == 0 || chn.nPanbrelloPos >= chn.nPanbrelloSpeed)
 			{
@@ -1400,7 +1554,7 @@ void CSoundFile::ProcessPanbrello(ModChannel &chn) const
 		}
 		// IT compatibility: Panbrello effect is active until next note or panning command.
 		// Test case: PanbrelloHold.it
-		if(m_playBehaviour[kITPanbrelloHold])
+		if(playBehaviour[kITPanbrelloHold])
 		{
 			chn.nPanbrelloOffset = static_cast<int8>(pdelta);
 		}
@@ -1414,7 +1568,14 @@ void CSoundFile::ProcessPanbrello(ModChannel &chn) const
 }
 
 
-void CSoundFile::ProcessArpeggio(CHANNELINDEX nChn, int &period, Tuning::NOTEINDEXTYPE &arpeggioSteps)
+void CSoundFile::ProcessPanbrello(ModChannel &chn) const
+{
+	ProcessPanbrello(chn, DynamicPlayBehaviour{m_playBehaviour, GetType()});
+}
+
+
+template<typename TPlayBehaviour>
+void CSoundFile::ProcessArpeggio(CHANNELINDEX nChn, int &period, Tuning::NOTEINDEXTYPE &arpeggioSteps, const TPlayBehaviour &playBehaviour)
 {
 	ModChannel &chn = m_PlayState.Chn[nChn];
 
@@ -1481,13 +1642,13 @@ void CSoundFile::ProcessArpeggio(CHANNELINDEX nChn, int &period, Tuning::NOTEIND
 			chn.m_ReCalculateFreqOnFirstTick = true;
 		} else
 		{
-			if(GetType() == MOD_TYPE_MT2 && m_SongFlags[SONG_FIRSTTICK])
+			if(playBehaviour.GetType() == MOD_TYPE_MT2 && m_SongFlags[SONG_FIRSTTICK])
 			{
 				// MT2 resets any previous portamento when an arpeggio occurs.
 				chn.nPeriod = period = GetPeriodFromNote(chn.nNote, chn.nFineTune, chn.nC5Speed);
 			}
 
-			if(m_playBehaviour[kITArpeggio])
+			if(playBehaviour[kITArpeggio])
 			{
 				//IT playback compatibility 01 & 02
 
@@ -1506,7 +1667,7 @@ void CSoundFile::ProcessArpeggio(CHANNELINDEX nChn, int &period, Tuning::NOTEIND
 					else
 						period = Util::muldivr(period, 65536, arpRatio);
 				}
-			} else if(m_playBehaviour[kFT2Arpeggio])
+			} else if(playBehaviour[kFT2Arpeggio])
 			{
 				// FastTracker 2: Swedish tracker logic (TM) arpeggio
 				if(!m_SongFlags[SONG_FIRSTTICK])
@@ -1556,15 +1717,15 @@ void CSoundFile::ProcessArpeggio(CHANNELINDEX nChn, int &period, Tuning::NOTEIND
 				uint32 tick = m_PlayState.m_nTickCount;
 
 				// TODO other likely formats for MOD case: MED, OKT, etc
-				uint8 note = (GetType() != MOD_TYPE_MOD) ? chn.nNote : static_cast<uint8>(GetNoteFromPeriod(period, chn.nFineTune, chn.nC5Speed));
-				if(GetType() & (MOD_TYPE_DBM | MOD_TYPE_DIGI))
+				uint8 note = (playBehaviour.GetType() != MOD_TYPE_MOD) ? chn.nNote : static_cast<uint8>(GetNoteFromPeriod(period, chn.nFineTune, chn.nC5Speed));
+				if(playBehaviour.GetType() & (MOD_TYPE_DBM | MOD_TYPE_DIGI))
 					tick += 2;
 				switch(tick % 3)
 				{
 				case 1: note += (chn.nArpeggio >> 4); break;
 				case 2: note += (chn.nArpeggio & 0x0F); break;
 				}
-				if(note != chn.nNote || (GetType() & (MOD_TYPE_DBM | MOD_TYPE_DIGI | MOD_TYPE_STM)) || m_playBehaviour[KST3PortaAfterArpeggio])
+				if(note != chn.nNote || (playBehaviour.GetType() & (MOD_TYPE_DBM | MOD_TYPE_DIGI | MOD_TYPE_STM)) || playBehaviour[KST3PortaAfterArpeggio])
 				{
 					if(m_SongFlags[SONG_PT_MODE])
 					{
@@ -1581,14 +1742,14 @@ void CSoundFile::ProcessArpeggio(CHANNELINDEX nChn, int &period, Tuning::NOTEIND
 					}
 					period = GetPeriodFromNote(note, chn.nFineTune, chn.nC5Speed);
 
-					if(GetType() & (MOD_TYPE_DBM | MOD_TYPE_DIGI | MOD_TYPE_PSM | MOD_TYPE_STM))
+					if(playBehaviour.GetType() & (MOD_TYPE_DBM | MOD_TYPE_DIGI | MOD_TYPE_PSM | MOD_TYPE_STM))
 					{
 						// The arpeggio note offset remains effective after the end of the current row in ScreamTracker 2.
 						// This fixes the flute lead in MORPH.STM by Skaven, pattern 27.
 						// Note that ScreamTracker 2.24 handles arpeggio slightly differently: It only considers the lower
 						// nibble, and switches to that note halfway through the row.
 						chn.nPeriod = period;
-					} else if(m_playBehaviour[KST3PortaAfterArpeggio])
+					} else if(playBehaviour[KST3PortaAfterArpeggio])
 					{
 						chn.nArpeggioLastNote = note;
 					}
@@ -1599,15 +1760,16 @@ void CSoundFile::ProcessArpeggio(CHANNELINDEX nChn, int &period, Tuning::NOTEIND
 }
 
 
-void CSoundFile::ProcessVibrato(CHANNELINDEX nChn, int &period, Tuning::RATIOTYPE &vibratoFactor)
+template<typename TPlayBehaviour>
+void CSoundFile::ProcessVibrato(CHANNELINDEX nChn, int &period, Tuning::RATIOTYPE &vibratoFactor, const TPlayBehaviour &playBehaviour)
 {
 	ModChannel &chn = m_PlayState.Chn[nChn];
 
 	if(chn.dwFlags[CHN_VIBRATO])
 	{
-		const bool advancePosition = !m_SongFlags[SONG_FIRSTTICK] || ((GetType() & (MOD_TYPE_IT | MOD_TYPE_MPT)) && !(m_SongFlags[SONG_ITOLDEFFECTS]));
+		const bool advancePosition = !m_SongFlags[SONG_FIRSTTICK] || ((playBehaviour.GetType() & (MOD_TYPE_IT | MOD_TYPE_MPT)) && !(m_SongFlags[SONG_ITOLDEFFECTS]));
 
-		if(GetType() == MOD_TYPE_669)
+		if(playBehaviour.GetType() == MOD_TYPE_669)
 		{
 			if(chn.nVibratoPos % 2u)
 			{
@@ -1618,10 +1780,10 @@ void CSoundFile::ProcessVibrato(CHANNELINDEX nChn, int &period, Tuning::RATIOTYP
 		}
 
 		// IT compatibility: IT has its own, more precise tables and pre-increments the vibrato position
-		if(advancePosition && m_playBehaviour[kITVibratoTremoloPanbrello])
+		if(advancePosition && playBehaviour[kITVibratoTremoloPanbrello])
 			chn.nVibratoPos += 4 * chn.nVibratoSpeed;
 
-		int vdelta = GetVibratoDelta(chn.nVibratoType, chn.nVibratoPos);
+		int vdelta = GetVibratoDelta(chn.nVibratoType, chn.nVibratoPos, playBehaviour);
 
 		if(chn.HasCustomTuning())
 		{
@@ -1636,12 +1798,12 @@ void CSoundFile::ProcessVibrato(CHANNELINDEX nChn, int &period, Tuning::RATIOTYP
 		} else
 		{
 			// Original behaviour
-			if(m_SongFlags.test_all(SONG_FIRSTTICK | SONG_PT_MODE) || ((GetType() & (MOD_TYPE_DIGI | MOD_TYPE_DBM)) && m_SongFlags[SONG_FIRSTTICK]))
+			if(m_SongFlags.test_all(SONG_FIRSTTICK | SONG_PT_MODE) || ((playBehaviour.GetType() & (MOD_TYPE_DIGI | MOD_TYPE_DBM)) && m_SongFlags[SONG_FIRSTTICK]))
 			{
 				// ProTracker doesn't apply vibrato nor advance on the first tick.
 				// Test case: VibratoReset.mod
 				return;
-			} else if((GetType() & (MOD_TYPE_XM | MOD_TYPE_MOD)) && (chn.nVibratoType & 0x03) == 1)
+			} else if((playBehaviour.GetType() & (MOD_TYPE_XM | MOD_TYPE_MOD)) && (chn.nVibratoType & 0x03) == 1)
 			{
 				// FT2 compatibility: Vibrato ramp down table is upside down.
 				// Test case: VibratoWaveforms.xm
@@ -1650,7 +1812,7 @@ void CSoundFile::ProcessVibrato(CHANNELINDEX nChn, int &period, Tuning::RATIOTYP
 
 			uint32 vdepth;
 			// IT compatibility: correct vibrato depth
-			if(m_playBehaviour[kITVibratoTremoloPanbrello])
+			if(playBehaviour[kITVibratoTremoloPanbrello])
 			{
 				// Yes, vibrato goes backwards with old effects enabled!
 				if(m_SongFlags[SONG_ITOLDEFFECTS])
@@ -1667,18 +1829,18 @@ void CSoundFile::ProcessVibrato(CHANNELINDEX nChn, int &period, Tuning::RATIOTYP
 			{
 				if(m_SongFlags[SONG_S3MOLDVIBRATO])
 					vdepth = 5;
-				else if(GetType() == MOD_TYPE_DTM)
+				else if(playBehaviour.GetType() == MOD_TYPE_DTM)
 					vdepth = 8;
-				else if(GetType() & (MOD_TYPE_DBM | MOD_TYPE_MTM))
+				else if(playBehaviour.GetType() & (MOD_TYPE_DBM | MOD_TYPE_MTM))
 					vdepth = 7;
-				else if((GetType() & (MOD_TYPE_IT | MOD_TYPE_MPT)) && !m_SongFlags[SONG_ITOLDEFFECTS])
+				else if((playBehaviour.GetType() & (MOD_TYPE_IT | MOD_TYPE_MPT)) && !m_SongFlags[SONG_ITOLDEFFECTS])
 					vdepth = 7;
 				else
 					vdepth = 6;
 
 				// ST3 compatibility: Do not distinguish between vibrato types in effect memory
 				// Test case: VibratoTypeChange.s3m
-				if(m_playBehaviour[kST3VibratoMemory] && chn.rowCommand.command == CMD_FINEVIBRATO)
+				if(playBehaviour[kST3VibratoMemory] && chn.rowCommand.command == CMD_FINEVIBRATO)
 					vdepth += 2;
 			}
 
@@ -1687,7 +1849,7 @@ void CSoundFile::ProcessVibrato(CHANNELINDEX nChn, int &period, Tuning::RATIOTYP
 			int16 midiDelta = static_cast<int16>(-vdelta);	// Periods are upside down
 #endif // NO_PLUGINS
 
-			if (m_SongFlags[SONG_LINEARSLIDES] && GetType() != MOD_TYPE_XM)
+			if (m_SongFlags[SONG_LINEARSLIDES] && playBehaviour.GetType() != MOD_TYPE_XM)
 			{
 				int l = vdelta;
 				if (l < 0)
@@ -1722,7 +1884,7 @@ void CSoundFile::ProcessVibrato(CHANNELINDEX nChn, int &period, Tuning::RATIOTYP
 
 		// Advance vibrato position - IT updates on every tick, unless "old effects" are enabled (in this case it only updates on non-first ticks like other trackers)
 		// IT compatibility: IT has its own, more precise tables and pre-increments the vibrato position
-		if(advancePosition && !m_playBehaviour[kITVibratoTremoloPanbrello])
+		if(advancePosition && !playBehaviour[kITVibratoTremoloPanbrello])
 			chn.nVibratoPos += chn.nVibratoSpeed;
 	} else if(chn.dwOldFlags[CHN_VIBRATO])
 	{
@@ -1738,7 +1900,8 @@ void CSoundFile::ProcessVibrato(CHANNELINDEX nChn, int &period, Tuning::RATIOTYP
 }
 
 
-void CSoundFile::ProcessSampleAutoVibrato(ModChannel &chn, int &period, Tuning::RATIOTYPE &vibratoFactor, int &nPeriodFrac) const
+template<typename TPlayBehaviour>
+void CSoundFile::ProcessSampleAutoVibrato(ModChannel &chn, int &period, Tuning::RATIOTYPE &vibratoFactor, int &nPeriodFrac, const TPlayBehaviour &playBehaviour) const
 {
 	// Sample Auto-Vibrato
 	if(chn.pModSample != nullptr && chn.pModSample->nVibDepth)
@@ -1755,7 +1918,7 @@ void CSoundFile::ProcessSampleAutoVibrato(ModChannel &chn, int &period, Tuning::
 		const uint32 (&fineDownTable)[16] = useFreq ? FineLinearSlideDownTable : FineLinearSlideUpTable;
 
 		// IT compatibility: Autovibrato is so much different in IT that I just put this in a separate code block, to get rid of a dozen IsCompatibilityMode() calls.
-		if(m_playBehaviour[kITVibratoTremoloPanbrello] && !hasTuning && GetType() != MOD_TYPE_MT2)
+		if(playBehaviour[kITVibratoTremoloPanbrello] && !hasTuning && playBehaviour.GetType() != MOD_TYPE_MT2)
 		{
 			if(!pSmp->nVibRate)
 				return;
@@ -1824,13 +1987,13 @@ void CSoundFile::ProcessSampleAutoVibrato(ModChannel &chn, int &period, Tuning::
 		} else
 		{
 			// MPT's autovibrato code
-			if (pSmp->nVibSweep == 0 && !(GetType() & (MOD_TYPE_IT | MOD_TYPE_MPT)))
+			if (pSmp->nVibSweep == 0 && !(playBehaviour.GetType() & (MOD_TYPE_IT | MOD_TYPE_MPT)))
 			{
 				chn.nAutoVibDepth = pSmp->nVibDepth * 256;
 			} else
 			{
 				// Calculate current autovibrato depth using vibsweep
-				if (GetType() & (MOD_TYPE_IT | MOD_TYPE_MPT))
+				if (playBehaviour.GetType() & (MOD_TYPE_IT | MOD_TYPE_MPT))
 				{
 					chn.nAutoVibDepth += pSmp->nVibSweep * 2u;
 				} else
@@ -1861,7 +2024,7 @@ void CSoundFile::ProcessSampleAutoVibrato(ModChannel &chn, int &period, Tuning::
 				break;
 			case VIB_SINE:
 			default:
-				if(GetType() != MOD_TYPE_MT2)
+				if(playBehaviour.GetType() != MOD_TYPE_MT2)
 				{
 					vdelta = -ITSinusTable[chn.nAutoVibPos & 0xFF];
 				} else
@@ -1889,7 +2052,7 @@ void CSoundFile::ProcessSampleAutoVibrato(ModChannel &chn, int &period, Tuning::
 			}
 			else //Original behavior
 			{
-				if (GetType() != MOD_TYPE_XM)
+				if (playBehaviour.GetType() != MOD_TYPE_XM)
 				{
 					int df1, df2;
 					if (n < 0)
@@ -1918,7 +2081,8 @@ void CSoundFile::ProcessSampleAutoVibrato(ModChannel &chn, int &period, Tuning::
 }
 
 
-void CSoundFile::ProcessRamping(ModChannel &chn) const
+template<typename TPlayBehaviour>
+void CSoundFile::ProcessRamping(ModChannel &chn, const TPlayBehaviour &playBehaviour) const
 {
 	chn.leftRamp = chn.rightRamp = 0;
 	if(chn.dwFlags[CHN_VOLUMERAMP] && (chn.leftVol != chn.newLeftVol || chn.rightVol != chn.newRightVol))
@@ -1928,7 +2092,7 @@ void CSoundFile::ProcessRamping(ModChannel &chn) const
 		rampLength = globalRampLength = (rampUp ? m_MixerSettings.GetVolumeRampUpSamples() : m_MixerSettings.GetVolumeRampDownSamples());
 		//XXXih: add real support for bidi ramping here
 
-		if(m_playBehaviour[kFT2VolumeRamping] && (GetType() & MOD_TYPE_XM))
+		if(playBehaviour[kFT2VolumeRamping] && (playBehaviour.GetType() & MOD_TYPE_XM))
 		{
 			// apply FT2-style super-soft volume ramping (5ms), overriding openmpt settings
 			rampLength = globalRampLength = Util::muldivr(5, m_MixerSettings.gdwMixingFreq, 1000);
@@ -2068,14 +2232,45 @@ bool CSoundFile::ReadNote()
 
 	////////////////////////////////////////////////////////////////////////////////////
 	// Update channels data
+	// The most common format configurations use code that is specialized for their playback behaviour flags.
 	m_nMixChannels = 0;
+	if(ITPlayBehaviour::Matches(GetType(), m_playBehaviour))
+		UpdateChannels(nMasterVol, ITPlayBehaviour{});
+	else if(MPTPlayBehaviour::Matches(GetType(), m_playBehaviour))
+		UpdateChannels(nMasterVol, MPTPlayBehaviour{});
+	else if(XMPlayBehaviour::Matches(GetType(), m_playBehaviour))
+		UpdateChannels(nMasterVol, XMPlayBehaviour{});
+	else if(S3MPlayBehaviour::Matches(GetType(), m_playBehaviour))
+		UpdateChannels(nMasterVol, S3MPlayBehaviour{});
+	else if(MODPlayBehaviour::Matches(GetType(), m_playBehaviour))
+		UpdateChannels(nMasterVol, MODPlayBehaviour{});
+	else
+		UpdateChannels(nMasterVol, DynamicPlayBehaviour{m_playBehaviour, GetType()});
+
+	if(m_voiceBudget.IsLimited())
+	{
+		ApplyVoiceBudget();
+	} else if(m_nMixChannels >= m_MixerSettings.m_nMaxMixChannels)
+	{
+		// If there are more channels being mixed than allowed, order them by volume and discard the most quiet ones
+		std::partial_sort(std::begin(m_PlayState.ChnMix), std::begin(m_PlayState.ChnMix) + m_MixerSettings.m_nMaxMixChannels, std::begin(m_PlayState.ChnMix) + m_nMixChannels,
+			[this](CHANNELINDEX i, CHANNELINDEX j) { return (m_PlayState.Chn[i].nRealVolume > m_PlayState.Chn[j].nRealVolume); });
+	}
+	return true;
+}
+
+
+// Update the channel data for the current tick and collect the channels that need to be mixed.
+template<typename TPlayBehaviour>
+void CSoundFile::UpdateChannels(uint32 nMasterVol, const TPlayBehaviour &playBehaviour)
+{
 	for (CHANNELINDEX nChn = 0; nChn < MAX_CHANNELS; nChn++)
 	{
 		ModChannel &chn = m_PlayState.Chn[nChn];
 		// FT2 Compatibility: Prevent notes to be stopped after a fadeout. This way, a portamento effect can pick up a faded instrument which is long enough.
 		// This occurs for example in the bassline (channel 11) of jt_burn.xm. I hope this won't break anything else...
 		// I also suppose this could decrease mixing performance a bit, but hey, which CPU can't handle 32 muted channels these days... :-)
-		if(chn.dwFlags[CHN_NOTEFADE] && (!(chn.nFadeOutVol|chn.leftVol|chn.rightVol)) && !m_playBehaviour[kFT2ProcessSilentChannels])
+		if(chn.dwFlags[CHN_NOTEFADE] && (!(chn.nFadeOutVol|chn.leftVol|chn.rightVol)) && !playBehaviour[kFT2ProcessSilentChannels])
 		{
 			chn.nLength = 0;
 			chn.nROfs = chn.nLOfs = 0;
@@ -2105,7 +2300,7 @@ bool CSoundFile::ReadNote()
 		const ModInstrument *pIns = chn.pModInstrument;
 
 		// Calc Frequency
-		int period;
+		int period = 0;
 
 		// Also process envelopes etc. when there's a plugin on this channel, for possible fake automation using volume and pan data.
 		// We only care about master channels, though, since automation only "happens" on them.
@@ -2116,10 +2311,10 @@ bool CSoundFile::ReadNote()
 			int vol = chn.nVolume;
 			int insVol = chn.nInsVol;		// This is the "SV * IV" value in ITTECH.TXT
 
-			ProcessVolumeSwing(chn, m_playBehaviour[kITSwingBehaviour] ? insVol : vol);
-			ProcessPanningSwing(chn);
-			ProcessTremolo(chn, vol);
-			ProcessTremor(nChn, vol);
+			ProcessVolumeSwing(chn, playBehaviour[kITSwingBehaviour] ? insVol : vol, playBehaviour);
+			ProcessPanningSwing(chn, playBehaviour);
+			ProcessTremolo(chn, vol, playBehaviour);
+			ProcessTremor(nChn, vol, playBehaviour);
 
 			// Clip volume and multiply (extend to 14 bits)
 			Limit(vol, 0, 256);
@@ -2128,18 +2323,18 @@ bool CSoundFile::ReadNote()
 			// Process Envelopes
 			if (pIns)
 			{
-				if(m_playBehaviour[kITEnvelopePositionHandling])
+				if(playBehaviour[kITEnvelopePositionHandling])
 				{
 					// In IT compatible mode, envelope position indices are shifted by one for proper envelope pausing,
 					// so we have to update the position before we actually process the envelopes.
 					// When using MPT behaviour, we get the envelope position for the next tick while we are still calculating the current tick,
 					// which then results in wrong position information when the envelope is paused on the next row.
 					// Test cases: s77.it
-					IncrementEnvelopePositions(chn);
+					IncrementEnvelopePositions(chn, playBehaviour);
 				}
-				ProcessVolumeEnvelope(chn, vol);
+				ProcessVolumeEnvelope(chn, vol, playBehaviour);
 				ProcessInstrumentFade(chn, vol);
-				ProcessPanningEnvelope(chn);
+				ProcessPanningEnvelope(chn, playBehaviour);
 				ProcessPitchPanSeparation(chn);
 			} else
 			{
@@ -2175,12 +2370,12 @@ bool CSoundFile::ReadNote()
 			// ST3 only clamps the final output period, but never the channel's internal period.
 			// Test case: PeriodLimit.s3m
 			if (chn.nPeriod < m_nMinPeriod
-				&& GetType() != MOD_TYPE_S3M
+				&& playBehaviour.GetType() != MOD_TYPE_S3M
 				&& !PeriodsAreFrequencies())
 			{
 				chn.nPeriod = m_nMinPeriod;
 			}
-			if(m_playBehaviour[kFT2Periods]) Clamp(chn.nPeriod, 1, 31999);
+			if(playBehaviour[kFT2Periods]) Clamp(chn.nPeriod, 1, 31999);
 			period = chn.nPeriod;
 
 			// When glissando mode is set to semitones, clamp to the next halftone.
@@ -2196,17 +2391,17 @@ bool CSoundFile::ReadNote()
 				period = chn.glissandoPeriod;
 			}
 
-			ProcessArpeggio(nChn, period, arpeggioSteps);
+			ProcessArpeggio(nChn, period, arpeggioSteps, playBehaviour);
 
 			// Preserve Amiga freq limits.
 			// In ST3, the frequency is always clamped to periods 113 to 856, while in ProTracker,
 			// the limit is variable, depending on the finetune of the sample.
-			// The int32_max test is for the arpeggio wrap-around in ProcessArpeggio().
+			// The int32_max test is for the arpeggio wrap-around in ProcessArpeggio(, playBehaviour).
 			// Test case: AmigaLimits.s3m, AmigaLimitsFinetune.mod
 			if(m_SongFlags[SONG_AMIGALIMITS | SONG_PT_MODE] && period != int32_max)
 			{
 				int limitLow = 113 * 4, limitHigh = 856 * 4;
-				if(GetType() != MOD_TYPE_S3M)
+				if(playBehaviour.GetType() != MOD_TYPE_S3M)
 				{
 					const int tableOffset = XM2MODFineTune(chn.nFineTune) * 12;
 					limitLow = ProTrackerTunedPeriods[tableOffset +  11] / 2;
@@ -2218,12 +2413,12 @@ bool CSoundFile::ReadNote()
 				Limit(chn.nPeriod, limitLow, limitHigh);
 			}
 
-			ProcessPanbrello(chn);
+			ProcessPanbrello(chn, playBehaviour);
 		}
 
 		// IT Compatibility: Ensure that there is no pan swing, panbrello, panning envelopes, etc. applied on surround channels.
 		// Test case: surround-pan.it
-		if(chn.dwFlags[CHN_SURROUND] && !m_SongFlags[SONG_SURROUNDPAN] && m_playBehaviour[kITNoSurroundPan])
+		if(chn.dwFlags[CHN_SURROUND] && !m_SongFlags[SONG_SURROUNDPAN] && playBehaviour[kITNoSurroundPan])
 		{
 			chn.nRealPan = 128;
 		}
@@ -2234,7 +2429,7 @@ bool CSoundFile::ReadNote()
 		// After MIDI macros have been processed, we can also process the pitch / filter envelope and other pitch-related things.
 		if(samplePlaying)
 		{
-			int cutoff = ProcessPitchFilterEnvelope(chn, period);
+			int cutoff = ProcessPitchFilterEnvelope(chn, period, playBehaviour);
 			if(cutoff >= 0 && chn.dwFlags[CHN_ADLIB] && m_opl)
 			{
 				// Cutoff doubles as modulator intensity for FM instruments
@@ -2245,36 +2440,36 @@ bool CSoundFile::ReadNote()
 		if(chn.rowCommand.volcmd == VOLCMD_VIBRATODEPTH &&
 			(chn.rowCommand.command == CMD_VIBRATO || chn.rowCommand.command == CMD_VIBRATOVOL || chn.rowCommand.command == CMD_FINEVIBRATO))
 		{
-			if(GetType() == MOD_TYPE_XM)
+			if(playBehaviour.GetType() == MOD_TYPE_XM)
 			{
 				// XM Compatibility: Vibrato should be advanced twice (but not added up) if both volume-column and effect column vibrato is present.
 				// Effect column vibrato parameter has precedence if non-zero.
 				// Test case: VibratoDouble.xm
 				if(!m_SongFlags[SONG_FIRSTTICK])
 					chn.nVibratoPos += chn.nVibratoSpeed;
-			} else if(GetType() & (MOD_TYPE_IT | MOD_TYPE_MPT))
+			} else if(playBehaviour.GetType() & (MOD_TYPE_IT | MOD_TYPE_MPT))
 			{
 				// IT Compatibility: Vibrato should be applied twice if both volume-colum and effect column vibrato is present.
 				// Volume column vibrato parameter has precedence if non-zero.
 				// Test case: VibratoDouble.it
 				Vibrato(chn, chn.rowCommand.vol);
-				ProcessVibrato(nChn, period, vibratoFactor);
+				ProcessVibrato(nChn, period, vibratoFactor, playBehaviour);
 			}
 		}
 		// Plugins may also receive vibrato
-		ProcessVibrato(nChn, period, vibratoFactor);
+		ProcessVibrato(nChn, period, vibratoFactor, playBehaviour);
 
 		if(samplePlaying)
 		{
 			int nPeriodFrac = 0;
-			ProcessSampleAutoVibrato(chn, period, vibratoFactor, nPeriodFrac);
+			ProcessSampleAutoVibrato(chn, period, vibratoFactor, nPeriodFrac, playBehaviour);
 
 			// Final Period
 			// ST3 only clamps the final output period, but never the channel's internal period.
 			// Test case: PeriodLimit.s3m
 			if (period <= m_nMinPeriod)
 			{
-				if(m_playBehaviour[kST3LimitPeriod]) chn.nLength = 0;	// Pattern 15 in watcha.s3m
+				if(playBehaviour[kST3LimitPeriod]) chn.nLength = 0;	// Pattern 15 in watcha.s3m
 				period = m_nMinPeriod;
 			}
 
@@ -2293,8 +2488,8 @@ bool CSoundFile::ReadNote()
 
 			if((chn.dwFlags & (CHN_ADLIB | CHN_MUTE | CHN_SYNCMUTE)) == CHN_ADLIB && m_opl)
 			{
-				const bool doProcess = m_playBehaviour[kOPLFlexibleNoteOff] || !chn.dwFlags[CHN_NOTEFADE] || GetType() == MOD_TYPE_S3M;
-				if(doProcess && !(GetType() == MOD_TYPE_S3M && chn.dwFlags[CHN_KEYOFF]))
+				const bool doProcess = playBehaviour[kOPLFlexibleNoteOff] || !chn.dwFlags[CHN_NOTEFADE] || playBehaviour.GetType() == MOD_TYPE_S3M;
+				if(doProcess && !(playBehaviour.GetType() == MOD_TYPE_S3M && chn.dwFlags[CHN_KEYOFF]))
 				{
 					// In ST3, a sample rate of 8363 Hz is mapped to middle-C, which is 261.625 Hz in a tempered scale at A4 = 440.
 					// Hence, we have to translate our "sample rate" into pitch.
@@ -2304,8 +2499,8 @@ bool CSoundFile::ReadNote()
 					milliHertz = Util::muldivr_unsigned(milliHertz, m_nFreqFactor, 65536);
 #endif  // !MODPLUG_TRACKER
 					const bool keyOff = chn.dwFlags[CHN_KEYOFF] || (chn.dwFlags[CHN_NOTEFADE] && chn.nFadeOutVol == 0);
-					if(!m_playBehaviour[kOPLNoteStopWith0Hz] || !keyOff)
-						m_opl->Frequency(nChn, milliHertz, keyOff, m_playBehaviour[kOPLBeatingOscillators]);
+					if(!playBehaviour[kOPLNoteStopWith0Hz] || !keyOff)
+						m_opl->Frequency(nChn, milliHertz, keyOff, playBehaviour[kOPLBeatingOscillators]);
 				}
 				if(doProcess)
 				{
@@ -2322,11 +2517,11 @@ bool CSoundFile::ReadNote()
 					&& ins->VolEnv.back().value == 0)
 				{
 					m_opl->NoteCut(nChn);
-					if(!m_playBehaviour[kOPLNoResetAtEnvelopeEnd])
+					if(!playBehaviour[kOPLNoResetAtEnvelopeEnd])
 						chn.dwFlags.reset(CHN_ADLIB);
 					chn.dwFlags.set(CHN_NOTEFADE);
 					chn.nFadeOutVol = 0;
-				} else if(m_playBehaviour[kOPLFlexibleNoteOff] && chn.dwFlags[CHN_NOTEFADE] && chn.nFadeOutVol == 0)
+				} else if(playBehaviour[kOPLFlexibleNoteOff] && chn.dwFlags[CHN_NOTEFADE] && chn.nFadeOutVol == 0)
 				{
 					m_opl->NoteCut(nChn);
 					chn.dwFlags.reset(CHN_ADLIB);
@@ -2345,11 +2540,11 @@ bool CSoundFile::ReadNote()
 		}
 
 		// Increment envelope positions
-		if(pIns != nullptr && !m_playBehaviour[kITEnvelopePositionHandling])
+		if(pIns != nullptr && !playBehaviour[kITEnvelopePositionHandling])
 		{
 			// In IT and FT2 compatible mode, envelope positions are updated above.
 			// Test cases: s77.it, EnvLoops.xm
-			IncrementEnvelopePositions(chn);
+			IncrementEnvelopePositions(chn, playBehaviour);
 		}
 
 		// Volume ramping
@@ -2360,7 +2555,7 @@ bool CSoundFile::ReadNote()
 		chn.nRightVU = (chn.nRightVU > VUMETER_DECAY) ? (chn.nRightVU - VUMETER_DECAY) : 0;
 
 		chn.newLeftVol = chn.newRightVol = 0;
-		chn.pCurrentSample = (chn.pModSample && chn.pModSample->HasSampleData() && chn.nLength && chn.IsSamplePlaying()) ? chn.pModSample->samplev() : nullptr;
+		chn.pCurrentSample = (chn.pModSample && chn.pModSample->HasPlayableData() && chn.nLength && chn.IsSamplePlaying()) ? chn.pModSample->GetPlaybackPointer() : nullptr;
 		if (chn.pCurrentSample || (chn.HasMIDIOutput() && !chn.dwFlags[CHN_KEYOFF | CHN_NOTEFADE]))
 		{
 			// Update VU-Meter (nRealVolume is 14-bit)
@@ -2459,6 +2654,10 @@ bool CSoundFile::ReadNote()
 				// Default to global mixer settings
 				chn.resamplingMode = m_Resampler.m_Settings.SrcMode;
 			}
+			if(m_previewRender && chn.resamplingMode != SRCMODE_NEAREST)
+			{
+				chn.resamplingMode = SRCMODE_LINEAR;
+			}
 
 			if(chn.increment.IsUnity() && !(chn.dwFlags[CHN_VIBRATO] || chn.nAutoVibDepth || chn.resamplingMode == SRCMODE_AMIGA))
 			{
@@ -2480,7 +2679,7 @@ bool CSoundFile::ReadNote()
 			if(chn.dwFlags[CHN_PINGPONGFLAG]) chn.increment.Negate();
 
 			// Setting up volume ramp
-			ProcessRamping(chn);
+			ProcessRamping(chn, playBehaviour);
 
 			// Adding the channel in the channel list
 			if(!chn.dwFlags[CHN_ADLIB])
@@ -2498,14 +2697,37 @@ bool CSoundFile::ReadNote()
 
 		chn.dwOldFlags = chn.dwFlags;
 	}
+}
+
+
+// Order the mixed channels by importance, so that the voices exceeding the voice budget are the least important ones,
+// and reduce the resampling quality of voices exceeding the full-quality budget. Voices exceeding the voice limit are skipped by CreateStereoMix.
+void CSoundFile::ApplyVoiceBudget()
+{
+	const CHANNELINDEX maxMixChannels = static_cast<CHANNELINDEX>(std::min({m_MixerSettings.m_nMaxMixChannels, uint32(m_voiceBudget.maxVoices), uint32(MAX_CHANNELS)}));
+	if(m_nMixChannels <= std::min(maxMixChannels, m_voiceBudget.fullQualityVoices))
+		return;
 
-	// If there are more channels being mixed than allowed, order them by volume and discard the most quiet ones
-	if(m_nMixChannels >= m_MixerSettings.m_nMaxMixChannels)
+	// Pattern channels first, then NNA voices by decreasing volume, then by increasing age (same volume metric as in GetNNAChannel)
+	std::array<uint64, MAX_CHANNELS> priority;
+	for(CHANNELINDEX i = 0; i < m_nMixChannels; i++)
 	{
-		std::partial_sort(std::begin(m_PlayState.ChnMix), std::begin(m_PlayState.ChnMix) + m_MixerSettings.m_nMaxMixChannels, std::begin(m_PlayState.ChnMix) + m_nMixChannels,
-			[this](CHANNELINDEX i, CHANNELINDEX j) { return (m_PlayState.Chn[i].nRealVolume > m_PlayState.Chn[j].nRealVolume); });
+		const CHANNELINDEX nChn = m_PlayState.ChnMix[i];
+		const ModChannel &chn = m_PlayState.Chn[nChn];
+		uint32 vol = (static_cast<uint32>(chn.nRealVolume) << 9) | static_cast<uint32>(chn.nVolume);
+		if(chn.dwFlags[CHN_LOOP])
+			vol /= 2;
+		priority[nChn] = (uint64(nChn < GetNumChannels() ? 1 : 0) << 63) | (uint64(vol & 0x7FFFFFFF) << 32) | uint64(~chn.VolEnv.nEnvPosition);
+	}
+	std::sort(std::begin(m_PlayState.ChnMix), std::begin(m_PlayState.ChnMix) + m_nMixChannels,
+		[&priority](CHANNELINDEX i, CHANNELINDEX j) { return priority[i] > priority[j]; });
+
+	for(CHANNELINDEX i = m_voiceBudget.fullQualityVoices; i < std::min(m_nMixChannels, maxMixChannels); i++)
+	{
+		ModChannel &chn = m_PlayState.Chn[m_PlayState.ChnMix[i]];
+		if(chn.resamplingMode != SRCMODE_NEAREST)
+			chn.resamplingMode = SRCMODE_LINEAR;
 	}
-	return true;
 }
 
 
@@ -2521,9 +2743,9 @@ void CSoundFile::ProcessMacroOnChannel(CHANNELINDEX nChn)
 		if((chn.rowCommand.command == CMD_MIDI && m_SongFlags[SONG_FIRSTTICK]) || chn.rowCommand.command == CMD_SMOOTHMIDI)
 		{
 			if(chn.rowCommand.param < 0x80)
-				ProcessMIDIMacro(nChn, (chn.rowCommand.command == CMD_SMOOTHMIDI), m_MidiCfg.szMidiSFXExt[chn.nActiveMacro], chn.rowCommand.param);
+				ProcessMIDIMacro(nChn, (chn.rowCommand.command == CMD_SMOOTHMIDI), m_MidiMacroPrograms.GetParameteredMacro(m_MidiCfg, chn.nActiveMacro), chn.rowCommand.param);
 			else
-				ProcessMIDIMacro(nChn, (chn.rowCommand.command == CMD_SMOOTHMIDI), m_MidiCfg.szMidiZXXExt[(chn.rowCommand.param & 0x7F)], 0);
+				ProcessMIDIMacro(nChn, (chn.rowCommand.command == CMD_SMOOTHMIDI), m_MidiMacroPrograms.GetFixedMacro(m_MidiCfg, chn.rowCommand.param & 0x7F), 0);
 		}
 	}
 }
@@ -2638,37 +2860,7 @@ void CSoundFile::ProcessMidiOut(CHANNELINDEX nChn)
 #endif // NO_PLUGINS
 
 
-template<int channels>
-MPT_FORCEINLINE void ApplyGlobalVolumeWithRamping(int32 *SoundBuffer, int32 *RearBuffer, int32 lCount, int32 m_nGlobalVolume, int32 step, int32 &m_nSamplesToGlobalVolRampDest, int32 &m_lHighResRampingGlobalVolume)
-{
-	const bool isStereo = (channels >= 2);
-	const bool hasRear = (channels >= 4);
-	for(int pos = 0; pos < lCount; ++pos)
-	{
-		if(m_nSamplesToGlobalVolRampDest > 0)
-		{
-			// Ramping required
-			m_lHighResRampingGlobalVolume += step;
-			                          SoundBuffer[0] = Util::muldiv(SoundBuffer[0], m_lHighResRampingGlobalVolume, MAX_GLOBAL_VOLUME << VOLUMERAMPPRECISION);
-			if constexpr(isStereo) SoundBuffer[1] = Util::muldiv(SoundBuffer[1], m_lHighResRampingGlobalVolume, MAX_GLOBAL_VOLUME << VOLUMERAMPPRECISION);
-			if constexpr(hasRear)  RearBuffer[0]  = Util::muldiv(RearBuffer[0] , m_lHighResRampingGlobalVolume, MAX_GLOBAL_VOLUME << VOLUMERAMPPRECISION); else MPT_UNUSED_VARIABLE(RearBuffer);
-			if constexpr(hasRear)  RearBuffer[1]  = Util::muldiv(RearBuffer[1] , m_lHighResRampingGlobalVolume, MAX_GLOBAL_VOLUME << VOLUMERAMPPRECISION); else MPT_UNUSED_VARIABLE(RearBuffer);
-			m_nSamplesToGlobalVolRampDest--;
-		} else
-		{
-			                          SoundBuffer[0] = Util::muldiv(SoundBuffer[0], m_nGlobalVolume, MAX_GLOBAL_VOLUME);
-			if constexpr(isStereo) SoundBuffer[1] = Util::muldiv(SoundBuffer[1], m_nGlobalVolume, MAX_GLOBAL_VOLUME);
-			if constexpr(hasRear)  RearBuffer[0]  = Util::muldiv(RearBuffer[0] , m_nGlobalVolume, MAX_GLOBAL_VOLUME); else MPT_UNUSED_VARIABLE(RearBuffer);
-			if constexpr(hasRear)  RearBuffer[1]  = Util::muldiv(RearBuffer[1] , m_nGlobalVolume, MAX_GLOBAL_VOLUME); else MPT_UNUSED_VARIABLE(RearBuffer);
-			m_lHighResRampingGlobalVolume = m_nGlobalVolume << VOLUMERAMPPRECISION;
-		}
-		SoundBuffer += isStereo ? 2 : 1;
-		if constexpr(hasRear) RearBuffer += 2;
-	}
-}
-
-
-void CSoundFile::ProcessGlobalVolume(long lCount)
+int32 CSoundFile::PrepareGlobalVolumeRamp()
 {
 
 	// should we ramp?
@@ -2716,24 +2908,56 @@ void CSoundFile::ProcessGlobalVolume(long lCount)
 		}
 	}
 
-	// apply volume and ramping
-	if(m_MixerSettings.gnChannels == 1)
-	{
-		ApplyGlobalVolumeWithRamping<1>(MixSoundBuffer, MixRearBuffer, lCount, m_PlayState.m_nGlobalVolume, step, m_PlayState.m_nSamplesToGlobalVolRampDest, m_PlayState.m_lHighResRampingGlobalVolume);
-	} else if(m_MixerSettings.gnChannels == 2)
+	return step;
+}
+
+
+void CSoundFile::ProcessMasterGain(uint32 countChunk)
+{
+	const bool applyGlobalVolume = m_PlayConfig.getGlobalVolumeAppliesToMaster();
+	const bool applySeparation = m_MixerSettings.m_nStereoSeparation != MixerSettings::StereoSeparationScale;
+	if(!applyGlobalVolume && !applySeparation && m_MixerSettings.gnChannels != 1)
 	{
-		ApplyGlobalVolumeWithRamping<2>(MixSoundBuffer, MixRearBuffer, lCount, m_PlayState.m_nGlobalVolume, step, m_PlayState.m_nSamplesToGlobalVolRampDest, m_PlayState.m_lHighResRampingGlobalVolume);
-	} else if(m_MixerSettings.gnChannels == 4)
+		return;
+	}
+
+	GlobalVolumeRamp volume{m_PlayState.m_nGlobalVolume, 0, 0, 0};
+	if(applyGlobalVolume)
 	{
-		ApplyGlobalVolumeWithRamping<4>(MixSoundBuffer, MixRearBuffer, lCount, m_PlayState.m_nGlobalVolume, step, m_PlayState.m_nSamplesToGlobalVolRampDest, m_PlayState.m_lHighResRampingGlobalVolume);
+		volume.step = PrepareGlobalVolumeRamp();
+		volume.samplesToRampDest = m_PlayState.m_nSamplesToGlobalVolRampDest;
+		volume.highResRampingGlobalVolume = m_PlayState.m_lHighResRampingGlobalVolume;
 	}
+	const StereoSeparation separation{m_MixerSettings.m_nStereoSeparation};
 
-}
+	if(m_stemLayout != StemLayout::None && (applyGlobalVolume || applySeparation))
+	{
+		// Stems follow the same ramp as the regular mix
+		for(uint32 stem = 0; stem < m_stemOfsVol.size(); stem++)
+		{
+			GlobalVolumeRamp stemVolume = volume;
+			ApplyMasterGain<2>(GetStemBuffer(stem), nullptr, countChunk, applyGlobalVolume, applySeparation, stemVolume, separation);
+		}
+	}
 
+	switch(m_MixerSettings.gnChannels)
+	{
+	case 1:
+		ApplyMasterGain<1>(MixSoundBuffer, MixRearBuffer, countChunk, applyGlobalVolume, false, volume, separation);
+		break;
+	case 2:
+		ApplyMasterGain<2>(MixSoundBuffer, MixRearBuffer, countChunk, applyGlobalVolume, applySeparation, volume, separation);
+		break;
+	case 4:
+		ApplyMasterGain<4>(MixSoundBuffer, MixRearBuffer, countChunk, applyGlobalVolume, applySeparation, volume, separation);
+		break;
+	}
 
-void CSoundFile::ProcessStereoSeparation(long countChunk)
-{
-	ApplyStereoSeparation(MixSoundBuffer, MixRearBuffer, m_MixerSettings.gnChannels, countChunk, m_MixerSettings.m_nStereoSeparation);
+	if(applyGlobalVolume)
+	{
+		m_PlayState.m_nSamplesToGlobalVolRampDest = volume.samplesToRampDest;
+		m_PlayState.m_lHighResRampingGlobalVolume = volume.highResRampingGlobalVolume;
+	}
 }
 
 
@@ -43,7 +43,7 @@ void ReplaceSample(ModSample &smp, void *pNewSample, const SmpLength newLength,
 // Propagate loop point changes to player
 bool UpdateLoopPoints(const ModSample &smp, CSoundFile &sndFile)
 {
-	if(!smp.HasSampleData())
+	if(!smp.HasPlayableData())
 		return false;
 
 	CriticalSection cs;
@@ -95,6 +95,7 @@ public:
 	bool IsInstrument() const override { return false; }
 	bool CanRecieveMidiEvents() override { return false; }
 	bool ShouldProcessSilence() override { return true; }
+	uint32 GetTailSize() const override { return m_delayTime + 1; }
 
 #ifdef MODPLUG_TRACKER
 	CString GetDefaultEffectName() override { return _T("Echo"); }
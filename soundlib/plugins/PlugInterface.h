@@ -42,6 +42,7 @@ struct SNDMIXPLUGINSTATE
 	mixsample_t *pMixBuffer = nullptr; // Stereo effect send buffer
 	uint32 dwFlags = 0;                // PluginStateFlags
 	uint32 inputSilenceCount = 0;      // How much silence has been processed? (for plugin auto-turnoff)
+	uint32 tailSilenceCount = 0;       // How long has the plugin's own output been silent without any input? (for tail-aware auto-turnoff)
 	mixsample_t nVolDecayL = 0, nVolDecayR = 0; // End of sample click removal
 
 	void ResetSilence()
@@ -49,6 +50,7 @@ struct SNDMIXPLUGINSTATE
 		dwFlags |= psfHasInput;
 		dwFlags &= ~psfSilenceBypass;
 		inputSilenceCount = 0;
+		tailSilenceCount = 0;
 	}
 };
 
@@ -165,6 +167,10 @@ public:
 	// If false is returned, mixing this plugin can be skipped if its input are currently completely silent.
 	virtual bool ShouldProcessSilence() = 0;
 	virtual void ResetSilence() { m_MixState.ResetSilence(); }
+	// Number of frames after which anything that is still stored in the plugin's delay lines has reached its output.
+	// If auto-suspend is enabled for the plugin, it is suspended as soon as it received no input and its output has been silent for this long,
+	// instead of after four seconds of silence. 0 = unknown.
+	virtual uint32 GetTailSize() const { return 0; }
 
 	size_t GetOutputPlugList(std::vector<IMixPlugin *> &list);
 	size_t GetInputPlugList(std::vector<IMixPlugin *> &list);
@@ -95,6 +95,8 @@ public:
 	bool IsInstrument() const override { return false; }
 	bool CanRecieveMidiEvents() override { return false; }
 	bool ShouldProcessSilence() override { return true; }
+	// While the echo is turned off, its delay line is kept but not played back
+	uint32 GetTailSize() const override { return (GetDSPType() != DSPType::Off) ? static_cast<uint32>(m_delayLine.size() / 2) : 0; }
 
 #ifdef MODPLUG_TRACKER
 	CString GetDefaultEffectName() override { return _T("Echo"); }
@@ -78,6 +78,7 @@ public:
 	bool IsInstrument() const override { return false; }
 	bool CanRecieveMidiEvents() override { return false; }
 	bool ShouldProcessSilence() override { return true; }
+	uint32 GetTailSize() const override { return m_bufSize; }
 
 #ifdef MODPLUG_TRACKER
 	CString GetDefaultEffectName() override { return _T("Chorus"); }
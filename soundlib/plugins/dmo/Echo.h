@@ -70,6 +70,7 @@ public:
 	bool IsInstrument() const override { return false; }
 	bool CanRecieveMidiEvents() override { return false; }
 	bool ShouldProcessSilence() override { return true; }
+	uint32 GetTailSize() const override { return std::max(m_delayTime[0], m_delayTime[1]) + 1; }
 
 #ifdef MODPLUG_TRACKER
 	CString GetDefaultEffectName() override { return _T("Echo"); }
@@ -296,6 +296,20 @@ void I3DL2Reverb::Process(float *pOutL, float *pOutR, uint32 numFrames)
 }
 
 
+uint32 I3DL2Reverb::GetTailSize() const
+{
+	uint32 length = 0;
+	for(const auto &delay : m_delayLines)
+	{
+		length += std::max(delay.Length(), int32(0));
+	}
+	// Delay lines may run at a reduced sample rate
+	if(m_effectiveSampleRate > 0.0f && m_effectiveSampleRate < static_cast<float>(m_SndFile.GetSampleRate()))
+		length = Util::muldivr_unsigned(length, m_SndFile.GetSampleRate(), static_cast<uint32>(m_effectiveSampleRate));
+	return length;
+}
+
+
 int32 I3DL2Reverb::GetNumPrograms() const
 {
 #ifdef MODPLUG_TRACKER
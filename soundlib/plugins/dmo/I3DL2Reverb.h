@@ -50,7 +50,7 @@ protected:
 
 	class DelayLine : private std::vector<float>
 	{
-		int32 m_length;
+		int32 m_length = 0;
 		int32 m_position;
 		int32 m_delayPosition;
 
@@ -61,6 +61,7 @@ protected:
 		void Set(float value);
 		float Get(int32 offset) const;
 		float Get() const;
+		int32 Length() const { return m_length; }
 	};
 
 	float m_param[kI3DL2ReverbNumParameters];
@@ -119,6 +120,7 @@ public:
 	bool IsInstrument() const override { return false; }
 	bool CanRecieveMidiEvents() override { return false; }
 	bool ShouldProcessSilence() override { return true; }
+	uint32 GetTailSize() const override;
 
 #ifdef MODPLUG_TRACKER
 	CString GetDefaultEffectName() override { return _T("I3DL2Reverb"); }
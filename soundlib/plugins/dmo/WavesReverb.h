@@ -75,6 +75,7 @@ public:
 	bool IsInstrument() const override { return false; }
 	bool CanRecieveMidiEvents() override { return false; }
 	bool ShouldProcessSilence() override { return true; }
+	uint32 GetTailSize() const override { return static_cast<uint32>(std::size(m_state.comb) + std::size(m_state.allpass1) + std::size(m_state.allpass2)); }
 
 #ifdef MODPLUG_TRACKER
 	CString GetDefaultEffectName() override { return _T("WavesReverb"); }
@@ -279,6 +279,10 @@ RATIOTYPE CTuning::GetRatio(const NOTEINDEXTYPE baseNote, const STEPINDEXTYPE ba
 	{
 		return s_DefaultFallbackRatio;
 	}
+	if(!m_RatioTableStep.empty())
+	{
+		return m_RatioTableStep[(note - m_NoteMin) * (fineStepCount + 1) + fineStep];
+	}
 	if(fineStep == 0)
 	{
 		return m_RatioTable[note - m_NoteMin];
@@ -330,6 +334,9 @@ bool CTuning::SetRatio(const NOTEINDEXTYPE& s, const RATIOTYPE& r)
 			}
 		}
 		UpdateFineStepTable();
+	} else
+	{
+		UpdateStepRatioTable();
 	}
 	return true;
 }
@@ -343,6 +350,13 @@ void CTuning::SetFineStepCount(const USTEPINDEXTYPE& fs)
 
 
 void CTuning::UpdateFineStepTable()
+{
+	UpdateFineRatioTable();
+	UpdateStepRatioTable();
+}
+
+
+void CTuning::UpdateFineRatioTable()
 {
 	if(m_FineStepCount <= 0)
 	{
@@ -404,6 +418,25 @@ void CTuning::UpdateFineStepTable()
 }
 
 
+void CTuning::UpdateStepRatioTable()
+{
+	m_RatioTableStep.clear();
+	const USTEPINDEXTYPE stepsPerNote = m_FineStepCount + 1;
+	if(m_FineStepCount <= 0 || m_RatioTable.size() > s_RatioTableStepSizeMax / stepsPerNote)
+	{
+		// Without finesteps, GetRatio is a plain table lookup anyway.
+		return;
+	}
+	// While the table is empty, GetRatio computes the ratios from scratch.
+	std::vector<RATIOTYPE> ratios(m_RatioTable.size() * stepsPerNote);
+	for(std::size_t i = 0; i < ratios.size(); i++)
+	{
+		ratios[i] = GetRatio(static_cast<NOTEINDEXTYPE>(m_NoteMin + i / stepsPerNote), static_cast<STEPINDEXTYPE>(i % stepsPerNote));
+	}
+	m_RatioTableStep = std::move(ratios);
+}
+
+
 bool CTuning::Multiply(const RATIOTYPE r)
 {
 	if(!IsValidRatio(r))
@@ -414,6 +447,7 @@ bool CTuning::Multiply(const RATIOTYPE r)
 	{
 		ratio *= r;
 	}
+	UpdateStepRatioTable();
 	return true;
 }
 
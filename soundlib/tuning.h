@@ -34,6 +34,7 @@ public:
 	static constexpr NOTEINDEXTYPE s_NoteMinDefault = -64;
 	static constexpr UNOTEINDEXTYPE s_RatioTableSizeDefault = 128;
 	static constexpr USTEPINDEXTYPE s_RatioTableFineSizeMaxDefault = 1000;
+	static constexpr USTEPINDEXTYPE s_RatioTableStepSizeMax = 65536;
 
 public:
 
@@ -204,6 +205,8 @@ private:
 	bool CreateGeometric(const UNOTEINDEXTYPE &s, const RATIOTYPE &r, const NoteRange &range);
 
 	void UpdateFineStepTable();
+	void UpdateFineRatioTable();
+	void UpdateStepRatioTable();
 
 	// GroupPeriodic-specific.
 	// Get the corresponding note in [0, period-1].
@@ -229,6 +232,11 @@ private:
 	//'Fineratios'
 	std::vector<RATIOTYPE> m_RatioTableFine;
 
+	// Ratios of all (note, finestep) combinations, indexed by (note - m_NoteMin) * (m_FineStepCount + 1) + finestep.
+	// Precomputed so that finestep slides do not have to evaluate the finestep ratios during playback.
+	// Empty if the table would become too large.
+	std::vector<RATIOTYPE> m_RatioTableStep;
+
 	// The lowest index of note in the table
 	NOTEINDEXTYPE m_NoteMin;
 
@@ -0,0 +1,586 @@
+/*
+ * benchmark.cpp
+ * -------------
+ * Purpose: Reproducible performance benchmarks for soundlib internals.
+ * Notes  : Run with "libopenmpt_test --benchmark [name...]" or "make bench".
+ *          Each case reports the fastest of several runs. Absolute numbers are only comparable between builds on the same machine;
+ *          where a case has a reference variant (e.g. the scalar code path), the ratio between the variants is what matters.
+ * Authors: OpenMPT Devs
+ * The OpenMPT source code is released under the BSD license. Read LICENSE for more details.
+ */
+
+
+#include "stdafx.h"
+#include "test.h"
+
+
+#ifdef ENABLE_TESTS
+#ifdef LIBOPENMPT_BUILD
+
+
+#include "../soundbase/SampleFormatConverters.h"
+#include "../soundbase/SampleFormatCopy.h"
+#include "../soundlib/Sndfile.h"
+#include "../soundlib/PlayBehaviour.h"
+#include "../soundlib/SampleCopyLoops.h"
+#include "../common/FileReader.h"
+#include "../common/mptRandom.h"
+#include "../common/mptStringBuffer.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+
+OPENMPT_NAMESPACE_BEGIN
+
+
+namespace Test {
+
+
+namespace {
+
+
+constexpr int BenchmarkRuns = 10;
+
+
+// Runs each function several times and returns the fastest run of each, in milliseconds.
+// The functions take turns, so that changes in machine load affect all of them alike.
+template <typename... Tfuncs>
+std::array<double, sizeof...(Tfuncs)> MeasureBest(Tfuncs &&...funcs)
+{
+	std::array<double, sizeof...(Tfuncs)> best;
+	best.fill(0.0);
+	for(int run = 0; run < BenchmarkRuns; run++)
+	{
+		std::size_t index = 0;
+		const auto measure = [&](auto &func)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			func();
+			const double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			if(run == 0 || elapsed < best[index])
+				best[index] = elapsed;
+			index++;
+		};
+		(measure(funcs), ...);
+	}
+	return best;
+}
+
+
+void PrintResult(const char *benchmark, const std::string &variant, double milliseconds)
+{
+	std::cout << "BENCH.: " << benchmark << ": " << std::left << std::setw(40) << variant << std::right << std::fixed << std::setprecision(2) << std::setw(10) << milliseconds << " ms" << std::endl;
+}
+
+
+// Keeps the compiler from optimizing away results that are never looked at
+volatile uint32 s_sink = 0;
+
+
+// Creates a module with one looped noise sample and empty 64-row patterns, each of which is played once
+std::unique_ptr<CSoundFile> CreateBenchmarkModule(MODTYPE type, CHANNELINDEX numChannels, PATTERNINDEX numPatterns)
+{
+	auto sndFile = std::make_unique<CSoundFile>();
+	sndFile->Create(FileReader(), CSoundFile::loadCompleteModule);
+	sndFile->m_nChannels = numChannels;
+	sndFile->m_nType = type;
+	sndFile->SetDefaultPlaybackBehaviour(type);
+	sndFile->m_nDefaultSpeed = 6;
+	sndFile->m_nDefaultTempo.Set(125);
+
+	sndFile->m_nSamples = 1;
+	ModSample &sample = sndFile->GetSample(1);
+	sample.Initialize(type);
+	sample.nLength = 4096;
+	sample.nC5Speed = 8363;
+	sample.uFlags.set(CHN_16BIT);
+	sample.AllocateSample();
+	mpt::deterministic_good_prng prng(0x1d872b41u);
+	for(SmpLength i = 0; i < sample.nLength; i++)
+	{
+		sample.sample16()[i] = mpt::random<int16>(prng);
+	}
+	sample.SetLoop(0, sample.nLength, true, false, *sndFile);
+
+	sndFile->Patterns.ResizeArray(numPatterns);
+	sndFile->Order().resize(numPatterns);
+	for(PATTERNINDEX pat = 0; pat < numPatterns; pat++)
+	{
+		sndFile->Patterns.Insert(pat, 64);
+		sndFile->Order()[pat] = pat;
+	}
+	return sndFile;
+}
+
+
+void RestartModule(CSoundFile &sndFile)
+{
+	sndFile.ResetPlayPos();
+	sndFile.InitPlayer(true);
+	sndFile.m_SongFlags.reset(SONG_ENDREACHED);
+}
+
+
+// Processes all ticks of the song without mixing anything
+void ProcessTicks(CSoundFile &sndFile)
+{
+	RestartModule(sndFile);
+	while(sndFile.ReadNote())
+	{
+	}
+}
+
+
+// Discards the rendered audio
+class BenchmarkTarget : public IAudioReadTarget
+{
+public:
+	void DataCallback(MixSampleInt *MixSoundBuffer, std::size_t, std::size_t) override
+	{
+		s_sink = s_sink + static_cast<uint32>(MixSoundBuffer[0]);
+	}
+	void DataCallback(MixSampleFloat *MixSoundBuffer, std::size_t, std::size_t) override
+	{
+		s_sink = s_sink + static_cast<uint32>(MixSoundBuffer[0]);
+	}
+};
+
+
+// Renders the first frames of the song
+void RenderFrames(CSoundFile &sndFile, std::size_t frames)
+{
+	RestartModule(sndFile);
+	BenchmarkTarget target;
+	while(frames > 0)
+	{
+		const std::size_t rendered = sndFile.Read(std::min(frames, std::size_t(1024)), target);
+		if(rendered == 0)
+			break;
+		frames -= rendered;
+	}
+}
+
+
+// Puts a note on every row of every channel, with varying pitches so that the voices are resampled at different rates
+void FillWithNotes(CSoundFile &sndFile)
+{
+	for(PATTERNINDEX pat = 0; pat < sndFile.Patterns.Size(); pat++)
+	{
+		for(ROWINDEX row = 0; row < sndFile.Patterns[pat].GetNumRows(); row++)
+		{
+			for(CHANNELINDEX chn = 0; chn < sndFile.GetNumChannels(); chn++)
+			{
+				ModCommand &m = *sndFile.Patterns[pat].GetpModCommand(row, chn);
+				m.note = static_cast<ModCommand::NOTE>(NOTE_MIDDLEC - 12 + (row * 5 + chn * 7) % 36);
+				m.instr = 1;
+			}
+		}
+	}
+}
+
+
+// SampleCopyLoops block converters against the scalar conversion functors they replace in CopyMonoSample
+void BenchmarkSampleConversion()
+{
+	constexpr std::size_t count = 4 * 1024 * 1024;
+	std::vector<std::byte> source(count * 4);
+	std::vector<int16> target(count);
+	mpt::deterministic_good_prng prng(0x5a3c96e1u);
+	for(std::size_t i = 0; i < source.size(); i += 4)
+	{
+		// Only finite floats in the range of a sample, so that the float formats measure the regular path
+		const float value = static_cast<float>(mpt::random<int32>(prng) % 70000) / 65536.0f;
+		const IEEE754binary32LE floatbits = IEEE754binary32LE(value);
+		for(std::size_t b = 0; b < 4; b++)
+			source[i + b] = floatbits.GetByte(b);
+	}
+
+#ifdef ENABLE_SSE2
+	const char *blockVariant = CPU::HasFeatureSet(CPU::feature::sse2) ? " block (SSE2)" : " block";
+#else
+	const char *blockVariant = " block";
+#endif
+
+	auto benchmarkFormat = [&](const char *name, auto conv)
+	{
+		using SampleConversion = decltype(conv);
+		using output_t = typename SampleConversion::output_t;
+		output_t *dst = reinterpret_cast<output_t *>(target.data());
+		const std::size_t num = count * sizeof(int16) / sizeof(output_t);
+		const auto [scalar, block] = MeasureBest(
+			[&]()
+			{
+				CopySample<SampleConversion>(dst, num, 1, source.data(), num * SampleConversion::input_inc, 1);
+				s_sink = s_sink + static_cast<uint32>(dst[num / 2]);
+			},
+			[&]()
+			{
+				ConvertSampleBlock(SampleBlockConverter<SampleConversion>::format, source.data(), dst, num);
+				s_sink = s_sink + static_cast<uint32>(dst[num / 2]);
+			});
+		PrintResult("SampleConversion", std::string(name) + " scalar", scalar);
+		PrintResult("SampleConversion", std::string(name) + blockVariant, block);
+	};
+	benchmarkFormat("8-bit unsigned", SC::DecodeUint8{});
+	benchmarkFormat("16-bit big-endian", SC::DecodeInt16<0, bigEndian16>{});
+	benchmarkFormat("24-bit little-endian", SC::ConversionChain<SC::Convert<int16, int32>, SC::DecodeInt24<0, littleEndian24>>{});
+	benchmarkFormat("32-bit float little-endian", SC::ConversionChain<SC::Convert<int16, float32>, SC::DecodeFloat32<littleEndian32>>{});
+}
+
+
+// Tick processing of a module that triggers MIDI macros on every tick of every channel, against the same module without macros.
+// There are no notes, so that the macro evaluation is not hidden behind the rest of the channel processing.
+void BenchmarkMIDIMacros()
+{
+	auto withMacros = CreateBenchmarkModule(MOD_TYPE_IT, 32, 32);
+	auto withoutMacros = CreateBenchmarkModule(MOD_TYPE_IT, 32, 32);
+	withMacros->m_MidiCfg.Reset();
+	// Set cutoff and resonance at once, like many modules with filter sweeps do
+	mpt::String::WriteAutoBuf(withMacros->m_MidiCfg.szMidiSFXExt[0]) = "Bc07z Bc0Az Bc0Bz";
+	for(PATTERNINDEX pat = 0; pat < withMacros->Patterns.Size(); pat++)
+	{
+		for(ROWINDEX row = 0; row < 64; row++)
+		{
+			for(CHANNELINDEX chn = 0; chn < withMacros->GetNumChannels(); chn++)
+			{
+				ModCommand &m = *withMacros->Patterns[pat].GetpModCommand(row, chn);
+				// Smooth parametered macros are evaluated on every tick, fixed macros on the first tick of the row
+				m.command = (row % 2) ? CMD_SMOOTHMIDI : CMD_MIDI;
+				m.param = static_cast<ModCommand::PARAM>((row * 2 + chn) & ((row % 2) ? 0x7F : 0xFF));
+			}
+		}
+	}
+	const auto [macros, noMacros] = MeasureBest(
+		[&]() { ProcessTicks(*withMacros); },
+		[&]() { ProcessTicks(*withoutMacros); });
+	PrintResult("MIDIMacros", "32 channels, Zxx / \\xx on every row", macros);
+	PrintResult("MIDIMacros", "32 channels, no macros", noMacros);
+}
+
+
+// Song length calculation (and thus RowVisitor) on long songs with nested pattern loops in every pattern.
+// Each channel loops a different part of the pattern, so there are many distinct loop states to remember.
+void BenchmarkGetLength()
+{
+	const auto createModule = [](MODTYPE type, CHANNELINDEX numChannels, ORDERINDEX numOrders)
+	{
+		auto sndFile = CreateBenchmarkModule(type, numChannels, 32);
+		const bool isMOD = (type == MOD_TYPE_MOD);
+		for(PATTERNINDEX pat = 0; pat < sndFile->Patterns.Size(); pat++)
+		{
+			for(CHANNELINDEX chn = 0; chn < numChannels; chn++)
+			{
+				// Loop rows [start, start + 8) of this channel two or three times
+				const ROWINDEX start = static_cast<ROWINDEX>(((chn * 8) + pat) % 56);
+				const ModCommand::PARAM count = static_cast<ModCommand::PARAM>(2 + (chn + pat) % 2);
+				ModCommand &loopStart = *sndFile->Patterns[pat].GetpModCommand(start, chn);
+				ModCommand &loopEnd = *sndFile->Patterns[pat].GetpModCommand(start + 7, chn);
+				loopStart.command = loopEnd.command = isMOD ? CMD_MODCMDEX : CMD_S3MCMDEX;
+				loopStart.param = isMOD ? 0x60 : 0xB0;
+				loopEnd.param = static_cast<ModCommand::PARAM>((isMOD ? 0x60 : 0xB0) | count);
+			}
+		}
+		sndFile->Order().resize(numOrders);
+		for(ORDERINDEX ord = 0; ord < numOrders; ord++)
+		{
+			sndFile->Order()[ord] = static_cast<PATTERNINDEX>((ord * 7) % sndFile->Patterns.Size());
+		}
+		return sndFile;
+	};
+	auto mod = createModule(MOD_TYPE_MOD, 4, 128);
+	auto it = createModule(MOD_TYPE_IT, 16, 256);
+	const auto [modLength, itLength] = MeasureBest(
+		[&]() { s_sink = s_sink + static_cast<uint32>(mod->GetLength(eNoAdjust).back().duration); },
+		[&]() { s_sink = s_sink + static_cast<uint32>(it->GetLength(eNoAdjust).back().duration); });
+	PrintResult("GetLength", "MOD, 4 channels, 128 orders, E6x", modLength);
+	PrintResult("GetLength", "IT, 16 channels, 256 orders, SBx", itLength);
+}
+
+
+// Amiga resampler emulation (Paula BLEP synthesis) against the regular resampler.
+// Renders two seconds of ProTracker-style modules with a new note on every row of every channel.
+void BenchmarkPaula()
+{
+	const auto measure = [](CHANNELINDEX numChannels)
+	{
+		auto regular = CreateBenchmarkModule(MOD_TYPE_MOD, numChannels, 1);
+		auto amiga = CreateBenchmarkModule(MOD_TYPE_MOD, numChannels, 1);
+		FillWithNotes(*regular);
+		FillWithNotes(*amiga);
+		// Only modules that are flagged as Amiga modules use the Amiga resampler
+		regular->m_SongFlags.set(SONG_ISAMIGA);
+		amiga->m_SongFlags.set(SONG_ISAMIGA);
+		CResamplerSettings settings = amiga->m_Resampler.m_Settings;
+		settings.emulateAmiga = Resampling::AmigaFilter::A500;
+		amiga->SetResamplerSettings(settings);
+		const std::size_t frames = amiga->GetSampleRate() * 2;
+		const auto [amigaTime, regularTime] = MeasureBest(
+			[&]() { RenderFrames(*amiga, frames); },
+			[&]() { RenderFrames(*regular, frames); });
+		const std::string channels = std::to_string(numChannels) + " channels, ";
+		PrintResult("Paula", channels + "Amiga resampler", amigaTime);
+		PrintResult("Paula", channels + "default resampler", regularTime);
+	};
+	measure(4);
+	measure(32);
+}
+
+
+// Voice budget (CSoundFile::m_voiceBudget) on a voice-dense IT module: 32 channels with a new note on every row,
+// an instrument with NNA "continue" and a looped sample, so that the background channels fill up after one second.
+// Renders three seconds with the 8-tap sinc resampler, without a budget, with all but 32 voices downgraded to linear interpolation
+// and with only 64 voices mixed at all.
+void BenchmarkVoiceBudget()
+{
+	const auto createModule = [](VoiceBudget budget)
+	{
+		auto sndFile = CreateBenchmarkModule(MOD_TYPE_IT, 32, 4);
+		FillWithNotes(*sndFile);
+		sndFile->m_nInstruments = 1;
+		ModInstrument *instr = sndFile->AllocateInstrument(1, 1);
+		instr->nNNA = NewNoteAction::Continue;
+		instr->nFadeOut = 0;
+		CResamplerSettings settings = sndFile->m_Resampler.m_Settings;
+		settings.SrcMode = SRCMODE_SINC8LP;
+		sndFile->SetResamplerSettings(settings);
+		sndFile->m_voiceBudget = budget;
+		return sndFile;
+	};
+	VoiceBudget downgrade, cull;
+	downgrade.fullQualityVoices = 32;
+	cull.maxVoices = 64;
+	auto unlimited = createModule(VoiceBudget());
+	auto downgraded = createModule(downgrade);
+	auto culled = createModule(cull);
+	const std::size_t frames = unlimited->GetSampleRate() * 3;
+	const auto [unlimitedTime, downgradedTime, culledTime] = MeasureBest(
+		[&]() { RenderFrames(*unlimited, frames); },
+		[&]() { RenderFrames(*downgraded, frames); },
+		[&]() { RenderFrames(*culled, frames); });
+	PrintResult("VoiceBudget", "unlimited", unlimitedTime);
+	PrintResult("VoiceBudget", "32 voices at full quality", downgradedTime);
+	PrintResult("VoiceBudget", "64 voices mixed", culledTime);
+}
+
+
+// Read() on a module without any notes, so that the time is spent in the per-chunk processing of the master mix
+// (mono downmix, global volume and stereo separation, see CSoundFile::ProcessMasterGain) rather than in the mixer.
+// The reference variant applies none of these stages, so the difference to it is the cost of the master gain stage.
+void BenchmarkMasterGain()
+{
+	struct Variant
+	{
+		const char *name;
+		uint32 channels;
+		int32 separation;
+		bool globalVolume;
+	};
+	static constexpr Variant variants[] =
+	{
+		{ "stereo, no master gain (reference)", 2, MixerSettings::StereoSeparationScale, false },
+		{ "mono", 1, MixerSettings::StereoSeparationScale, true },
+		{ "stereo", 2, MixerSettings::StereoSeparationScale, true },
+		{ "stereo, stereo separation", 2, MixerSettings::StereoSeparationScale / 2, true },
+		{ "quad", 4, MixerSettings::StereoSeparationScale, true },
+		{ "quad, stereo separation", 4, MixerSettings::StereoSeparationScale / 2, true },
+	};
+	std::vector<std::unique_ptr<CSoundFile>> modules;
+	for(const auto &variant : variants)
+	{
+		auto sndFile = CreateBenchmarkModule(MOD_TYPE_IT, 4, 8);
+		sndFile->SetMixLevels(variant.globalVolume ? MixLevels::Compatible : MixLevels::Original);
+		MixerSettings settings = sndFile->m_MixerSettings;
+		settings.gnChannels = variant.channels;
+		settings.m_nStereoSeparation = variant.separation;
+		sndFile->SetMixerSettings(settings);
+		modules.push_back(std::move(sndFile));
+	}
+	const std::size_t frames = modules[0]->GetSampleRate() * 60;
+	const auto times = MeasureBest(
+		[&]() { RenderFrames(*modules[0], frames); },
+		[&]() { RenderFrames(*modules[1], frames); },
+		[&]() { RenderFrames(*modules[2], frames); },
+		[&]() { RenderFrames(*modules[3], frames); },
+		[&]() { RenderFrames(*modules[4], frames); },
+		[&]() { RenderFrames(*modules[5], frames); });
+	for(std::size_t i = 0; i < std::size(variants); i++)
+	{
+		PrintResult("MasterGain", variants[i].name, times[i]);
+	}
+}
+
+
+// Tick processing with the playback behaviour flags a format specialization of CSoundFile::UpdateChannels was built for,
+// against the same module with one flag toggled, which has to go through the DynamicPlayBehaviour accessor.
+// The toggled flag only affects the retrigger command, which the patterns do not use, so both variants do the same work.
+template <typename Traits>
+void BenchmarkPlayBehaviourFormat(const char *name)
+{
+	PlayBehaviourSet canonical;
+	for(std::size_t i = 0; i < kMaxPlayBehaviours; i++)
+		canonical.set(i, Traits::flags[i]);
+	PlayBehaviourSet toggled = canonical;
+	toggled.flip(kITRetrigger);
+
+	const auto createModule = [](const PlayBehaviourSet &flags)
+	{
+		auto sndFile = CreateBenchmarkModule(Traits::type, 32, 8);
+		FillWithNotes(*sndFile);
+		// Vibrato and volume slides on every row, so that the effect helpers run on every tick
+		for(PATTERNINDEX pat = 0; pat < sndFile->Patterns.Size(); pat++)
+		{
+			for(ROWINDEX row = 0; row < sndFile->Patterns[pat].GetNumRows(); row++)
+			{
+				for(CHANNELINDEX chn = 0; chn < sndFile->GetNumChannels(); chn++)
+				{
+					ModCommand &m = *sndFile->Patterns[pat].GetpModCommand(row, chn);
+					m.command = (chn % 2) ? CMD_VIBRATO : CMD_VOLUMESLIDE;
+					m.param = (chn % 2) ? 0x46 : 0x01;
+				}
+			}
+		}
+		if(Traits::type & (MOD_TYPE_IT | MOD_TYPE_MPT | MOD_TYPE_XM))
+		{
+			sndFile->m_nInstruments = 1;
+			ModInstrument *instr = sndFile->AllocateInstrument(1, 1);
+			instr->VolEnv.push_back(0, ENVELOPE_MAX);
+			instr->VolEnv.push_back(20, ENVELOPE_MAX / 2);
+			instr->VolEnv.push_back(100, ENVELOPE_MAX / 4);
+			instr->VolEnv.dwFlags.set(ENV_ENABLED);
+			instr->PanEnv.push_back(0, ENVELOPE_MID);
+			instr->PanEnv.push_back(50, ENVELOPE_MAX);
+			instr->PanEnv.dwFlags.set(ENV_ENABLED);
+		}
+		sndFile->m_playBehaviour = flags;
+		return sndFile;
+	};
+	auto specialized = createModule(canonical);
+	auto dynamic = createModule(toggled);
+	const auto [specializedTime, dynamicTime] = MeasureBest(
+		[&]() { ProcessTicks(*specialized); },
+		[&]() { ProcessTicks(*dynamic); });
+	PrintResult("PlayBehaviour", std::string(name) + " specialized", specializedTime);
+	PrintResult("PlayBehaviour", std::string(name) + " dynamic", dynamicTime);
+}
+
+
+void BenchmarkPlayBehaviour()
+{
+	BenchmarkPlayBehaviourFormat<ITPlayBehaviourTraits>("IT");
+	BenchmarkPlayBehaviourFormat<MPTPlayBehaviourTraits>("MPTM");
+	BenchmarkPlayBehaviourFormat<XMPlayBehaviourTraits>("XM");
+	BenchmarkPlayBehaviourFormat<S3MPlayBehaviourTraits>("S3M");
+	BenchmarkPlayBehaviourFormat<MODPlayBehaviourTraits>("MOD");
+}
+
+
+// Choosing background channels for NNA voices when all 256 voices are playing and every pattern channel has a new note on the same tick:
+// Scanning all background channels for every note (GetNNAChannel) against examining them once per tick (AllocateNNAChannel)
+void BenchmarkNNAAllocation()
+{
+	constexpr CHANNELINDEX patternChannels = 32;
+	constexpr int ticks = 2000;
+	auto sndFile = CreateBenchmarkModule(MOD_TYPE_IT, patternChannels, 1);
+	auto &chn = sndFile->m_PlayState.Chn;
+	mpt::deterministic_good_prng prng(0x7c41d2e9u);
+	const auto setVoices = [&]()
+	{
+		for(CHANNELINDEX i = 0; i < MAX_CHANNELS; i++)
+		{
+			chn[i].nLength = 4096;
+			chn[i].nFadeOutVol = 65536;
+			chn[i].nRealVolume = 256 + mpt::random<uint16>(prng) % 8192;
+			chn[i].nVolume = 256;
+			chn[i].VolEnv.nEnvPosition = mpt::random<uint8>(prng);
+		}
+	};
+	// Both variants work on the same channel states, which are reset at the start of every tick
+	std::vector<ModChannel> states;
+	for(int tick = 0; tick < 16; tick++)
+	{
+		setVoices();
+		states.insert(states.end(), std::begin(chn), std::end(chn));
+	}
+	const auto runTicks = [&](auto allocate)
+	{
+		for(int tick = 0; tick < ticks; tick++)
+		{
+			std::copy(states.begin() + (tick % 16) * MAX_CHANNELS, states.begin() + (tick % 16 + 1) * MAX_CHANNELS, std::begin(chn));
+			sndFile->BeginNNAChannelAllocation();
+			for(CHANNELINDEX source = 0; source < patternChannels; source++)
+			{
+				const CHANNELINDEX nnaChn = allocate(source);
+				if(nnaChn == CHANNELINDEX_INVALID)
+					continue;
+				chn[nnaChn] = chn[source];
+				chn[source].nLength = 0;
+				s_sink = s_sink + nnaChn;
+			}
+			sndFile->EndNNAChannelAllocation();
+		}
+	};
+	const auto [setupTime, scanTime, cacheTime] = MeasureBest(
+		[&]() { runTicks([&](CHANNELINDEX source) { return static_cast<CHANNELINDEX>(patternChannels + source); }); },
+		[&]() { runTicks([&](CHANNELINDEX source) { return sndFile->GetNNAChannel(source); }); },
+		[&]() { runTicks([&](CHANNELINDEX source) { return sndFile->AllocateNNAChannel(source); }); });
+	PrintResult("NNAAllocation", "channel setup and copies only", setupTime);
+	PrintResult("NNAAllocation", "scan per note (GetNNAChannel)", scanTime);
+	PrintResult("NNAAllocation", "once per tick (AllocateNNAChannel)", cacheTime);
+
+	// The same situation during actual playback, for comparison with the rest of the tick processing
+	auto song = CreateBenchmarkModule(MOD_TYPE_IT, patternChannels, 4);
+	FillWithNotes(*song);
+	song->m_nInstruments = 1;
+	ModInstrument *instr = song->AllocateInstrument(1, 1);
+	instr->nNNA = NewNoteAction::Continue;
+	instr->nFadeOut = 0;
+	const auto [songTime] = MeasureBest([&]() { ProcessTicks(*song); });
+	PrintResult("NNAAllocation", "ProcessTicks, 256 voices", songTime);
+}
+
+
+struct Benchmark
+{
+	const char *name;
+	void (*func)();
+};
+
+const Benchmark Benchmarks[] =
+{
+	{ "SampleConversion", &BenchmarkSampleConversion },
+	{ "MIDIMacros", &BenchmarkMIDIMacros },
+	{ "GetLength", &BenchmarkGetLength },
+	{ "Paula", &BenchmarkPaula },
+	{ "VoiceBudget", &BenchmarkVoiceBudget },
+	{ "NNAAllocation", &BenchmarkNNAAllocation },
+	{ "PlayBehaviour", &BenchmarkPlayBehaviour },
+	{ "MasterGain", &BenchmarkMasterGain },
+};
+
+
+}  // namespace
+
+
+void DoBenchmarks(const std::vector<std::string> &names)
+{
+	for(const auto &benchmark : Benchmarks)
+	{
+		if(!names.empty() && std::find(names.begin(), names.end(), benchmark.name) == names.end())
+			continue;
+		benchmark.func();
+	}
+}
+
+
+}  // namespace Test
+
+
+OPENMPT_NAMESPACE_END
+
+
+#endif  // LIBOPENMPT_BUILD
+#endif  // ENABLE_TESTS
@@ -26,10 +26,18 @@
 #include "../soundlib/mod_specifications.h"
 #include "../soundlib/MIDIEvents.h"
 #include "../soundlib/MIDIMacros.h"
+#include "../soundlib/AudioReadTarget.h"
 #include "../soundbase/SampleFormatConverters.h"
 #include "../soundbase/SampleFormatCopy.h"
 #include "../soundlib/ModSampleCopy.h"
 #include "../soundlib/ITCompression.h"
+#include "../soundlib/ModFingerprint.h"
+#include "../soundlib/ParallelSampleReader.h"
+#include "../soundlib/SampleCache.h"
+#include "../soundlib/SampleCopyLoops.h"
+#include "../soundlib/SampleIO.h"
+#include "../soundlib/SampleStore.h"
+#include "../soundlib/SampleStream.h"
 #include "../soundlib/tuningcollection.h"
 #include "../soundlib/tuning.h"
 #include "../soundbase/Dither.h"
@@ -51,6 +59,7 @@
 #endif // LIBOPENMPT_BUILD
 #ifndef NO_PLUGINS
 #include "../soundlib/plugins/PlugInterface.h"
+#include "../soundlib/plugins/PluginManager.h"
 #endif
 #include <sstream>
 #include <limits>
@@ -112,10 +121,20 @@ static MPT_NOINLINE void TestStringIO();
 static MPT_NOINLINE void TestMIDIEvents();
 static MPT_NOINLINE void TestSampleConversion();
 static MPT_NOINLINE void TestITCompression();
+static MPT_NOINLINE void TestSampleStream();
 static MPT_NOINLINE void TestTunings();
 static MPT_NOINLINE void TestPCnoteSerialization();
 static MPT_NOINLINE void TestLoadSaveFile();
 static MPT_NOINLINE void TestEditing();
+static MPT_NOINLINE void TestNNAChannelAllocation();
+static MPT_NOINLINE void TestPlayBehaviourSpecializations();
+static MPT_NOINLINE void TestSampleSeeking();
+static MPT_NOINLINE void TestStemRendering();
+static MPT_NOINLINE void TestPreviewRendering();
+static MPT_NOINLINE void TestLoudnessMeasurement();
+static MPT_NOINLINE void TestFingerprint();
+static MPT_NOINLINE void TestSampleSharing();
+static MPT_NOINLINE void TestPluginTailSuspend();
 
 
 
@@ -213,12 +232,22 @@ void DoTests()
 	DO_TEST(TestMIDIEvents);
 	DO_TEST(TestSampleConversion);
 	DO_TEST(TestITCompression);
+	DO_TEST(TestSampleStream);
 	DO_TEST(TestTunings);
 
 	// slower tests, require opening a CModDoc
 	DO_TEST(TestPCnoteSerialization);
 	DO_TEST(TestLoadSaveFile);
 	DO_TEST(TestEditing);
+	DO_TEST(TestNNAChannelAllocation);
+	DO_TEST(TestPlayBehaviourSpecializations);
+	DO_TEST(TestSampleSeeking);
+	DO_TEST(TestStemRendering);
+	DO_TEST(TestPreviewRendering);
+	DO_TEST(TestLoudnessMeasurement);
+	DO_TEST(TestFingerprint);
+	DO_TEST(TestSampleSharing);
+	DO_TEST(TestPluginTailSuspend);
 
 	delete s_PRNG;
 	s_PRNG = nullptr;
@@ -1156,6 +1185,11 @@ static MPT_NOINLINE void TestMisc1()
 	VERIFY_EQUAL(mpt::countr_zero(uint8(0b11000000)), 6);
 	VERIFY_EQUAL(mpt::countr_zero(uint8(0b10000000)), 7);
 	VERIFY_EQUAL(mpt::countr_zero(uint8(0b00000000)), 8);
+	VERIFY_EQUAL(mpt::countr_zero(uint64(1) << 45), 45);
+	VERIFY_EQUAL(mpt::countr_zero(uint64(0)), 64);
+	VERIFY_EQUAL(mpt::countl_zero(uint64(1) << 45), 18);
+	VERIFY_EQUAL(mpt::countr_one(~(uint64(1) << 45)), 45);
+	VERIFY_EQUAL(mpt::countl_one(~(uint64(1) << 45)), 18);
 
 	// trivials
 	VERIFY_EQUAL( mpt::saturate_cast<int>(-1), -1 );
@@ -3354,6 +3388,30 @@ static MPT_NOINLINE void TestMIDIEvents()
 	VERIFY_EQUAL_NONCONT(MIDIEvents::GetChannelFromEvent(midiEvent), MIDIEvents::sysStart);
 	VERIFY_EQUAL_NONCONT(MIDIEvents::GetDataByte1FromEvent(midiEvent), 0);
 	VERIFY_EQUAL_NONCONT(MIDIEvents::GetDataByte2FromEvent(midiEvent), 0);
+
+	// MIDI macro compilation
+	{
+		using Opcode = MIDIMacroProgram::Opcode;
+		const auto compile = [](const char *str)
+		{
+			MIDIMacroConfig::Macro macro = {};
+			mpt::String::WriteAutoBuf(macro) = std::string(str);
+			MIDIMacroProgram program;
+			program.Compile(macro);
+			std::vector<std::pair<Opcode, uint8>> result;
+			for(const auto &instr : program)
+				result.push_back({instr.opcode, instr.value});
+			return result;
+		};
+		const std::vector<std::pair<Opcode, uint8>> expected1 = {{Opcode::Byte, 0xF0}, {Opcode::Byte, 0xF0}, {Opcode::Byte, 0x00}, {Opcode::ZxxParam, 0}};
+		VERIFY_EQUAL_NONCONT(compile("F0F000z") == expected1, true);
+		const std::vector<std::pair<Opcode, uint8>> expected2 = {{Opcode::Nibble, 0x0B}, {Opcode::MIDIChannel, 0}, {Opcode::Byte, 0x07}, {Opcode::Nibble, 0x09}, {Opcode::Note, 0}};
+		VERIFY_EQUAL_NONCONT(compile("Bc 07 9n") == expected2, true);
+		// After a checksum in the middle of a byte, nibbles are no longer merged
+		const std::vector<std::pair<Opcode, uint8>> expected3 = {{Opcode::Byte, 0x12}, {Opcode::Checksum, 0}, {Opcode::Byte, 0x34}, {Opcode::Nibble, 0x05}, {Opcode::Checksum, 0}, {Opcode::Nibble, 0x06}, {Opcode::Nibble, 0x07}};
+		VERIFY_EQUAL_NONCONT(compile("12s345s67") == expected3, true);
+		VERIFY_EQUAL_NONCONT(compile("").empty(), true);
+	}
 }
 
 
@@ -4545,6 +4603,783 @@ static MPT_NOINLINE void TestEditing()
 }
 
 
+// Test which background channels are chosen for New Note Actions
+static MPT_NOINLINE void TestNNAChannelAllocation()
+{
+#ifdef MODPLUG_TRACKER
+	auto modDoc = static_cast<CModDoc *>(theApp.GetModDocTemplate()->CreateNewDocument());
+	auto &sndFile = modDoc->GetSoundFile();
+	sndFile.Create(FileReader(), CSoundFile::loadCompleteModule, modDoc);
+#else
+	auto pSndFile = std::make_unique<CSoundFile>();
+	auto &sndFile = *pSndFile;
+	sndFile.Create(FileReader(), CSoundFile::loadCompleteModule);
+#endif
+	sndFile.m_nChannels = 4;
+	sndFile.m_nType = MOD_TYPE_IT;
+
+	auto &chn = sndFile.m_PlayState.Chn;
+	const auto setVoice = [](ModChannel &c, int32 realVolume)
+	{
+		c.nLength = 1000;
+		c.nFadeOutVol = 65536;
+		c.nRealVolume = realVolume;
+		c.nVolume = 256;
+		c.pModInstrument = nullptr;
+		c.dwFlags.reset();
+		c.VolEnv.nEnvPosition = 0;
+	};
+	setVoice(chn[0], 2000);
+	for(CHANNELINDEX i = 4; i < MAX_CHANNELS; i++)
+		setVoice(chn[i], 1000);
+
+	// All voices equally loud and quieter than the new note: first voice
+	VERIFY_EQUAL(sndFile.GetNNAChannel(0), 4);
+	// Quietest voice
+	chn[100].nRealVolume = 500;
+	VERIFY_EQUAL(sndFile.GetNNAChannel(0), 100);
+	// Equally quiet voice that is further into its volume envelope
+	chn[150].nRealVolume = 500;
+	chn[150].VolEnv.nEnvPosition = 10;
+	VERIFY_EQUAL(sndFile.GetNNAChannel(0), 150);
+	// Looping voices count half as loud
+	chn[200].nRealVolume = 800;
+	chn[200].dwFlags.set(CHN_LOOP);
+	VERIFY_EQUAL(sndFile.GetNNAChannel(0), 200);
+	// Voices that have already faded out take precedence over quieter voices
+	chn[220].nFadeOutVol = 0;
+	VERIFY_EQUAL(sndFile.GetNNAChannel(0), 220);
+	VERIFY_EQUAL(sndFile.GetNNAChannel(CHANNELINDEX_INVALID), 220);
+	// Empty channels take precedence over everything else
+	chn[240].nLength = 0;
+	VERIFY_EQUAL(sndFile.GetNNAChannel(0), 240);
+	chn[230].nLength = 0;
+	VERIFY_EQUAL(sndFile.GetNNAChannel(0), 230);
+	VERIFY_EQUAL(sndFile.GetNNAChannel(CHANNELINDEX_INVALID), 230);
+
+	// No empty channel and the new note has already faded out: No voice
+	chn[230].nLength = 1000;
+	chn[240].nLength = 1000;
+	chn[0].nFadeOutVol = 0;
+	VERIFY_EQUAL(sndFile.GetNNAChannel(0), CHANNELINDEX_INVALID);
+	// All voices are louder than the new note: No voice
+	chn[0].nFadeOutVol = 65536;
+	chn[0].nRealVolume = 100;
+	chn[220].nFadeOutVol = 65536;
+	VERIFY_EQUAL(sndFile.GetNNAChannel(0), CHANNELINDEX_INVALID);
+	VERIFY_EQUAL(sndFile.GetNNAChannel(CHANNELINDEX_INVALID), 200);
+
+	// While the effects of a tick are processed, AllocateNNAChannel only examines the background channels once, but must still pick the same voices,
+	// also when several notes on the same tick take over background channels or other background channels are changed in between.
+	mpt::deterministic_good_prng prng(0x3e2f7a15u);
+	for(int tick = 0; tick < 50; tick++)
+	{
+		for(CHANNELINDEX i = 4; i < MAX_CHANNELS; i++)
+		{
+			// Few distinct values, so that there are many ties
+			setVoice(chn[i], mpt::random<uint8>(prng) % 4 * 100);
+			chn[i].VolEnv.nEnvPosition = mpt::random<uint8>(prng) % 3;
+			if(mpt::random<uint8>(prng) % 4 == 0)
+				chn[i].dwFlags.set(CHN_LOOP);
+			if(tick % 5 == 0 && mpt::random<uint8>(prng) % 64 == 0)
+				chn[i].nLength = 0;
+			if(tick % 3 == 0 && mpt::random<uint8>(prng) % 64 == 0)
+				chn[i].nFadeOutVol = 0;
+		}
+		sndFile.BeginNNAChannelAllocation();
+		for(int note = 0; note < 20; note++)
+		{
+			const CHANNELINDEX source = static_cast<CHANNELINDEX>(note % 4);
+			setVoice(chn[source], mpt::random<uint8>(prng) % 5 * 100);
+			const CHANNELINDEX expected = sndFile.GetNNAChannel(source);
+			const CHANNELINDEX allocated = sndFile.AllocateNNAChannel(source);
+			VERIFY_EQUAL_QUIET_NONCONT(allocated, expected);
+			if(allocated == CHANNELINDEX_INVALID)
+				continue;
+			chn[allocated] = chn[source];
+			if(note % 3 == 0)
+				chn[allocated].nFadeOutVol = 0;
+			chn[source].nLength = 0;
+			if(note % 7 == 0)
+			{
+				// Like a duplicate note action on another background channel
+				const CHANNELINDEX other = static_cast<CHANNELINDEX>(4 + mpt::random<uint8>(prng) % (MAX_CHANNELS - 4));
+				chn[other].nFadeOutVol = 0;
+				sndFile.InvalidateNNAChannel(other);
+			}
+		}
+		sndFile.EndNNAChannelAllocation();
+	}
+
+#ifdef MODPLUG_TRACKER
+	sndFile.Destroy();
+	modDoc->OnCloseDocument();
+#endif
+}
+
+
+// Check that the playback behaviour specializations of the tick processing match the behaviour that files made with the respective trackers get.
+static MPT_NOINLINE void TestPlayBehaviourSpecializations()
+{
+	VERIFY_EQUAL(ITPlayBehaviour::Matches(MOD_TYPE_IT, CSoundFile::GetDefaultPlaybackBehaviour(MOD_TYPE_IT)), true);
+	VERIFY_EQUAL(ITPlayBehaviour::Matches(MOD_TYPE_MPT, CSoundFile::GetDefaultPlaybackBehaviour(MOD_TYPE_IT)), false);
+	VERIFY_EQUAL(MPTPlayBehaviour::Matches(MOD_TYPE_MPT, CSoundFile::GetDefaultPlaybackBehaviour(MOD_TYPE_MPT)), true);
+	VERIFY_EQUAL(MPTPlayBehaviour::Matches(MOD_TYPE_MPT, CSoundFile::GetSupportedPlaybackBehaviour(MOD_TYPE_MPT)), false);
+
+	// FT2-made XMs have FT2 volume ramping enabled, which is not part of the default behaviour
+	VERIFY_EQUAL(XMPlayBehaviour::Matches(MOD_TYPE_XM, CSoundFile::GetSupportedPlaybackBehaviour(MOD_TYPE_XM)), true);
+	VERIFY_EQUAL(XMPlayBehaviour::Matches(MOD_TYPE_XM, CSoundFile::GetDefaultPlaybackBehaviour(MOD_TYPE_XM)), false);
+
+	VERIFY_EQUAL(S3MPlayBehaviour::Matches(MOD_TYPE_S3M, CSoundFile::GetDefaultPlaybackBehaviour(MOD_TYPE_S3M)), true);
+	VERIFY_EQUAL(S3MPlayBehaviour::Matches(MOD_TYPE_S3M, CSoundFile::GetSupportedPlaybackBehaviour(MOD_TYPE_S3M)), false);
+
+	// ProTracker M.K. files get all MOD behaviours except for VBlank timing
+	PlayBehaviourSet proTracker = CSoundFile::GetSupportedPlaybackBehaviour(MOD_TYPE_MOD);
+	proTracker.reset(kMODVBlankTiming);
+	VERIFY_EQUAL(MODPlayBehaviour::Matches(MOD_TYPE_MOD, proTracker), true);
+	VERIFY_EQUAL(MODPlayBehaviour::Matches(MOD_TYPE_MOD, CSoundFile::GetSupportedPlaybackBehaviour(MOD_TYPE_MOD)), false);
+
+	constexpr ITPlayBehaviour itBehaviour;
+	static_assert(itBehaviour[kITVibratoTremoloPanbrello]);
+	static_assert(!itBehaviour[kFT2VolumeRamping]);
+	static_assert(itBehaviour.GetType() == MOD_TYPE_IT);
+	const PlayBehaviourSet flags = CSoundFile::GetDefaultPlaybackBehaviour(MOD_TYPE_XM);
+	const DynamicPlayBehaviour dynamicBehaviour{flags, MOD_TYPE_XM};
+	VERIFY_EQUAL(dynamicBehaviour[kFT2Arpeggio], true);
+	VERIFY_EQUAL(dynamicBehaviour[kFT2VolumeRamping], false);
+	VERIFY_EQUAL(dynamicBehaviour.GetType(), MOD_TYPE_XM);
+}
+
+
+// Check that seeking with sample position synchronization follows a held note through its sample loop exactly like playing it tick by tick would.
+static MPT_NOINLINE void TestSampleSeeking()
+{
+#ifdef MODPLUG_TRACKER
+	auto modDoc = static_cast<CModDoc *>(theApp.GetModDocTemplate()->CreateNewDocument());
+	auto &sndFile = modDoc->GetSoundFile();
+	sndFile.Create(FileReader(), CSoundFile::loadCompleteModule, modDoc);
+#else
+	auto pSndFile = std::make_unique<CSoundFile>();
+	auto &sndFile = *pSndFile;
+	sndFile.Create(FileReader(), CSoundFile::loadCompleteModule);
+#endif
+	sndFile.m_nChannels = 1;
+	sndFile.m_nType = MOD_TYPE_IT;
+	sndFile.SetDefaultPlaybackBehaviour(MOD_TYPE_IT);
+	sndFile.m_nDefaultSpeed = 6;
+	sndFile.m_nDefaultTempo.Set(125);
+
+	sndFile.m_nSamples = 1;
+	ModSample &sample = sndFile.GetSample(1);
+	sample.Initialize(MOD_TYPE_IT);
+	sample.nLength = 10000;
+	sample.nC5Speed = 33333;
+	sample.AllocateSample();
+
+	sndFile.Patterns.ResizeArray(1);
+	sndFile.Patterns.Insert(0, 64);
+	ModCommand &m = *sndFile.Patterns[0].GetpModCommand(0, 0);
+	m.note = NOTE_MIDDLEC + 7;
+	m.instr = 1;
+	sndFile.Order().assign(1, 0);
+
+	const ModChannel &chn = sndFile.m_PlayState.Chn[0];
+	sndFile.GetLength(eAdjustSamplePositions, GetLengthTarget(0, 1));
+	VERIFY_EQUAL_NONCONT(chn.IsSamplePlaying(), true);
+	const SamplePosition inc = chn.increment * sndFile.GetTickDuration(sndFile.m_PlayState);
+
+	for(const bool loop : {false, true})
+	{
+		sample.SetLoop(1000, 3000, loop, false, sndFile);
+		for(const ROWINDEX row : {1, 2, 20, 63})
+		{
+			sndFile.GetLength(eAdjustSamplePositions, GetLengthTarget(0, row));
+			const uint32 numTicks = row * sndFile.m_nDefaultSpeed;
+			SamplePosition expected;
+			bool playing = true;
+			for(uint32 tick = 0; tick < numTicks && playing; tick++)
+			{
+				expected += inc;
+				if(loop && expected.GetUInt() >= sample.nLoopEnd)
+					expected.SetInt(expected.GetUInt() - (expected.GetUInt() - sample.nLoopStart) / 2000 * 2000);
+				else if(!loop && expected.GetUInt() >= sample.nLength)
+					playing = false;
+			}
+			VERIFY_EQUAL_NONCONT(chn.IsSamplePlaying(), playing);
+			if(playing)
+				VERIFY_EQUAL_NONCONT(chn.position, expected);
+		}
+	}
+
+#ifdef MODPLUG_TRACKER
+	sndFile.Destroy();
+	modDoc->OnCloseDocument();
+#endif
+}
+
+
+// Collects the regular mix and all stems of CSoundFile::Read
+class StemTestTarget : public IAudioReadTarget
+{
+public:
+	StemLayout layout = StemLayout::None;
+	std::vector<MixSampleInt> mix;
+	std::vector<std::vector<MixSampleInt>> stems;
+
+	StemLayout GetStemLayout() const override { return layout; }
+	void DataCallback(MixSampleInt *MixSoundBuffer, std::size_t channels, std::size_t countChunk) override
+	{
+		mix.insert(mix.end(), MixSoundBuffer, MixSoundBuffer + channels * countChunk);
+	}
+	void DataCallback(MixSampleFloat *, std::size_t, std::size_t) override { }
+	void StemCallback(MixSampleInt *stemBuffer, std::size_t stem, std::size_t countChunk) override
+	{
+		if(stems.size() <= stem)
+			stems.resize(stem + 1);
+		stems[stem].insert(stems[stem].end(), stemBuffer, stemBuffer + 2 * countChunk);
+	}
+};
+
+
+static MPT_NOINLINE void TestStemRendering()
+{
+#ifdef MODPLUG_TRACKER
+	auto modDoc = static_cast<CModDoc *>(theApp.GetModDocTemplate()->CreateNewDocument());
+	auto &sndFile = modDoc->GetSoundFile();
+	sndFile.Create(FileReader(), CSoundFile::loadCompleteModule, modDoc);
+#else
+	auto pSndFile = std::make_unique<CSoundFile>();
+	auto &sndFile = *pSndFile;
+	sndFile.Create(FileReader(), CSoundFile::loadCompleteModule);
+#endif
+	sndFile.m_nChannels = 2;
+	sndFile.m_nType = MOD_TYPE_IT;
+	sndFile.SetDefaultPlaybackBehaviour(MOD_TYPE_IT);
+	sndFile.m_nDefaultSpeed = 6;
+	sndFile.m_nDefaultTempo.Set(125);
+
+	sndFile.m_nSamples = 2;
+	for(SAMPLEINDEX smp = 1; smp <= 2; smp++)
+	{
+		ModSample &sample = sndFile.GetSample(smp);
+		sample.Initialize(MOD_TYPE_IT);
+		sample.nLength = 1000;
+		sample.nC5Speed = 8363 * smp;
+		sample.AllocateSample();
+		for(SmpLength i = 0; i < sample.nLength; i++)
+		{
+			sample.sample8()[i] = mpt::random<int8>(*s_PRNG);
+		}
+		sample.SetLoop(0, sample.nLength, true, false, sndFile);
+	}
+
+	sndFile.Patterns.ResizeArray(1);
+	sndFile.Patterns.Insert(0, 64);
+	for(CHANNELINDEX chn = 0; chn < 2; chn++)
+	{
+		ModCommand &m = *sndFile.Patterns[0].GetpModCommand(0, chn);
+		m.note = NOTE_MIDDLEC;
+		m.instr = static_cast<ModCommand::INSTR>(chn + 1);
+	}
+	sndFile.Patterns[0].GetpModCommand(32, 1)->note = NOTE_NOTECUT;
+	sndFile.Order().assign(1, 0);
+
+	const auto render = [&sndFile](StemLayout layout, CHANNELINDEX mutedChannel)
+	{
+		for(CHANNELINDEX chn = 0; chn < 2; chn++)
+		{
+			sndFile.ChnSettings[chn].dwFlags.set(CHN_MUTE, chn == mutedChannel);
+		}
+		sndFile.ResetPlayPos();
+		sndFile.InitPlayer(true);
+		sndFile.m_SongFlags.reset(SONG_ENDREACHED);
+		StemTestTarget target;
+		target.layout = layout;
+		while(sndFile.Read(4096, target) > 0)
+		{
+		}
+		return target;
+	};
+
+	VERIFY_EQUAL(sndFile.GetNumStems(StemLayout::Channels), 2u);
+	VERIFY_EQUAL(sndFile.GetNumStems(StemLayout::Instruments), 2u);
+
+	// Each stem must contain exactly what a regular render with all other channels muted contains, and nothing must be left in the regular mix
+	const StemTestTarget stems = render(StemLayout::Channels, CHANNELINDEX_INVALID);
+	VERIFY_EQUAL_NONCONT(stems.stems.size(), 2u);
+	VERIFY_EQUAL_NONCONT(std::count(stems.mix.begin(), stems.mix.end(), 0), static_cast<std::ptrdiff_t>(stems.mix.size()));
+	for(CHANNELINDEX chn = 0; chn < 2 && stems.stems.size() == 2; chn++)
+	{
+		const StemTestTarget single = render(StemLayout::None, 1 - chn);
+		VERIFY_EQUAL_NONCONT(single.mix.size(), stems.stems[chn].size());
+		VERIFY_EQUAL_NONCONT(single.mix == stems.stems[chn], true);
+	}
+
+	// Without instruments, there is one stem per sample
+	const StemTestTarget sampleStems = render(StemLayout::Instruments, CHANNELINDEX_INVALID);
+	VERIFY_EQUAL_NONCONT(sampleStems.stems == stems.stems, true);
+
+	// With instruments, there is one stem per instrument, no matter which sample it plays
+	sndFile.m_nInstruments = 3;
+	for(INSTRUMENTINDEX ins = 1; ins <= 3; ins++)
+	{
+		sndFile.AllocateInstrument(ins, static_cast<SAMPLEINDEX>(3 - ins));
+	}
+	VERIFY_EQUAL(sndFile.GetNumStems(StemLayout::Instruments), 3u);
+	const StemTestTarget channelStems = render(StemLayout::Channels, CHANNELINDEX_INVALID);
+	const StemTestTarget instrumentStems = render(StemLayout::Instruments, CHANNELINDEX_INVALID);
+	VERIFY_EQUAL_NONCONT(instrumentStems.stems.size(), 3u);
+	VERIFY_EQUAL_NONCONT(channelStems.stems.size(), 2u);
+	if(instrumentStems.stems.size() == 3 && channelStems.stems.size() == 2)
+	{
+		VERIFY_EQUAL_NONCONT(instrumentStems.stems[0] == channelStems.stems[0], true);
+		VERIFY_EQUAL_NONCONT(instrumentStems.stems[1] == channelStems.stems[1], true);
+		VERIFY_EQUAL_NONCONT(std::count(instrumentStems.stems[2].begin(), instrumentStems.stems[2].end(), 0), static_cast<std::ptrdiff_t>(instrumentStems.stems[2].size()));
+		VERIFY_EQUAL_NONCONT(instrumentStems.stems[0] == stems.stems[0], false);
+	}
+
+#ifdef MODPLUG_TRACKER
+	sndFile.Destroy();
+	modDoc->OnCloseDocument();
+#endif
+}
+
+
+static MPT_NOINLINE void TestPreviewRendering()
+{
+#ifdef MODPLUG_TRACKER
+	auto modDoc = static_cast<CModDoc *>(theApp.GetModDocTemplate()->CreateNewDocument());
+	auto &sndFile = modDoc->GetSoundFile();
+	sndFile.Create(FileReader(), CSoundFile::loadCompleteModule, modDoc);
+#else
+	auto pSndFile = std::make_unique<CSoundFile>();
+	auto &sndFile = *pSndFile;
+	sndFile.Create(FileReader(), CSoundFile::loadCompleteModule);
+#endif
+	sndFile.m_nChannels = 2;
+	sndFile.m_nType = MOD_TYPE_IT;
+	sndFile.SetDefaultPlaybackBehaviour(MOD_TYPE_IT);
+	sndFile.m_nDefaultSpeed = 6;
+	sndFile.m_nDefaultTempo.Set(125);
+
+	sndFile.m_nSamples = 1;
+	ModSample &sample = sndFile.GetSample(1);
+	sample.Initialize(MOD_TYPE_IT);
+	sample.nLength = 1000;
+	sample.nC5Speed = 12345;
+	sample.AllocateSample();
+	for(SmpLength i = 0; i < sample.nLength; i++)
+	{
+		sample.sample8()[i] = mpt::random<int8>(*s_PRNG);
+	}
+	sample.SetLoop(0, sample.nLength, true, false, sndFile);
+
+	sndFile.Patterns.ResizeArray(1);
+	sndFile.Patterns.Insert(0, 64);
+	for(CHANNELINDEX chn = 0; chn < 2; chn++)
+	{
+		ModCommand &m = *sndFile.Patterns[0].GetpModCommand(chn * 16, chn);
+		m.note = static_cast<ModCommand::NOTE>(NOTE_MIDDLEC + chn * 7);
+		m.instr = 1;
+	}
+	sndFile.Order().assign(1, 0);
+
+	MixerSettings mixerSettings = sndFile.m_MixerSettings;
+	mixerSettings.gnChannels = 1;
+	sndFile.SetMixerSettings(mixerSettings);
+
+	const auto render = [&sndFile](ResamplingMode mode, bool preview, IAudioReadTarget &target)
+	{
+		CResamplerSettings resamplerSettings = sndFile.m_Resampler.m_Settings;
+		resamplerSettings.SrcMode = mode;
+		sndFile.SetResamplerSettings(resamplerSettings);
+		sndFile.m_previewRender = preview;
+		sndFile.ResetPlayPos();
+		sndFile.InitPlayer(true);
+		sndFile.m_SongFlags.reset(SONG_ENDREACHED);
+		while(sndFile.Read(4096, target) > 0)
+		{
+		}
+	};
+
+	// Preview rendering limits the resampling quality to linear interpolation
+	StemTestTarget linear, sinc, sincPreview;
+	render(SRCMODE_LINEAR, false, linear);
+	render(SRCMODE_SINC8LP, false, sinc);
+	render(SRCMODE_SINC8LP, true, sincPreview);
+	VERIFY_EQUAL_NONCONT(linear.mix.empty(), false);
+	VERIFY_EQUAL_NONCONT(sinc.mix == linear.mix, false);
+	VERIFY_EQUAL_NONCONT(sincPreview.mix == linear.mix, true);
+
+#ifdef LIBOPENMPT_BUILD
+	// Peaks are the extremes of each block of frames of the mix
+	constexpr std::size_t framesPerPeak = 100;
+	const std::size_t numPeaks = (linear.mix.size() + framesPerPeak - 1) / framesPerPeak;
+	std::vector<float> minPeaks(numPeaks), maxPeaks(numPeaks);
+	AudioReadTargetPeaks peaks(framesPerPeak, minPeaks.data(), maxPeaks.data(), 1.0f);
+	render(SRCMODE_LINEAR, true, peaks);
+	VERIFY_EQUAL_NONCONT(peaks.Finish(), numPeaks);
+	std::vector<float> expected(linear.mix.size());
+	ConvertMixToFloat(linear.mix.data(), 1, expected.data(), expected.size());
+	for(std::size_t peak = 0; peak < numPeaks; peak++)
+	{
+		const auto first = expected.begin() + peak * framesPerPeak;
+		const auto last = expected.begin() + std::min((peak + 1) * framesPerPeak, expected.size());
+		VERIFY_EQUAL_NONCONT(minPeaks[peak], *std::min_element(first, last));
+		VERIFY_EQUAL_NONCONT(maxPeaks[peak], *std::max_element(first, last));
+	}
+#endif // LIBOPENMPT_BUILD
+
+#ifdef MODPLUG_TRACKER
+	sndFile.Destroy();
+	modDoc->OnCloseDocument();
+#endif
+}
+
+
+static MPT_NOINLINE void TestLoudnessMeasurement()
+{
+	// Feeds seconds of a stereo sine wave with the given frequency, amplitude and phase into the meter
+	const auto feedSine = [](LoudnessMeter &meter, double frequency, double amplitude, double phase, double seconds)
+	{
+		constexpr uint32 sampleRate = 48000;
+		std::vector<mixsample_t> buffer(MIXBUFFERSIZE * 2);
+		uint32 frames = static_cast<uint32>(seconds * sampleRate);
+		uint32 pos = 0;
+		while(frames > 0)
+		{
+			const uint32 count = std::min(frames, static_cast<uint32>(MIXBUFFERSIZE));
+			for(uint32 i = 0; i < count; i++, pos++)
+			{
+				const double x = amplitude * std::sin(2.0 * M_PI * frequency * pos / sampleRate + phase);
+#ifdef MPT_INTMIXER
+				buffer[i * 2] = buffer[i * 2 + 1] = mpt::saturate_round<mixsample_t>(x * MIXING_SCALEF);
+#else
+				buffer[i * 2] = buffer[i * 2 + 1] = static_cast<mixsample_t>(x);
+#endif
+			}
+			meter.Process(buffer.data(), 2, count);
+			frames -= count;
+		}
+	};
+
+	LoudnessMeter meter;
+	meter.Initialize(48000);
+	VERIFY_EQUAL(meter.GetIntegratedLoudness(), -std::numeric_limits<double>::infinity());
+
+	// EBU Tech 3341: A 1 kHz stereo sine wave at -23 dBFS measures -23 LUFS
+	feedSine(meter, 1000.0, std::pow(10.0, -23.0 / 20.0), 0.0, 20.0);
+	VERIFY_EQUAL_EPS(meter.GetIntegratedLoudness(), -23.0, 0.1);
+	VERIFY_EQUAL_EPS(meter.GetLoudnessRange(), 0.0, 0.1);
+	VERIFY_EQUAL_EPS(meter.GetTruePeak(), std::pow(10.0, -23.0 / 20.0), 0.001);
+
+	// EBU Tech 3342: 20 seconds at -20 dBFS followed by 20 seconds at -30 dBFS have a loudness range of 10 LU
+	meter.Reset();
+	feedSine(meter, 1000.0, std::pow(10.0, -20.0 / 20.0), 0.0, 20.0);
+	feedSine(meter, 1000.0, std::pow(10.0, -30.0 / 20.0), 0.0, 20.0);
+	VERIFY_EQUAL_EPS(meter.GetLoudnessRange(), 10.0, 1.0);
+
+	// The true peak of a sine wave at a quarter of the sample rate lies between its samples
+	meter.Reset();
+	feedSine(meter, 12000.0, 0.5, M_PI / 4.0, 1.0);
+	VERIFY_EQUAL_EPS(meter.GetTruePeak(), 0.5, 0.02);
+}
+
+
+static MPT_NOINLINE void TestFingerprint()
+{
+#ifdef MODPLUG_TRACKER
+	auto modDoc = static_cast<CModDoc *>(theApp.GetModDocTemplate()->CreateNewDocument());
+	auto &sndFile = modDoc->GetSoundFile();
+	sndFile.Create(FileReader(), CSoundFile::loadCompleteModule, modDoc);
+#else
+	auto pSndFile = std::make_unique<CSoundFile>();
+	auto &sndFile = *pSndFile;
+	sndFile.Create(FileReader(), CSoundFile::loadCompleteModule);
+#endif
+	sndFile.m_nChannels = 2;
+	sndFile.m_nType = MOD_TYPE_XM;
+	sndFile.SetDefaultPlaybackBehaviour(MOD_TYPE_XM);
+
+	sndFile.m_nSamples = 2;
+	for(SAMPLEINDEX smp = 1; smp <= 2; smp++)
+	{
+		ModSample &sample = sndFile.GetSample(smp);
+		sample.Initialize(MOD_TYPE_XM);
+		sample.uFlags.set(CHN_16BIT);
+		sample.nLength = 1000 * smp;
+		sample.AllocateSample();
+		for(SmpLength i = 0; i < sample.nLength; i++)
+		{
+			sample.sample16()[i] = mpt::random<int16>(*s_PRNG);
+		}
+	}
+
+	sndFile.Patterns.ResizeArray(1);
+	sndFile.Patterns.Insert(0, 64);
+	for(CHANNELINDEX chn = 0; chn < 2; chn++)
+	{
+		ModCommand &m = *sndFile.Patterns[0].GetpModCommand(chn * 4, chn);
+		m.note = NOTE_MIDDLEC;
+		m.instr = static_cast<ModCommand::INSTR>(chn + 1);
+	}
+	sndFile.Order().assign(1, 0);
+
+	const uint64 exact = ModFingerprint::CalculateExact(sndFile);
+	const uint64 fuzzy = ModFingerprint::CalculateFuzzy(sndFile);
+	VERIFY_EQUAL(exact != fuzzy, true);
+
+	// Names, trailing empty orders and unused effect parameters are not part of the content
+	sndFile.m_songName = "Fingerprint";
+	sndFile.m_szNames[1] = "Sample";
+	sndFile.Order().push_back();
+	sndFile.Patterns[0].GetpModCommand(1, 0)->param = 0x33;
+	VERIFY_EQUAL(ModFingerprint::CalculateExact(sndFile), exact);
+	VERIFY_EQUAL(ModFingerprint::CalculateFuzzy(sndFile), fuzzy);
+
+	// Rearranging the samples, moving the notes to other channels and splitting the pattern only keeps the fuzzy fingerprint
+	std::swap(sndFile.GetSample(1), sndFile.GetSample(2));
+	sndFile.Patterns[0].Resize(2);
+	sndFile.Patterns.Insert(1, 62);
+	sndFile.Patterns[0].ClearCommands();
+	for(CHANNELINDEX chn = 0; chn < 2; chn++)
+	{
+		ModCommand &m = *sndFile.Patterns[chn].GetpModCommand(chn * 2, 1 - chn);
+		m.note = NOTE_MIDDLEC;
+		m.instr = static_cast<ModCommand::INSTR>(2 - chn);
+	}
+	sndFile.Order().assign(1, 0);
+	sndFile.Order().push_back(1);
+	VERIFY_EQUAL(ModFingerprint::CalculateExact(sndFile) != exact, true);
+	VERIFY_EQUAL(ModFingerprint::CalculateFuzzy(sndFile), fuzzy);
+
+	// Reducing a sample to 8-bit also keeps the fuzzy fingerprint
+	{
+		ModSample &sample = sndFile.GetSample(1);
+		const std::vector<int16> sampleData(sample.sample16(), sample.sample16() + sample.nLength);
+		sample.FreeSample();
+		sample.uFlags.reset(CHN_16BIT);
+		sample.AllocateSample();
+		for(SmpLength i = 0; i < sample.nLength; i++)
+		{
+			sample.sample8()[i] = static_cast<int8>(sampleData[i] >> 8);
+		}
+	}
+	VERIFY_EQUAL(ModFingerprint::CalculateFuzzy(sndFile), fuzzy);
+
+	// Different rhythm is different music
+	std::swap(*sndFile.Patterns[1].GetpModCommand(2, 0), *sndFile.Patterns[1].GetpModCommand(6, 0));
+	VERIFY_EQUAL(ModFingerprint::CalculateFuzzy(sndFile) != fuzzy, true);
+	std::swap(*sndFile.Patterns[1].GetpModCommand(2, 0), *sndFile.Patterns[1].GetpModCommand(6, 0));
+	VERIFY_EQUAL(ModFingerprint::CalculateFuzzy(sndFile), fuzzy);
+
+	// Different notes are different music
+	sndFile.Patterns[0].GetpModCommand(0, 1)->note = NOTE_MIDDLEC + 1;
+	VERIFY_EQUAL(ModFingerprint::CalculateFuzzy(sndFile) != fuzzy, true);
+
+#ifdef MODPLUG_TRACKER
+	sndFile.Destroy();
+	modDoc->OnCloseDocument();
+#endif
+}
+
+
+static MPT_NOINLINE void TestSampleSharing()
+{
+#ifdef MODPLUG_TRACKER
+	auto modDoc1 = static_cast<CModDoc *>(theApp.GetModDocTemplate()->CreateNewDocument());
+	auto modDoc2 = static_cast<CModDoc *>(theApp.GetModDocTemplate()->CreateNewDocument());
+	auto &sndFile1 = modDoc1->GetSoundFile();
+	auto &sndFile2 = modDoc2->GetSoundFile();
+	sndFile1.Create(FileReader(), CSoundFile::loadCompleteModule, modDoc1);
+	sndFile2.Create(FileReader(), CSoundFile::loadCompleteModule, modDoc2);
+#else
+	auto pSndFile1 = std::make_unique<CSoundFile>();
+	auto pSndFile2 = std::make_unique<CSoundFile>();
+	auto &sndFile1 = *pSndFile1;
+	auto &sndFile2 = *pSndFile2;
+	sndFile1.Create(FileReader(), CSoundFile::loadCompleteModule);
+	sndFile2.Create(FileReader(), CSoundFile::loadCompleteModule);
+#endif
+	const std::size_t oldSize = SampleStore::GetSize();
+	const std::size_t oldSavedSize = SampleStore::GetSavedSize();
+
+	std::vector<int16> sampleData(1000);
+	for(auto &v : sampleData)
+	{
+		v = mpt::random<int16>(*s_PRNG);
+	}
+	const auto setSample = [&sampleData](CSoundFile &sndFile, SAMPLEINDEX smp, int16 offset)
+	{
+		sndFile.m_nSamples = std::max(sndFile.m_nSamples, smp);
+		ModSample &sample = sndFile.GetSample(smp);
+		sample.Initialize(MOD_TYPE_IT);
+		sample.uFlags.set(CHN_16BIT);
+		sample.nLength = static_cast<SmpLength>(sampleData.size());
+		sample.AllocateSample();
+		for(SmpLength i = 0; i < sample.nLength; i++)
+		{
+			sample.sample16()[i] = static_cast<int16>(sampleData[i] + offset);
+		}
+		sample.PrecomputeLoops(sndFile, false);
+		SampleStore::Share(sample);
+	};
+	const std::size_t bufferSize = ModSample::GetRealSampleBufferSize(static_cast<SmpLength>(sampleData.size()), 2);
+
+	// Identical samples within a module and across modules share one buffer
+	setSample(sndFile1, 1, 0);
+	setSample(sndFile1, 2, 1);
+	setSample(sndFile1, 3, 0);
+	setSample(sndFile2, 1, 0);
+	VERIFY_EQUAL(sndFile1.GetSample(1).samplev() == sndFile1.GetSample(3).samplev(), true);
+	VERIFY_EQUAL(sndFile1.GetSample(1).samplev() == sndFile2.GetSample(1).samplev(), true);
+	VERIFY_EQUAL(sndFile1.GetSample(1).samplev() != sndFile1.GetSample(2).samplev(), true);
+	VERIFY_EQUAL(SampleStore::GetSize(), oldSize + 2 * bufferSize);
+	VERIFY_EQUAL(SampleStore::GetSavedSize(), oldSavedSize + 2 * bufferSize);
+	std::size_t shared = 0;
+	VERIFY_EQUAL(sndFile1.GetSampleMemoryUsage(&shared), 2 * bufferSize);
+	VERIFY_EQUAL(shared, bufferSize);
+
+	// Modifying a shared sample gives it its own copy
+	sndFile1.GetSample(3).SetLoop(0, 500, true, false, sndFile1);
+	VERIFY_EQUAL(sndFile1.GetSample(1).samplev() != sndFile1.GetSample(3).samplev(), true);
+	VERIFY_EQUAL(SampleStore::GetSavedSize(), oldSavedSize + bufferSize);
+	VERIFY_EQUAL(std::equal(sampleData.begin(), sampleData.end(), sndFile1.GetSample(1).sample16()), true);
+	VERIFY_EQUAL(std::equal(sampleData.begin(), sampleData.end(), sndFile1.GetSample(3).sample16()), true);
+	// Only the new copy has a loop wrap-around buffer
+	const auto hasLoopLookahead = [&sampleData](const ModSample &sample)
+	{
+		const int16 *lookahead = sample.sample16() + sampleData.size() + InterpolationMaxLookahead;
+		return std::any_of(lookahead, lookahead + 4 * InterpolationMaxLookahead, [](int16 v) { return v != 0; });
+	};
+	VERIFY_EQUAL(hasLoopLookahead(sndFile1.GetSample(1)), false);
+	VERIFY_EQUAL(hasLoopLookahead(sndFile1.GetSample(3)), true);
+
+	// Samples that the MOD invert loop effect modifies during playback are not shared when loading
+	sndFile2.m_nType = MOD_TYPE_MOD;
+	sndFile2.m_nChannels = 4;
+	sndFile2.Patterns.ResizeArray(1);
+	sndFile2.Patterns.Insert(0, 64);
+	ModCommand &invertLoop = *sndFile2.Patterns[0].GetpModCommand(0, 0);
+	invertLoop.command = CMD_MODCMDEX;
+	invertLoop.param = 0xF0;
+	VERIFY_EQUAL(sndFile2.UsesInvertLoop(), false);
+	invertLoop.param = 0xF1;
+	VERIFY_EQUAL(sndFile2.UsesInvertLoop(), true);
+	sndFile2.m_nType = MOD_TYPE_IT;
+	VERIFY_EQUAL(sndFile2.UsesInvertLoop(), false);
+
+	// Buffers leave the store once they are no longer used by any sample
+	sndFile1.DestroySample(1);
+	VERIFY_EQUAL(SampleStore::GetSavedSize(), oldSavedSize);
+	VERIFY_EQUAL(SampleStore::IsShared(sndFile2.GetSample(1).samplev()), false);
+	VERIFY_EQUAL(std::equal(sampleData.begin(), sampleData.end(), sndFile2.GetSample(1).sample16()), true);
+	sndFile2.DestroySample(1);
+	VERIFY_EQUAL(SampleStore::GetSize(), oldSize + bufferSize);
+	sndFile1.DestroySample(2);
+	VERIFY_EQUAL(SampleStore::GetSize(), oldSize);
+
+#ifdef MODPLUG_TRACKER
+	sndFile1.Destroy();
+	sndFile2.Destroy();
+	modDoc1->OnCloseDocument();
+	modDoc2->OnCloseDocument();
+#endif
+}
+
+
+// Plugins with a known tail may only be suspended early if auto-suspend is enabled for them, and never before their tail has decayed.
+static MPT_NOINLINE void TestPluginTailSuspend()
+{
+#ifndef NO_PLUGINS
+#ifdef MODPLUG_TRACKER
+	auto modDoc = static_cast<CModDoc *>(theApp.GetModDocTemplate()->CreateNewDocument());
+	auto &sndFile = modDoc->GetSoundFile();
+	sndFile.Create(FileReader(), CSoundFile::loadCompleteModule, modDoc);
+#else
+	auto pSndFile = std::make_unique<CSoundFile>();
+	auto &sndFile = *pSndFile;
+	sndFile.Create(FileReader(), CSoundFile::loadCompleteModule);
+#endif
+	sndFile.m_nChannels = 1;
+	sndFile.m_nType = MOD_TYPE_IT;
+	sndFile.SetDefaultPlaybackBehaviour(MOD_TYPE_IT);
+	sndFile.m_nDefaultSpeed = 6;
+	sndFile.m_nDefaultTempo.Set(125);
+
+	sndFile.m_nSamples = 1;
+	ModSample &sample = sndFile.GetSample(1);
+	sample.Initialize(MOD_TYPE_IT);
+	sample.nLength = 2000;
+	sample.nC5Speed = 8363;
+	sample.AllocateSample();
+	for(SmpLength i = 0; i < sample.nLength; i++)
+	{
+		sample.sample8()[i] = mpt::random<int8>(*s_PRNG);
+	}
+
+	// Two short notes with enough silence in between for the chorus tail to decay completely
+	sndFile.Patterns.ResizeArray(1);
+	sndFile.Patterns.Insert(0, 64);
+	for(ROWINDEX row : {0, 56})
+	{
+		ModCommand &m = *sndFile.Patterns[0].GetpModCommand(row, 0);
+		m.note = NOTE_MIDDLEC;
+		m.instr = 1;
+	}
+	sndFile.Order().assign(1, 0);
+
+	sndFile.ChnSettings[0].nMixPlugin = 1;
+	SNDMIXPLUGIN &plugin = sndFile.m_MixPlugins[0];
+	plugin.Info.dwPluginId1 = kDmoMagic;
+	plugin.Info.dwPluginId2 = 0xEFE6629C;
+	plugin.Info.szLibraryName = "Chorus";
+	CreateMixPluginProc(plugin, sndFile);
+	VERIFY_EQUAL_NONCONT(plugin.pMixPlugin != nullptr, true);
+	if(plugin.pMixPlugin == nullptr)
+		return;
+	VERIFY_EQUAL_NONCONT(plugin.pMixPlugin->GetTailSize() > 0, true);
+
+	// Returns the rendered output and the frame at which the plugin was suspended, if it was suspended
+	const auto render = [&sndFile, &plugin](bool autoSuspend)
+	{
+		plugin.SetAutoSuspend(autoSuspend);
+		plugin.pMixPlugin->ResetSilence();
+		plugin.pMixPlugin->PositionChanged();
+		plugin.pMixPlugin->Resume();
+		sndFile.ResetPlayPos();
+		sndFile.InitPlayer(true);
+		sndFile.m_SongFlags.reset(SONG_ENDREACHED);
+		StemTestTarget target;
+		std::size_t suspendedAt = 0;
+		while(sndFile.Read(256, target) > 0)
+		{
+			if(!suspendedAt && (plugin.pMixPlugin->m_MixState.dwFlags & SNDMIXPLUGINSTATE::psfSilenceBypass))
+				suspendedAt = target.mix.size() / 2;
+		}
+		return std::make_pair(target.mix, suspendedAt);
+	};
+
+	// Without auto-suspend, the plugin keeps running through the silence, so that its modulation keeps going
+	const auto [processed, neverSuspended] = render(false);
+	VERIFY_EQUAL_NONCONT(neverSuspended, 0u);
+
+	// With auto-suspend, the plugin is suspended once its tail has decayed, which must not change the output up to the next note
+	const auto [suspended, suspendedAt] = render(true);
+	const std::size_t secondNote = sndFile.GetSampleRate() * 56 * 6 * 5 / (2 * 125);
+	VERIFY_EQUAL_NONCONT(suspendedAt > 0, true);
+	VERIFY_EQUAL_NONCONT(suspendedAt < secondNote, true);
+	VERIFY_EQUAL_NONCONT(processed.size(), suspended.size());
+	VERIFY_EQUAL_NONCONT(std::equal(suspended.begin(), suspended.begin() + std::min(secondNote * 2, suspended.size()), processed.begin()), true);
+
+#ifdef MODPLUG_TRACKER
+	sndFile.Destroy();
+	modDoc->OnCloseDocument();
+#endif
+#endif // NO_PLUGINS
+}
+
+
 static void RunITCompressionTest(const std::vector<int8> &sampleData, FlagSet<ChannelFlags> smpFormat, bool it215)
 {
 
@@ -4570,6 +5405,43 @@ static void RunITCompressionTest(const std::vector<int8> &sampleData, FlagSet<Ch
 		ITDecompression decompression(file, smp, it215);
 		VERIFY_EQUAL_NONCONT(memcmp(sampleData.data(), sampleDataNew.data(), sampleData.size()), 0);
 	}
+
+	// Decoding during playback must give the same result, also for truncated data and when jumping around in the sample
+	for(const std::size_t size : {data.size(), data.size() * 2 / 3})
+	{
+		FileReader file(mpt::byte_cast<mpt::const_byte_span>(mpt::as_span(data.data(), size)));
+		std::vector<int8> expected(sampleData.size(), 0);
+		smp.pData.pSample = expected.data();
+		ITDecompression decompression(file, smp, it215);
+		const FileReader::off_t dataEnd = file.GetPosition();
+
+		file.Rewind();
+		ITSampleDecoder decoder(file, smp, it215);
+		VERIFY_EQUAL_NONCONT(file.GetPosition(), dataEnd);
+
+		const std::size_t bytesPerFrame = smp.GetBytesPerSample();
+		const auto decodeRest = [&](ISampleDecoder &dec, SmpLength pos)
+		{
+			std::vector<int8> decoded(sampleData.size(), 0);
+			while(pos < smp.nLength)
+			{
+				const SmpLength count = dec.Decode(decoded.data() + pos * bytesPerFrame, std::min(smp.nLength - pos, SmpLength(3001)));
+				if(!count)
+					break;
+				pos += count;
+			}
+			return decoded;
+		};
+		VERIFY_EQUAL_NONCONT(decodeRest(decoder, 0) == expected, true);
+
+		auto skipped = decoder.Clone();
+		const SmpLength skipPos = smp.nLength / 2 + 11;
+		VERIFY_EQUAL_NONCONT(skipped->Skip(nullptr, skipPos), skipPos);
+		auto state = skipped->CloneState();
+		const std::vector<int8> decoded = decodeRest(*skipped, skipPos);
+		VERIFY_EQUAL_NONCONT(memcmp(decoded.data() + skipPos * bytesPerFrame, expected.data() + skipPos * bytesPerFrame, (smp.nLength - skipPos) * bytesPerFrame), 0);
+		VERIFY_EQUAL_NONCONT(decodeRest(*state, skipPos) == decoded, true);
+	}
 }
 
 
@@ -4592,6 +5464,220 @@ static MPT_NOINLINE void TestITCompression()
 		RunITCompressionTest(sampleData, CHN_STEREO, i == 0);
 		RunITCompressionTest(sampleData, CHN_16BIT | CHN_STEREO, i == 0);
 	}
+
+	// Decoded sample cache
+	{
+		ModSample smp;
+		smp.uFlags = CHN_16BIT;
+		smp.pData.pSample = sampleData.data();
+		smp.nLength = mpt::saturate_cast<SmpLength>(sampleData.size() / smp.GetBytesPerSample());
+		std::string data;
+		{
+			std::ostringstream f;
+			ITCompression compression(smp, true, &f);
+			data = f.str() + "end";
+		}
+		smp.pData.pSample = nullptr;
+
+		const std::size_t oldMaxSize = DecodedSampleCache::GetMaxSize();
+		DecodedSampleCache::Clear();
+		DecodedSampleCache::SetMaxSize(1 << 20);
+		const SampleIO sampleIO(SampleIO::_16bit, SampleIO::mono, SampleIO::littleEndian, SampleIO::IT215);
+		DecodedSampleCache::Key key;
+		key.fileHash = 1;
+		key.fileSize = data.size();
+		key.sampleIndex = 1;
+		for(int i = 0; i < 2; i++)
+		{
+			FileReader file(mpt::byte_cast<mpt::const_byte_span>(mpt::as_span(data)));
+			ModSample smpNew;
+			smpNew.nLength = smp.nLength;
+			DecodedSampleCache::ReadSample(sampleIO, smpNew, file, key);
+			VERIFY_EQUAL_NONCONT(smpNew.nLength, smp.nLength);
+			VERIFY_EQUAL_NONCONT(smpNew.uFlags[CHN_16BIT], true);
+			VERIFY_EQUAL_NONCONT(memcmp(sampleData.data(), smpNew.samplev(), sampleData.size()), 0);
+			VERIFY_EQUAL_NONCONT(file.BytesLeft(), 3u);
+			VERIFY_EQUAL_NONCONT(DecodedSampleCache::GetSize(), sampleData.size());
+			smpNew.FreeSample();
+		}
+		// Shrinking the cache evicts the sample
+		DecodedSampleCache::SetMaxSize(sampleData.size() - 1);
+		VERIFY_EQUAL(DecodedSampleCache::GetSize(), 0u);
+		DecodedSampleCache::SetMaxSize(oldMaxSize);
+
+		// Parallel sample decoding
+		const FileReader file(mpt::byte_cast<mpt::const_byte_span>(mpt::as_span(data)));
+		for(uint32 numThreads : {1u, 4u})
+		{
+			std::vector<ModSample> samples(8);
+			ParallelSampleReader sampleReader(file, numThreads);
+			for(auto &smpNew : samples)
+			{
+				smpNew.nLength = smp.nLength;
+				sampleReader.Add([&smpNew, sampleIO, sampleFile = sampleReader.GetChunk(0, data.size())]() mutable
+				{
+					sampleIO.ReadSample(smpNew, sampleFile);
+				});
+			}
+			sampleReader.Run();
+			for(auto &smpNew : samples)
+			{
+				VERIFY_EQUAL_NONCONT(smpNew.nLength, smp.nLength);
+				VERIFY_EQUAL_NONCONT(memcmp(sampleData.data(), smpNew.samplev(), sampleData.size()), 0);
+				smpNew.FreeSample();
+			}
+
+			bool caught = false;
+			try
+			{
+				sampleReader.Add([]() { throw std::runtime_error("test"); });
+				sampleReader.Run();
+			} catch(const std::runtime_error &)
+			{
+				caught = true;
+			}
+			VERIFY_EQUAL(caught, true);
+		}
+	}
+}
+
+
+namespace
+{
+
+// Produces a deterministic 16-bit stereo waveform in chunks of varying size, like a packet-based decoder would.
+class TestSampleDecoder : public ISampleDecoder
+{
+	SmpLength m_pos = 0;
+	const SmpLength m_length;
+	const bool m_canCopyState;
+	std::shared_ptr<SmpLength> m_decodedFrames;  // Shared between all clones
+
+public:
+	TestSampleDecoder(SmpLength length, bool canCopyState, std::shared_ptr<SmpLength> decodedFrames)
+		: m_length(length), m_canCopyState(canCopyState), m_decodedFrames(std::move(decodedFrames)) { }
+
+	static int16 Value(SmpLength frame, int channel) { return static_cast<int16>(frame * 7 + channel * 1000); }
+
+	std::unique_ptr<ISampleDecoder> Clone() const override { return std::make_unique<TestSampleDecoder>(m_length, m_canCopyState, m_decodedFrames); }
+
+	std::unique_ptr<ISampleDecoder> CloneState() const override
+	{
+		if(!m_canCopyState)
+			return nullptr;
+		auto decoder = std::make_unique<TestSampleDecoder>(m_length, m_canCopyState, m_decodedFrames);
+		decoder->m_pos = m_pos;
+		return decoder;
+	}
+
+	SmpLength Decode(void *dest, SmpLength count) override
+	{
+		count = std::min({count, m_length - m_pos, static_cast<SmpLength>(1 + m_pos % 1000)});
+		*m_decodedFrames += count;
+		int16 *out = static_cast<int16 *>(dest);
+		for(SmpLength i = 0; i < count; i++, m_pos++)
+		{
+			*out++ = Value(m_pos, 0);
+			*out++ = Value(m_pos, 1);
+		}
+		return count;
+	}
+};
+
+}  // namespace
+
+
+static MPT_NOINLINE void TestSampleStream()
+{
+	constexpr SmpLength length = 200000, encodedLength = 190000;
+	ModSample sample;
+	sample.uFlags = CHN_16BIT | CHN_STEREO;
+	sample.nLength = length;
+	auto decodedFrames = std::make_shared<SmpLength>(0);
+	auto stream = std::make_shared<SampleStream>(std::make_unique<TestSampleDecoder>(encodedLength, true, decodedFrames), sample);
+	VERIFY_EQUAL(stream->GetBytesPerFrame(), 4);
+	// Seek points are only created within the encoded data
+	VERIFY_EQUAL(stream->GetNumSeekPoints(), encodedLength / SampleStream::SeekPointInterval);
+
+	const auto checkFrames = [](const std::byte *data, int32 base, int32 first, int32 last)
+	{
+		const int16 *frames = reinterpret_cast<const int16 *>(data);
+		for(int32 frame = first; frame < last; frame++)
+		{
+			for(int channel = 0; channel < 2; channel++)
+			{
+				// The first and last frame are held outside of the sample, decoded frames are silent past the end of the encoded data.
+				const int32 heldFrame = std::clamp(frame, int32(0), static_cast<int32>(length - 1));
+				const int16 expected = (heldFrame < static_cast<int32>(encodedLength)) ? TestSampleDecoder::Value(heldFrame, channel) : 0;
+				if(frames[(frame - base) * 2 + channel] != expected)
+					return false;
+			}
+		}
+		return true;
+	};
+
+	SampleStreamCursor cursor;
+	int32 base = 0;
+	// Forward playback in mixer-sized chunks, crossing the sample boundaries
+	for(int32 pos = -20; pos < static_cast<int32>(length) + 20; pos += 3000)
+	{
+		const std::byte *data = cursor.Prepare(stream, pos, pos + 3033, base);
+		VERIFY_EQUAL_NONCONT(base <= pos, true);
+		VERIFY_EQUAL_NONCONT(checkFrames(data, base, pos, pos + 3033), true);
+	}
+	// Backward playback
+	for(int32 pos = static_cast<int32>(length) + 20; pos > -20; pos -= 3000)
+	{
+		const std::byte *data = cursor.Prepare(stream, pos - 3033, pos, base);
+		VERIFY_EQUAL_NONCONT(checkFrames(data, base, pos - 3033, pos), true);
+	}
+	// Random seeking
+	uint32 rng = 1;
+	for(int i = 0; i < 100; i++)
+	{
+		rng = rng * 1103515245u + 12345u;
+		const int32 first = static_cast<int32>((rng >> 8) % (length + 100)) - 50;
+		rng = rng * 1103515245u + 12345u;
+		const int32 last = first + 1 + static_cast<int32>((rng >> 8) % 20000);
+		const std::byte *data = cursor.Prepare(stream, first, last, base);
+		VERIFY_EQUAL_NONCONT(checkFrames(data, base, first, last), true);
+	}
+	VERIFY_EQUAL(cursor.GetMemoryUsage(), SampleStreamCursor::WindowLength * 4u);
+	VERIFY_EQUAL(stream->GetCacheSize(), 0u);
+
+	// Jumping backwards continues decoding at the closest seek point instead of the sample start
+	for(const bool canCopyState : {true, false})
+	{
+		auto seekStream = std::make_shared<SampleStream>(std::make_unique<TestSampleDecoder>(encodedLength, canCopyState, decodedFrames), sample);
+		VERIFY_EQUAL(seekStream->GetNumSeekPoints(), canCopyState ? 1u : 0u);
+		SampleStreamCursor seekCursor;
+		const int32 seekPoint = SampleStream::SeekPointInterval;
+		seekCursor.Prepare(seekStream, seekPoint + 65000, seekPoint + 68000, base);
+		*decodedFrames = 0;
+		// When jumping, the new window ends at the last requested frame
+		const std::byte *seekData = seekCursor.Prepare(seekStream, seekPoint + 31000, seekPoint + 34000, base);
+		VERIFY_EQUAL(base, seekPoint + 34000 - static_cast<int32>(SampleStreamCursor::WindowLength));
+		VERIFY_EQUAL(checkFrames(seekData, base, seekPoint + 31000, seekPoint + 34000), true);
+		VERIFY_EQUAL(*decodedFrames, (canCopyState ? 0u : SampleStream::SeekPointInterval) + 34000u);
+	}
+
+	// Loops are decoded once, including the interpolation lookahead around them
+	sample.uFlags.set(CHN_LOOP);
+	sample.nLoopStart = 150000;
+	sample.nLoopEnd = 160000;
+	stream->UpdateLoopCache(sample);
+	VERIFY_EQUAL(stream->GetCacheSize(), (10000u + 2u * (InterpolationMaxLookahead + 1u) + 4u * InterpolationMaxLookahead) * 4u);
+	VERIFY_EQUAL(stream->GetCachedLoop(false) != nullptr, true);
+	VERIFY_EQUAL(stream->GetCachedLoop(true) == nullptr, true);
+	VERIFY_EQUAL(checkFrames(stream->GetCachedLoop(false), 150000, 150000, 160000), true);
+	const std::byte *data = cursor.Prepare(stream, 150000 - InterpolationMaxLookahead, 160000 + InterpolationMaxLookahead, base);
+	VERIFY_EQUAL(base, static_cast<int32>(150000 - InterpolationMaxLookahead - 1));
+	VERIFY_EQUAL(checkFrames(data, base, 150000 - InterpolationMaxLookahead, 160000 + InterpolationMaxLookahead), true);
+	// Loops longer than the limit are not cached
+	sample.nLoopStart = 0;
+	sample.nLoopEnd = SampleStream::MaxCachedLoopLength + 1;
+	stream->UpdateLoopCache(sample);
+	VERIFY_EQUAL(stream->GetCacheSize(), 0u);
 }
 
 
@@ -4637,9 +5723,47 @@ static void CheckEqualTuningCollections(const CTuningCollection &a, const CTunin
 
 static MPT_NOINLINE void TestTunings()
 {
+	using namespace Tuning;
 
-	// nothing for now
+	// General tuning with geometric finestepping between arbitrary note ratios
+	{
+		std::unique_ptr<CTuning> tuning = CTuning::CreateGeneral(U_("test"));
+		for(NOTEINDEXTYPE note = -64; note < 64; note++)
+		{
+			tuning->SetRatio(note, static_cast<RATIOTYPE>(std::pow(2.0, note / 7.0)));
+		}
+		tuning->SetFineStepCount(3);
+		VERIFY_EQUAL_EPS(tuning->GetRatio(0, 2), std::sqrt(tuning->GetRatio(0) * tuning->GetRatio(1)), 0.0001);
+		VERIFY_EQUAL(tuning->GetRatio(0, 4), tuning->GetRatio(1));
+		VERIFY_EQUAL(tuning->GetRatio(0, -1), tuning->GetRatio(-1, 3));
+		VERIFY_EQUAL(tuning->GetRatio(63, 4), CTuning::s_DefaultFallbackRatio);
+		VERIFY_EQUAL(tuning->GetRatio(-64, -1), CTuning::s_DefaultFallbackRatio);
+
+		// Changing ratios must be reflected in finestep ratios as well
+		const RATIOTYPE fineRatio = tuning->GetRatio(5, 1);
+		tuning->Multiply(2);
+		VERIFY_EQUAL_EPS(tuning->GetRatio(5, 1), fineRatio * 2, 0.0001);
+		tuning->SetRatio(6, tuning->GetRatio(5));
+		VERIFY_EQUAL(tuning->GetRatio(5, 1), tuning->GetRatio(5));
+	}
 
+	// Geometric tuning
+	{
+		std::unique_ptr<CTuning> tuning = CTuning::CreateGeometric(U_("test"), 12, 2, 15);
+		VERIFY_EQUAL_EPS(tuning->GetRatio(0, 8), std::pow(2.0, 0.5 / 12.0), 0.0001);
+		VERIFY_EQUAL_EPS(tuning->GetRatio(12, -8), std::pow(2.0, 11.5 / 12.0), 0.0001);
+		VERIFY_EQUAL(tuning->GetRatio(3, 16), tuning->GetRatio(4));
+		tuning->SetFineStepCount(0);
+		VERIFY_EQUAL(tuning->GetRatio(3, 1), tuning->GetRatio(4));
+	}
+
+	// Group-geometric tuning
+	{
+		std::unique_ptr<CTuning> tuning = CTuning::CreateGroupGeometric(U_("test"), std::vector<RATIOTYPE>{1.0f, 1.25f, 1.5f}, 2, 1);
+		VERIFY_EQUAL_EPS(tuning->GetRatio(1, 1), std::sqrt(1.25 * 1.5), 0.0001);
+		VERIFY_EQUAL_EPS(tuning->GetRatio(2, 1), std::sqrt(1.5 * 2.0), 0.0001);
+		VERIFY_EQUAL_EPS(tuning->GetRatio(3, 3), 2.0 * std::sqrt(1.25 * 1.5), 0.0001);
+	}
 }
 
 
@@ -5253,6 +6377,62 @@ static MPT_NOINLINE void TestSampleConversion()
 		}
 	}
 
+	// Block converters must produce exactly the same output as the scalar conversion functors
+	{
+		constexpr std::size_t count = 1031;
+		mpt::default_prng &prng = *s_PRNG;
+		for(std::size_t i = 0; i < count * 4 * 2; i++)
+		{
+			sourceBuf[i] = mpt::random<uint8>(prng);
+		}
+		// Converting NaN or infinity to integer is undefined, so avoid them in either byte order
+		for(std::size_t i = 0; i < count * 4 * 2; i += 4)
+		{
+			sourceBuf[i] &= 0xBF;
+			sourceBuf[i + 3] &= 0xBF;
+		}
+		// Sprinkle in some valid floats, including values that need clipping and rounding
+		for(std::size_t i = 0; i < count * 2; i += 3)
+		{
+			IEEE754binary32LE floatbits = IEEE754binary32LE(static_cast<float>(mpt::random<int32>(prng) % 70000) / 65536.0f);
+			for(std::size_t b = 0; b < 4; b++)
+			{
+				sourceBuf[i * 4 + b] = mpt::byte_cast<uint8>(floatbits.GetByte(b));
+			}
+		}
+		const std::byte *source = mpt::byte_cast<const std::byte *>(sourceBuf);
+
+		auto testFormat = [&](auto conv)
+		{
+			using SampleConversion = decltype(conv);
+			using output_t = typename SampleConversion::output_t;
+			constexpr SampleBlockFormat format = SampleBlockConverter<SampleConversion>::format;
+			output_t *expected = static_cast<output_t *>(targetBuf);
+			output_t *mono = expected + count * 2;
+			output_t *split = mono + count * 2;
+			CopySample<SampleConversion>(expected, count * 2, 1, source, count * 2 * SampleConversion::input_inc, 1);
+			ConvertSampleBlock(format, source, mono, count * 2);
+			VERIFY_EQUAL_NONCONT(memcmp(expected, mono, count * 2 * sizeof(output_t)), 0);
+
+			CopySample<SampleConversion>(expected, count, 2, source, count * SampleConversion::input_inc, 1);
+			CopySample<SampleConversion>(expected + 1, count, 2, source + count * SampleConversion::input_inc, count * SampleConversion::input_inc, 1);
+			ConvertSampleBlockStereoSplit(format, source, source + count * SampleConversion::input_inc, split, count);
+			VERIFY_EQUAL_NONCONT(memcmp(expected, split, count * 2 * sizeof(output_t)), 0);
+		};
+		testFormat(SC::DecodeInt8{});
+		testFormat(SC::DecodeUint8{});
+		testFormat(SC::DecodeInt16<0, littleEndian16>{});
+		testFormat(SC::DecodeInt16<0, bigEndian16>{});
+		testFormat(SC::DecodeInt16<0x8000u, littleEndian16>{});
+		testFormat(SC::DecodeInt16<0x8000u, bigEndian16>{});
+		testFormat(SC::ConversionChain<SC::Convert<int16, int32>, SC::DecodeInt24<0, littleEndian24>>{});
+		testFormat(SC::ConversionChain<SC::Convert<int16, int32>, SC::DecodeInt24<0, bigEndian24>>{});
+		testFormat(SC::ConversionChain<SC::Convert<int16, int32>, SC::DecodeInt32<0, littleEndian32>>{});
+		testFormat(SC::ConversionChain<SC::Convert<int16, int32>, SC::DecodeInt32<0, bigEndian32>>{});
+		testFormat(SC::ConversionChain<SC::Convert<int16, float32>, SC::DecodeFloat32<littleEndian32>>{});
+		testFormat(SC::ConversionChain<SC::Convert<int16, float32>, SC::DecodeFloat32<bigEndian32>>{});
+	}
+
 	// ALaw
 	{
 		for(unsigned int i = 0; i < 256; ++i)
@@ -5409,6 +6589,60 @@ static MPT_NOINLINE void TestSampleConversion()
 			VERIFY_EQUAL_QUIET_NONCONT(buffer[i], expected[i]);
 		}
 	}
+
+	// Block-wise dithering and output conversion must match the per-sample reference
+	{
+		constexpr std::size_t channels = 3, frames = 37, chunks = 3;
+		std::vector<MixSampleInt> mixInput(channels * frames * chunks);
+		for(std::size_t i = 0; i < mixInput.size(); ++i)
+		{
+			mixInput[i] = static_cast<MixSampleInt>((i * 0x2F3A9B1u) ^ (i << 20)) >> (i % 5);
+		}
+		mixInput[0] = std::numeric_limits<int32>::max() / 2;
+		mixInput[1] = std::numeric_limits<int32>::min() / 2;
+
+		// Renders mixInput through AudioReadTargetBuffer and through ConvertBufferMixFixedToBuffer, using identically seeded dithers
+		auto testConversion = [&](DitherMode mode, auto makeBuffer, auto *sampleTag)
+		{
+			using Tsample = std::remove_pointer_t<decltype(sampleTag)>;
+			mpt::deterministic_good_prng rdRef(0x1234u), rdBlock(0x1234u);
+			Dither ditherRef(rdRef), ditherBlock(rdBlock);
+			ditherRef.SetMode(mode);
+			ditherBlock.SetMode(mode);
+			ditherRef.SetChannels(channels);
+			ditherBlock.SetChannels(channels);
+
+			std::vector<Tsample> outRef(channels * frames * chunks), outBlock(channels * frames * chunks);
+			std::vector<Tsample *> planesRef, planesBlock;
+			for(std::size_t channel = 0; channel < channels; ++channel)
+			{
+				planesRef.push_back(outRef.data() + channel * frames * chunks);
+				planesBlock.push_back(outBlock.data() + channel * frames * chunks);
+			}
+			const auto bufferRef = makeBuffer(outRef.data(), planesRef.data());
+			AudioReadTargetBuffer<std::remove_const_t<decltype(bufferRef)>> target(makeBuffer(outBlock.data(), planesBlock.data()), ditherBlock);
+			for(std::size_t chunk = 0; chunk < chunks; ++chunk)
+			{
+				std::vector<MixSampleInt> mixBuffer(mixInput.begin() + chunk * channels * frames, mixInput.begin() + (chunk + 1) * channels * frames);
+				ditherRef.WithDither([&](auto &ditherInstance)
+					{
+						ConvertBufferMixFixedToBuffer<MixSampleIntTraits::mix_fractional_bits, false>(make_audio_buffer_with_offset(bufferRef, chunk * frames), audio_buffer_interleaved<MixSampleInt>(mixBuffer.data(), channels, frames), ditherInstance, channels, frames);
+					});
+				target.DataCallback(mixBuffer.data(), channels, frames);
+			}
+			VERIFY_EQUAL_NONCONT(target.GetRenderedCount(), frames * chunks);
+			VERIFY_EQUAL_NONCONT(outRef == outBlock, true);
+		};
+		auto interleaved = [&](auto *interleavedBuf, auto **) { return audio_buffer_interleaved<std::remove_pointer_t<decltype(interleavedBuf)>>(interleavedBuf, channels, frames * chunks); };
+		auto planar = [&](auto *interleavedBuf, auto **planes) { return audio_buffer_planar<std::remove_pointer_t<decltype(interleavedBuf)>>(planes, channels, frames * chunks); };
+		for(DitherMode mode : {DitherNone, DitherModPlug, DitherSimple})
+		{
+			testConversion(mode, interleaved, static_cast<int16 *>(nullptr));
+			testConversion(mode, planar, static_cast<int16 *>(nullptr));
+			testConversion(mode, interleaved, static_cast<float *>(nullptr));
+			testConversion(mode, planar, static_cast<float *>(nullptr));
+		}
+	}
 }
 
 
@@ -13,12 +13,18 @@
 
 #include "BuildSettings.h"
 
+#include <string>
+#include <vector>
+
 OPENMPT_NAMESPACE_BEGIN
 
 namespace Test {
 
 void DoTests();
 
+// Runs the benchmarks with the given names, or all of them if names is empty (see benchmark.cpp)
+void DoBenchmarks(const std::vector<std::string> &names);
+
 } // namespace Test
 
 OPENMPT_NAMESPACE_END